@@ -0,0 +1,487 @@
+// file ducc_bench.cc
+
+/*
+Stand-alone C++ benchmarks for the computational kernels of DUCC
+(FFT, NUFFT of types 1-3, associated Legendre transforms of the SHT, and the wgridder).
+
+In contrast to the Python demo scripts, these measurements contain no
+binding overhead and can be run without a Python installation.
+
+Compilation: (the -I path must point to the src/ directory in the ducc0 checkout)
+
+g++ -O3 -march=native -ffast-math -I ../src/ ducc_bench.cc -Wfatal-errors -pthread -std=c++17 -o ducc_bench
+
+Usage:
+
+ducc_bench [--filter STR] [--threads N1,N2,...] [--min-time SECONDS]
+           [--format text|csv|json] [--output FILE] [--list]
+           [--nufft-log2tile L1,L2,...]
+
+--filter    only run benchmarks whose name contains STR (may be repeated)
+--threads   comma-separated list of thread counts (default: 1 and the
+            maximum number of threads available)
+--min-time  minimum accumulated run time per measurement (default: 0.5)
+--format    output format (default: text)
+--output    write the results to FILE instead of standard output
+--list      only print the names of the available benchmarks
+--nufft-log2tile  comma-separated list of tile sizes (base-2 logarithms,
+            0 for the automatic choice) for which the type 1 and 2 NUFFT
+            benchmarks are run (default: 0)
+
+Every benchmark is run once for warm-up (this also fills the FFT plan cache)
+and then repeated until --min-time has elapsed, but at least three times.
+The reported "rate" is the nominal amount of work (given in "unit") divided
+by the fastest run.
+*/
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <numeric>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "ducc0/infra/string_utils.cc"
+#include "ducc0/infra/threading.cc"
+#include "ducc0/infra/mav.cc"
+#include "ducc0/infra/system.cc"
+#include "ducc0/math/gl_integrator.cc"
+#include "ducc0/math/gridding_kernel.cc"
+#include "ducc0/infra/timers.h"
+#include "ducc0/fft/fft.h"
+#include "ducc0/nufft/nufft.h"
+#include "ducc0/sht/sht.cc"
+#include "ducc0/wgridder/wgridder.h"
+
+using namespace ducc0;
+using namespace std;
+using shape_t = fmav_info::shape_t;
+
+namespace {
+
+struct Benchmark
+  {
+  string name, params;
+  double work;  // nominal amount of work per call, in units of "unit"
+  string unit;
+  // prepares the data and returns a function carrying out one call
+  function<function<void()>(size_t nthreads)> setup;
+  };
+
+struct Result
+  {
+  const Benchmark *bench;
+  size_t nthreads, nrep;
+  double tmin, tmedian, tmean;
+  };
+
+template<typename T> void fill_random(T *ptr, size_t n, double lo, double hi,
+  unsigned seed)
+  {
+  mt19937 rng(seed);
+  uniform_real_distribution<double> dist(lo, hi);
+  for (size_t i=0; i<n; ++i)
+    {
+    if constexpr (is_floating_point<T>::value)
+      ptr[i] = T(dist(rng));
+    else
+      ptr[i] = T(dist(rng), dist(rng));
+    }
+  }
+
+string shape_str(const shape_t &shp)
+  {
+  ostringstream os;
+  for (size_t i=0; i<shp.size(); ++i)
+    os << (i ? "x" : "") << shp[i];
+  return os.str();
+  }
+
+double fft_flops(const shape_t &shp, double fct)
+  {
+  double n=1;
+  for (auto s: shp) n*=double(s);
+  return fct*n*log2(n)*1e-9;
+  }
+
+template<typename T> void add_fft_benchmarks(vector<Benchmark> &res,
+  const string &tname)
+  {
+  // length classes: powers of two, other smooth lengths, and lengths with
+  // large prime factors (Bluestein algorithm)
+  const vector<pair<string, shape_t>> c2c_cases
+    {{"pow2", {4096}}, {"pow2", {1<<20}},
+     {"smooth", {10395}}, {"smooth", {240240}},
+     {"prime", {10007}}, {"prime", {100003}},
+     {"pow2", {1024, 1024}}, {"smooth", {1000, 1000}}, {"pow2", {128, 128, 128}}};
+  for (const auto &[cls, shp]: c2c_cases)
+    res.push_back({"fft/c2c/"+tname, cls+" "+shape_str(shp),
+      fft_flops(shp, 5.), "GFlop", [shp=shp](size_t nthreads)
+      {
+      auto arr = make_shared<vfmav<complex<T>>>(shp);
+      fill_random(arr->data(), arr->size(), -1, 1, 42);
+      shape_t axes(shp.size());
+      iota(axes.begin(), axes.end(), 0);
+      return [arr, axes, nthreads]()
+        { c2c(*arr, *arr, axes, true, T(1), nthreads); };
+      }});
+
+  const vector<pair<string, shape_t>> r2c_cases
+    {{"pow2", {1<<20}}, {"smooth", {240240}}, {"prime", {100003}},
+     {"pow2", {2048, 2048}}};
+  for (const auto &[cls, shp]: r2c_cases)
+    res.push_back({"fft/r2c/"+tname, cls+" "+shape_str(shp),
+      fft_flops(shp, 2.5), "GFlop", [shp=shp](size_t nthreads)
+      {
+      auto in = make_shared<vfmav<T>>(shp);
+      fill_random(in->data(), in->size(), -1, 1, 42);
+      auto shp2 = shp;
+      shp2.back() = shp.back()/2+1;
+      auto out = make_shared<vfmav<complex<T>>>(shp2);
+      shape_t axes(shp.size());
+      iota(axes.begin(), axes.end(), 0);
+      return [in, out, axes, nthreads]()
+        { r2c(*in, *out, axes, true, T(1), nthreads); };
+      }});
+  }
+
+template<size_t ndim> void add_nufft_benchmark(vector<Benchmark> &res,
+  const array<size_t,ndim> &shp, size_t npoints, double epsilon,
+  const vector<int> &log2tiles)
+  {
+  for (int log2tile: log2tiles)
+    for (bool type1: {true, false})
+      {
+      ostringstream params;
+      params << shape_str(shape_t(shp.begin(), shp.end())) << " npoints="
+             << npoints << " eps=" << epsilon;
+      if (log2tile!=0) params << " log2tile=" << log2tile;
+      res.push_back({string("nufft/")+(type1 ? "nu2u" : "u2nu")+"/"
+        +to_string(ndim)+"d", params.str(), double(npoints)*1e-6, "Mpoint",
+        [shp, npoints, epsilon, type1, log2tile](size_t nthreads)
+          -> function<void()>
+        {
+        vmav<double,2> coord({npoints, ndim});
+        fill_random(coord.data(), coord.size(), -pi, pi, 42);
+        auto points = make_shared<vmav<complex<double>,1>>(array<size_t,1>{npoints});
+        fill_random(points->data(), npoints, -1, 1, 43);
+        auto grid = make_shared<vmav<complex<double>,ndim>>(shp);
+        fill_random(grid->data(), grid->size(), -1, 1, 44);
+        auto plan = make_shared<Nufft<double, double, double, ndim>>(type1,
+          coord, shp, epsilon, nthreads, 1.1, 2.6, 2*pi, false);
+        if (log2tile!=0) plan->set_log2tile(log2tile);
+        if (type1)
+          return [plan, points, grid]()
+            { plan->nu2u(true, 0, *points, *grid); };
+        return [plan, points, grid]()
+          { plan->u2nu(true, 0, *grid, *points); };
+        }});
+      }
+  }
+
+template<size_t ndim> void add_nufft3_benchmark(vector<Benchmark> &res,
+  size_t npoints, double xmax, double smax, double epsilon)
+  {
+  ostringstream params;
+  params << "npoints=" << npoints << " |x|<=" << xmax << " |s|<=" << smax
+         << " eps=" << epsilon;
+  res.push_back({"nufft/nu2nu/"+to_string(ndim)+"d", params.str(),
+    double(npoints)*1e-6, "Mpoint",
+    [npoints, xmax, smax, epsilon](size_t nthreads) -> function<void()>
+    {
+    vmav<double,2> coord_in({npoints, ndim}), coord_out({npoints, ndim});
+    fill_random(coord_in.data(), coord_in.size(), -xmax, xmax, 42);
+    fill_random(coord_out.data(), coord_out.size(), -smax, smax, 43);
+    auto points_in = make_shared<vmav<complex<double>,1>>(array<size_t,1>{npoints});
+    fill_random(points_in->data(), npoints, -1, 1, 44);
+    auto points_out = make_shared<vmav<complex<double>,1>>(array<size_t,1>{npoints});
+    auto plan = make_shared<Nufft3<double, double, double, ndim>>(coord_in,
+      coord_out, epsilon, nthreads, 1.1, 2.6);
+    return [plan, points_in, points_out]()
+      { plan->nu2nu(true, 0, *points_in, *points_out); };
+    }});
+  }
+
+void add_sht_benchmarks(vector<Benchmark> &res)
+  {
+  for (size_t lmax: {511, 2047})
+    for (bool synthesis: {true, false})
+      {
+      size_t nalm = ((lmax+1)*(lmax+2))/2, nrings = lmax+1;
+      res.push_back({synthesis ? "sht/alm2leg" : "sht/leg2alm",
+        "lmax="+to_string(lmax)+" spin=0 nrings="+to_string(nrings),
+        double(nalm)*double(nrings)*1e-9, "Gterm",
+        [lmax, nalm, nrings, synthesis](size_t nthreads) -> function<void()>
+        {
+        auto mval = make_shared<vmav<size_t,1>>(array<size_t,1>{lmax+1});
+        auto mstart = make_shared<vmav<size_t,1>>(array<size_t,1>{lmax+1});
+        for (size_t m=0; m<=lmax; ++m)
+          {
+          (*mval)(m) = m;
+          (*mstart)(m) = (m*(2*lmax+1-m))/2;
+          }
+        auto theta = make_shared<vmav<double,1>>(array<size_t,1>{nrings});
+        for (size_t i=0; i<nrings; ++i)
+          (*theta)(i) = pi*(i+0.5)/double(nrings);
+        auto alm = make_shared<vmav<complex<double>,2>>(array<size_t,2>{1, nalm});
+        fill_random(alm->data(), nalm, -1, 1, 42);
+        for (size_t m=0; m<=lmax; ++m)  // a_l0 must be real
+          (*alm)(0, (*mstart)(0)+m).imag(0.);
+        auto leg = make_shared<vmav<complex<double>,3>>
+          (array<size_t,3>{1, nrings, lmax+1});
+        fill_random(leg->data(), leg->size(), -1, 1, 43);
+        if (synthesis)
+          return [=]()
+            {
+            alm2leg(cmav<complex<double>,2>(*alm), *leg, 0, lmax, *mval,
+              *mstart, 1, *theta, nthreads);
+            };
+        return [=]()
+          {
+          leg2alm(*alm, cmav<complex<double>,3>(*leg), 0, lmax, *mval,
+            *mstart, 1, *theta, nthreads);
+          };
+        }});
+      }
+  }
+
+void add_wgridder_benchmarks(vector<Benchmark> &res)
+  {
+  constexpr size_t nrow=100000, nchan=16, npix=1024;
+  constexpr double epsilon=1e-5;
+  for (bool adjoint: {true, false})
+    {
+    ostringstream params;
+    params << "npix=" << npix << "x" << npix << " nvis=" << nrow*nchan
+           << " eps=" << epsilon;
+    res.push_back({adjoint ? "wgridder/ms2dirty" : "wgridder/dirty2ms",
+      params.str(), double(nrow*nchan)*1e-6, "Mvis",
+      [adjoint](size_t nthreads) -> function<void()>
+      {
+      constexpr double speedoflight = 299792458.;
+      double fov = 2.*pi/180.;  // 2 degrees
+      double pixsize = fov/npix;
+      auto freq = make_shared<vmav<double,1>>(array<size_t,1>{nchan});
+      for (size_t i=0; i<nchan; ++i)
+        (*freq)(i) = 1e9 + 1e6*double(i);
+      // longest baseline in wavelengths must stay below 1/(2*pixsize)
+      double maxuv = 0.45/pixsize * speedoflight/(*freq)(nchan-1);
+      auto uvw = make_shared<vmav<double,2>>(array<size_t,2>{nrow, 3});
+      fill_random(uvw->data(), uvw->size(), -maxuv, maxuv, 42);
+      for (size_t i=0; i<nrow; ++i)
+        (*uvw)(i,2) *= 0.1;
+      auto ms = make_shared<vmav<complex<float>,2>>(array<size_t,2>{nrow, nchan});
+      fill_random(ms->data(), ms->size(), -1, 1, 43);
+      auto dirty = make_shared<vmav<float,2>>(array<size_t,2>{npix, npix});
+      fill_random(dirty->data(), dirty->size(), -1, 1, 44);
+      auto wgt = make_shared<vmav<float,2>>(vmav<float,2>::build_empty());
+      auto mask = make_shared<vmav<uint8_t,2>>(vmav<uint8_t,2>::build_empty());
+      if (adjoint)
+        return [=]()
+          {
+          ms2dirty<float, float>(*uvw, *freq, *ms, *wgt, *mask, pixsize,
+            pixsize, epsilon, true, nthreads, *dirty, 0);
+          };
+      return [=]()
+        {
+        dirty2ms<float, float>(*uvw, *freq, *dirty, *wgt, *mask, pixsize,
+          pixsize, epsilon, true, nthreads, *ms, 0);
+        };
+      }});
+    }
+  }
+
+vector<Benchmark> all_benchmarks(const vector<int> &nufft_log2tiles)
+  {
+  vector<Benchmark> res;
+  add_fft_benchmarks<double>(res, "f64");
+  add_fft_benchmarks<float>(res, "f32");
+  add_nufft_benchmark<1>(res, {1000000}, 1000000, 1e-6, nufft_log2tiles);
+  add_nufft_benchmark<2>(res, {1024, 1024}, 1000000, 1e-6, nufft_log2tiles);
+  add_nufft_benchmark<3>(res, {128, 128, 128}, 1000000, 1e-6,
+    nufft_log2tiles);
+  // large kernel support, where the local buffers may exceed the cache
+  add_nufft_benchmark<3>(res, {64, 64, 64}, 1000000, 1e-12, nufft_log2tiles);
+  add_nufft3_benchmark<1>(res, 1000000, 1000., 500., 1e-6);
+  add_nufft3_benchmark<2>(res, 1000000, 30., 30., 1e-6);
+  add_nufft3_benchmark<3>(res, 1000000, 8., 8., 1e-6);
+  add_sht_benchmarks(res);
+  add_wgridder_benchmarks(res);
+  return res;
+  }
+
+Result run(const Benchmark &bench, size_t nthreads, double min_time)
+  {
+  auto func = bench.setup(nthreads);
+  func();  // warm-up
+  vector<double> times;
+  SimpleTimer total;
+  while ((times.size()<3) || (total()<min_time))
+    {
+    SimpleTimer t;
+    func();
+    times.push_back(t());
+    }
+  Result res{&bench, nthreads, times.size(), 0., 0., 0.};
+  res.tmean = accumulate(times.begin(), times.end(), 0.)/double(times.size());
+  sort(times.begin(), times.end());
+  res.tmin = times[0];
+  res.tmedian = times[times.size()/2];
+  return res;
+  }
+
+string json_escape(const string &s)
+  {
+  string res;
+  for (auto c: s)
+    {
+    if ((c=='"') || (c=='\\')) res += '\\';
+    res += c;
+    }
+  return res;
+  }
+
+void write_header(ostream &os, const string &format)
+  {
+  if (format=="csv")
+    os << "name,params,nthreads,nrep,t_min,t_median,t_mean,rate,unit\n";
+  else if (format=="json")
+    os << "[";
+  else
+    os << left << setw(22) << "name" << setw(42) << "params" << right
+       << setw(4) << "nth" << setw(6) << "nrep" << setw(13) << "t_min[s]"
+       << setw(13) << "t_median[s]" << setw(11) << "rate" << "  unit/s\n";
+  }
+
+void write_result(ostream &os, const string &format, const Result &r,
+  bool first)
+  {
+  const auto &b(*r.bench);
+  double rate = b.work/r.tmin;
+  if (format=="csv")
+    os << b.name << ",\"" << b.params << "\"," << r.nthreads << "," << r.nrep
+       << "," << r.tmin << "," << r.tmedian << "," << r.tmean << "," << rate
+       << "," << b.unit << "/s\n";
+  else if (format=="json")
+    os << (first ? "\n" : ",\n") << "  {\"name\": \"" << json_escape(b.name)
+       << "\", \"params\": \"" << json_escape(b.params)
+       << "\", \"nthreads\": " << r.nthreads << ", \"nrep\": " << r.nrep
+       << ", \"t_min\": " << r.tmin << ", \"t_median\": " << r.tmedian
+       << ", \"t_mean\": " << r.tmean << ", \"rate\": " << rate
+       << ", \"unit\": \"" << b.unit << "/s\"}";
+  else
+    os << left << setw(22) << b.name << setw(42) << b.params << right
+       << setw(4) << r.nthreads << setw(6) << r.nrep << setw(13) << r.tmin
+       << setw(13) << r.tmedian << setw(11) << rate << "  " << b.unit << "/s\n";
+  os.flush();
+  }
+
+void write_footer(ostream &os, const string &format)
+  {
+  if (format=="json")
+    os << "\n]\n";
+  }
+
+} // unnamed namespace
+
+int main(int argc, const char **argv)
+  {
+  try
+    {
+    vector<string> filters;
+    vector<size_t> nthreads{1};
+    vector<int> nufft_log2tiles{0};
+    if (max_threads()>1) nthreads.push_back(max_threads());
+    double min_time=0.5;
+    string format="text", outname;
+    bool list=false;
+    for (int i=1; i<argc; ++i)
+      {
+      string arg(argv[i]);
+      auto value = [&]() -> string
+        {
+        MR_assert(i+1<argc, "missing value for option ", arg);
+        return argv[++i];
+        };
+      if (arg=="--filter")
+        filters.push_back(value());
+      else if (arg=="--threads")
+        {
+        auto tmp = value();
+        replace(tmp.begin(), tmp.end(), ',', ' ');
+        istringstream is(tmp);
+        nthreads.clear();
+        for (size_t n; is >> n;)
+          nthreads.push_back(n);
+        }
+      else if (arg=="--min-time")
+        min_time = stringToData<double>(value());
+      else if (arg=="--format")
+        format = value();
+      else if (arg=="--output")
+        outname = value();
+      else if (arg=="--list")
+        list = true;
+      else if (arg=="--nufft-log2tile")
+        {
+        auto tmp = value();
+        replace(tmp.begin(), tmp.end(), ',', ' ');
+        istringstream is(tmp);
+        nufft_log2tiles.clear();
+        for (int n; is >> n;)
+          nufft_log2tiles.push_back(n);
+        }
+      else
+        MR_fail("unknown option ", arg);
+      }
+    MR_assert((format=="text")||(format=="csv")||(format=="json"),
+      "unknown output format ", format);
+    MR_assert(!nthreads.empty(), "no thread counts given");
+    MR_assert(!nufft_log2tiles.empty(), "no tile sizes given");
+
+    auto benches = all_benchmarks(nufft_log2tiles);
+    vector<const Benchmark *> selected;
+    for (const auto &b: benches)
+      {
+      bool match = filters.empty();
+      for (const auto &f: filters)
+        match = match || (b.name.find(f)!=string::npos);
+      if (match) selected.push_back(&b);
+      }
+    if (list)
+      {
+      for (auto b: selected)
+        cout << b->name << "  " << b->params << "\n";
+      return 0;
+      }
+
+    ofstream ofs;
+    if (!outname.empty())
+      {
+      ofs.open(outname);
+      MR_assert(ofs.good(), "could not open output file ", outname);
+      }
+    ostream &os(outname.empty() ? cout : ofs);
+    write_header(os, format);
+    bool first=true;
+    for (auto b: selected)
+      for (auto nth: nthreads)
+        {
+        write_result(os, format, run(*b, nth, min_time), first);
+        first=false;
+        }
+    write_footer(os, format);
+    }
+  catch (const exception &e)
+    {
+    cerr << e.what() << endl;
+    return 1;
+    }
+  return 0;
+  }
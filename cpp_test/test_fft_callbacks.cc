@@ -0,0 +1,258 @@
+/*
+ *  This file is part of DUCC.
+ *
+ *  DUCC is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  DUCC is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with DUCC; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+/*
+ *  Copyright (C) 2023 Max-Planck-Society
+ */
+
+/* Tests of the load and store callbacks of c2c(), r2r_fftpack() and
+   c2c_pruned(). The callbacks multiply every value by a factor depending
+   on its offset and its index along the transformed axis; the result is
+   compared to the unmodified transform of the explicitly multiplied input,
+   explicitly multiplied afterwards. */
+
+#include <sstream>
+#include "ducc0/infra/string_utils.cc"
+#include "ducc0/infra/threading.cc"
+#include "ducc0/infra/mav.cc"
+#include "ducc0/fft/fft.h"
+#include "test_utils.h"
+
+using namespace ducc0;
+using namespace ducc0::test;
+using namespace std;
+using shape_t = fmav_info::shape_t;
+
+namespace {
+
+mt19937 rng(42);
+
+// factors applied by the load and store callbacks
+template<typename T> complex<T> load_factor(size_t idx, ptrdiff_t ofs)
+  { return polar(T(1+0.1*double(idx)), T(0.01*double(ofs))); }
+template<typename T> complex<T> store_factor(size_t idx, ptrdiff_t ofs)
+  { return polar(T(1-0.01*double(idx)), T(-0.03*double(ofs))); }
+
+// calls func(value, multi-index, offset) for all entries of arr
+template<typename T, typename Func> void for_each_entry(vfmav<T> &arr,
+  Func func)
+  {
+  shape_t idx(arr.ndim(), 0);
+  for (size_t i=0; i<arr.size(); ++i)
+    {
+    ptrdiff_t ofs=0;
+    for (size_t d=0; d<arr.ndim(); ++d)
+      ofs += ptrdiff_t(idx[d])*arr.stride(d);
+    func(arr.raw(ofs), idx, ofs);
+    for (size_t d=arr.ndim(); d-->0; )
+      {
+      if (++idx[d]<arr.shape(d)) break;
+      idx[d]=0;
+      }
+    }
+  }
+
+// multiplies every entry with its callback factor along axis ax, where
+// the offsets are computed for the memory layout of \a layout
+template<typename T, typename Tv, typename Func> void apply_factors(
+  vfmav<Tv> &arr, size_t ax, Func factor, const fmav_info &layout)
+  {
+  for_each_entry(arr, [&](Tv &v, const shape_t &idx, ptrdiff_t)
+    {
+    ptrdiff_t ofs=0;
+    for (size_t d=0; d<idx.size(); ++d)
+      ofs += ptrdiff_t(idx[d])*layout.stride(d);
+    if constexpr (is_same<Tv, T>::value)
+      v *= factor(idx[ax], ofs).real();
+    else
+      v *= factor(idx[ax], ofs);
+    });
+  }
+
+template<typename T> vfmav<T> copy_of(const cfmav<T> &arr)
+  {
+  vfmav<T> res(arr.shape());
+  mav_apply([](T &a, const T &b) { a=b; }, 1, res, arr);
+  return res;
+  }
+
+// returns a view of a freshly allocated array with the given shape, whose
+// entries along axis ax are not adjacent in memory if stride>1
+template<typename T> vfmav<T> make_array(const shape_t &shp, size_t ax,
+  size_t stride)
+  {
+  auto shp2 = shp;
+  shp2[ax] *= stride;
+  vfmav<T> tmp(shp2);
+  vector<slice> slc(shp.size());
+  slc[ax] = slice(0, MAXIDX, ptrdiff_t(stride));
+  return tmp.subarray(slc);
+  }
+
+string describe(const string &func, const shape_t &shp, const shape_t &axes,
+  size_t stride, bool inplace, size_t nthreads)
+  {
+  ostringstream os;
+  os << func << " shape=(";
+  for (size_t i=0; i<shp.size(); ++i) os << (i ? "," : "") << shp[i];
+  os << ") axes=(";
+  for (size_t i=0; i<axes.size(); ++i) os << (i ? "," : "") << axes[i];
+  os << ") stride=" << stride << " inplace=" << inplace << " nthreads="
+     << nthreads;
+  return os.str();
+  }
+
+template<typename T> constexpr double tolerance()
+  { return is_same<T,float>::value ? 3e-6 : 2e-14; }
+
+template<typename T> void test_c2c(const shape_t &shp, const shape_t &axes,
+  size_t stride, size_t nthreads)
+  {
+  using Tc = complex<T>;
+  auto ld = [](Tc &v, size_t idx, ptrdiff_t ofs)
+    { v *= load_factor<T>(idx, ofs); };
+  auto st = [](Tc &v, size_t idx, ptrdiff_t ofs)
+    { v *= store_factor<T>(idx, ofs); };
+  auto in = make_array<Tc>(shp, axes[0], stride);
+  fill_random(in, rng);
+  for (bool fwd: {true, false})
+    {
+    T fct = fwd ? T(1) : T(0.25);
+    auto reference = [&](const fmav_info &lin, const fmav_info &lout,
+      bool do_load)
+      {
+      auto res = copy_of<Tc>(in);
+      if (do_load) apply_factors<T>(res, axes[0], load_factor<T>, lin);
+      c2c(res, res, axes, fwd, fct, nthreads);
+      apply_factors<T>(res, axes.back(), store_factor<T>, lout);
+      return res;
+      };
+    // out-of-place, with differently strided input and output
+    auto out = make_array<Tc>(shp, axes.back(), stride+1);
+    c2c(in, out, axes, fwd, fct, ld, st, nthreads);
+    check_err(l2error<Tc,Tc>(out, reference(in, out, true)), tolerance<T>(),
+      describe("c2c", shp, axes, stride, false, nthreads));
+    // in-place
+    auto arr = copy_of<Tc>(in);
+    c2c(arr, arr, axes, fwd, fct, ld, st, nthreads);
+    check_err(l2error<Tc,Tc>(arr, reference(arr, arr, true)), tolerance<T>(),
+      describe("c2c", shp, axes, 1, true, nthreads));
+    // only one callback
+    auto ref3 = reference(arr, arr, false);
+    auto arr3 = copy_of<Tc>(in);
+    c2c(arr3, arr3, axes, fwd, fct, no_callback(), st, nthreads);
+    check_err(l2error<Tc,Tc>(arr3, ref3), tolerance<T>(),
+      describe("c2c (store only)", shp, axes, 1, true, nthreads));
+    }
+  }
+
+template<typename T> void test_r2r(const shape_t &shp, const shape_t &axes,
+  size_t stride, size_t nthreads)
+  {
+  auto ld = [](T &v, size_t idx, ptrdiff_t ofs)
+    { v *= load_factor<T>(idx, ofs).real(); };
+  auto st = [](T &v, size_t idx, ptrdiff_t ofs)
+    { v *= store_factor<T>(idx, ofs).real(); };
+  auto in = make_array<T>(shp, axes[0], stride);
+  fill_random(in, rng);
+  for (bool r2h: {true, false})
+    for (bool fwd: {true, false})
+      {
+      auto reference = [&](const fmav_info &lin, const fmav_info &lout)
+        {
+        auto res = copy_of<T>(in);
+        apply_factors<T>(res, axes[0], load_factor<T>, lin);
+        r2r_fftpack(res, res, axes, r2h, fwd, T(1), nthreads);
+        apply_factors<T>(res, axes.back(), store_factor<T>, lout);
+        return res;
+        };
+      auto arr = copy_of<T>(in);
+      r2r_fftpack(arr, arr, axes, r2h, fwd, T(1), ld, st, nthreads);
+      check_err(l2error<T,T>(arr, reference(arr, arr)), tolerance<T>(),
+        describe("r2r_fftpack", shp, axes, 1, true, nthreads));
+      // out-of-place from a strided input into a contiguous output
+      vfmav<T> out(shp);
+      r2r_fftpack(in, out, axes, r2h, fwd, T(1), ld, st, nthreads);
+      check_err(l2error<T,T>(out, reference(in, out)), tolerance<T>(),
+        describe("r2r_fftpack", shp, axes, stride, false, nthreads));
+      }
+  }
+
+// the callbacks of c2c_pruned() are only checked inside the needed region
+template<typename T> void test_c2c_pruned(size_t nthreads)
+  {
+  using Tc = complex<T>;
+  shape_t shp{12, 10};
+  shape_t axes{0, 1};
+  vector<vector<slice>> nz{{slice(0,3), slice(9,12)}, {}};
+  vector<vector<slice>> nd{{}, {slice(0,2), slice(7,10)}};
+  auto ld = [](Tc &v, size_t idx, ptrdiff_t ofs)
+    { v *= load_factor<T>(idx, ofs); };
+  auto st = [](Tc &v, size_t idx, ptrdiff_t ofs)
+    { v *= store_factor<T>(idx, ofs); };
+  vfmav<Tc> in(shp);
+  fill_random(in, rng);
+  for_each_entry(in, [](Tc &v, const shape_t &idx, ptrdiff_t)
+    { if ((idx[0]>=3) && (idx[0]<9)) v=Tc(0); });
+  auto ref = copy_of<Tc>(in);
+  apply_factors<T>(ref, 0, load_factor<T>, in);
+  c2c(ref, ref, axes, true, T(1), nthreads);
+  apply_factors<T>(ref, 1, store_factor<T>, in);
+  auto arr = copy_of<Tc>(in);
+  c2c_pruned(arr, arr, axes, nz, nd, true, T(1), ld, st, nthreads);
+  double sum=0, nrm=0;
+  for_each_entry(ref, [&](Tc &v, const shape_t &idx, ptrdiff_t ofs)
+    {
+    nrm += norm(complex<double>(v));
+    if ((idx[1]<2) || (idx[1]>=7))
+      sum += norm(complex<double>(arr.raw(ofs))-complex<double>(v));
+    });
+  check_err(sqrt(sum/nrm), tolerance<T>(), "c2c_pruned with callbacks");
+  }
+
+template<typename T> void run_all(size_t nthreads)
+  {
+  // 1D, contiguous (handled without work buffers) and strided
+  test_c2c<T>({32}, {0}, 1, nthreads);
+  test_c2c<T>({30}, {0}, 3, nthreads);
+  // many lines, so that SIMD and multi-line code paths are used
+  for (const auto &axes: vector<shape_t>{{0}, {1}, {0,1}, {1,0}})
+    {
+    test_c2c<T>({40, 17}, axes, 1, nthreads);
+    test_c2c<T>({40, 17}, axes, 2, nthreads);
+    }
+  test_c2c<T>({6, 5, 8}, {2, 0}, 1, nthreads);
+  test_c2c<T>({6, 5, 8}, {1, 2, 0}, 2, nthreads);
+  test_r2r<T>({32}, {0}, 1, nthreads);
+  test_r2r<T>({31}, {0}, 2, nthreads);
+  for (const auto &axes: vector<shape_t>{{0}, {1}, {0,1}})
+    test_r2r<T>({40, 18}, axes, 2, nthreads);
+  test_c2c_pruned<T>(nthreads);
+  }
+
+}
+
+int main()
+  {
+  for (size_t nthreads: {1, 3})
+    {
+    run_all<double>(nthreads);
+    run_all<float>(nthreads);
+    }
+  return finish("test_fft_callbacks");
+  }
@@ -0,0 +1,279 @@
+/*
+ *  This file is part of DUCC.
+ *
+ *  DUCC is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  DUCC is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with DUCC; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+/*
+ *  Copyright (C) 2023 Max-Planck-Society
+ */
+
+/* Tests of the distributed FFTs in fft_distributed.h.
+   Every rank sets up the same complete input array and transforms its own
+   part of it; the result must agree with the corresponding part of the
+   serial c2c/r2c/c2r of the complete array. All slab and pencil process
+   grids are tested, with evenly and unevenly distributed inputs (the
+   latter with an empty rank), transposed and regular output layouts, and
+   blocked communication.
+   Without MPI, Communicator has exactly one rank and the all-to-all
+   exchanges reduce to local transposes. For the multi-rank tests, compile
+   with
+
+   mpicxx -O2 -std=c++17 -pthread -DDUCC0_USE_MPI -I ../src test_fft_distributed.cc -o test_fft_distributed
+
+   and run e.g. "mpirun -np 4 ./test_fft_distributed". */
+
+#include <sstream>
+#include "ducc0/infra/string_utils.cc"
+#include "ducc0/infra/threading.cc"
+#include "ducc0/infra/mav.cc"
+#include "ducc0/infra/types.cc"
+#include "ducc0/infra/communication.cc"
+#include "ducc0/fft/fft_distributed.h"
+#include "test_utils.h"
+
+using namespace ducc0;
+using namespace ducc0::test;
+using namespace std;
+using shape_t = fmav_info::shape_t;
+using ranges = vector<tuple<size_t, size_t>>;
+
+namespace {
+
+mt19937 rng(42);
+
+template<typename T> double tol() { return is_same<T,float>::value ? 3e-6 : 1e-14; }
+
+/* Distribution of an array over the ranks */
+struct Decomp
+  {
+  bool pencil;
+  size_t nproc0;  // first dimension of the process grid (pencil only)
+  bool skewed;    // input on rank 0 (or process grid row/column 0) empty
+  };
+
+/* Index range of an input axis with \a n entries on \a rank of \a nranks */
+tuple<size_t, size_t> input_range(size_t n, size_t nranks, size_t rank,
+  bool skewed)
+  {
+  if ((!skewed) || (nranks==1)) return distributed_range(n, nranks, rank);
+  if (rank==0) return {0, 0};
+  return distributed_range(n, nranks-1, rank-1);
+  }
+
+ranges full_ranges(const shape_t &shp)
+  {
+  ranges res;
+  for (auto n: shp) res.emplace_back(0, n);
+  return res;
+  }
+
+/* Local part of an input (or non-transposed output) array of shape \a shp */
+ranges input_part(const Communicator &comm, const Decomp &d,
+  const shape_t &shp)
+  {
+  auto res = full_ranges(shp);
+  auto nranks = size_t(comm.num_ranks()), rank = size_t(comm.rank());
+  if (!d.pencil)
+    res[0] = input_range(shp[0], nranks, rank, d.skewed);
+  else
+    {
+    auto nproc1 = nranks/d.nproc0;
+    res[0] = input_range(shp[0], d.nproc0, rank/nproc1, d.skewed);
+    res[1] = input_range(shp[1], nproc1, rank%nproc1, d.skewed);
+    }
+  return res;
+  }
+
+/* Local part of a transposed output array of shape \a shp */
+ranges transposed_part(const Communicator &comm, const Decomp &d,
+  const shape_t &shp)
+  {
+  auto res = full_ranges(shp);
+  auto nranks = size_t(comm.num_ranks()), rank = size_t(comm.rank());
+  if (!d.pencil)
+    res[1] = distributed_range(shp[1], nranks, rank);
+  else
+    {
+    auto nproc1 = nranks/d.nproc0;
+    res[1] = distributed_range(shp[1], d.nproc0, rank/nproc1);
+    res[2] = distributed_range(shp[2], nproc1, rank%nproc1);
+    }
+  return res;
+  }
+
+/* Returns a copy of the part \a rng of \a arr. */
+template<typename T> vfmav<T> part(const cfmav<T> &arr, const ranges &rng)
+  {
+  shape_t shp;
+  vector<slice> slc;
+  for (auto [lo, hi]: rng)
+    {
+    shp.push_back(hi-lo);
+    slc.emplace_back(lo, hi);
+    }
+  vfmav<T> res(shp);
+  // subarray() cannot produce arrays without elements
+  if (res.size()>0)
+    mav_apply([](T &a, const T &b) { a=b; }, 1, res, arr.subarray(slc));
+  return res;
+  }
+
+string describe(const string &func, const Decomp &d, const shape_t &shp,
+  bool fwd, bool transposed, size_t nblocks)
+  {
+  ostringstream os;
+  os << func << "_" << (d.pencil ? "pencil" : "slab") << " shape=(";
+  for (size_t i=0; i<shp.size(); ++i) os << (i ? "," : "") << shp[i];
+  os << ")";
+  if (d.pencil) os << " nproc0=" << d.nproc0;
+  os << " skewed=" << d.skewed << " forward=" << fwd << " transposed="
+     << transposed << " nblocks=" << nblocks;
+  return os.str();
+  }
+
+template<typename T> void test_c2c(const Communicator &comm, const Decomp &d,
+  const shape_t &shp, bool fwd, bool transposed, size_t nblocks)
+  {
+  vfmav<complex<T>> full(shp), ref(shp);
+  fill_random(full, rng);
+  T fct = T(1)/T(full.size());
+  c2c(full, ref, detail_fft_distributed::axis_range(0, shp.size()), fwd, fct);
+  auto in = part<complex<T>>(full, input_part(comm, d, shp));
+  auto lref = part<complex<T>>(ref, transposed ?
+    transposed_part(comm, d, shp) : input_part(comm, d, shp));
+  vfmav<complex<T>> out(lref.shape());
+  if (d.pencil)
+    c2c_pencil(comm, d.nproc0, in, out, fwd, fct, transposed, nblocks);
+  else
+    c2c_slab(comm, in, out, fwd, fct, transposed, nblocks);
+  check_err(l2error(cfmav<complex<T>>(out), cfmav<complex<T>>(lref)),
+    tol<T>(), describe("c2c", d, shp, fwd, transposed, nblocks));
+  }
+
+template<typename T> void test_c2c_inplace(const Communicator &comm,
+  const Decomp &d, const shape_t &shp, size_t nblocks)
+  {
+  vfmav<complex<T>> full(shp), ref(shp);
+  fill_random(full, rng);
+  c2c(full, ref, detail_fft_distributed::axis_range(0, shp.size()), true,
+    T(1));
+  auto data = part<complex<T>>(full, input_part(comm, d, shp));
+  auto lref = part<complex<T>>(ref, input_part(comm, d, shp));
+  if (d.pencil)
+    c2c_pencil(comm, d.nproc0, data, data, true, T(1), false, nblocks);
+  else
+    c2c_slab(comm, data, data, true, T(1), false, nblocks);
+  check_err(l2error(cfmav<complex<T>>(data), cfmav<complex<T>>(lref)),
+    tol<T>(), describe("c2c (in place)", d, shp, true, false, nblocks));
+  }
+
+template<typename T> void test_r2c_c2r(const Communicator &comm,
+  const Decomp &d, const shape_t &shp, bool fwd, bool transposed,
+  size_t nblocks)
+  {
+  auto cshp = shp;
+  cshp.back() = cshp.back()/2+1;
+  vfmav<T> full(shp);
+  vfmav<complex<T>> ref(cshp);
+  fill_random(full, rng);
+  r2c(full, ref, detail_fft_distributed::axis_range(0, shp.size()), fwd,
+    T(1));
+  auto in = part<T>(full, input_part(comm, d, shp));
+  auto lref = part<complex<T>>(ref, transposed ?
+    transposed_part(comm, d, cshp) : input_part(comm, d, cshp));
+  vfmav<complex<T>> out(lref.shape());
+  if (d.pencil)
+    r2c_pencil(comm, d.nproc0, in, out, fwd, T(1), transposed, nblocks);
+  else
+    r2c_slab(comm, in, out, fwd, T(1), transposed, nblocks);
+  check_err(l2error(cfmav<complex<T>>(out), cfmav<complex<T>>(lref)),
+    tol<T>(), describe("r2c", d, shp, fwd, transposed, nblocks));
+  if (transposed) return;
+  // c2r must invert r2c
+  T fct = T(1)/T(full.size());
+  vfmav<T> back(in.shape());
+  if (d.pencil)
+    c2r_pencil(comm, d.nproc0, lref, back, !fwd, fct, nblocks);
+  else
+    c2r_slab(comm, lref, back, !fwd, fct, nblocks);
+  check_err(l2error(cfmav<T>(back), cfmav<T>(in)), tol<T>(),
+    describe("c2r", d, shp, !fwd, false, nblocks));
+  }
+
+template<typename T> void run_all(const Communicator &comm)
+  {
+  // the last shapes leave some ranks without data in the transposed layouts
+  const vector<shape_t> slab_shapes{{16, 12}, {9, 14, 5}, {8, 6, 7, 4},
+    {7, 3, 6}};
+  const vector<shape_t> pencil_shapes{{9, 14, 5}, {8, 6, 10}, {5, 6, 7, 4},
+    {6, 3, 2}};
+  auto nranks = size_t(comm.num_ranks());
+  vector<Decomp> decomps;
+  for (bool skewed: {false, true})
+    {
+    if (skewed && (nranks==1)) continue;  // same as the regular layout
+    decomps.push_back({false, 1, skewed});
+    for (size_t nproc0=1; nproc0<=nranks; ++nproc0)
+      if (nranks%nproc0==0)
+        decomps.push_back({true, nproc0, skewed});
+    }
+  for (const auto &d: decomps)
+    for (size_t nblocks: {1, 2, 3, 64})
+      {
+      const auto &shapes(d.pencil ? pencil_shapes : slab_shapes);
+      for (bool fwd: {true, false})
+        for (bool transposed: {false, true})
+          for (const auto &shp: shapes)
+            {
+            test_c2c<T>(comm, d, shp, fwd, transposed, nblocks);
+            test_r2c_c2r<T>(comm, d, shp, fwd, transposed, nblocks);
+            }
+      test_c2c_inplace<T>(comm, d, shapes[1], nblocks);
+      }
+  }
+
+void test_errors(const Communicator &comm)
+  {
+  vfmav<complex<double>> a1({8}), a2({4, 5, 6}), a3({4, 5, 7});
+  check_throws([&]{ c2c_slab(comm, a1, a1, true, 1.); },
+    "c2c_slab on a 1D array");
+  check_throws([&]{ c2c_pencil(comm, 1, vfmav<complex<double>>({4,5}),
+    a1, true, 1.); }, "c2c_pencil on a 2D array");
+  check_throws([&]{ c2c_slab(comm, a2, a3, true, 1.); },
+    "c2c_slab with mismatching shapes");
+  check_throws([&]{ c2c_pencil(comm, size_t(comm.num_ranks())+1, a2, a2,
+    true, 1.); }, "c2c_pencil with a bad process grid");
+  }
+
+}
+
+int main()
+  {
+  Communication::init();
+  int res;
+  {
+  Communicator comm;
+  run_all<double>(comm);
+  run_all<float>(comm);
+  test_errors(comm);
+  ostringstream name;
+  name << "test_fft_distributed (rank " << comm.rank() << " of "
+       << comm.num_ranks() << ")";
+  res = finish(name.str());
+  }
+  Communication::finalize();
+  return res;
+  }
@@ -0,0 +1,239 @@
+/*
+ *  This file is part of DUCC.
+ *
+ *  DUCC is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  DUCC is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with DUCC; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+/*
+ *  Copyright (C) 2023 Max-Planck-Society
+ */
+
+/* Tests of c2c_pruned() and r2c_pruned() against the unpruned transforms.
+   The input is zeroed outside of the declared nonzero intervals, and the
+   results are only compared inside the requested output intervals. */
+
+#include <sstream>
+#include "ducc0/infra/string_utils.cc"
+#include "ducc0/infra/threading.cc"
+#include "ducc0/infra/mav.cc"
+#include "ducc0/fft/fft.h"
+#include "test_utils.h"
+
+using namespace ducc0;
+using namespace ducc0::test;
+using namespace std;
+using shape_t = fmav_info::shape_t;
+using ranges_t = vector<vector<slice>>;
+
+namespace {
+
+mt19937 rng(42);
+
+bool in_ranges(const ranges_t &ranges, size_t dim, size_t i, size_t n)
+  {
+  if (ranges.empty() || ranges[dim].empty()) return true;
+  for (const auto &r: ranges[dim])
+    if ((i>=r.beg) && (i<min(r.end, n))) return true;
+  return false;
+  }
+
+// calls func(flat index, multi-index) for all entries of a C-contiguous
+// array of shape shp
+template<typename Func> void for_each_index(const shape_t &shp, Func func)
+  {
+  size_t size=1;
+  for (auto n: shp) size*=n;
+  shape_t idx(shp.size(), 0);
+  for (size_t i=0; i<size; ++i)
+    {
+    func(i, idx);
+    for (size_t d=shp.size(); d-->0; )
+      {
+      if (++idx[d]<shp[d]) break;
+      idx[d]=0;
+      }
+    }
+  }
+
+bool contained(const ranges_t &ranges, const shape_t &shp, const shape_t &idx)
+  {
+  for (size_t d=0; d<shp.size(); ++d)
+    if (!in_ranges(ranges, d, idx[d], shp[d])) return false;
+  return true;
+  }
+
+// only the intervals along transformed axes restrict the output
+ranges_t output_region(const ranges_t &needed_out, const shape_t &axes,
+  size_t ndim)
+  {
+  ranges_t res(ndim);
+  if (needed_out.empty()) return res;
+  for (auto ax: axes) res[ax] = needed_out[ax];
+  return res;
+  }
+
+template<typename T1, typename T2> double masked_error(const cfmav<T1> &a,
+  const cfmav<T2> &ref, const ranges_t &region)
+  {
+  double sum=0, nrm=0;
+  for_each_index(ref.shape(), [&](size_t i, const shape_t &idx)
+    {
+    nrm += norm(complex<double>(ref.data()[i]));
+    if (contained(region, ref.shape(), idx))
+      sum += norm(complex<double>(a.data()[i])-complex<double>(ref.data()[i]));
+    });
+  return (nrm==0) ? sqrt(sum) : sqrt(sum/nrm);
+  }
+
+string describe(const string &func, const shape_t &shp, const shape_t &axes,
+  const ranges_t &nonzero_in, const ranges_t &needed_out, bool inplace)
+  {
+  ostringstream os;
+  auto print_ranges = [&os](const ranges_t &r)
+    {
+    os << "[";
+    for (size_t d=0; d<r.size(); ++d)
+      {
+      os << (d ? "," : "") << "[";
+      for (size_t j=0; j<r[d].size(); ++j)
+        os << (j ? "," : "") << r[d][j].beg << ":" << r[d][j].end;
+      os << "]";
+      }
+    os << "]";
+    };
+  os << func << " shape=(";
+  for (size_t i=0; i<shp.size(); ++i) os << (i ? "," : "") << shp[i];
+  os << ") axes=(";
+  for (size_t i=0; i<axes.size(); ++i) os << (i ? "," : "") << axes[i];
+  os << ") nonzero_in=";
+  print_ranges(nonzero_in);
+  os << " needed_out=";
+  print_ranges(needed_out);
+  os << " inplace=" << inplace;
+  return os.str();
+  }
+
+template<typename T> void test_c2c(const shape_t &shp, const shape_t &axes,
+  const ranges_t &nonzero_in, const ranges_t &needed_out)
+  {
+  constexpr double tol = is_same<T,float>::value ? 3e-6 : 1e-14;
+  vfmav<complex<T>> in(shp), ref(shp);
+  fill_random(in, rng);
+  for_each_index(shp, [&](size_t i, const shape_t &idx)
+    { if (!contained(nonzero_in, shp, idx)) in.data()[i]=complex<T>(0); });
+  auto region = output_region(needed_out, axes, shp.size());
+  for (bool fwd: {true, false})
+    {
+    T fct = fwd ? T(1) : T(0.5);
+    c2c(in, ref, axes, fwd, fct);
+    // out-of-place, with garbage in the output array
+    vfmav<complex<T>> out(shp);
+    fill_random(out, rng);
+    c2c_pruned(in, out, axes, nonzero_in, needed_out, fwd, fct);
+    check_err(masked_error<complex<T>>(out, ref, region), tol,
+      describe("c2c_pruned", shp, axes, nonzero_in, needed_out, false));
+    // in-place
+    mav_apply([](complex<T> &a, const complex<T> &b) { a=b; }, 1, out, in);
+    c2c_pruned(out, out, axes, nonzero_in, needed_out, fwd, fct);
+    check_err(masked_error<complex<T>>(out, ref, region), tol,
+      describe("c2c_pruned", shp, axes, nonzero_in, needed_out, true));
+    }
+  }
+
+template<typename T> void test_r2c(const shape_t &shp, const shape_t &axes,
+  const ranges_t &nonzero_in, const ranges_t &needed_out)
+  {
+  constexpr double tol = is_same<T,float>::value ? 3e-6 : 1e-14;
+  auto cshp = shp;
+  cshp[axes.back()] = shp[axes.back()]/2+1;
+  vfmav<T> in(shp);
+  vfmav<complex<T>> out(cshp), ref(cshp);
+  fill_random(in, rng);
+  for_each_index(shp, [&](size_t i, const shape_t &idx)
+    { if (!contained(nonzero_in, shp, idx)) in.data()[i]=T(0); });
+  auto region = output_region(needed_out, axes, shp.size());
+  for (bool fwd: {true, false})
+    {
+    r2c(in, ref, axes, fwd, T(1));
+    fill_random(out, rng);
+    r2c_pruned(in, out, axes, nonzero_in, needed_out, fwd, T(1));
+    check_err(masked_error<complex<T>>(out, ref, region), tol,
+      describe("r2c_pruned", shp, axes, nonzero_in, needed_out, false));
+    }
+  }
+
+template<typename T> void run_all()
+  {
+  const ranges_t none;
+  // 1D
+  test_c2c<T>({32}, {0}, {{slice(0,5), slice(27,32)}}, {{slice(3,9)}});
+  test_c2c<T>({32}, {0}, none, {{slice(0,32)}});
+  test_r2c<T>({30}, {0}, {{slice(0,7)}}, {{slice(2,4), slice(10,16)}});
+  // 2D, typical zero-padding pattern
+  shape_t s2{16, 20};
+  ranges_t nz2{{slice(0,4), slice(12,16)}, {slice(0,5), slice(15,20)}};
+  ranges_t nd2{{slice(0,3), slice(14,16)}, {slice(0,4), slice(17,20)}};
+  for (const auto &axes: vector<shape_t>{{0,1}, {1,0}})
+    {
+    test_c2c<T>(s2, axes, nz2, nd2);
+    test_c2c<T>(s2, axes, nz2, none);
+    test_c2c<T>(s2, axes, none, nd2);
+    // needed_out refers to the shape of the r2c output
+    test_r2c<T>(s2, axes, nz2, {{slice(0,3), slice(6,9)}, {slice(0,4)}});
+    }
+  // 3D, including an untransformed axis with restricted input
+  shape_t s3{8, 10, 12};
+  ranges_t nz3{{slice(1,3)}, {slice(0,2), slice(7,10)}, {slice(4,9)}};
+  ranges_t nd3{{slice(0,8)}, {slice(2,3)}, {slice(0,2), slice(11,12)}};
+  ranges_t nd3r{{slice(0,2), slice(4,5)}, {slice(2,3)}, {slice(0,2), slice(6,7)}};
+  for (const auto &axes: vector<shape_t>{{0,1,2}, {2,1,0}, {2,0}, {1}})
+    {
+    test_c2c<T>(s3, axes, nz3, nd3);
+    test_r2c<T>(s3, axes, nz3, nd3r);
+    }
+  // intervals covering everything, explicitly and implicitly
+  ranges_t all3{{slice(0,8)}, {slice(0,10)}, {slice(0,12)}};
+  test_c2c<T>(s3, {0,1,2}, all3, all3);
+  test_c2c<T>(s3, {0,1,2}, none, none);
+  test_c2c<T>(s3, {0,1,2}, {{}, {}, {}}, {{}, {}, {}});
+  test_r2c<T>(s3, {0,1,2}, none, none);
+  // adjacent intervals
+  test_c2c<T>(s3, {0,1,2}, {{slice(0,2), slice(2,4)}, {}, {slice(6,12)}},
+    {{}, {slice(0,1), slice(1,3)}, {}});
+  // empty intervals: no input at all, or no output needed
+  test_c2c<T>(s3, {0,1,2}, {{slice(3,3)}, {}, {}}, none);
+  test_c2c<T>(s3, {0,1,2}, none, {{}, {slice(5,5)}, {}});
+  test_r2c<T>(s3, {0,1,2}, {{}, {slice(4,4)}, {}}, none);
+  test_r2c<T>(s3, {0,1,2}, none, {{slice(0,0)}, {}, {}});
+  }
+
+void test_errors()
+  {
+  vfmav<complex<double>> a({8, 6});
+  check_throws([&]{ c2c_pruned(a, a, {0,1}, {{slice(0,2)}}, {}, true, 1.); },
+    "c2c_pruned with too few interval lists");
+  check_throws([&]{ c2c_pruned(a, a, {2}, {}, {}, true, 1.); },
+    "c2c_pruned with a bad axis");
+  }
+
+}
+
+int main()
+  {
+  run_all<double>();
+  run_all<float>();
+  test_errors();
+  return finish("test_fft_pruned");
+  }
@@ -0,0 +1,358 @@
+/*
+ *  This file is part of DUCC.
+ *
+ *  DUCC is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  DUCC is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with DUCC; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+/*
+ *  Copyright (C) 2023 Max-Planck-Society
+ */
+
+/* Tests of the 16-bit storage types float16 and bfloat16 and of the FFTs
+   operating on arrays of them.
+   The conversions from float are checked against a straightforward
+   reference which picks the nearer of the two neighbouring 16-bit values
+   (the even one in case of a tie). The transforms are compared to single
+   precision transforms of the same input. */
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <sstream>
+#include <vector>
+#include "ducc0/infra/string_utils.cc"
+#include "ducc0/infra/threading.cc"
+#include "ducc0/infra/mav.cc"
+#include "ducc0/fft/fft.h"
+#include "test_utils.h"
+
+using namespace ducc0;
+using namespace ducc0::test;
+using namespace std;
+using shape_t = fmav_info::shape_t;
+
+namespace {
+
+mt19937 rng(42);
+
+float from_bits(uint32_t u)
+  { float res; memcpy(&res, &u, sizeof(res)); return res; }
+uint32_t to_bits(float f)
+  { uint32_t res; memcpy(&res, &f, sizeof(res)); return res; }
+
+template<typename T> T make16(uint16_t bits)
+  { T res; res.bits=bits; return res; }
+
+string hex(uint32_t v)
+  {
+  ostringstream os;
+  os << "0x" << std::hex << v;
+  return os.str();
+  }
+
+// Magnitudes of all finite non-negative 16-bit values of type T, in
+// increasing order (index == bit pattern), followed by the magnitude at
+// which the representable range ends, i.e. values which round to this
+// "next" entry overflow to infinity.
+template<typename T> vector<double> magnitudes(uint16_t ninf, double next)
+  {
+  vector<double> res;
+  for (uint32_t b=0; b<ninf; ++b)
+    res.push_back(double(float(make16<T>(uint16_t(b)))));
+  res.push_back(next);
+  return res;
+  }
+
+// reference conversion from float to the 16-bit type with the given table
+uint16_t ref_round(float f, const vector<double> &mag)
+  {
+  uint16_t sign = (to_bits(f)>>31) ? 0x8000 : 0;
+  double x = abs(double(f));
+  auto it = upper_bound(mag.begin(), mag.end(), x);
+  if (it==mag.end())  // beyond the "next" entry
+    return uint16_t(sign | (mag.size()-1));
+  size_t hi = size_t(it-mag.begin()), lo = hi-1;
+  double dlo = x-mag[lo], dhi = mag[hi]-x;
+  size_t res = (dlo<dhi) ? lo : ((dhi<dlo) ? hi : ((lo&1) ? hi : lo));
+  return uint16_t(sign | res);
+  }
+
+bool isnan16(uint16_t bits, uint16_t ninf)
+  { return (bits&0x7fff)>ninf; }
+
+template<typename T> void test_conversion(const string &name, uint16_t ninf,
+  double next)
+  {
+  auto mag = magnitudes<T>(ninf, next);
+  // float -> 16 bit -> float must be exact, and back to identical bits
+  size_t nbad=0;
+  for (uint32_t b=0; b<0x10000; ++b)
+    {
+    auto v = make16<T>(uint16_t(b));
+    float f = float(v);
+    uint16_t b2 = T(f).bits;
+    if (isnan16(uint16_t(b), ninf))
+      nbad += (!isnan(f)) || (!isnan16(b2, ninf));
+    else if ((b&0x7fff)==ninf)
+      nbad += (!isinf(f)) || (b2!=b);
+    else
+      nbad += (b2!=b) || (double(abs(f))!=mag[b&0x7fff]);
+    }
+  check(nbad==0, name+": round trip of all bit patterns");
+  // special values
+  check(T(numeric_limits<float>::infinity()).bits==ninf,
+    name+": +inf");
+  check(T(-numeric_limits<float>::infinity()).bits==(ninf|0x8000),
+    name+": -inf");
+  check(isinf(float(make16<T>(ninf))) && (float(make16<T>(ninf))>0),
+    name+": conversion of +inf to float");
+  check(isnan16(T(numeric_limits<float>::quiet_NaN()).bits, ninf),
+    name+": quiet NaN");
+  check(isnan16(T(numeric_limits<float>::signaling_NaN()).bits, ninf),
+    name+": signaling NaN");
+  check(isnan16(T(from_bits(0x7f800001u)).bits, ninf),
+    name+": NaN with a payload in the lowest bit");
+  check(T(-0.f).bits==0x8000, name+": negative zero");
+  // midpoints between all neighbouring values (including the largest
+  // finite value and the overflow threshold) and their neighbours
+  nbad=0;
+  for (size_t i=0; i+1<mag.size(); ++i)
+    {
+    float mid = float(0.5*(mag[i]+mag[i+1]));
+    MR_assert(double(mid)==0.5*(mag[i]+mag[i+1]), "midpoint not exact");
+    for (float f: {mid, nextafter(mid, 0.f),
+                   nextafter(mid, numeric_limits<float>::infinity()),
+                   float(mag[i]), -mid})
+      {
+      uint16_t res = T(f).bits, ref = ref_round(f, mag);
+      if (res!=ref)
+        {
+        if (++nbad<5)
+          cerr << name << ": " << f << " (" << hex(to_bits(f)) << ") gives "
+               << hex(res) << ", expected " << hex(ref) << endl;
+        }
+      }
+    }
+  check(nbad==0, name+": rounding of midpoints to nearest even");
+  // random bit patterns of finite floats
+  nbad=0;
+  uniform_int_distribution<uint32_t> dist;
+  for (size_t i=0; i<1000000; ++i)
+    {
+    float f = from_bits(dist(rng));
+    if (!isfinite(f)) continue;
+    nbad += T(f).bits!=ref_round(f, mag);
+    }
+  check(nbad==0, name+": rounding of random values");
+  // overflow
+  check(T(numeric_limits<float>::max()).bits==ninf,
+    name+": overflow of FLT_MAX");
+  check(T(-float(next)).bits==(ninf|0x8000), name+": negative overflow");
+  check(T(float(mag[ninf-1])).bits==ninf-1, name+": largest finite value");
+  }
+
+void test_float16_specifics()
+  {
+  // values from the IEEE 754 binary16 format
+  check(float16(65504.f).bits==0x7bff, "float16: largest finite value");
+  check(float16(65519.996f).bits==0x7bff, "float16: just below overflow");
+  check(float16(65520.f).bits==0x7c00, "float16: overflow threshold");
+  check(float16(1.f).bits==0x3c00, "float16: one");
+  check(float16(-2.f).bits==0xc000, "float16: minus two");
+  check(float16(0.333251953125f).bits==0x3555, "float16: 1/3 rounded");
+  check(float16(0x1p-14f).bits==0x0400, "float16: smallest normal");
+  check(float16(0x1p-24f).bits==0x0001, "float16: smallest subnormal");
+  check(float16(0x1p-25f).bits==0x0000, "float16: tie below the smallest "
+    "subnormal rounds to zero");
+  check(float16(0x1.8p-24f).bits==0x0002, "float16: tie rounds to even "
+    "subnormal");
+  check(float16(0x1.000002p-25f).bits==0x0001, "float16: just above the "
+    "tie below the smallest subnormal");
+  check(float16(0x1.ffcp-15f).bits==0x0400, "float16: largest subnormal "
+    "rounding up to the smallest normal");
+  check(float(float16(-0x1p-24f))==-0x1p-24f, "float16: negative subnormal");
+  check(float16(1e-10f).bits==0, "float16: underflow to zero");
+  check(float16(-1e-10f).bits==0x8000, "float16: underflow to -zero");
+  }
+
+void test_bfloat16_specifics()
+  {
+  check(bfloat16(1.f).bits==0x3f80, "bfloat16: one");
+  check(bfloat16(from_bits(0x3f808000u)).bits==0x3f80, "bfloat16: tie "
+    "rounds to even (down)");
+  check(bfloat16(from_bits(0x3f818000u)).bits==0x3f82, "bfloat16: tie "
+    "rounds to even (up)");
+  check(bfloat16(from_bits(0x3f808001u)).bits==0x3f81, "bfloat16: above "
+    "the tie");
+  check(bfloat16(from_bits(0x7f7f8000u)).bits==0x7f80, "bfloat16: overflow "
+    "by rounding");
+  check(bfloat16(from_bits(0x00000001u)).bits==0x0000, "bfloat16: float "
+    "subnormal rounding to zero");
+  check(bfloat16(from_bits(0x00018000u)).bits==0x0002, "bfloat16: float "
+    "subnormal tie");
+  check(to_bits(float(bfloat16(from_bits(0x00010000u))))==0x00010000u,
+    "bfloat16: subnormal round trip");
+  check((bfloat16(from_bits(0x7f800001u)).bits&0x7f)!=0, "bfloat16: NaN "
+    "must not become infinity");
+  check((bfloat16(from_bits(0xff800001u)).bits&0x8000)!=0, "bfloat16: sign "
+    "of a NaN");
+  }
+
+// FFTs of 16-bit data, compared to float FFTs of the same input.
+// The tolerance (about twice the unit roundoff of the type) accounts for
+// the rounding of the input to every pass and of the final output.
+template<typename Ts> double tolerance()
+  { return is_same<Ts, float16>::value ? 1e-3 : 8e-3; }
+
+template<typename Ts> string describe(const string &func, const shape_t &shp,
+  const shape_t &axes, bool fwd)
+  {
+  ostringstream os;
+  os << func << "<" << (is_same<Ts, float16>::value ? "float16" : "bfloat16")
+     << "> shape=(";
+  for (size_t i=0; i<shp.size(); ++i) os << (i ? "," : "") << shp[i];
+  os << ") axes=(";
+  for (size_t i=0; i<axes.size(); ++i) os << (i ? "," : "") << axes[i];
+  os << ") forward=" << fwd;
+  return os.str();
+  }
+
+// random complex data, rounded to Ts, and its exact float equivalent
+template<typename Ts> void random_data(vfmav<Cmplx<Ts>> &a16,
+  vfmav<complex<float>> &a32)
+  {
+  uniform_real_distribution<float> dist(-1, 1);
+  mav_apply([&](Cmplx<Ts> &v, complex<float> &w)
+    {
+    v.Set(Ts(dist(rng)), Ts(dist(rng)));
+    w = complex<float>(float(v.r), float(v.i));
+    }, 1, a16, a32);
+  }
+template<typename Ts> void random_data(vfmav<Ts> &a16, vfmav<float> &a32)
+  {
+  uniform_real_distribution<float> dist(-1, 1);
+  mav_apply([&](Ts &v, float &w) { v = Ts(dist(rng)); w = float(v); },
+    1, a16, a32);
+  }
+
+template<typename Ts> double error16(const cfmav<Cmplx<Ts>> &a16,
+  const cfmav<complex<float>> &ref)
+  {
+  double sum=0, nrm=0;
+  mav_apply([&](const Cmplx<Ts> &v, const complex<float> &w)
+    {
+    sum += norm(complex<double>(float(v.r), float(v.i))-complex<double>(w));
+    nrm += norm(complex<double>(w));
+    }, 1, a16, ref);
+  return sqrt(sum/nrm);
+  }
+template<typename Ts> double error16(const cfmav<Ts> &a16,
+  const cfmav<float> &ref)
+  {
+  double sum=0, nrm=0;
+  mav_apply([&](const Ts &v, const float &w)
+    {
+    sum += (double(float(v))-w)*(double(float(v))-w);
+    nrm += double(w)*w;
+    }, 1, a16, ref);
+  return sqrt(sum/nrm);
+  }
+
+template<typename Ts> void test_c2c(const shape_t &shp, const shape_t &axes,
+  size_t nthreads)
+  {
+  vfmav<Cmplx<Ts>> a16(shp), o16(shp);
+  vfmav<complex<float>> a32(shp), o32(shp);
+  random_data(a16, a32);
+  size_t n=1;
+  for (auto ax: axes) n*=shp[ax];
+  for (bool fwd: {true, false})
+    {
+    // normalized, so that float16 does not overflow
+    float fct = 1.f/float(sqrt(double(n)));
+    c2c(a32, o32, axes, fwd, fct, nthreads);
+    c2c(a16, o16, axes, fwd, fct, nthreads);
+    check_err(error16<Ts>(o16, o32), tolerance<Ts>(),
+      describe<Ts>("c2c", shp, axes, fwd));
+    // in-place
+    vfmav<Cmplx<Ts>> b16(shp);
+    mav_apply([](Cmplx<Ts> &a, const Cmplx<Ts> &b) { a=b; }, 1, b16, a16);
+    c2c(b16, b16, axes, fwd, fct, nthreads);
+    check_err(error16<Ts>(b16, o32), tolerance<Ts>(),
+      describe<Ts>("c2c (in-place)", shp, axes, fwd));
+    }
+  }
+
+template<typename Ts> void test_r2c_c2r(const shape_t &shp,
+  const shape_t &axes, size_t nthreads)
+  {
+  auto cshp = shp;
+  cshp[axes.back()] = shp[axes.back()]/2+1;
+  vfmav<Ts> a16(shp), r16(shp);
+  vfmav<float> a32(shp), r32(shp);
+  vfmav<Cmplx<Ts>> c16(cshp);
+  vfmav<complex<float>> c32(cshp), cin32(cshp);
+  random_data(a16, a32);
+  size_t n=1;
+  for (auto ax: axes) n*=shp[ax];
+  float fct = 1.f/float(sqrt(double(n)));
+  for (bool fwd: {true, false})
+    {
+    r2c(a32, c32, axes, fwd, fct, nthreads);
+    r2c(a16, c16, axes, fwd, fct, nthreads);
+    check_err(error16<Ts>(c16, c32), tolerance<Ts>(),
+      describe<Ts>("r2c", shp, axes, fwd));
+    // c2r of the (16-bit) result of r2c
+    mav_apply([](complex<float> &w, const Cmplx<Ts> &v)
+      { w = complex<float>(float(v.r), float(v.i)); }, 1, cin32, c16);
+    c2r(cin32, r32, axes, !fwd, fct, nthreads);
+    c2r(c16, r16, axes, !fwd, fct, nthreads);
+    check_err(error16<Ts>(r16, r32), tolerance<Ts>(),
+      describe<Ts>("c2r", shp, axes, !fwd));
+    // and the round trip
+    check_err(error16<Ts>(r16, a32), 2*tolerance<Ts>(),
+      describe<Ts>("r2c+c2r round trip", shp, axes, fwd));
+    }
+  }
+
+template<typename Ts> void test_transforms(size_t nthreads)
+  {
+  test_c2c<Ts>({64}, {0}, nthreads);
+  test_c2c<Ts>({77}, {0}, nthreads);
+  for (const auto &axes: vector<shape_t>{{0}, {1}, {0,1}, {1,0}})
+    test_c2c<Ts>({40, 36}, axes, nthreads);
+  test_c2c<Ts>({10, 12, 14}, {0, 1, 2}, nthreads);
+  test_r2c_c2r<Ts>({64}, {0}, nthreads);
+  test_r2c_c2r<Ts>({63}, {0}, nthreads);
+  for (const auto &axes: vector<shape_t>{{0}, {1}, {0,1}, {1,0}})
+    test_r2c_c2r<Ts>({40, 36}, axes, nthreads);
+  test_r2c_c2r<Ts>({10, 12, 14}, {2, 0, 1}, nthreads);
+  }
+
+}
+
+int main()
+  {
+  test_conversion<float16>("float16", 0x7c00, 65536.);
+  test_conversion<bfloat16>("bfloat16", 0x7f80, 0x1p128);
+  test_float16_specifics();
+  test_bfloat16_specifics();
+  for (size_t nthreads: {1, 2})
+    {
+    test_transforms<float16>(nthreads);
+    test_transforms<bfloat16>(nthreads);
+    }
+  return finish("test_float16");
+  }
@@ -0,0 +1,133 @@
+/*
+ *  This file is part of DUCC.
+ *
+ *  DUCC is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  DUCC is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with DUCC; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+/*
+ *  Copyright (C) 2023 Max-Planck-Society
+ */
+
+/*! \file test_utils.h
+ *  Minimal helpers for the stand-alone C++ tests in this directory.
+ *
+ *  These tests cover functionality which is only available from C++ (and
+ *  therefore cannot be exercised by the Python test suite in python/test).
+ *  Every test_*.cc file is a self-contained program which includes the
+ *  required ducc0 sources directly, e.g.
+ *
+ *  g++ -O2 -std=c++17 -pthread -I ../src test_fft_distributed.cc -o test_fft_distributed
+ *
+ *  and returns a nonzero exit code if any check fails.
+ */
+
+#ifndef DUCC0_CPP_TEST_UTILS_H
+#define DUCC0_CPP_TEST_UTILS_H
+
+#include <cmath>
+#include <complex>
+#include <cstddef>
+#include <iostream>
+#include <random>
+#include <string>
+#include "ducc0/infra/mav.h"
+
+namespace ducc0 {
+
+namespace test {
+
+using namespace std;
+
+inline size_t &nchecks()
+  {
+  static size_t res=0;
+  return res;
+  }
+inline size_t &nfailed()
+  {
+  static size_t res=0;
+  return res;
+  }
+
+/// Records a failed check if \a cond is \c false.
+inline void check(bool cond, const string &what)
+  {
+  ++nchecks();
+  if (cond) return;
+  ++nfailed();
+  cerr << "FAILED: " << what << endl;
+  }
+
+/// Records a failed check if \a err exceeds \a tol.
+inline void check_err(double err, double tol, const string &what)
+  {
+  ++nchecks();
+  if (err<=tol) return;
+  ++nfailed();
+  cerr << "FAILED: " << what << " (error " << err << ", tolerance " << tol
+       << ")" << endl;
+  }
+
+/// Runs \a func and records a failed check if it does not throw.
+template<typename Func> void check_throws(Func func, const string &what)
+  {
+  bool thrown=false;
+  try { func(); }
+  catch (const exception &) { thrown=true; }
+  check(thrown, what+" must throw");
+  }
+
+/// Prints a summary and returns the exit code of the test program.
+inline int finish(const string &name)
+  {
+  if (nfailed()==0)
+    {
+    cout << name << ": all " << nchecks() << " checks passed" << endl;
+    return 0;
+    }
+  cout << name << ": " << nfailed() << " of " << nchecks()
+       << " checks failed" << endl;
+  return 1;
+  }
+
+/// Fills \a arr with uniformly distributed random values in [-0.5; 0.5].
+template<typename T> void fill_random(vfmav<T> &arr, mt19937 &rng)
+  {
+  uniform_real_distribution<double> dist(-0.5, 0.5);
+  mav_apply([&](T &v) { v = T(dist(rng)); }, 1, arr);
+  }
+template<typename T> void fill_random(vfmav<complex<T>> &arr, mt19937 &rng)
+  {
+  uniform_real_distribution<double> dist(-0.5, 0.5);
+  mav_apply([&](complex<T> &v)
+    { v = complex<T>(T(dist(rng)), T(dist(rng))); }, 1, arr);
+  }
+
+/// Returns the L2 norm of a-b, divided by the L2 norm of \a b.
+template<typename T1, typename T2> double l2error(const cfmav<T1> &a,
+  const cfmav<T2> &b)
+  {
+  double sum=0, ref=0;
+  mav_apply([&](const T1 &va, const T2 &vb)
+    {
+    sum += norm(complex<double>(va)-complex<double>(vb));
+    ref += norm(complex<double>(vb));
+    }, 1, a, b);
+  return (ref==0) ? sqrt(sum) : sqrt(sum/ref);
+  }
+
+}}
+
+#endif
@@ -10,8 +10,10 @@ Creating the shared library:
 g++ -O3 -march=native -o ducc_julia.so ducc_julia.o -Wfatal-errors -pthread -std=c++17 -shared -fPIC
 */
 
+#include "ducc0/infra/string_utils.cc"
 #include "ducc0/infra/threading.cc"
 #include "ducc0/infra/mav.cc"
+#include "ducc0/infra/system.cc"
 #include "ducc0/math/gl_integrator.cc"
 #include "ducc0/math/gridding_kernel.cc"
 #include "ducc0/nufft/nufft.h"
@@ -0,0 +1,81 @@
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#
+# Copyright(C) 2023 Max-Planck-Society
+
+# Accuracy and throughput of the type 3 (nonuniform to nonuniform) NUFFT.
+# The error is measured against a direct summation over a subset of the
+# target frequencies.
+
+import ducc0
+import numpy as np
+from time import time
+
+try:
+    import finufft
+    have_finufft = True
+except ImportError:
+    have_finufft = False
+
+
+def direct_sum(coord, points, coord_out, forward):
+    isign = -1 if forward else 1
+    res = np.empty(coord_out.shape[0], dtype=np.complex128)
+    for i in range(coord_out.shape[0]):
+        res[i] = np.sum(points*np.exp(isign*1j*(coord@coord_out[i])))
+    return res
+
+
+def runbench(ndim, npoints, xmax, smax, nthreads, singleprec=False,
+             ncheck=100):
+    rng = np.random.default_rng(42)
+    rdtype = np.float32 if singleprec else np.float64
+    dtype = np.complex64 if singleprec else np.complex128
+    coord = (xmax*(2*rng.random((npoints, ndim))-1)).astype(rdtype)
+    coord_out = (smax*(2*rng.random((npoints, ndim))-1)).astype(rdtype)
+    points = (rng.random(npoints)-0.5 + 1j*(rng.random(npoints)-0.5)).astype(dtype)
+    ref = direct_sum(coord.astype(np.float64), points.astype(np.complex128),
+                     coord_out[:ncheck].astype(np.float64), True)
+    if singleprec:
+        epslist = [1e-6, 1e-5, 1e-4, 1e-3, 1e-2]
+    else:
+        epslist = [1e-13, 1e-12, 1e-10, 1e-8, 1e-6, 1e-4, 1e-2]
+    print(f"ndim={ndim}, npoints={npoints}, |x|<={xmax}, |s|<={smax}, "
+          f"nthreads={nthreads}, singleprec={singleprec}")
+    for eps in epslist:
+        t0 = time()
+        plan = ducc0.nufft.plan3(coord=coord, coord_out=coord_out,
+                                 epsilon=eps, nthreads=nthreads)
+        tplan = time()-t0
+        t0 = time()
+        res = plan.nu2nu(points=points, forward=True)
+        texec = time()-t0
+        err = ducc0.misc.l2error(res[:ncheck], ref)
+        line = (f"  eps={eps:8.1e}: ducc err={err:8.2e}, planning {tplan:7.3f}s, "
+                f"execution {texec:7.3f}s ({1e9*texec/npoints:7.1f}ns/point)")
+        if have_finufft:
+            t0 = time()
+            res = finufft.nufft1d3(coord[:,0], points, coord_out[:,0], eps=eps, isign=-1, nthreads=nthreads) if ndim == 1 else \
+                  finufft.nufft2d3(coord[:,0], coord[:,1], points, coord_out[:,0], coord_out[:,1], eps=eps, isign=-1, nthreads=nthreads) if ndim == 2 else \
+                  finufft.nufft3d3(coord[:,0], coord[:,1], coord[:,2], points, coord_out[:,0], coord_out[:,1], coord_out[:,2], eps=eps, isign=-1, nthreads=nthreads)
+            tfin = time()-t0
+            err = ducc0.misc.l2error(res[:ncheck], ref)
+            line += f"; finufft err={err:8.2e}, {tfin:7.3f}s"
+        print(line)
+
+
+runbench(1, 1000000, 1000., 500., 1)
+runbench(2, 1000000, 30., 30., 1)
+runbench(3, 1000000, 8., 8., 1)
+runbench(2, 1000000, 30., 30., 1, singleprec=True)
+runbench(3, 10000000, 8., 8., 8)
@@ -1,6 +1,7 @@
 #include "ducc0/infra/string_utils.cc"
 #include "ducc0/infra/threading.cc"
 #include "ducc0/infra/mav.cc"
+#include "ducc0/infra/system.cc"
 #include "ducc0/math/pointing.cc"
 #include "ducc0/math/geom_utils.cc"
 #include "ducc0/math/space_filling.cc"
@@ -10,6 +11,7 @@
 #include "ducc0/healpix/healpix_tables.cc"
 #include "ducc0/healpix/healpix_base.cc"
 #include "ducc0/wgridder/wgridder.cc"
+#include "ducc0/infra/cpu_isa.h"
 
 #include <pybind11/pybind11.h>
 #include "python/sht_pymod.cc"
@@ -23,13 +25,66 @@
 
 using namespace ducc0;
 
+#ifdef DUCC0_ISA_VARIANTS
+// Renames the module \a mod of an ISA variant to \a name and sets the
+// __module__ attribute of everything defined in it accordingly (recursing
+// into submodules). This way, the objects of the variant report the
+// name of the baseline module (e.g. "ducc0.fft" instead of "ducc0_avx2.fft")
+// in their reprs and documentation.
+void rename_module(pybind11::handle mod, const std::string &name)
+  {
+  mod.attr("__name__") = name;
+  for (auto item: mod.attr("__dict__").cast<pybind11::dict>())
+    {
+    auto key = item.first.cast<std::string>();
+    if (key.substr(0,2)=="__") continue;
+    if (pybind11::isinstance<pybind11::module_>(item.second))
+      rename_module(item.second, name+"."+key);
+    else if (pybind11::hasattr(item.second, "__module__"))
+      {
+      try { item.second.attr("__module__") = name; }
+      catch (pybind11::error_already_set &) {}  // read-only, leave it
+      }
+    }
+  }
+#endif
+
 PYBIND11_MODULE(PKGNAME, m)
   {
 #define DUCC0_XSTRINGIFY(s) DUCC0_STRINGIFY(s)
 #define DUCC0_STRINGIFY(s) #s
   m.attr("__version__") = DUCC0_XSTRINGIFY(PKGVERSION);
-#undef DUCC0_STRINGIFY
-#undef DUCC0_XSTRINGIFY
+  m.attr("__isa__") = compiled_isa();
+
+#ifdef DUCC0_ISA_VARIANTS
+  // This is the baseline build. If copies of the module compiled for more
+  // capable instruction sets were built alongside (as PKGNAME_<isa>), use
+  // the best one the CPU supports and expose its contents under our name.
+  {
+  std::vector<std::string> available{compiled_isa()};
+  std::string tmp(DUCC0_XSTRINGIFY(DUCC0_ISA_VARIANTS));
+  for (size_t pos=0; pos<=tmp.size();)
+    {
+    auto end = std::min(tmp.find(',', pos), tmp.size());
+    if (end>pos) available.push_back(tmp.substr(pos, end-pos));
+    pos = end+1;
+    }
+  auto isa = select_isa(available);
+  if (isa!=compiled_isa())
+    {
+    std::string pkgname(DUCC0_XSTRINGIFY(PKGNAME));
+    auto variant = pybind11::module_::import((pkgname+"_"+isa).c_str());
+    for (auto item: variant.attr("__dict__").cast<pybind11::dict>())
+      {
+      auto name = item.first.cast<std::string>();
+      if ((name.substr(0,2)!="__") || (name=="__isa__"))
+        m.attr(name.c_str()) = item.second;
+      }
+    rename_module(variant, pkgname);
+    return;
+    }
+  }
+#endif
 
   add_fft(m);
   add_sht(m);
@@ -39,4 +94,6 @@ PYBIND11_MODULE(PKGNAME, m)
   add_misc(m);
   add_pointingprovider(m);
   add_nufft(m);
+#undef DUCC0_STRINGIFY
+#undef DUCC0_XSTRINGIFY
   }
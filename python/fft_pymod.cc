@@ -42,6 +42,8 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <complex>
 
 #include "ducc0/fft/fft.h"
+#include "ducc0/fft/fft_streaming.h"
+#include "ducc0/fft/fft_ooc.h"
 #include "ducc0/bindings/pybind_utils.h"
 
 namespace ducc0 {
@@ -68,17 +70,17 @@ using f64 = double;
 using flong = ldbl_t;
 auto None = py::none();
 
-shape_t makeaxes(const py::array &in, const py::object &axes)
+shape_t makeaxes(size_t ndim_, const py::object &axes)
   {
   if (axes.is_none())
     {
-    shape_t res(size_t(in.ndim()));
+    shape_t res(ndim_);
     for (size_t i=0; i<res.size(); ++i)
       res[i]=i;
     return res;
     }
   auto tmp=axes.cast<std::vector<ptrdiff_t>>();
-  auto ndim = in.ndim();
+  auto ndim = ptrdiff_t(ndim_);
   if ((tmp.size()>size_t(ndim)) || (tmp.size()==0))
     throw std::runtime_error("bad axes argument");
   for (auto& sz: tmp)
@@ -90,6 +92,8 @@ shape_t makeaxes(const py::array &in, const py::object &axes)
     }
   return shape_t(tmp.begin(), tmp.end());
   }
+shape_t makeaxes(const py::array &in, const py::object &axes)
+  { return makeaxes(size_t(in.ndim()), axes); }
 
 #define DISPATCH(arr, T1, T2, T3, func, args) \
   { \
@@ -432,6 +436,244 @@ py::array convolve_axis(const py::array &in, py::array &out, size_t axis,
       kernel, nthreads))
   }
 
+template<typename T> py::dict c2c_out_of_core_internal(const py::array &a,
+  const py::object &axes_, bool forward, int inorm, size_t max_memory,
+  size_t nthreads)
+  {
+  auto axes = makeaxes(a, axes_);
+  auto arr = to_vfmav<std::complex<T>>(a);
+  ducc0::OocInfo info;
+  {
+  py::gil_scoped_release gil_release;
+  T fct = norm_fct<T>(inorm, arr.shape(), axes);
+  // pages are only released if the array lives in a shared file mapping
+  info = ducc0::c2c_out_of_core(arr, axes, forward, fct, max_memory, nthreads,
+    true);
+  }
+  py::dict res;
+  res["npasses"] = info.npasses;
+  res["nblocks"] = info.nblocks;
+  res["max_block"] = info.max_block;
+  res["peak_rss"] = info.peak_rss;
+  return res;
+  }
+
+py::dict c2c_out_of_core(const py::array &a, const py::object &axes_,
+  bool forward, int inorm, size_t max_memory, size_t nthreads)
+  {
+  DISPATCH(a, c128, c64, clong, c2c_out_of_core_internal, (a, axes_, forward,
+    inorm, max_memory, nthreads))
+  }
+
+py::dict plan_cache_info()
+  {
+  auto stats = ducc0::plan_cache_stats();
+  py::dict res;
+  res["capacity"] = stats.capacity;
+  res["size"] = stats.size;
+  res["hits"] = stats.hits;
+  res["misses"] = stats.misses;
+  res["evictions"] = stats.evictions;
+  return res;
+  }
+
+void set_planner_mode(const std::string &mode)
+  {
+  if (mode=="estimate")
+    ducc0::set_planner_mode(ducc0::PlannerMode::estimate);
+  else if (mode=="measure")
+    ducc0::set_planner_mode(ducc0::PlannerMode::measure);
+  else
+    MR_fail("unknown planner mode '", mode, "'");
+  }
+
+class Py_DcstPlan
+  {
+  private:
+    std::unique_ptr<DcstPlan<f32>> pf;
+    std::unique_ptr<DcstPlan<f64>> pd;
+    shape_t shape;
+    double fct;
+
+    template<typename T> py::array exec2(const DcstPlan<T> &plan,
+      const py::array &in, py::object &out_, size_t nthreads) const
+      {
+      auto ain = to_cfmav<T>(in);
+      auto out = get_optional_Pyarr<T>(out_, ain.shape());
+      auto aout = to_vfmav<T>(out);
+      {
+      py::gil_scoped_release release;
+      plan.exec(ain, aout, T(fct), nthreads);
+      }
+      return out;
+      }
+
+  public:
+    Py_DcstPlan(const std::vector<size_t> &shape_, int type, bool cosine,
+      const py::object &axes_, int inorm, const py::object &dtype_)
+      : shape(shape_.begin(), shape_.end())
+      {
+      auto axes = makeaxes(shape.size(), axes_);
+      fct = (type==1) ? norm_fct<double>(inorm, shape, axes, 2, cosine ? -1 : 1)
+                      : norm_fct<double>(inorm, shape, axes, 2);
+      bool ortho = inorm == true;
+      auto dtype = py::dtype::from_args(dtype_);
+      if (dtype.equal(py::dtype::of<f64>()))
+        pd = std::make_unique<DcstPlan<f64>>(shape, axes, type, cosine, ortho);
+      else if (dtype.equal(py::dtype::of<f32>()))
+        pf = std::make_unique<DcstPlan<f32>>(shape, axes, type, cosine, ortho);
+      else
+        MR_fail("unsupported data type");
+      }
+
+    py::array exec(const py::array &in, py::object &out_, size_t nthreads) const
+      {
+      return pd ? exec2(*pd, in, out_, nthreads) : exec2(*pf, in, out_, nthreads);
+      }
+  };
+
+class Py_StreamingConvolver
+  {
+  private:
+    std::unique_ptr<StreamingConvolver<f32>> pf;
+    std::unique_ptr<StreamingConvolver<f64>> pd;
+    std::unique_ptr<StreamingConvolver<c64>> pcf;
+    std::unique_ptr<StreamingConvolver<c128>> pcd;
+
+    template<typename T> static py::array push2(StreamingConvolver<T> &conv,
+      const py::array &in_, size_t nthreads)
+      {
+      auto in = to_cmav<T,1>(in_);
+      auto res_ = make_Pyarr<T>({conv.n_output(in.shape(0))});
+      auto res = to_vmav<T,1>(res_);
+      {
+      py::gil_scoped_release release;
+      conv.push(in, res, nthreads);
+      }
+      return res_;
+      }
+    template<typename T> static py::array flush2(StreamingConvolver<T> &conv,
+      size_t nthreads)
+      {
+      auto res_ = make_Pyarr<T>({conv.n_pending()});
+      auto res = to_vmav<T,1>(res_);
+      {
+      py::gil_scoped_release release;
+      conv.flush(res, nthreads);
+      }
+      return res_;
+      }
+
+  public:
+    Py_StreamingConvolver(const py::array &kernel, size_t nfft)
+      {
+      if (isPyarr<f32>(kernel))
+        pf = std::make_unique<StreamingConvolver<f32>>(to_cmav<f32,1>(kernel), nfft);
+      else if (isPyarr<f64>(kernel))
+        pd = std::make_unique<StreamingConvolver<f64>>(to_cmav<f64,1>(kernel), nfft);
+      else if (isPyarr<c64>(kernel))
+        pcf = std::make_unique<StreamingConvolver<c64>>(to_cmav<c64,1>(kernel), nfft);
+      else if (isPyarr<c128>(kernel))
+        pcd = std::make_unique<StreamingConvolver<c128>>(to_cmav<c128,1>(kernel), nfft);
+      else
+        MR_fail("unsupported kernel data type");
+      }
+
+    py::array push(const py::array &in, size_t nthreads)
+      {
+      if (pf) return push2(*pf, in, nthreads);
+      if (pd) return push2(*pd, in, nthreads);
+      if (pcf) return push2(*pcf, in, nthreads);
+      return push2(*pcd, in, nthreads);
+      }
+    py::array flush(size_t nthreads)
+      {
+      if (pf) return flush2(*pf, nthreads);
+      if (pd) return flush2(*pd, nthreads);
+      if (pcf) return flush2(*pcf, nthreads);
+      return flush2(*pcd, nthreads);
+      }
+    void reset()
+      {
+      if (pf) pf->reset();
+      if (pd) pd->reset();
+      if (pcf) pcf->reset();
+      if (pcd) pcd->reset();
+      }
+    size_t fft_length() const
+      {
+      return pf ? pf->fft_length() : (pd ? pd->fft_length() :
+        (pcf ? pcf->fft_length() : pcd->fft_length()));
+      }
+    size_t n_pending() const
+      {
+      return pf ? pf->n_pending() : (pd ? pd->n_pending() :
+        (pcf ? pcf->n_pending() : pcd->n_pending()));
+      }
+  };
+
+class Py_StreamingSTFT
+  {
+  private:
+    std::unique_ptr<StreamingSTFT<f32>> pf;
+    std::unique_ptr<StreamingSTFT<f64>> pd;
+    std::unique_ptr<StreamingSTFT<c64>> pcf;
+    std::unique_ptr<StreamingSTFT<c128>> pcd;
+
+    template<typename T> static py::array push2(StreamingSTFT<T> &stft,
+      const py::array &in_, size_t nthreads)
+      {
+      using Tc = std::complex<typename StreamingSTFT<T>::Treal>;
+      auto in = to_cmav<T,1>(in_);
+      auto res_ = make_Pyarr<Tc>({stft.n_frames(in.shape(0)), stft.n_bins()});
+      auto res = to_vmav<Tc,2>(res_);
+      {
+      py::gil_scoped_release release;
+      stft.push(in, res, nthreads);
+      }
+      return res_;
+      }
+
+  public:
+    Py_StreamingSTFT(const py::array &window, size_t hop, size_t nfft,
+      bool real_input)
+      {
+      if (isPyarr<f32>(window))
+        {
+        auto win = to_cmav<f32,1>(window);
+        if (real_input)
+          pf = std::make_unique<StreamingSTFT<f32>>(win, hop, nfft);
+        else
+          pcf = std::make_unique<StreamingSTFT<c64>>(win, hop, nfft);
+        }
+      else if (isPyarr<f64>(window))
+        {
+        auto win = to_cmav<f64,1>(window);
+        if (real_input)
+          pd = std::make_unique<StreamingSTFT<f64>>(win, hop, nfft);
+        else
+          pcd = std::make_unique<StreamingSTFT<c128>>(win, hop, nfft);
+        }
+      else
+        MR_fail("unsupported window data type");
+      }
+
+    py::array push(const py::array &in, size_t nthreads)
+      {
+      if (pf) return push2(*pf, in, nthreads);
+      if (pd) return push2(*pd, in, nthreads);
+      if (pcf) return push2(*pcf, in, nthreads);
+      return push2(*pcd, in, nthreads);
+      }
+    void reset()
+      {
+      if (pf) pf->reset();
+      if (pd) pd->reset();
+      if (pcf) pcf->reset();
+      if (pcd) pcd->reset();
+      }
+  };
+
 const char *fft_DS = R"""(Fast Fourier, sine/cosine, and Hartley transforms.
 
 This module supports
@@ -835,6 +1077,286 @@ out : int
 
 )""";
 
+const char *c2c_out_of_core_DS = R"""(Performs an in-place complex FFT of an array
+which may be larger than main memory.
+
+The array is processed in blocks of at most about `max_memory` bytes. If `a`
+lies in a shared mapping of a file (e.g. a `numpy.memmap` opened with mode
+"r+" or "w+"), the pages of every processed block are written back to the
+file and removed from memory, so that the resident memory of the process
+stays close to `max_memory`. Such mappings are only detected on systems
+providing /proc/self/maps (e.g. Linux).
+All transformed trailing axes that fit into this limit are handled in one
+pass over the file; every other transformed axis requires one additional pass.
+
+Parameters
+----------
+a : numpy.ndarray or numpy.memmap (C-contiguous, any complex type)
+    The data to transform. It is overwritten with the result.
+axes : list of integers
+    The axes along which the FFT is carried out.
+    If not set, all axes will be transformed.
+forward : bool
+    If `True`, a negative sign is used in the exponent, else a positive one.
+inorm : int
+    Normalization type
+      | 0 : no normalization
+      | 1 : divide by sqrt(N)
+      | 2 : divide by N
+
+    where N is the product of the lengths of the transformed axes.
+max_memory : int
+    Approximate upper limit for the amount of data (in bytes) kept in memory.
+    Must be large enough to hold one line along every transformed axis.
+nthreads : int
+    Number of threads to use. If 0, use the system default (typically the number
+    of hardware threads on the compute node).
+
+Returns
+-------
+dict
+    with the entries "npasses" (number of passes over the data), "nblocks"
+    (number of processed blocks), "max_block" (size of the largest block in
+    bytes) and "peak_rss" (largest resident set size of the process observed
+    during the transform in bytes, 0 if not available).
+)""";
+
+const char *DcstPlan_DS = R"""(
+Multidimensional DCT or DST for repeated use on arrays of a fixed shape.
+
+The object keeps the 1D plans and twiddle factors for all transformed axes.
+Transformed axes at the end of the array which (together with the axes
+between them) fit into the CPU cache are processed in a single sweep over the
+array instead of one sweep per axis.
+)""";
+
+const char *DcstPlan_init_DS = R"""(
+Prepares the transform.
+
+Parameters
+----------
+shape : tuple of int
+    The shape of the arrays to be transformed.
+type : integer
+    the type of the transform. Must be in [1; 4].
+cosine : bool
+    If True, DCTs are computed, otherwise DSTs.
+axes : list of integers
+    The axes along which the transform is carried out.
+    If not set, all axes will be transformed.
+inorm : integer
+    the normalization type (see `dct` and `dst`)
+dtype : numpy.dtype
+    the data type of the arrays (numpy.float32 or numpy.float64)
+)""";
+
+const char *DcstPlan_exec_DS = R"""(
+Carries out the transform.
+
+Parameters
+----------
+a : numpy.ndarray (shape and dtype given to the constructor)
+    The input data
+out : numpy.ndarray (same shape and data type as `a`)
+    May be identical to `a`, but if it isn't, it must not overlap with `a`.
+    If None, a new array is allocated to store the output.
+nthreads : int
+    Number of threads to use. If 0, use the system default (typically the number
+    of hardware threads on the compute node).
+
+Returns
+-------
+numpy.ndarray (same shape and data type as `a`)
+    The transformed data
+)""";
+
+const char *plan_cache_info_DS = R"""(Returns usage statistics of the FFT plan cache.
+
+Returns
+-------
+dict
+    with the entries "capacity" (maximum number of cached plans per plan
+    type), "size" (current number of cached plans of all types), "hits",
+    "misses", and "evictions"
+    (counters since program start or the last call to `clear_plan_cache`).
+)""";
+
+const char *set_plan_cache_size_DS = R"""(Sets the maximum number of cached FFT plans per plan type.
+
+Parameters
+----------
+size : int
+    The new capacity. If the cache currently holds more plans of a type, the
+    least recently used ones are discarded. A value of 0 disables plan
+    caching.
+
+Notes
+-----
+The limit applies separately to every kind of plan (complex, real, DCT/DST,
+... in single and double precision), so that mixed workloads do not evict
+each other's plans.
+The initial capacity is taken from the environment variable
+`DUCC0_FFT_PLAN_CACHE_SIZE` and defaults to 10.
+)""";
+
+const char *clear_plan_cache_DS = R"""(Removes all plans from the FFT plan cache and
+resets its statistics.
+)""";
+
+const char *save_wisdom_DS = R"""(Writes a description of all cached FFT plans to a file.
+
+Parameters
+----------
+filename : str
+    The name of the output file.
+
+Notes
+-----
+The file can be read by `load_wisdom` in a different process, which allows
+quick start-up of worker processes that need the same set of transforms.
+It is only meaningful for the same build of ducc0.
+All algorithm choices made by the "measure" planner are written as well.
+)""";
+
+const char *set_planner_mode_DS = R"""(Selects how the 1D FFT algorithms are chosen.
+
+Parameters
+----------
+mode : str
+    "estimate": use built-in heuristics (the default)
+    "measure": benchmark several factorizations and algorithms for every new
+    transform length and use the fastest one
+
+Notes
+-----
+The initial mode can also be set via the environment variable
+DUCC0_FFT_PLANNER.
+"measure" makes plan creation considerably more expensive, but the chosen
+algorithms are remembered for the rest of the process and can be stored
+with `save_wisdom`. Plans which are already in the plan cache are not
+affected; call `clear_plan_cache` to enforce re-planning.
+)""";
+
+const char *load_wisdom_DS = R"""(Reads a file written by `save_wisdom` and
+prepares the listed FFT plans.
+
+Parameters
+----------
+filename : str
+    The name of the input file.
+
+Notes
+-----
+Plans for transform types that were already used in this process are built
+immediately, all others as soon as their transform type is first requested.
+The number of retained plans is limited by the cache capacity.
+)""";
+
+const char *StreamingConvolver_DS = R"""(
+Causal FIR filter for data streams of arbitrary length.
+
+For a kernel `h` of length M, output sample `n` is
+``sum(h[k]*x[n-k] for k in range(M))``, where samples before the start of the
+stream are taken as zero. The input can be supplied in chunks of arbitrary
+size; output is produced blockwise by the overlap-save method as soon as it
+is available. Memory consumption does not depend on the length of the stream.
+)""";
+
+const char *StreamingConvolver_init_DS = R"""(
+StreamingConvolver constructor
+
+Parameters
+----------
+kernel : numpy.ndarray((M,), dtype=numpy.float32, numpy.float64, numpy.complex64 or numpy.complex128)
+    The convolution kernel. Its data type determines the data type of the
+    stream.
+nfft : int
+    The FFT length used for processing the stream. Must be 0 (in which case
+    a suitable length is chosen automatically) or at least M.
+)""";
+
+const char *StreamingConvolver_push_DS = R"""(
+Appends a chunk to the stream and returns the newly available output.
+
+Parameters
+----------
+in : numpy.ndarray((nin,), same type as the kernel)
+    the next input samples
+nthreads : int
+    Number of threads to use. If 0, use the system default (typically the number
+    of hardware threads on the compute node).
+
+Returns
+-------
+numpy.ndarray((nout,), same type as the kernel)
+    the output samples for all input blocks completed by this chunk.
+    These directly continue the output of previous calls.
+)""";
+
+const char *StreamingConvolver_flush_DS = R"""(
+Returns the output for all pending input samples and resets the stream.
+
+Parameters
+----------
+nthreads : int
+    Number of threads to use. If 0, use the system default (typically the number
+    of hardware threads on the compute node).
+
+Returns
+-------
+numpy.ndarray((n_pending(),), same type as the kernel)
+    the remaining output samples
+
+Notes
+-----
+To obtain the full linear convolution, push M-1 zeros before calling this
+method.
+)""";
+
+const char *StreamingSTFT_DS = R"""(
+Short-time Fourier transform of data streams of arbitrary length.
+
+Frame `j` covers the input samples ``x[j*hop:j*hop+nwin]``, which are multiplied
+with the window, zero-padded to length `nfft` and transformed forward without
+normalization. Frames are returned as soon as all their samples have been
+supplied. Memory consumption does not depend on the length of the stream.
+)""";
+
+const char *StreamingSTFT_init_DS = R"""(
+StreamingSTFT constructor
+
+Parameters
+----------
+window : numpy.ndarray((nwin,), dtype=numpy.float32 or numpy.float64)
+    The window function. Its data type determines the precision of the
+    stream.
+hop : int
+    The distance between the starting samples of subsequent frames.
+nfft : int
+    The FFT length. Must be 0 (in which case nwin is used) or at least nwin.
+real_input : bool
+    If True, the stream is real-valued and only the nfft//2+1 non-negative
+    frequencies are returned; otherwise the stream is complex-valued and all
+    nfft frequencies are returned in the usual FFT ordering.
+)""";
+
+const char *StreamingSTFT_push_DS = R"""(
+Appends a chunk to the stream and returns the newly completed frames.
+
+Parameters
+----------
+in : numpy.ndarray((nin,), real or complex with the precision of the window)
+    the next input samples
+nthreads : int
+    Number of threads to use. If 0, use the system default (typically the number
+    of hardware threads on the compute node).
+
+Returns
+-------
+numpy.ndarray((nframes, nbins), complex with the precision of the window)
+    the spectra of all frames completed by this chunk.
+)""";
+
 } // unnamed namespace
 
 void add_fft(py::module_ &msup)
@@ -864,6 +1386,45 @@ void add_fft(py::module_ &msup)
   m.def("convolve_axis", convolve_axis, convolve_axis_DS, "in"_a, "out"_a,
     "axis"_a, "kernel"_a, "nthreads"_a=1);
 
+  py::class_<Py_DcstPlan> (m, "DcstPlan", py::module_local(), DcstPlan_DS)
+    .def(py::init<const std::vector<size_t> &, int, bool, const py::object &,
+      int, const py::object &>(), DcstPlan_init_DS, "shape"_a, "type"_a,
+      "cosine"_a=true, "axes"_a=None, "inorm"_a=0, "dtype"_a=py::dtype::of<f64>())
+    .def("exec", &Py_DcstPlan::exec, DcstPlan_exec_DS, "a"_a, "out"_a=None,
+      "nthreads"_a=1);
+
+  py::class_<Py_StreamingConvolver> (m, "StreamingConvolver", py::module_local(),
+    StreamingConvolver_DS)
+    .def(py::init<const py::array &, size_t>(), StreamingConvolver_init_DS,
+      "kernel"_a, "nfft"_a=0)
+    .def("push", &Py_StreamingConvolver::push, StreamingConvolver_push_DS,
+      "in"_a, "nthreads"_a=1)
+    .def("flush", &Py_StreamingConvolver::flush, StreamingConvolver_flush_DS,
+      "nthreads"_a=1)
+    .def("reset", &Py_StreamingConvolver::reset)
+    .def("fft_length", &Py_StreamingConvolver::fft_length)
+    .def("n_pending", &Py_StreamingConvolver::n_pending);
+  py::class_<Py_StreamingSTFT> (m, "StreamingSTFT", py::module_local(),
+    StreamingSTFT_DS)
+    .def(py::init<const py::array &, size_t, size_t, bool>(),
+      StreamingSTFT_init_DS, "window"_a, "hop"_a, "nfft"_a=0,
+      "real_input"_a=true)
+    .def("push", &Py_StreamingSTFT::push, StreamingSTFT_push_DS, "in"_a,
+      "nthreads"_a=1)
+    .def("reset", &Py_StreamingSTFT::reset);
+
+  m.def("c2c_out_of_core", c2c_out_of_core, c2c_out_of_core_DS, "a"_a,
+    "axes"_a=None, "forward"_a=true, "inorm"_a=0, "max_memory"_a=size_t(1)<<30,
+    "nthreads"_a=1);
+
+  m.def("plan_cache_info", plan_cache_info, plan_cache_info_DS);
+  m.def("set_plan_cache_size", ducc0::set_plan_cache_capacity,
+    set_plan_cache_size_DS, "size"_a);
+  m.def("clear_plan_cache", ducc0::clear_plan_cache, clear_plan_cache_DS);
+  m.def("save_wisdom", ducc0::save_wisdom, save_wisdom_DS, "filename"_a);
+  m.def("load_wisdom", ducc0::load_wisdom, load_wisdom_DS, "filename"_a);
+  m.def("set_planner_mode", set_planner_mode, set_planner_mode_DS, "mode"_a);
+
   static PyMethodDef good_size_meth[] =
     {{"good_size", good_size, METH_VARARGS, good_size_DS},
      {nullptr, nullptr, 0, nullptr}};
@@ -32,6 +32,7 @@
 #include <complex>
 
 #include "ducc0/infra/mav.h"
+#include "ducc0/infra/threading.h"
 #include "ducc0/infra/transpose.h"
 #include "ducc0/math/constants.h"
 #include "ducc0/math/gl_integrator.h"
@@ -693,6 +694,93 @@ Notes
 `inp` and `out` must not overlap in memory.
 )""";
 
+constexpr const char *Py_async_call_DS = R"""(
+Calls `func(*args, **kwargs)` asynchronously.
+
+The call is appended to a queue of jobs which are executed one after the other
+on a dedicated background thread; this function returns immediately.
+All transforms of this package (e.g. `fft.c2c`, `fft.r2c`, `nufft.nu2u`,
+`sht.synthesis`, `wgridder.ms2dirty`) release the GIL during the actual
+computation, so the calling thread can do other work in the meantime, and
+the transforms can still use all threads requested via their `nthreads`
+argument.
+
+Parameters
+----------
+func : callable
+    the function to call
+args, kwargs :
+    the arguments passed to `func`
+
+Returns
+-------
+AsyncResult
+    a `concurrent.futures.Future` which will hold the return value of `func`
+    (or the exception raised by it). It can also be awaited in `asyncio`
+    coroutines.
+
+Notes
+-----
+Input and output arrays must not be modified or deallocated by the caller
+before the returned future has completed.
+Calls which have not started when the process forks (e.g. via
+`multiprocessing`) are not executed in the child process, and their futures
+never complete there.
+)""";
+
+constexpr const char *AsyncResult_DS = R"""(
+Result of `async_call`.
+
+This is a `concurrent.futures.Future` which in addition can be awaited in
+`asyncio` coroutines.
+)""";
+
+py::object make_AsyncResult(const py::module_ &m)
+  {
+  auto await = py::cpp_function([](py::object self)
+    {
+    auto fut = py::module_::import("asyncio").attr("wrap_future")(self);
+    return fut.attr("__await__")();
+    });
+  py::dict ns;
+  ns["__doc__"] = AsyncResult_DS;
+  ns["__module__"] = m.attr("__name__");
+  // wrap in an instancemethod, so that `self` is bound on attribute lookup
+  ns["__await__"] = py::reinterpret_steal<py::object>
+    (PyInstanceMethod_New(await.ptr()));
+  auto base = py::module_::import("concurrent.futures").attr("Future");
+  auto type = py::module_::import("builtins").attr("type");
+  return type("AsyncResult", py::make_tuple(base), ns);
+  }
+
+py::object Py_async_call(const py::object &cls, const py::object &func,
+  const py::args &args, const py::kwargs &kwargs)
+  {
+  struct Job
+    { py::object fut, func; py::args args; py::kwargs kwargs; };
+  // The job's Python objects must only be touched while holding the GIL,
+  // so they are kept on the heap and deleted explicitly by the job.
+  auto job = new Job{cls(), func, args, kwargs};
+  auto res = job->fut;
+  execAsync([job]()
+    {
+    py::gil_scoped_acquire gil;
+    unique_ptr<Job> j(job);
+    if (!j->fut.attr("set_running_or_notify_cancel")().cast<bool>())
+      return;  // cancelled before it was started
+    try
+      { j->fut.attr("set_result")(j->func(*j->args, **j->kwargs)); }
+    catch (py::error_already_set &e)
+      { j->fut.attr("set_exception")(e.value()); }
+    catch (const exception &e)
+      {
+      j->fut.attr("set_exception")
+        (py::handle(PyExc_RuntimeError)(e.what()));
+      }
+    });
+  return res;
+  }
+
 constexpr const char *misc_DS = R"""(
 Various unsorted utilities
 
@@ -731,6 +819,19 @@ void add_misc(py::module_ &msup)
 
   m.def("roll_resize_roll", Py_roll_resize_roll, Py_roll_resize_roll_DS,
     "inp"_a, "out"_a, "roll_inp"_a, "roll_out"_a, "nthreads"_a=1);
+
+  auto cls = make_AsyncResult(m);
+  m.attr("AsyncResult") = cls;
+  m.def("async_call", [cls](const py::object &func, const py::args &args,
+    const py::kwargs &kwargs)
+    { return Py_async_call(cls, func, args, kwargs); },
+    Py_async_call_DS, "func"_a);
+  // finish pending asynchronous jobs while the interpreter is still alive
+  py::module_::import("atexit").attr("register")(py::cpp_function([]()
+    {
+    py::gil_scoped_release release;
+    execAsync([]{}).wait();
+    }));
   }
 
 }
@@ -117,6 +117,48 @@ py::array Py_nu2u(const py::array &points,
   MR_fail("not yet supported");
   }
 
+template<typename Tpoints, typename Tcoord> py::array Py2_nu2nu(
+  const py::array &points_, const py::array &coord_,
+  const py::array &coord_out_, bool forward, double epsilon, size_t nthreads,
+  py::object &out__, size_t verbosity, double sigma_min, double sigma_max)
+  {
+  auto coord = to_cmav<Tcoord,2>(coord_);
+  auto coord_out = to_cmav<Tcoord,2>(coord_out_);
+  auto points = to_cmav<complex<Tpoints>,1>(points_);
+  auto out_ = get_optional_Pyarr<complex<Tpoints>>(out__, {coord_out.shape(0)});
+  auto out = to_vmav<complex<Tpoints>,1>(out_);
+  {
+  py::gil_scoped_release release;
+  nu2nu<Tpoints,Tpoints>(coord, points, coord_out, forward, epsilon, nthreads,
+    out, verbosity, sigma_min, sigma_max);
+  }
+  return out_;
+  }
+py::array Py_nu2nu(const py::array &points, const py::array &coord,
+  const py::array &coord_out, bool forward, double epsilon, size_t nthreads,
+  py::object &out, size_t verbosity, double sigma_min, double sigma_max)
+  {
+  if (isPyarr<double>(coord))
+    {
+    if (isPyarr<complex<double>>(points))
+      return Py2_nu2nu<double, double>(points, coord, coord_out, forward,
+        epsilon, nthreads, out, verbosity, sigma_min, sigma_max);
+    else if (isPyarr<complex<float>>(points))
+      return Py2_nu2nu<float, double>(points, coord, coord_out, forward,
+        epsilon, nthreads, out, verbosity, sigma_min, sigma_max);
+    }
+  else if (isPyarr<float>(coord))
+    {
+    if (isPyarr<complex<double>>(points))
+      return Py2_nu2nu<double, float>(points, coord, coord_out, forward,
+        epsilon, nthreads, out, verbosity, sigma_min, sigma_max);
+    else if (isPyarr<complex<float>>(points))
+      return Py2_nu2nu<float, float>(points, coord, coord_out, forward,
+        epsilon, nthreads, out, verbosity, sigma_min, sigma_max);
+    }
+  MR_fail("not yet supported");
+  }
+
 class Py_Nufftplan
   {
   private:
@@ -152,6 +194,19 @@ class Py_Nufftplan
       bool forward, size_t verbosity, const py::array &points_,
       py::object &uniform__) const
       {
+      if (points_.ndim()==2)
+        {
+        auto points = to_cmav<complex<T>,2>(points_);
+        auto shp(uniform_shape);
+        shp.insert(shp.begin(), points.shape(0));
+        auto uniform_ = get_optional_Pyarr<complex<T>>(uniform__, shp);
+        auto uniform = to_vmav<complex<T>,ndim+1>(uniform_);
+        {
+        py::gil_scoped_release release;
+        ptr->nu2u(forward, verbosity, points, uniform);
+        }
+        return uniform_;
+        }
       auto points = to_cmav<complex<T>,1>(points_);
       auto uniform_ = get_optional_Pyarr<complex<T>>(uniform__, uniform_shape);
       auto uniform = to_vmav<complex<T>,ndim>(uniform_);
@@ -166,6 +221,18 @@ class Py_Nufftplan
       bool forward, size_t verbosity, const py::array &uniform_,
       py::object &points__) const
       {
+      if (size_t(uniform_.ndim())==ndim+1)
+        {
+        auto uniform = to_cmav<complex<T>,ndim+1>(uniform_);
+        auto points_ = get_optional_Pyarr<complex<T>>(points__,
+          {uniform.shape(0), npoints});
+        auto points = to_vmav<complex<T>,2>(points_);
+        {
+        py::gil_scoped_release release;
+        ptr->u2nu(forward, verbosity, uniform, points);
+        }
+        return points_;
+        }
       auto uniform = to_cmav<complex<T>,ndim>(uniform_);
       auto points_ = get_optional_Pyarr<complex<T>>(points__, {npoints});
       auto points = to_vmav<complex<T>,1>(points_);
@@ -175,6 +242,45 @@ class Py_Nufftplan
       }
       return points_;
       }
+    template<typename T, size_t ndim> void do_update_coords(
+      const unique_ptr<Nufft<T,T,T,ndim>> &ptr, const py::array &coord_)
+      {
+      auto coord = to_cmav<T,2>(coord_);
+      {
+      py::gil_scoped_release release;
+      ptr->update_coords(coord);
+      }
+      }
+    template<typename T, size_t ndim> void do_set_log2tile(
+      const unique_ptr<Nufft<T,T,T,ndim>> &ptr, int log2tile)
+      {
+      py::gil_scoped_release release;
+      ptr->set_log2tile(log2tile);
+      }
+    template<typename T, size_t ndim> void do_prep_toeplitz(
+      const unique_ptr<Nufft<T,T,T,ndim>> &ptr,
+      bool forward, size_t verbosity, const py::object &weights_)
+      {
+      auto weights = weights_.is_none() ? cmav<T,1>()
+                                        : to_cmav<T,1>(py::array(weights_));
+      {
+      py::gil_scoped_release release;
+      ptr->prep_toeplitz(forward, verbosity, weights);
+      }
+      }
+    template<typename T, size_t ndim> py::array do_apply_toeplitz(
+      const unique_ptr<Nufft<T,T,T,ndim>> &ptr,
+      const py::array &uniform_, py::object &out__)
+      {
+      auto uniform = to_cmav<complex<T>,ndim>(uniform_);
+      auto out_ = get_optional_Pyarr<complex<T>>(out__, uniform_shape);
+      auto out = to_vmav<complex<T>,ndim>(out_);
+      {
+      py::gil_scoped_release release;
+      ptr->apply_toeplitz(uniform, out);
+      }
+      return out_;
+      }
 
   public:
     Py_Nufftplan(bool gridding, const py::array &coord_,
@@ -238,8 +344,347 @@ class Py_Nufftplan
       if (pf3) return do_u2nu(pf3, forward, verbosity, uniform_, points_);
       MR_fail("unsupported");
       }
+    void update_coords(const py::array &coord)
+      {
+      if (pd1) return do_update_coords(pd1, coord);
+      if (pf1) return do_update_coords(pf1, coord);
+      if (pd2) return do_update_coords(pd2, coord);
+      if (pf2) return do_update_coords(pf2, coord);
+      if (pd3) return do_update_coords(pd3, coord);
+      if (pf3) return do_update_coords(pf3, coord);
+      MR_fail("unsupported");
+      }
+    void prep_toeplitz(bool forward, size_t verbosity,
+      const py::object &weights)
+      {
+      if (pd1) return do_prep_toeplitz(pd1, forward, verbosity, weights);
+      if (pf1) return do_prep_toeplitz(pf1, forward, verbosity, weights);
+      if (pd2) return do_prep_toeplitz(pd2, forward, verbosity, weights);
+      if (pf2) return do_prep_toeplitz(pf2, forward, verbosity, weights);
+      if (pd3) return do_prep_toeplitz(pd3, forward, verbosity, weights);
+      if (pf3) return do_prep_toeplitz(pf3, forward, verbosity, weights);
+      MR_fail("unsupported");
+      }
+    py::array apply_toeplitz(const py::array &uniform_, py::object &out_)
+      {
+      if (pd1) return do_apply_toeplitz(pd1, uniform_, out_);
+      if (pf1) return do_apply_toeplitz(pf1, uniform_, out_);
+      if (pd2) return do_apply_toeplitz(pd2, uniform_, out_);
+      if (pf2) return do_apply_toeplitz(pf2, uniform_, out_);
+      if (pd3) return do_apply_toeplitz(pd3, uniform_, out_);
+      if (pf3) return do_apply_toeplitz(pf3, uniform_, out_);
+      MR_fail("unsupported");
+      }
+    size_t kernel_cache_size() const
+      {
+      if (pd1) return pd1->kernel_cache_size();
+      if (pf1) return pf1->kernel_cache_size();
+      if (pd2) return pd2->kernel_cache_size();
+      if (pf2) return pf2->kernel_cache_size();
+      if (pd3) return pd3->kernel_cache_size();
+      if (pf3) return pf3->kernel_cache_size();
+      MR_fail("unsupported");
+      }
+    void set_kernel_cache(bool enable)
+      {
+      if (pd1) return pd1->set_kernel_cache(enable);
+      if (pf1) return pf1->set_kernel_cache(enable);
+      if (pd2) return pd2->set_kernel_cache(enable);
+      if (pf2) return pf2->set_kernel_cache(enable);
+      if (pd3) return pd3->set_kernel_cache(enable);
+      if (pf3) return pf3->set_kernel_cache(enable);
+      MR_fail("unsupported");
+      }
+    int log2tile() const
+      {
+      if (pd1) return pd1->get_log2tile();
+      if (pf1) return pf1->get_log2tile();
+      if (pd2) return pd2->get_log2tile();
+      if (pf2) return pf2->get_log2tile();
+      if (pd3) return pd3->get_log2tile();
+      if (pf3) return pf3->get_log2tile();
+      MR_fail("unsupported");
+      }
+    void set_log2tile(int log2tile)
+      {
+      if (pd1) return do_set_log2tile(pd1, log2tile);
+      if (pf1) return do_set_log2tile(pf1, log2tile);
+      if (pd2) return do_set_log2tile(pd2, log2tile);
+      if (pf2) return do_set_log2tile(pf2, log2tile);
+      if (pd3) return do_set_log2tile(pd3, log2tile);
+      if (pf3) return do_set_log2tile(pf3, log2tile);
+      MR_fail("unsupported");
+      }
+  };
+
+class Py_Nu2uStream
+  {
+  private:
+    vector<size_t> uniform_shape;
+    size_t ntrans;
+    bool batched;
+
+    unique_ptr<Nufft< float,  float,  float, 1>> pf1;
+    unique_ptr<Nufft<double, double, double, 1>> pd1;
+    unique_ptr<Nufft< float,  float,  float, 2>> pf2;
+    unique_ptr<Nufft<double, double, double, 2>> pd2;
+    unique_ptr<Nufft< float,  float,  float, 3>> pf3;
+    unique_ptr<Nufft<double, double, double, 3>> pd3;
+
+    template<typename T, size_t ndim> void construct(
+      unique_ptr<Nufft<T,T,T,ndim>> &ptr, size_t npoints,
+      const py::object &uniform_shape_, double epsilon_, size_t nthreads_,
+      double sigma_min, double sigma_max, double periodicity, bool fft_order_)
+      {
+      auto shp = to_array<size_t,ndim>(uniform_shape_);
+      {
+      py::gil_scoped_release release;
+      ptr = make_unique<Nufft<T,T,T,ndim>> (true, npoints, shp,
+        epsilon_, nthreads_, sigma_min, sigma_max, periodicity, fft_order_);
+      }
+      }
+    template<typename T, size_t ndim> void do_add(
+      const unique_ptr<Nufft<T,T,T,ndim>> &ptr, const py::array &coord_,
+      const py::array &points_)
+      {
+      auto coord = to_cmav<T,2>(coord_);
+      if (batched)
+        {
+        auto points = to_cmav<complex<T>,2>(points_);
+        py::gil_scoped_release release;
+        if (!ptr->nu2u_active()) ptr->nu2u_begin(ntrans);
+        ptr->nu2u_add(coord, points);
+        }
+      else
+        {
+        auto points = to_cmav<complex<T>,1>(points_);
+        py::gil_scoped_release release;
+        if (!ptr->nu2u_active()) ptr->nu2u_begin(ntrans);
+        ptr->nu2u_add(coord, points);
+        }
+      }
+    template<typename T, size_t ndim> py::array do_finish(
+      const unique_ptr<Nufft<T,T,T,ndim>> &ptr, bool forward,
+      size_t verbosity, py::object &uniform__)
+      {
+      auto shp(uniform_shape);
+      if (batched) shp.insert(shp.begin(), ntrans);
+      auto uniform_ = get_optional_Pyarr<complex<T>>(uniform__, shp);
+      if (batched)
+        {
+        auto uniform = to_vmav<complex<T>,ndim+1>(uniform_);
+        py::gil_scoped_release release;
+        if (!ptr->nu2u_active()) ptr->nu2u_begin(ntrans);
+        ptr->nu2u_finish(forward, verbosity, uniform);
+        }
+      else
+        {
+        auto uniform = to_vmav<complex<T>,ndim>(uniform_);
+        py::gil_scoped_release release;
+        if (!ptr->nu2u_active()) ptr->nu2u_begin(ntrans);
+        ptr->nu2u_finish(forward, verbosity, uniform);
+        }
+      return uniform_;
+      }
+
+  public:
+    Py_Nu2uStream(const py::object &uniform_shape_, double epsilon_,
+                  size_t npoints, const py::object &ntrans_, bool singleprec,
+                  size_t nthreads_, double sigma_min, double sigma_max,
+                  double periodicity, bool fft_order_)
+      : uniform_shape(py::cast<vector<size_t>>(uniform_shape_)),
+        ntrans(ntrans_.is_none() ? 1 : py::cast<size_t>(ntrans_)),
+        batched(!ntrans_.is_none())
+      {
+      auto ndim = uniform_shape.size();
+      MR_assert((ndim>=1)&&(ndim<=3), "unsupported dimensionality");
+      MR_assert(ntrans>0, "ntrans must be positive");
+      if (!singleprec)
+        {
+        if (ndim==1)
+          construct(pd1, npoints, uniform_shape_, epsilon_, nthreads_,
+            sigma_min, sigma_max, periodicity, fft_order_);
+        else if (ndim==2)
+          construct(pd2, npoints, uniform_shape_, epsilon_, nthreads_,
+            sigma_min, sigma_max, periodicity, fft_order_);
+        else if (ndim==3)
+          construct(pd3, npoints, uniform_shape_, epsilon_, nthreads_,
+            sigma_min, sigma_max, periodicity, fft_order_);
+        }
+      else
+        {
+        if (ndim==1)
+          construct(pf1, npoints, uniform_shape_, epsilon_, nthreads_,
+            sigma_min, sigma_max, periodicity, fft_order_);
+        else if (ndim==2)
+          construct(pf2, npoints, uniform_shape_, epsilon_, nthreads_,
+            sigma_min, sigma_max, periodicity, fft_order_);
+        else if (ndim==3)
+          construct(pf3, npoints, uniform_shape_, epsilon_, nthreads_,
+            sigma_min, sigma_max, periodicity, fft_order_);
+        }
+      }
+
+    void add(const py::array &coord, const py::array &points)
+      {
+      if (pd1) return do_add(pd1, coord, points);
+      if (pf1) return do_add(pf1, coord, points);
+      if (pd2) return do_add(pd2, coord, points);
+      if (pf2) return do_add(pf2, coord, points);
+      if (pd3) return do_add(pd3, coord, points);
+      if (pf3) return do_add(pf3, coord, points);
+      MR_fail("unsupported");
+      }
+    py::array finish(bool forward, size_t verbosity, py::object &out)
+      {
+      if (pd1) return do_finish(pd1, forward, verbosity, out);
+      if (pf1) return do_finish(pf1, forward, verbosity, out);
+      if (pd2) return do_finish(pd2, forward, verbosity, out);
+      if (pf2) return do_finish(pf2, forward, verbosity, out);
+      if (pd3) return do_finish(pd3, forward, verbosity, out);
+      if (pf3) return do_finish(pf3, forward, verbosity, out);
+      MR_fail("unsupported");
+      }
+  };
+
+class Py_Nufft3plan
+  {
+  private:
+    size_t npoints_out;
+
+    unique_ptr<Nufft3< float,  float,  float, 1>> pf1;
+    unique_ptr<Nufft3<double, double, double, 1>> pd1;
+    unique_ptr<Nufft3< float,  float,  float, 2>> pf2;
+    unique_ptr<Nufft3<double, double, double, 2>> pd2;
+    unique_ptr<Nufft3< float,  float,  float, 3>> pf3;
+    unique_ptr<Nufft3<double, double, double, 3>> pd3;
+
+    template<typename T, size_t ndim> void construct(
+      unique_ptr<Nufft3<T,T,T,ndim>> &ptr, const py::array &coord_,
+      const py::array &coord_out_, double epsilon_, size_t nthreads_,
+      double sigma_min, double sigma_max)
+      {
+      auto coord = to_cmav<T,2>(coord_);
+      auto coord_out = to_cmav<T,2>(coord_out_);
+      {
+      py::gil_scoped_release release;
+      ptr = make_unique<Nufft3<T,T,T,ndim>> (coord, coord_out, epsilon_,
+        nthreads_, sigma_min, sigma_max);
+      }
+      }
+    template<typename T, size_t ndim> py::array do_nu2nu(
+      const unique_ptr<Nufft3<T,T,T,ndim>> &ptr,
+      bool forward, size_t verbosity, const py::array &points_,
+      py::object &out__) const
+      {
+      auto points = to_cmav<complex<T>,1>(points_);
+      auto out_ = get_optional_Pyarr<complex<T>>(out__, {npoints_out});
+      auto out = to_vmav<complex<T>,1>(out_);
+      {
+      py::gil_scoped_release release;
+      ptr->nu2nu(forward, verbosity, points, out);
+      }
+      return out_;
+      }
+
+  public:
+    Py_Nufft3plan(const py::array &coord_, const py::array &coord_out_,
+                  double epsilon_, size_t nthreads_, double sigma_min,
+                  double sigma_max)
+      : npoints_out(coord_out_.shape(0))
+      {
+      MR_assert(coord_.ndim()==2, "coord must be a 2D array");
+      MR_assert(coord_out_.ndim()==2, "coord_out must be a 2D array");
+      auto ndim = size_t(coord_.shape(1));
+      MR_assert((ndim>=1)&&(ndim<=3), "unsupported dimensionality");
+      if (isPyarr<double>(coord_))
+        {
+        if (ndim==1)
+          construct(pd1, coord_, coord_out_, epsilon_, nthreads_, sigma_min,
+            sigma_max);
+        else if (ndim==2)
+          construct(pd2, coord_, coord_out_, epsilon_, nthreads_, sigma_min,
+            sigma_max);
+        else if (ndim==3)
+          construct(pd3, coord_, coord_out_, epsilon_, nthreads_, sigma_min,
+            sigma_max);
+        }
+      else if (isPyarr<float>(coord_))
+        {
+        if (ndim==1)
+          construct(pf1, coord_, coord_out_, epsilon_, nthreads_, sigma_min,
+            sigma_max);
+        else if (ndim==2)
+          construct(pf2, coord_, coord_out_, epsilon_, nthreads_, sigma_min,
+            sigma_max);
+        else if (ndim==3)
+          construct(pf3, coord_, coord_out_, epsilon_, nthreads_, sigma_min,
+            sigma_max);
+        }
+      else
+        MR_fail("unsupported");
+      }
+
+    py::array nu2nu(bool forward, size_t verbosity, const py::array &points_,
+      py::object &out_)
+      {
+      if (pd1) return do_nu2nu(pd1, forward, verbosity, points_, out_);
+      if (pf1) return do_nu2nu(pf1, forward, verbosity, points_, out_);
+      if (pd2) return do_nu2nu(pd2, forward, verbosity, points_, out_);
+      if (pf2) return do_nu2nu(pf2, forward, verbosity, points_, out_);
+      if (pd3) return do_nu2nu(pd3, forward, verbosity, points_, out_);
+      if (pf3) return do_nu2nu(pf3, forward, verbosity, points_, out_);
+      MR_fail("unsupported");
+      }
+    size_t kernel_cache_size() const
+      {
+      if (pd1) return pd1->kernel_cache_size();
+      if (pf1) return pf1->kernel_cache_size();
+      if (pd2) return pd2->kernel_cache_size();
+      if (pf2) return pf2->kernel_cache_size();
+      if (pd3) return pd3->kernel_cache_size();
+      if (pf3) return pf3->kernel_cache_size();
+      MR_fail("unsupported");
+      }
+    void set_kernel_cache(bool enable)
+      {
+      if (pd1) return pd1->set_kernel_cache(enable);
+      if (pf1) return pf1->set_kernel_cache(enable);
+      if (pd2) return pd2->set_kernel_cache(enable);
+      if (pf2) return pf2->set_kernel_cache(enable);
+      if (pd3) return pd3->set_kernel_cache(enable);
+      if (pf3) return pf3->set_kernel_cache(enable);
+      MR_fail("unsupported");
+      }
   };
 
+py::dict cost_model2dict(const NufftCostModel &model)
+  {
+  py::dict res;
+  res["fft_ref"] = model.fft_ref;
+  res["grid_ref"] = model.grid_ref;
+  res["max_fft_scaling"] = model.max_fft_scaling;
+  res["max_grid_scaling"] = model.max_grid_scaling;
+  res["scaling_power"] = model.scaling_power;
+  return res;
+  }
+
+py::dict get_cost_model()
+  { return cost_model2dict(get_nufft_cost_model()); }
+
+py::dict calibrate_cost_model(size_t nthreads, const py::object &filename,
+  bool quick)
+  {
+  NufftCostModel res;
+  {
+  py::gil_scoped_release release;
+  res = calibrate_nufft_cost_model(nthreads, quick);
+  }
+  if (!filename.is_none())
+    save_nufft_cost_model(filename.cast<string>());
+  return cost_model2dict(res);
+  }
+
 
 constexpr const char *u2nu_DS = R"""(
 Type 2 non-uniform FFT (uniform to non-uniform)
@@ -325,6 +770,93 @@ numpy.ndarray(1D/2D/3D, same dtype as points)
     Identical to `out`.
 )""";
 
+constexpr const char *nu2nu_DS = R"""(
+Type 3 non-uniform FFT (non-uniform to non-uniform)
+
+Computes out[k] = sum_j points[j] * exp(+-i * dot(coord_out[k], coord[j])).
+
+Parameters
+----------
+points : numpy.ndarray((npoints,), dtype=numpy.complex)
+    The input values at the non-uniform source points
+coord : numpy.ndarray((npoints, ndim), dtype=numpy.float32 or numpy.float64)
+    the coordinates of the npoints non-uniform source points.
+    Unlike for nu2u and u2nu, no periodicity is assumed.
+coord_out : numpy.ndarray((npoints_out, ndim), same dtype as coord)
+    the non-uniform target frequencies.
+forward : bool
+    if True, perform the transform with exponent -1, else +1.
+epsilon : float
+    desired accuracy
+    for single precision inputs, this must be >1e-6, for double precision it
+    must be >2e-13
+nthreads : int >= 0
+    the number of threads to use for the computation
+    if 0, use as many threads as there are hardware threads available on the system
+out : numpy.ndarray((npoints_out,), same dtype as points), optional
+    if provided, this will be used to store the result
+verbosity: int
+    0: no console output
+    1: some diagnostic console output
+sigma_min, sigma_max: float
+    minimum and maximum allowed oversampling factors
+    1.2 <= sigma_min < sigma_max <= 2.5
+
+Returns
+-------
+numpy.ndarray((npoints_out,), same dtype as points)
+    the computed values at the target frequencies.
+    Identical to `out` if it was provided
+
+Notes
+-----
+The cost of the transform grows with the product of the extents of `coord`
+and `coord_out` in every dimension.
+)""";
+
+constexpr const char *plan3_init_DS = R"""(
+Type 3 Nufft plan constructor
+
+Parameters
+----------
+coord : numpy.ndarray((npoints, ndim), dtype=numpy.float32 or numpy.float64)
+    the coordinates of the npoints non-uniform source points.
+coord_out : numpy.ndarray((npoints_out, ndim), same dtype as coord)
+    the non-uniform target frequencies.
+epsilon : float
+    desired accuracy
+    for single precision inputs, this must be >1e-6, for double precision it
+    must be >2e-13
+nthreads : int >= 0
+    the number of threads to use for the computation
+    if 0, use as many threads as there are hardware threads available on the system
+sigma_min, sigma_max: float
+    minimum and maximum allowed oversampling factors
+    1.2 <= sigma_min < sigma_max <= 2.5
+)""";
+
+constexpr const char *plan3_nu2nu_DS = R"""(
+Perform a pre-planned type 3 (nu2nu) transform.
+
+Parameters
+----------
+forward : bool
+    if True, perform the transform with exponent -1, else +1.
+verbosity: int
+    0: no console output
+    1: some diagnostic console output
+points : numpy.ndarray((npoints,), dtype=numpy.complex)
+    The input values at the non-uniform source points
+out : numpy.ndarray((npoints_out,), same dtype as points), optional
+    if provided, this will be used to store he result.
+
+Returns
+-------
+numpy.ndarray((npoints_out,), same dtype as points)
+    the computed values at the target frequencies.
+    Identical to `out` if it was provided.
+)""";
+
 constexpr const char *plan_init_DS = R"""(
 Nufft plan constructor
 
@@ -368,15 +900,19 @@ forward : bool
 verbosity: int
     0: no console output
     1: some diagnostic console output
-points : numpy.ndarray((npoints,), dtype=numpy.complex)
-    The input values at the specified non-uniform grid points
+points : numpy.ndarray((npoints,) or (ntrans, npoints), dtype=numpy.complex)
+    The input values at the specified non-uniform grid points.
+    If two-dimensional, `ntrans` independent data sets are transformed
+    together, sharing the kernel evaluations and FFT plans.
 out : numpy.ndarray(1D/2D/3D, same dtype as points)
     if provided, this will be used to store he result.
+    For batched input, it must have an additional leading axis of length
+    `ntrans`.
 
 Returns
 -------
 numpy.ndarray(1D/2D/3D, same dtype as points)
-    the computed grid values.
+    the computed grid values (with leading `ntrans` axis for batched input).
     Identical to `out` if it was provided.
 )""";
 
@@ -391,17 +927,204 @@ verbosity: int
     0: no console output
     1: some diagnostic console output
 grid : numpy.ndarray(1D/2D/3D, dtype=complex)
-    the grid of input data
-out : numpy.ndarray((npoints,), same data type as grid), optional
+    the grid of input data.
+    If it has one more dimension than the plan, the first axis runs over
+    `ntrans` independent data sets, which are transformed together.
+out : numpy.ndarray((npoints,) or (ntrans, npoints), same data type as grid), optional
     if provided, this will be used to store the result
 
 Returns
 -------
-numpy.ndarray((npoints,), same data type as grid)
+numpy.ndarray((npoints,) or (ntrans, npoints), same data type as grid)
     the computed values at the specified non-uniform grid points.
     Identical to `out` if it was provided.
 )""";
 
+constexpr const char *plan_prep_toeplitz_DS = R"""(
+Prepare the plan for applying the normal operator
+nu2u(forward=not forward, points=weights*u2nu(forward=forward, grid=x))
+via `apply_toeplitz`.
+
+This computes the point spread function of the non-uniform points (a nu2u
+transform of the weights onto a grid of twice the size of the uniform grid)
+and stores its Fourier transform. Afterwards, the normal operator can be
+applied with two FFTs and without any spreading or interpolation.
+
+Parameters
+----------
+forward : bool
+    the direction of the u2nu transform: if True, it is done with exponent -1,
+    else +1. The nu2u transform uses the opposite sign.
+verbosity: int
+    0: no console output
+    1: some diagnostic console output
+weights : numpy.ndarray((npoints,), dtype=float, same precision as the plan), optional
+    real-valued weights (e.g. density compensation) for the non-uniform
+    points. If not provided, all weights are 1.
+)""";
+
+constexpr const char *plan_apply_toeplitz_DS = R"""(
+Apply the normal operator prepared by `prep_toeplitz`.
+
+Parameters
+----------
+grid : numpy.ndarray(1D/2D/3D, dtype=complex)
+    the grid of input data
+out : numpy.ndarray(same shape and dtype as grid), optional
+    if provided, this will be used to store the result. May be identical
+    to `grid`.
+
+Returns
+-------
+numpy.ndarray(same shape and dtype as grid)
+    the result of the operator, which agrees with explicit u2nu and nu2u
+    transforms to roughly the accuracy of the plan.
+    Identical to `out` if it was provided.
+)""";
+
+constexpr const char *plan_kernel_cache_size_DS = R"""(
+Returns the amount of memory needed for storing the kernel weights of all
+non-uniform points (see `set_kernel_cache`).
+
+Returns
+-------
+int
+    the required memory in bytes
+)""";
+
+constexpr const char *plan_set_kernel_cache_DS = R"""(
+Switches storage of the kernel weights on or off.
+
+If switched on, the grid positions and kernel weights of all non-uniform
+points are computed at the beginning of the next transform and reused by all
+later ones, so that spreading and interpolation no longer evaluate the
+kernel. This trades memory (see `kernel_cache_size`) for speed and pays off
+when a plan is executed many times.
+
+Parameters
+----------
+enable : bool
+    whether the kernel weights should be stored
+)""";
+
+constexpr const char *plan_update_coords_DS = R"""(
+Replaces the coordinates of the non-uniform points.
+
+This is meant for coordinates which change only slightly between
+transforms. Points which stay within their tile keep their place in the
+processing order, and only the others are re-sorted, which is considerably
+cheaper than creating a new plan. Stored kernel weights (see
+`set_kernel_cache`) are recomputed on demand, and `prep_toeplitz` has to be
+called again before the next call to `apply_toeplitz`.
+
+Parameters
+----------
+coord : numpy.ndarray((npoints, ndim), dtype=numpy.float32 or numpy.float64)
+    the new coordinates of the non-uniform points.
+    Must have the same shape and data type as the coordinates passed to the
+    constructor.
+""")";
+
+constexpr const char *plan_log2tile_DS = R"""(
+Returns the base-2 logarithm of the linear tile size (in grid cells) used by
+this plan.
+
+Notes
+-----
+Spreading and interpolation process the points tile by tile, accumulating
+into a local buffer covering one tile plus the kernel support.
+Unless set explicitly with `set_log2tile`, the size is chosen from kernel
+support, point density and the size of the L2 cache.
+)""";
+
+constexpr const char *plan_set_log2tile_DS = R"""(
+Sets the linear tile size used by this plan to 2**log2tile grid cells.
+
+Parameters
+----------
+log2tile : int
+    the base-2 logarithm of the tile size, or 0 for an automatic choice.
+    The permitted range depends on dimensionality and grid size.
+
+Notes
+-----
+This only affects performance, not the results (apart from rounding).
+The coordinates stored in the plan are re-sorted for the new tiles.
+)""";
+
+constexpr const char *nu2u_stream_init_DS = R"""(
+Constructor of a streaming nu2u transform.
+
+The non-uniform points are passed in chunks via `add`, which spreads every
+chunk onto an oversampled grid that stays in memory; `finish` carries out the
+FFT and grid correction. Only a single chunk of coordinates and values has to
+be held in memory, so that data sets larger than main memory can be
+transformed straight from disk.
+
+Parameters
+----------
+grid_shape : tuple(int) of length ndim
+    the shape of the uniform grid
+epsilon : float
+    desired accuracy
+    for single precision inputs, this must be >1e-6, for double precision it
+    must be >2e-13
+npoints : int
+    the total number of non-uniform points. This is only used for choosing
+    kernel and oversampling factor; the chunks may have arbitrary sizes.
+ntrans : int, optional
+    if provided, `ntrans` independent data sets sharing the same coordinates
+    are transformed together, and points and results have an additional
+    leading axis of this length.
+singleprec : bool
+    True if np.float32/np.complex64 are used, otherwise False
+nthreads : int >= 0
+    the number of threads to use for the computation
+    if 0, use as many threads as there are hardware threads available on the system
+sigma_min, sigma_max: float
+    minimum and maximum allowed oversampling factors
+    1.2 <= sigma_min < sigma_max <= 2.5
+periodicity: float
+    periodicity of the coordinates
+fft_order: bool
+    if False, grids start with the most negative Fourier node
+    if True, grids start with the zero Fourier mode
+)""";
+
+constexpr const char *nu2u_stream_add_DS = R"""(
+Spreads a chunk of non-uniform points onto the oversampled grid.
+
+Parameters
+----------
+coord : numpy.ndarray((nchunk, ndim), dtype=numpy.float32 or numpy.float64)
+    the coordinates of the points in this chunk
+points : numpy.ndarray((nchunk,) or (ntrans, nchunk), dtype=numpy.complex)
+    the values at these points
+)""";
+
+constexpr const char *nu2u_stream_finish_DS = R"""(
+Completes the transform of all points added since the last call.
+
+Afterwards, the object can be reused for a new transform.
+
+Parameters
+----------
+forward : bool
+    if True, perform the FFT with exponent -1, else +1.
+verbosity: int
+    0: no console output
+    1: some diagnostic console output
+out : numpy.ndarray(1D/2D/3D, same dtype as points), optional
+    if provided, this will be used to store the result.
+    If `ntrans` was given, it must have an additional leading axis of this
+    length.
+
+Returns
+-------
+numpy.ndarray(1D/2D/3D, same dtype as points)
+    the computed grid values. Identical to `out` if it was provided.
+)""";
+
 constexpr const char *bestEpsilon_DS = R"""(
 Computes the smallest possible error for the given NUFFT parameters.
 
@@ -422,6 +1145,73 @@ float
 )""";
 
 
+constexpr const char *calibrate_cost_model_DS = R"""(
+Benchmarks FFTs and spreading on this machine and adapts the cost model,
+which selects kernel support and oversampling factor of NUFFT plans,
+to the results.
+
+Parameters
+----------
+nthreads : int
+    Number of threads to use. If larger than 1, the thread scaling of FFTs
+    and spreading is measured as well. If 0, use the system default.
+filename : str or None
+    if not None, the fitted cost model is also written to this file
+quick : bool
+    if True, much smaller problems are measured only once. This is about
+    20 times faster, but the resulting model is less reliable; it is
+    mainly useful for testing.
+
+Returns
+-------
+dict
+    the coefficients of the fitted cost model (see `get_cost_model`)
+
+Notes
+-----
+The new model is used for all NUFFTs planned afterwards in this process.
+Running the benchmarks takes about one second per thread count.
+A file written here can be read by `load_cost_model`, or by pointing the
+environment variable DUCC0_NUFFT_PROFILE to it, which makes it the initial
+cost model of every process using ducc0.
+)""";
+
+constexpr const char *get_cost_model_DS = R"""(
+Returns the coefficients of the cost model currently used for planning
+NUFFTs.
+
+Returns
+-------
+dict
+    "fft_ref": run time (in s) of a 2048x2048 complex FFT on one thread
+    "grid_ref": run time (in s) per unit of spreading/interpolation work on
+    one thread
+    "max_fft_scaling", "max_grid_scaling": asymptotic speedups of FFTs and
+    spreading/interpolation for many threads
+    "scaling_power": sharpness of the transition between linear and
+    saturated speedup
+)""";
+
+constexpr const char *save_cost_model_DS = R"""(
+Writes the current NUFFT cost model to a file.
+
+Parameters
+----------
+filename : str
+    The name of the output file.
+)""";
+
+constexpr const char *load_cost_model_DS = R"""(
+Reads a NUFFT cost model from a file and uses it for all NUFFTs planned
+afterwards.
+
+Parameters
+----------
+filename : str
+    The name of the input file, written by `save_cost_model` or
+    `calibrate_cost_model`.
+)""";
+
 void add_nufft(py::module_ &msup)
   {
   using namespace pybind11::literals;
@@ -435,8 +1225,19 @@ void add_nufft(py::module_ &msup)
         "forward"_a, "epsilon"_a, "nthreads"_a=1, "out"_a=None, "verbosity"_a=0,
         "sigma_min"_a=1.2, "sigma_max"_a=2.51, "periodicity"_a=2*pi,
         "fft_order"_a=false);
+  m.def("nu2nu", &Py_nu2nu, nu2nu_DS, py::kw_only(), "points"_a, "coord"_a,
+        "coord_out"_a, "forward"_a, "epsilon"_a, "nthreads"_a=1, "out"_a=None,
+        "verbosity"_a=0, "sigma_min"_a=1.2, "sigma_max"_a=2.51);
   m.def("bestEpsilon", &bestEpsilon, bestEpsilon_DS, py::kw_only(),
         "ndim"_a, "singleprec"_a, "sigma_min"_a=1.1, "sigma_max"_a=2.6);
+  m.def("calibrate_cost_model", &calibrate_cost_model,
+        calibrate_cost_model_DS, "nthreads"_a=1, "filename"_a=None,
+        "quick"_a=false);
+  m.def("get_cost_model", &get_cost_model, get_cost_model_DS);
+  m.def("save_cost_model", &save_nufft_cost_model, save_cost_model_DS,
+        "filename"_a);
+  m.def("load_cost_model", &load_nufft_cost_model, load_cost_model_DS,
+        "filename"_a);
 
   py::class_<Py_Nufftplan> (m, "plan", py::module_local())
     .def(py::init<bool, const py::array &, const py::object &,
@@ -446,8 +1247,46 @@ void add_nufft(py::module_ &msup)
         "periodicity"_a=2*pi, "fft_order"_a=false)
     .def("nu2u", &Py_Nufftplan::nu2u, plan_nu2u_DS, py::kw_only(), "forward"_a,
       "verbosity"_a=0, "points"_a, "out"_a=None)
-    .def("u2nu", &Py_Nufftplan::u2nu, py::kw_only(), "forward"_a,
-      "verbosity"_a=0, "grid"_a, "out"_a=None);
+    .def("u2nu", &Py_Nufftplan::u2nu, plan_u2nu_DS, py::kw_only(), "forward"_a,
+      "verbosity"_a=0, "grid"_a, "out"_a=None)
+    .def("prep_toeplitz", &Py_Nufftplan::prep_toeplitz,
+      plan_prep_toeplitz_DS, py::kw_only(), "forward"_a, "verbosity"_a=0,
+      "weights"_a=None)
+    .def("apply_toeplitz", &Py_Nufftplan::apply_toeplitz,
+      plan_apply_toeplitz_DS, py::kw_only(), "grid"_a, "out"_a=None)
+    .def("kernel_cache_size", &Py_Nufftplan::kernel_cache_size,
+      plan_kernel_cache_size_DS)
+    .def("set_kernel_cache", &Py_Nufftplan::set_kernel_cache,
+      plan_set_kernel_cache_DS, "enable"_a)
+    .def("update_coords", &Py_Nufftplan::update_coords,
+      plan_update_coords_DS, "coord"_a)
+    .def("log2tile", &Py_Nufftplan::log2tile, plan_log2tile_DS)
+    .def("set_log2tile", &Py_Nufftplan::set_log2tile, plan_set_log2tile_DS,
+      "log2tile"_a);
+
+  py::class_<Py_Nu2uStream> (m, "nu2u_stream", py::module_local())
+    .def(py::init<const py::object &, double, size_t, const py::object &,
+                  bool, size_t, double, double, double, bool>(),
+      nu2u_stream_init_DS, py::kw_only(), "grid_shape"_a, "epsilon"_a,
+        "npoints"_a, "ntrans"_a=None, "singleprec"_a=false, "nthreads"_a=0,
+        "sigma_min"_a=1.1, "sigma_max"_a=2.6, "periodicity"_a=2*pi,
+        "fft_order"_a=false)
+    .def("add", &Py_Nu2uStream::add, nu2u_stream_add_DS, py::kw_only(),
+      "coord"_a, "points"_a)
+    .def("finish", &Py_Nu2uStream::finish, nu2u_stream_finish_DS,
+      py::kw_only(), "forward"_a, "verbosity"_a=0, "out"_a=None);
+
+  py::class_<Py_Nufft3plan> (m, "plan3", py::module_local())
+    .def(py::init<const py::array &, const py::array &, double, size_t,
+                  double, double>(),
+      plan3_init_DS, py::kw_only(), "coord"_a, "coord_out"_a, "epsilon"_a,
+        "nthreads"_a=0, "sigma_min"_a=1.1, "sigma_max"_a=2.6)
+    .def("nu2nu", &Py_Nufft3plan::nu2nu, plan3_nu2nu_DS, py::kw_only(),
+      "forward"_a, "verbosity"_a=0, "points"_a, "out"_a=None)
+    .def("kernel_cache_size", &Py_Nufft3plan::kernel_cache_size,
+      plan_kernel_cache_size_DS)
+    .def("set_kernel_cache", &Py_Nufft3plan::set_kernel_cache,
+      plan_set_kernel_cache_DS, "enable"_a);
   }
 
 }
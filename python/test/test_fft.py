@@ -317,6 +317,33 @@ def testdcst1D(len, inorm, type, dtype):
                   type=itype), eps)
 
 
+@pmp("shape", ((6, 70, 90), (3, 4, 33, 20), (50,)))
+@pmp("inorm", [0, 1, 2])
+@pmp("type", [1, 2, 3, 4])
+@pmp("cosine", [True, False])
+@pmp("dtype", [np.float32, np.float64])
+def test_dcst_plan(shape, inorm, type, cosine, dtype):
+    rng = np.random.default_rng(42)
+    a = (rng.random(shape)-0.5).astype(dtype)
+    func = fft.dct if cosine else fft.dst
+    axsets = [None, tuple(range(len(shape)))[::-1]]
+    if len(shape) > 1:
+        axsets.append((0, len(shape)-1))
+    for axes in axsets:
+        axlist = range(len(shape)) if axes is None else axes
+        ref = a
+        for ax in axlist:
+            ref = func(ref, type=type, axes=(ax,), inorm=inorm)
+        plan = fft.DcstPlan(shape, type, cosine, axes=axes, inorm=inorm,
+                            dtype=dtype)
+        _assert_close(plan.exec(a, nthreads=2), ref, 4*tol[dtype])
+        _assert_close(func(a, type=type, axes=axes, inorm=inorm), ref,
+                      4*tol[dtype])
+        b = a.copy()
+        plan.exec(b, out=b)
+        _assert_close(b, ref, 4*tol[dtype])
+
+
 @pmp("len", (3, 4, 5, 6, 7, 8, 9, 10))
 @pmp("dtype", dtypes)
 def test_r2r_extra(len, dtype):
@@ -387,3 +414,219 @@ def test_conv2(L1,L2,dtype):
     x2 = refconv(a,L2,1,k)
     eps = tol[x2.real.dtype.type]
     _assert_close(x, x2, eps)
+
+
+def test_plan_cache(tmp_path):
+    fft.clear_plan_cache()
+    fft.set_plan_cache_size(4)
+    a = np.random.random((6, 7)) + 1j*np.random.random((6, 7))
+    fftn(a)
+    info = fft.plan_cache_info()
+    assert_(info["capacity"] == 4)
+    assert_(info["size"] == 2)
+    assert_(info["misses"] == 2)
+    fftn(a)
+    assert_(fft.plan_cache_info()["hits"] == 2)
+    for n in range(8, 12):
+        fftn(np.zeros(n, np.complex128))
+    info = fft.plan_cache_info()
+    assert_(info["size"] == 4)
+    assert_(info["evictions"] == 2)
+    fname = str(tmp_path / "wisdom.txt")
+    fft.save_wisdom(fname)
+    fft.clear_plan_cache()
+    fft.load_wisdom(fname)
+    assert_(fft.plan_cache_info()["size"] == 4)
+    fftn(np.zeros(11, np.complex128))
+    assert_(fft.plan_cache_info()["hits"] == 1)
+    # the capacity applies to every plan type separately
+    for n in range(20, 23):
+        fft.r2c(np.zeros(n))
+    info = fft.plan_cache_info()
+    assert_(info["size"] == 7)
+    assert_(info["evictions"] == 0)
+    fftn(np.zeros(11, np.complex128))
+    assert_(fft.plan_cache_info()["hits"] == 2)
+    fft.set_plan_cache_size(2)
+    assert_(fft.plan_cache_info()["size"] == 4)
+    # only the most recently used plans of a larger wisdom file are loaded,
+    # and the skipped ones are not counted as evictions
+    fft.set_plan_cache_size(50)
+    for n in range(30, 80):
+        fftn(np.zeros(n, np.complex128))
+    fft.save_wisdom(fname)
+    fft.set_plan_cache_size(3)
+    fft.clear_plan_cache()
+    fft.load_wisdom(fname)
+    info = fft.plan_cache_info()
+    assert_(info["size"] == 5)
+    assert_(info["evictions"] == 0)
+    fftn(np.zeros(77, np.complex128))
+    assert_(fft.plan_cache_info()["hits"] == 1)
+    fft.set_plan_cache_size(10)
+
+
+@pmp("n", (2, 7, 16, 24, 60, 64))
+@pmp("axis", (0, 1))
+@pmp("dtype", (np.complex64, np.complex128))
+def test_small_batched(n, axis, dtype):
+    shape = (n, 37) if axis == 0 else (37, n)
+    a = (np.random.random(shape)-0.5 + 1j*(np.random.random(shape)-0.5)).astype(dtype)
+    eps = 1e-6 if dtype == np.complex64 else 1e-15
+    ref = np.fft.fft(a.astype(np.complex128), axis=axis)
+    _assert_close(fftn(a, axes=(axis,), nthreads=2), ref, eps)
+    _assert_close(ifftn(ref.astype(dtype), axes=(axis,), inorm=2), a, eps)
+
+
+def test_planner_measure(tmp_path):
+    fft.clear_plan_cache()
+    fft.set_planner_mode("measure")
+    try:
+        for n in (1155, 2*137, 9973, 3*4096, 64*81, 15015):
+            a = np.random.random(n) + 1j*np.random.random(n)
+            assert_(l2error(fft.c2c(a), np.fft.fft(a)) < 1e-14)
+            assert_(l2error(fft.r2c(a.real), np.fft.rfft(a.real)) < 1e-14)
+        fname = str(tmp_path / "wisdom.txt")
+        fft.save_wisdom(fname)
+        with open(fname) as f:
+            assert_(any(line.startswith("pass c 8 1155 ") for line in f))
+    finally:
+        fft.set_planner_mode("estimate")
+        fft.clear_plan_cache()
+    fft.load_wisdom(fname)
+    a = np.random.random(1155) + 1j*np.random.random(1155)
+    assert_(l2error(fft.c2c(a), np.fft.fft(a)) < 1e-14)
+
+
+# Pass types which the planner may not choose on its own for any length
+# are forced via wisdom files.
+@pmp("n,choice", ((4096, "multipass 8 8 8 8"),
+                  (12288, "multipass 3 16 16 16"),
+                  (1155, "pfa 33 35"),
+                  (1040, "pfa 16 65")))
+@pmp("dtype", (np.complex64, np.complex128))
+@pmp("nrows", (None, 5))
+def test_forced_passes(tmp_path, n, choice, dtype, nrows):
+    fname = str(tmp_path / "wisdom.txt")
+    with open(fname, "w") as f:
+        f.write("pass c {} {} {}\n".format(np.dtype(dtype).itemsize//2, n,
+                                          choice))
+    fft.clear_plan_cache()
+    fft.load_wisdom(fname)
+    rng = np.random.default_rng(42)
+    shape = (n,) if nrows is None else (nrows, n)
+    a = (rng.random(shape)-0.5 + 1j*(rng.random(shape)-0.5)).astype(dtype)
+    eps = 5e-7 if dtype == np.complex64 else 1e-15
+    # naive DFT in long double precision at some frequencies
+    check_ld = dtype == np.complex64 or true_long_double
+    k = np.unique(np.concatenate(([0, 1, n//2, n-1], rng.integers(0, n, 28))))
+    ang = (8*np.arctan(np.longdouble(1))/n) * (np.outer(np.arange(n), k) % n)
+    cos, sin = np.cos(ang), np.sin(ang)
+    for forward in (True, False):
+        res = fft.c2c(a, forward=forward)
+        ref = (np.fft.fft(a.astype(np.complex128)) if forward else
+               np.fft.ifft(a.astype(np.complex128))*n)
+        _assert_close(res, ref, eps)
+        if check_ld:
+            w = cos + (-1j if forward else 1j)*sin
+            ref = (a.astype(np.clongdouble) @ w).astype(np.complex128)
+            _assert_close(res[..., k], ref, eps)
+    fft.clear_plan_cache()
+
+
+@pmp("M", (1, 7, 100))
+@pmp("nfft", (0, 128))
+@pmp("dtype", (np.float32, np.float64, np.complex64, np.complex128))
+def test_streaming_convolver(M, nfft, dtype):
+    rng = np.random.default_rng(42)
+    ntot = 5000
+    x = rng.random(ntot) - 0.5
+    k = rng.random(M) - 0.5
+    if issubclass(dtype, np.complexfloating):
+        x = x + 1j*(rng.random(ntot)-0.5)
+        k = k + 1j*(rng.random(M)-0.5)
+    x, k = x.astype(dtype), k.astype(dtype)
+    conv = fft.StreamingConvolver(k, nfft=nfft)
+    res = []
+    pos = 0
+    while pos < ntot:
+        n = rng.integers(0, 700)
+        res.append(conv.push(x[pos:pos+n], nthreads=2))
+        pos += n
+    res.append(conv.flush())
+    res = np.concatenate(res)
+    ref = np.convolve(x.astype(np.complex128), k.astype(np.complex128))[:ntot]
+    _assert_close(res, ref, tol[res.real.dtype.type])
+
+
+@pmp("nwin", (1, 16, 31))
+@pmp("hop", (1, 8, 40))
+@pmp("nfft", (0, 33))
+@pmp("dtype", (np.float32, np.float64, np.complex64, np.complex128))
+def test_streaming_stft(nwin, hop, nfft, dtype):
+    rng = np.random.default_rng(42)
+    ntot = 1000
+    x = rng.random(ntot) - 0.5
+    cplx = issubclass(dtype, np.complexfloating)
+    if cplx:
+        x = x + 1j*(rng.random(ntot)-0.5)
+    x = x.astype(dtype)
+    win = rng.random(nwin).astype(x.real.dtype)
+    stft = fft.StreamingSTFT(win, hop, nfft=nfft, real_input=not cplx)
+    res = []
+    pos = 0
+    while pos < ntot:
+        n = rng.integers(0, 100)
+        res.append(stft.push(x[pos:pos+n], nthreads=2))
+        pos += n
+    res = np.concatenate(res)
+    nfft = nwin if nfft == 0 else nfft
+    frames = np.array([x[i:i+nwin]*win
+                       for i in range(0, ntot-nwin+1, hop)], dtype=np.complex128)
+    ref = np.fft.fft(frames, n=nfft, axis=1)
+    if not cplx:
+        ref = ref[:, :nfft//2+1]
+    _assert_close(res, ref, tol[res.real.dtype.type])
+
+
+@pmp("axes", ((0, 1, 2), (0,), (1, 2), (0, 2)))
+@pmp("max_memory", (1 << 20, 30*16*5, 1))
+def test_c2c_out_of_core(tmp_path, axes, max_memory):
+    shape = (20, 24, 30)
+    ref = np.random.random(shape)-0.5 + 1j*(np.random.random(shape)-0.5)
+    res = np.fft.fftn(ref, axes=axes, norm="forward")
+    a = np.memmap(tmp_path/"data.bin", dtype=np.complex128, mode="w+",
+                  shape=shape)
+    a[()] = ref
+    info = fft.c2c_out_of_core(a, axes=axes, inorm=2, max_memory=max_memory)
+    _assert_close(a, res, 1e-15)
+    assert_(info["npasses"] >= 1)
+    del a
+    _assert_close(np.fromfile(tmp_path/"data.bin", dtype=np.complex128)
+                  .reshape(shape), res, 1e-15)
+    b = ref.copy()
+    fft.c2c_out_of_core(b, axes=axes, inorm=2, max_memory=max_memory)
+    _assert_close(b, res, 1e-15)
+
+
+def test_async_call():
+    import asyncio
+    from ducc0.misc import async_call
+    a = np.random.random((32, 20))-0.5 + 1j*(np.random.random((32, 20))-0.5)
+    ref = np.fft.fftn(a)
+    futs = [async_call(fft.c2c, a, forward=True, nthreads=2) for _ in range(4)]
+    for f in futs:
+        _assert_close(f.result(), ref, 1e-15)
+    r = async_call(fft.r2c, a.real, axes=(1,)).result()
+    _assert_close(r, np.fft.rfft(a.real, axis=1), 1e-15)
+
+    async def run():
+        return await async_call(fft.c2c, a, forward=False, inorm=2)
+    _assert_close(asyncio.run(run()), a, 1e-15)
+
+    # errors are raised by result(), with the type of a synchronous call
+    with pytest.raises(ValueError):
+        fft.c2c(a, axes=(5,))
+    fut = async_call(fft.c2c, a, axes=(5,))
+    with pytest.raises(ValueError):
+        fut.result()
@@ -224,3 +224,288 @@ def test_nufft_3d(nx, ny, nz, npoints, epsilon, forward, singleprec,
         if comp.ndim==0:
             comp=np.array([comp[()]])
         assert_allclose(ducc0.misc.l2error(ms2,comp), 0, atol=50*epsilon)
+
+
+@pmp("shape", ((40,), (21, 32), (12, 15, 10)))
+@pmp("npoints", (1, 500))
+@pmp("forward", (True, False))
+@pmp("singleprec", (True, False))
+@pmp("fft_order", (False, True))
+@pmp("weighted", (False, True))
+def test_nufft_toeplitz(shape, npoints, forward, singleprec, fft_order,
+                        weighted):
+    epsilon = 1e-5 if singleprec else 1e-10
+    periodicity = 2*np.pi
+    rng = np.random.default_rng(42)
+    ndim = len(shape)
+    uvw = (rng.random((npoints, ndim))-0.5)*periodicity
+    dirty = rng.random(shape)-0.5 + 1j*(rng.random(shape)-0.5)
+    weights = rng.random(npoints)+0.5 if weighted else None
+    if singleprec:
+        uvw = uvw.astype(np.float32)
+        dirty = dirty.astype(np.complex64)
+        if weighted:
+            weights = weights.astype(np.float32)
+
+    plan = ducc0.nufft.plan(nu2u=False, coord=uvw, grid_shape=shape,
+                            epsilon=epsilon, nthreads=2,
+                            periodicity=periodicity, fft_order=fft_order)
+    points = plan.u2nu(grid=dirty, forward=forward)
+    if weighted:
+        points *= weights
+    ref = plan.nu2u(points=points, forward=not forward)
+    plan.prep_toeplitz(forward=forward, weights=weights)
+    res = plan.apply_toeplitz(grid=dirty)
+    assert_allclose(ducc0.misc.l2error(res, ref), 0, atol=10*epsilon)
+    res2 = plan.apply_toeplitz(grid=dirty, out=dirty)
+    assert res2 is dirty
+    assert_allclose(ducc0.misc.l2error(res2, ref), 0, atol=10*epsilon)
+
+
+@pmp("shape", ((40,), (21, 32), (12, 15, 10)))
+@pmp("npoints", (1, 500))
+@pmp("ntrans", (1, 5))
+@pmp("forward", (True, False))
+@pmp("singleprec", (True, False))
+def test_nufft_batched(shape, npoints, ntrans, forward, singleprec):
+    epsilon = 1e-5 if singleprec else 1e-10
+    rng = np.random.default_rng(42)
+    ndim = len(shape)
+    coord = (rng.random((npoints, ndim))-0.5)*2*np.pi
+    points = rng.random((ntrans, npoints))-0.5 \
+        + 1j*(rng.random((ntrans, npoints))-0.5)
+    grid = rng.random((ntrans,)+shape)-0.5 \
+        + 1j*(rng.random((ntrans,)+shape)-0.5)
+    if singleprec:
+        coord = coord.astype(np.float32)
+        points = points.astype(np.complex64)
+        grid = grid.astype(np.complex64)
+
+    plan = ducc0.nufft.plan(nu2u=True, coord=coord, grid_shape=shape,
+                            epsilon=epsilon, nthreads=2)
+    res = plan.nu2u(points=points, forward=forward)
+    assert res.shape == (ntrans,)+shape
+    for t in range(ntrans):
+        ref = plan.nu2u(points=points[t], forward=forward)
+        assert_allclose(ducc0.misc.l2error(res[t], ref), 0, atol=epsilon)
+    plan = ducc0.nufft.plan(nu2u=False, coord=coord, grid_shape=shape,
+                            epsilon=epsilon, nthreads=2)
+    out = np.empty((ntrans, npoints), dtype=grid.dtype)
+    res = plan.u2nu(grid=grid, forward=forward, out=out)
+    assert res is out
+    for t in range(ntrans):
+        ref = plan.u2nu(grid=grid[t], forward=forward)
+        assert_allclose(ducc0.misc.l2error(res[t], ref), 0, atol=epsilon)
+
+
+@pmp("shape", ((40,), (21, 32), (12, 15, 10)))
+@pmp("npoints", (1, 500))
+@pmp("epsilon", (1e-5, 1e-10))
+@pmp("singleprec", (True, False))
+def test_nufft_kernel_cache(shape, npoints, epsilon, singleprec):
+    if singleprec and epsilon < 1e-6:
+        pytest.skip()
+    rng = np.random.default_rng(42)
+    ndim = len(shape)
+    coord = (rng.random((npoints, ndim))-0.5)*2*np.pi
+    points = rng.random(npoints)-0.5 + 1j*(rng.random(npoints)-0.5)
+    grid = rng.random(shape)-0.5 + 1j*(rng.random(shape)-0.5)
+    if singleprec:
+        coord = coord.astype(np.float32)
+        points = points.astype(np.complex64)
+        grid = grid.astype(np.complex64)
+
+    plan = ducc0.nufft.plan(nu2u=True, coord=coord, grid_shape=shape,
+                            epsilon=epsilon, nthreads=2)
+    ref_grid = plan.nu2u(points=points, forward=True)
+    ref_points = plan.u2nu(grid=grid, forward=False)
+    assert plan.kernel_cache_size() > 0
+    plan.set_kernel_cache(True)
+    for _ in range(2):
+        res = plan.nu2u(points=points, forward=True)
+        assert_allclose(ducc0.misc.l2error(res, ref_grid), 0, atol=epsilon)
+        res = plan.u2nu(grid=grid, forward=False)
+        assert_allclose(ducc0.misc.l2error(res, ref_points), 0, atol=epsilon)
+
+
+@pmp("shape", ((40,), (21, 32), (12, 15, 10)))
+@pmp("npoints", (1, 500))
+@pmp("step", (1e-3, 0.1, 10.))
+@pmp("singleprec", (True, False))
+def test_nufft_update_coords(shape, npoints, step, singleprec):
+    epsilon = 1e-5 if singleprec else 1e-10
+    rng = np.random.default_rng(42)
+    ndim = len(shape)
+    coord = (rng.random((npoints, ndim))-0.5)*2*np.pi
+    coord2 = coord + step*(rng.random((npoints, ndim))-0.5)
+    points = rng.random(npoints)-0.5 + 1j*(rng.random(npoints)-0.5)
+    grid = rng.random(shape)-0.5 + 1j*(rng.random(shape)-0.5)
+    if singleprec:
+        coord = coord.astype(np.float32)
+        coord2 = coord2.astype(np.float32)
+        points = points.astype(np.complex64)
+        grid = grid.astype(np.complex64)
+
+    plan = ducc0.nufft.plan(nu2u=True, coord=coord, grid_shape=shape,
+                            epsilon=epsilon, nthreads=2)
+    plan.set_kernel_cache(True)
+    plan.nu2u(points=points, forward=True)
+    plan.update_coords(coord2)
+    ref = ducc0.nufft.plan(nu2u=True, coord=coord2, grid_shape=shape,
+                           epsilon=epsilon, nthreads=2)
+    res = plan.nu2u(points=points, forward=True)
+    assert_allclose(ducc0.misc.l2error(res, ref.nu2u(points=points,
+                    forward=True)), 0, atol=epsilon)
+    res = plan.u2nu(grid=grid, forward=False)
+    assert_allclose(ducc0.misc.l2error(res, ref.u2nu(grid=grid,
+                    forward=False)), 0, atol=epsilon)
+
+
+@pmp("shape", ((1000,), (64, 50), (24, 20, 16)))
+@pmp("center", (0., 0.5))
+@pmp("width", (0.02, 1.))
+@pmp("singleprec", (True, False))
+def test_nufft_clustered(shape, center, width, singleprec):
+    # clustered points are spread into private per-thread slabs of the grid;
+    # the result must not depend on the number of threads
+    epsilon = 1e-5 if singleprec else 1e-10
+    rng = np.random.default_rng(42)
+    ndim = len(shape)
+    npoints = 5000
+    coord = 2*np.pi*(center + width*(rng.random((npoints, ndim))-0.5))
+    points = rng.random(npoints)-0.5 + 1j*(rng.random(npoints)-0.5)
+    if singleprec:
+        coord = coord.astype(np.float32)
+        points = points.astype(np.complex64)
+
+    out = np.empty(shape, dtype=points.dtype)
+    ref = ducc0.nufft.nu2u(points=points, coord=coord, forward=True,
+                           epsilon=epsilon, nthreads=1, out=out.copy())
+    for nthreads in (2, 4):
+        res = ducc0.nufft.nu2u(points=points, coord=coord, forward=True,
+                               epsilon=epsilon, nthreads=nthreads, out=out)
+        assert_allclose(ducc0.misc.l2error(res, ref), 0, atol=epsilon)
+        plan = ducc0.nufft.plan(nu2u=True, coord=coord, grid_shape=shape,
+                                epsilon=epsilon, nthreads=nthreads)
+        res = plan.nu2u(points=points, forward=True)
+        assert_allclose(ducc0.misc.l2error(res, ref), 0, atol=epsilon)
+
+
+@pmp("ndim", (1, 2, 3))
+@pmp("npoints", ((1, 1), (37, 21), (300, 200)))
+@pmp("extent", ((1., 1.), (10., 3.), (0., 5.), (4., 0.)))
+@pmp("epsilon", (1e-5, 1e-10))
+@pmp("forward", (True, False))
+@pmp("singleprec", (True, False))
+def test_nufft_type3(ndim, npoints, extent, epsilon, forward, singleprec):
+    if singleprec and epsilon < 1e-6:
+        pytest.skip()
+    rng = np.random.default_rng(42)
+    nin, nout = npoints
+    xmax, smax = extent
+    coord = 2 + xmax*(2*rng.random((nin, ndim))-1)
+    coord_out = -1 + smax*(2*rng.random((nout, ndim))-1)
+    points = rng.random(nin)-0.5 + 1j*(rng.random(nin)-0.5)
+    if singleprec:
+        coord = coord.astype(np.float32)
+        coord_out = coord_out.astype(np.float32)
+        points = points.astype(np.complex64)
+    isign = -1 if forward else 1
+    ref = np.array([np.sum(points*np.exp(isign*1j*(coord.astype(np.float64)@s)))
+                    for s in coord_out.astype(np.float64)])
+
+    res = ducc0.nufft.nu2nu(points=points, coord=coord, coord_out=coord_out,
+                            forward=forward, epsilon=epsilon, nthreads=2)
+    assert_allclose(ducc0.misc.l2error(res, ref), 0, atol=10*epsilon)
+    plan = ducc0.nufft.plan3(coord=coord, coord_out=coord_out,
+                             epsilon=epsilon, nthreads=2)
+    out = np.empty(nout, dtype=points.dtype)
+    res2 = plan.nu2nu(points=points, forward=forward, out=out)
+    assert res2 is out
+    assert_allclose(ducc0.misc.l2error(res2, ref), 0, atol=10*epsilon)
+
+
+def test_nufft_cost_model(tmp_path):
+    orig = str(tmp_path / "orig.txt")
+    ducc0.nufft.save_cost_model(orig)
+    fname = str(tmp_path / "profile.txt")
+    model = ducc0.nufft.calibrate_cost_model(nthreads=2, filename=fname,
+                                             quick=True)
+    assert ducc0.nufft.get_cost_model() == model
+    assert model["fft_ref"] > 0 and model["grid_ref"] > 0
+    assert model["max_fft_scaling"] > 1 and model["max_grid_scaling"] > 1
+    ducc0.nufft.load_cost_model(orig)
+    assert ducc0.nufft.get_cost_model() != model
+    ducc0.nufft.load_cost_model(fname)
+    assert ducc0.nufft.get_cost_model() == model
+    # plans must work with the calibrated model
+    rng = np.random.default_rng(42)
+    coord = (rng.random((1000, 2))-0.5)*2*np.pi
+    points = rng.random(1000)-0.5 + 1j*(rng.random(1000)-0.5)
+    res = ducc0.nufft.nu2u(points=points, coord=coord, forward=True,
+                           epsilon=1e-8, out=np.empty((20, 22), np.complex128))
+    ref = explicit_nufft(coord, points, (20, 22), True, 2*np.pi, False)
+    assert_allclose(ducc0.misc.l2error(res, ref), 0, atol=1e-7)
+    ducc0.nufft.load_cost_model(orig)
+
+
+@pmp("shape", ((1000,), (64, 50), (24, 20, 16)))
+@pmp("singleprec", (True, False))
+def test_nufft_log2tile(shape, singleprec):
+    # the tile size must only affect performance, not the results
+    epsilon = 1e-5 if singleprec else 1e-10
+    rng = np.random.default_rng(42)
+    ndim = len(shape)
+    npoints = 5000
+    coord = (rng.random((npoints, ndim))-0.5)*2*np.pi
+    points = rng.random(npoints)-0.5 + 1j*(rng.random(npoints)-0.5)
+    grid = rng.random(shape)-0.5 + 1j*(rng.random(shape)-0.5)
+    if singleprec:
+        coord = coord.astype(np.float32)
+        points = points.astype(np.complex64)
+        grid = grid.astype(np.complex64)
+
+    plan = ducc0.nufft.plan(nu2u=True, coord=coord, grid_shape=shape,
+                            epsilon=epsilon, nthreads=2)
+    ref1 = plan.nu2u(points=points, forward=True)
+    ref2 = plan.u2nu(grid=grid, forward=False)
+    for log2tile in (2, 3, 5, 0):
+        plan.set_log2tile(log2tile)
+        if log2tile != 0:
+            assert plan.log2tile() == log2tile
+        res = plan.nu2u(points=points, forward=True)
+        assert_allclose(ducc0.misc.l2error(res, ref1), 0, atol=epsilon)
+        res = plan.u2nu(grid=grid, forward=False)
+        assert_allclose(ducc0.misc.l2error(res, ref2), 0, atol=epsilon)
+    with pytest.raises(RuntimeError):
+        plan.set_log2tile(30)
+
+
+@pmp("shape", ((1000,), (64, 50), (24, 20, 16)))
+@pmp("singleprec", (True, False))
+@pmp("ntrans", (None, 3))
+@pmp("forward", (True, False))
+def test_nufft_stream(shape, singleprec, ntrans, forward):
+    # accumulating the points chunk by chunk must reproduce a single nu2u
+    epsilon = 1e-5 if singleprec else 1e-10
+    rng = np.random.default_rng(42)
+    ndim = len(shape)
+    npoints = 5000
+    coord = (rng.random((npoints, ndim))-0.5)*2*np.pi
+    pshape = (npoints,) if ntrans is None else (ntrans, npoints)
+    points = rng.random(pshape)-0.5 + 1j*(rng.random(pshape)-0.5)
+    if singleprec:
+        coord = coord.astype(np.float32)
+        points = points.astype(np.complex64)
+
+    plan = ducc0.nufft.plan(nu2u=True, coord=coord, grid_shape=shape,
+                            epsilon=epsilon, nthreads=2)
+    ref = plan.nu2u(points=points, forward=forward)
+    stream = ducc0.nufft.nu2u_stream(grid_shape=shape, epsilon=epsilon,
+                                     npoints=npoints, ntrans=ntrans,
+                                     singleprec=singleprec, nthreads=2)
+    for _ in range(2):  # the object must be reusable after finish()
+        for lo, hi in ((0, 1234), (1234, 1234), (1234, 4000), (4000, npoints)):
+            stream.add(coord=coord[lo:hi], points=points[..., lo:hi])
+        res = stream.finish(forward=forward)
+        assert_allclose(ducc0.misc.l2error(res, ref), 0, atol=epsilon)
@@ -3,6 +3,7 @@ import os.path
 import itertools
 from glob import iglob
 import os
+import platform
 
 from setuptools import setup, Extension
 import pybind11
@@ -104,15 +105,57 @@ depfiles = (_get_files_by_suffix('.', 'h') +
             _get_files_by_suffix('.', 'cc') +
             ['setup.py'])
 
+# For portable builds on x86_64, the module is additionally compiled for
+# more capable instruction sets (as "ducc0_<isa>"); at import time, "ducc0"
+# forwards to the best variant supported by the CPU (see
+# src/ducc0/infra/cpu_isa.h). DUCC0_ISA_VARIANTS can be used to change the
+# list of variants; setting it to "none" disables them.
+isa_flags = {'avx2': ['-mavx2', '-mfma'],
+             'avx512': ['-mavx512f', '-mavx2', '-mfma']}
+default_variants = ''
+if ((not do_native) and do_optimize and sys.platform != 'win32'
+        and platform.machine().lower() in ['x86_64', 'amd64']):
+    default_variants = 'avx2,avx512'
+tmp = os.getenv('DUCC0_ISA_VARIANTS', default_variants)
+isa_variants = [x for x in tmp.split(',') if x not in ['', 'none']]
+for isa in isa_variants:
+    if isa not in isa_flags:
+        raise RuntimeError('unknown instruction set variant "{}"'.format(isa))
+baseline_macros = define_macros[:]
+if isa_variants:
+    baseline_macros += [("DUCC0_ISA_VARIANTS", ','.join(isa_variants))]
+
 extensions = [Extension(pkgname,
                         language='c++',
                         sources=['python/ducc.cc'],
                         depends=depfiles,
                         include_dirs=include_dirs,
-                        define_macros=define_macros,
+                        define_macros=baseline_macros,
                         extra_compile_args=extra_compile_args,
                         extra_link_args=python_module_link_args)]
 
+# every variant needs its own source file, since setuptools would otherwise
+# reuse the object file compiled for the baseline module
+def _variant_source(isa):
+    name = os.path.join('build', 'isa_variants', 'ducc_{}.cc'.format(isa))
+    os.makedirs(os.path.dirname(name), exist_ok=True)
+    content = '#include "python/ducc.cc"\n'
+    if not os.path.exists(name) or open(name).read() != content:
+        with open(name, 'w') as f:
+            f.write(content)
+    return name
+
+extensions += [Extension(pkgname+'_'+isa,
+                         language='c++',
+                         sources=[_variant_source(isa)],
+                         depends=depfiles,
+                         include_dirs=include_dirs,
+                         define_macros=[("PKGNAME", pkgname+'_'+isa),
+                                        ("PKGVERSION", version)],
+                         extra_compile_args=extra_compile_args+isa_flags[isa],
+                         extra_link_args=python_module_link_args)
+               for isa in isa_variants]
+
 _print_env()
 
 setup(name=pkgname,
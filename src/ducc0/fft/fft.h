@@ -68,6 +68,16 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <vector>
 #include <complex>
 #include <algorithm>
+#include <functional>
+#include <map>
+#include <set>
+#include <list>
+#include <unordered_map>
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <typeinfo>
+#include <tuple>
 #ifndef DUCC0_NO_THREADING
 #include <mutex>
 #endif
@@ -79,8 +89,10 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "ducc0/infra/mav.h"
 #include "ducc0/infra/aligned_array.h"
 #include "ducc0/math/cmplx.h"
+#include "ducc0/math/float16.h"
 #include "ducc0/math/unity_roots.h"
 #include "ducc0/fft/fft1d.h"
+#include "ducc0/fft/fft_small.h"
 
 /** \file fft.h
  *  Implementation of multi-dimensional Fast Fourier and related transforms
@@ -475,64 +487,351 @@ template<typename T0> class T_dcst4
 // multi-D infrastructure
 //
 
-template<typename T> std::shared_ptr<T> get_plan(size_t length, bool vectorize=false)
+/// Usage statistics of the global FFT plan cache
+struct PlanCacheStats
   {
-#ifdef DUCC0_NO_FFT_CACHE
-  return std::make_shared<T>(length, vectorize);
-#else
-  constexpr size_t nmax=10;
-  struct entry { size_t n; bool vectorize; std::shared_ptr<T> ptr; };
-  static std::array<entry, nmax> cache{{{0,0,nullptr}}};
-  static std::array<size_t, nmax> last_access{{0}};
-  static size_t access_counter = 0;
+  size_t capacity,  ///< maximum number of cached plans per plan type
+         size,      ///< number of currently cached plans (all types)
+         hits,      ///< number of requests served from the cache
+         misses,    ///< number of requests which required building a plan
+         evictions; ///< number of plans removed to make room for new ones
+  };
+
+/// Process-wide LRU cache for FFT plans of all types and precisions.
+/** The capacity applies separately to every plan type, so that e.g. r2c
+ *  and c2c plans do not evict each other. It can be changed at runtime;
+ *  its initial value is taken from the environment variable
+ *  DUCC0_FFT_PLAN_CACHE_SIZE (default: 10).
+ *  Looking up, inserting and evicting a plan take constant time, so that
+ *  the cache can also hold thousands of plans.
+ *  The list of cached plans can be written to a "wisdom" file and read back
+ *  in a different process, which then builds all listed plans up front. */
+class PlanCache
+  {
+  public:
+    /// Length and vectorization flag of a plan listed in a wisdom file
+    struct Request
+      {
+      size_t length;
+      bool vectorize;
+      };
+
+  private:
+    using Factory = std::function<std::shared_ptr<void>(size_t, bool)>;
+    struct Entry
+      {
+      size_t length;
+      bool vectorize;
+      std::shared_ptr<void> plan;
+      };
+    // everything belonging to one plan type
+    struct TypeCache
+      {
+      // cached plans, most recently used first
+      std::list<Entry> lru;
+      // position of every cached plan in lru, see key()
+      std::unordered_map<size_t, std::list<Entry>::iterator> index;
+      // empty until the type is requested for the first time
+      Factory factory;
+      // plans from wisdom files which are built once factory is known
+      std::vector<Request> pending;
+      };
+
+    // type_key() -> TypeCache; elements are never removed, so references
+    // to them stay valid
+    std::unordered_map<std::string, TypeCache> types;
+    size_t capacity, size=0;
+    size_t hits=0, misses=0, evictions=0;
 #ifndef DUCC0_NO_THREADING
-  static std::mutex mut;
+    mutable std::mutex mut;
 #endif
 
-  auto find_in_cache = [&]() -> std::shared_ptr<T>
-    {
-    for (size_t i=0; i<nmax; ++i)
-      if (cache[i].ptr && (cache[i].n==length) && (cache[i].vectorize==vectorize))
+    static size_t capacity_from_env()
+      {
+      auto evar=getenv("DUCC0_FFT_PLAN_CACHE_SIZE");
+      if (!evar) return 10;
+      auto res = std::strtol(evar, nullptr, 10);
+      MR_assert(res>=0, "invalid value in DUCC0_FFT_PLAN_CACHE_SIZE");
+      return size_t(res);
+      }
+
+    PlanCache() : capacity(capacity_from_env()) {}
+
+    // identifier of a plan type, without white space, so that it can be
+    // used as a token in wisdom files
+    template<typename T> static const std::string &type_key()
+      {
+      static const std::string key = []
         {
-        // no need to update if this is already the most recent entry
-        if (last_access[i]!=access_counter)
-          {
-          last_access[i] = ++access_counter;
-          // Guard against overflow
-          if (access_counter == 0)
-            last_access.fill(0);
-          }
-        return cache[i].ptr;
+        std::string res(typeid(T).name());
+        std::replace(res.begin(), res.end(), ' ', '_');
+        return res;
+        }();
+      return key;
+      }
+    static size_t key(size_t length, bool vectorize)
+      { return 2*length + size_t(vectorize); }
+
+    // all functions below expect the mutex to be held by the caller
+    std::shared_ptr<void> find(TypeCache &tc, size_t length, bool vectorize)
+      {
+      auto it = tc.index.find(key(length, vectorize));
+      if (it==tc.index.end()) return nullptr;
+      tc.lru.splice(tc.lru.begin(), tc.lru, it->second);
+      return it->second->plan;
+      }
+    // removes the least recently used plans of tc until at most nmax of
+    // them are left, and returns the number of removed plans
+    size_t shrink(TypeCache &tc, size_t nmax)
+      {
+      size_t res=0;
+      for (; tc.lru.size()>nmax; ++res)
+        {
+        tc.index.erase(key(tc.lru.back().length, tc.lru.back().vectorize));
+        tc.lru.pop_back();
+        --size;
         }
+      return res;
+      }
+    // plans from wisdom files do not count as evictions when they replace
+    // others
+    void insert(TypeCache &tc, size_t length, bool vectorize,
+      const std::shared_ptr<void> &plan, bool from_wisdom=false)
+      {
+      if (capacity==0) return;
+      auto nevicted = shrink(tc, capacity-1);
+      if (!from_wisdom) evictions += nevicted;
+      tc.lru.push_front({length, vectorize, plan});
+      tc.index[key(length, vectorize)] = tc.lru.begin();
+      ++size;
+      }
+    // Of a list of plans in wisdom file order (least recently used first),
+    // returns those which are not cached yet and would not be evicted
+    // again by the ones behind them.
+    std::vector<Request> select_new(TypeCache &tc,
+      const std::vector<Request> &plans) const
+      {
+      std::vector<Request> res;
+      size_t nskip = (plans.size()>capacity) ? plans.size()-capacity : 0;
+      for (size_t i=nskip; i<plans.size(); ++i)
+        if (tc.index.find(key(plans[i].length, plans[i].vectorize))
+            ==tc.index.end())
+          res.push_back(plans[i]);
+      return res;
+      }
+    // builds the plans in todo via factory and inserts them into tc
+    void build_from_wisdom(TypeCache &tc, const Factory &factory,
+      const std::vector<Request> &todo)
+      {
+      for (const auto &r: todo)
+        {
+        auto plan = factory(r.length, r.vectorize);
+#ifndef DUCC0_NO_THREADING
+        std::lock_guard<std::mutex> lock(mut);
+#endif
+        if (!find(tc, r.length, r.vectorize))
+          insert(tc, r.length, r.vectorize, plan, true);
+        }
+      }
 
-    return nullptr;
-    };
+  public:
+    static PlanCache &instance()
+      {
+      static PlanCache cache;
+      return cache;
+      }
 
-  {
+    template<typename T> std::shared_ptr<T> get(size_t length, bool vectorize)
+      {
+      std::vector<Request> todo;
+      static TypeCache &tc = [this]() -> TypeCache &
+        {
 #ifndef DUCC0_NO_THREADING
-  std::lock_guard<std::mutex> lock(mut);
+        std::lock_guard<std::mutex> lock(mut);
 #endif
-  auto p = find_in_cache();
-  if (p) return p;
-  }
-  auto plan = std::make_shared<T>(length, vectorize);
-  {
+        return types[type_key<T>()];
+        }();
+      Factory factory;
+      {
+#ifndef DUCC0_NO_THREADING
+      std::lock_guard<std::mutex> lock(mut);
+#endif
+      if (!tc.factory)
+        {
+        tc.factory = [](size_t n, bool vec)
+          { return std::static_pointer_cast<void>(std::make_shared<T>(n, vec)); };
+        todo = select_new(tc, tc.pending);
+        tc.pending.clear();
+        factory = tc.factory;
+        }
+      auto p = find(tc, length, vectorize);
+      if (p) { ++hits; return std::static_pointer_cast<T>(p); }
+      }
+      // plans requested by a wisdom file for this type can be built now
+      build_from_wisdom(tc, factory, todo);
+      if (!todo.empty())  // the requested plan may have been among them
+        {
+#ifndef DUCC0_NO_THREADING
+        std::lock_guard<std::mutex> lock(mut);
+#endif
+        auto p = find(tc, length, vectorize);
+        if (p) { ++hits; return std::static_pointer_cast<T>(p); }
+        }
+      auto plan = std::make_shared<T>(length, vectorize);
+      {
 #ifndef DUCC0_NO_THREADING
-  std::lock_guard<std::mutex> lock(mut);
+      std::lock_guard<std::mutex> lock(mut);
 #endif
-  auto p = find_in_cache();
-  if (p) return p;
+      auto p = find(tc, length, vectorize);
+      if (p) { ++hits; return std::static_pointer_cast<T>(p); }
+      ++misses;
+      insert(tc, length, vectorize, plan);
+      }
+      return plan;
+      }
 
-  size_t lru = 0;
-  for (size_t i=1; i<nmax; ++i)
-    if (last_access[i] < last_access[lru])
-      lru = i;
+    PlanCacheStats stats() const
+      {
+#ifndef DUCC0_NO_THREADING
+      std::lock_guard<std::mutex> lock(mut);
+#endif
+      return {capacity, size, hits, misses, evictions};
+      }
+    void set_capacity(size_t newcap)
+      {
+#ifndef DUCC0_NO_THREADING
+      std::lock_guard<std::mutex> lock(mut);
+#endif
+      capacity = newcap;
+      for (auto &t: types) evictions += shrink(t.second, capacity);
+      }
+    void clear()
+      {
+#ifndef DUCC0_NO_THREADING
+      std::lock_guard<std::mutex> lock(mut);
+#endif
+      for (auto &t: types)
+        {
+        t.second.lru.clear();
+        t.second.index.clear();
+        }
+      size = hits = misses = evictions = 0;
+      }
 
-  cache[lru] = {length,vectorize, plan};
-  last_access[lru] = ++access_counter;
-  }
-  return plan;
+    /// Writes the list of currently cached plans to \a os, sorted by type
+    /// and least recently used first.
+    void save(std::ostream &os) const
+      {
+#ifndef DUCC0_NO_THREADING
+      std::lock_guard<std::mutex> lock(mut);
 #endif
+      std::map<std::string, const TypeCache *> sorted;
+      for (const auto &t: types) sorted[t.first] = &t.second;
+      for (const auto &t: sorted)
+        for (auto e=t.second->lru.rbegin(); e!=t.second->lru.rend(); ++e)
+          os << "plan " << t.first << " " << e->length << " " << e->vectorize
+             << "\n";
+      }
+    /// Adds plans of type \a type, listed in a wisdom file in the order
+    /// \a plans, to the cache.
+    /** Plans which would be evicted again by the ones behind them are
+     *  skipped. The others are built immediately if the type has already
+     *  been used in this process, or else when it is requested for the
+     *  first time. */
+    void add_from_wisdom(const std::string &type,
+      const std::vector<Request> &plans)
+      {
+      TypeCache *tc;
+      Factory factory;
+      std::vector<Request> todo;
+      {
+#ifndef DUCC0_NO_THREADING
+      std::lock_guard<std::mutex> lock(mut);
+#endif
+      tc = &types[type];
+      if (!tc->factory)
+        {
+        tc->pending.insert(tc->pending.end(), plans.begin(), plans.end());
+        return;
+        }
+      factory = tc->factory;
+      todo = select_new(*tc, plans);
+      }
+      build_from_wisdom(*tc, factory, todo);
+      }
+  };
+
+template<typename T> std::shared_ptr<T> get_plan(size_t length, bool vectorize=false)
+  {
+#ifdef DUCC0_NO_FFT_CACHE
+  return std::make_shared<T>(length, vectorize);
+#else
+  return PlanCache::instance().get<T>(length, vectorize);
+#endif
+  }
+
+/// Returns usage statistics of the FFT plan cache.
+inline PlanCacheStats plan_cache_stats()
+  { return PlanCache::instance().stats(); }
+
+/// Sets the maximum number of plans of each type held in the FFT plan cache.
+/** Excess plans are evicted immediately. A capacity of 0 disables caching. */
+inline void set_plan_cache_capacity(size_t capacity)
+  { PlanCache::instance().set_capacity(capacity); }
+
+/// Removes all plans from the FFT plan cache and resets its statistics.
+inline void clear_plan_cache()
+  { PlanCache::instance().clear(); }
+
+/// Writes the contents of the FFT plan cache, together with all algorithm
+/// decisions made by the measuring planner, to the file \a filename.
+/** The file is a plain text file and can be passed to load_wisdom() in
+ *  another process running the same build of the library. */
+inline void save_wisdom(const std::string &filename)
+  {
+  std::ofstream os(filename);
+  MR_assert(os, "could not open wisdom file '", filename, "' for writing");
+  os << "# ducc0 FFT wisdom v1\n";
+  PlannerWisdom::instance().save(os);
+  PlanCache::instance().save(os);
+  MR_assert(os, "error writing wisdom file '", filename, "'");
+  }
+
+/// Reads a file written by save_wisdom() and adds the listed plans to the
+/// FFT plan cache.
+/** Recorded planner decisions are used for all subsequently created plans
+ *  of the respective length, independent of the planner mode. Of the
+ *  listed plans, only the most recently used ones that fit into the cache
+ *  are built. This happens immediately for transform types that have
+ *  already been used in this process, and otherwise when their type is
+ *  requested for the first time. */
+inline void load_wisdom(const std::string &filename)
+  {
+  std::ifstream is(filename);
+  MR_assert(is, "could not open wisdom file '", filename, "' for reading");
+  std::string line;
+  // plans are only built after all planner decisions have been read
+  std::map<std::string, std::vector<PlanCache::Request>> plans;
+  while (std::getline(is, line))
+    {
+    std::istringstream iss(line);
+    std::string key;
+    if ((!(iss >> key)) || (key[0]=='#')) continue;
+    if (key=="plan")
+      {
+      std::string type;
+      PlanCache::Request req;
+      MR_assert(iss >> type >> req.length >> req.vectorize,
+        "malformed line in wisdom file: '", line, "'");
+      plans[type].push_back(req);
+      }
+    else if (key=="pass")
+      PlannerWisdom::instance().add_from_wisdom(iss);
+    else
+      MR_fail("unknown entry in wisdom file: '", line, "'");
+    }
+  for (const auto &p: plans)
+    PlanCache::instance().add_from_wisdom(p.first, p.second);
   }
 
 template<size_t N> class multi_iter
@@ -897,150 +1196,331 @@ template <typename T, size_t vlen> struct add_vec<Cmplx<T>, vlen>
   { using type = Cmplx<typename simd_select<T, vlen>::type>; };
 template <typename T, size_t vlen> using add_vec_t = typename add_vec<T, vlen>::type;
 
-template<typename Tplan, typename T, typename T0, typename Exec>
-DUCC0_NOINLINE void general_nd(const cfmav<T> &in, vfmav<T> &out,
-  const shape_t &axes, T0 fct, size_t nthreads, const Exec &exec,
-  const bool /*allow_inplace*/=true)
+/// Placeholder for an absent load or store callback
+struct no_callback {};
+
+// Access to the individual transforms ("lanes") stored in a work buffer
+template<typename T, typename=void> struct buf_lanes
   {
-  if ((in.ndim()==1)&&(in.stride(0)==1)&&(out.stride(0)==1))
+  static constexpr size_t n=1;
+  static T get(const T &v, size_t) { return v; }
+  static void set(T &v, size_t, const T &x) { v=x; }
+  };
+template<typename T> struct buf_lanes<T, std::void_t<decltype(T::size())>>
+  {
+  static constexpr size_t n=T::size();
+  using Ts = typename T::value_type;
+  static Ts get(const T &v, size_t j) { return v[j]; }
+  static void set(T &v, size_t j, const Ts &x) { v[j]=x; }
+  };
+template<typename T> struct buf_lanes<Cmplx<T>>
+  {
+  using inner = buf_lanes<T>;
+  static constexpr size_t n=inner::n;
+  static std::complex<decltype(inner::get(std::declval<T>(),0))>
+    get(const Cmplx<T> &v, size_t j)
+    { return {inner::get(v.r,j), inner::get(v.i,j)}; }
+  template<typename Ts> static void set(Cmplx<T> &v, size_t j,
+    const std::complex<Ts> &x)
+    { inner::set(v.r,j,x.real()); inner::set(v.i,j,x.imag()); }
+  };
+
+/* Variants of copy_input() and copy_output() which call the load or store
+   callback \a cb(value, index, offset) for every element on its way between
+   the array and the work buffer, so that no additional sweep over the data
+   is needed. Source and destination may overlap. */
+template<typename Titer, typename Ts, typename T, typename Tcb> DUCC0_NOINLINE
+  void copy_input(const Titer &it, const cfmav<Ts> &src, T *dst, size_t nvec,
+  size_t vstr, const Tcb &cb)
+  {
+  if constexpr (is_same<Tcb, no_callback>::value)
+    copy_input(it, src, dst, nvec, vstr);
+  else
     {
-    auto plan = get_plan<Tplan>(in.shape(0), true);
-    exec.exec_simple(in.data(), out.data(), *plan, fct, nthreads);
-    return;
+    using lanes = buf_lanes<T>;
+    for (size_t i=0; i<it.length_in(); ++i)
+      for (size_t j0=0; j0<nvec; ++j0)
+        for (size_t j1=0; j1<lanes::n; ++j1)
+          {
+          auto ofs = it.iofs(j0*lanes::n+j1,i);
+          auto v = buf_lanes<Ts>::get(src.raw(ofs), 0);
+          cb(v, i, ofs);
+          lanes::set(dst[j0*vstr+i], j1, v);
+          }
     }
-  std::shared_ptr<Tplan> plan;
-  size_t nth1d = (in.ndim()==1) ? nthreads : 1;
-  bool inplace = (out.ndim()==1)&&(out.stride(0)==1);
-
-  for (size_t iax=0; iax<axes.size(); ++iax)
+  }
+template<typename Titer, typename Ts, typename T, typename Tcb> inline
+  void copy_input(const Titer &it, const cfmav<Ts> &src, T *dst,
+  const Tcb &cb)
+  {
+  if constexpr (is_same<Tcb, no_callback>::value)
+    copy_input(it, src, dst);
+  else
+    copy_input(it, src, dst, 1, 0, cb);
+  }
+template<typename Titer, typename T, typename Ts, typename Tcb> DUCC0_NOINLINE
+  void copy_output(const Titer &it, const T *src, vfmav<Ts> &dst, size_t nvec,
+  size_t vstr, const Tcb &cb)
+  {
+  if constexpr (is_same<Tcb, no_callback>::value)
+    copy_output(it, src, dst, nvec, vstr);
+  else
     {
-    size_t len=in.shape(axes[iax]);
-    if ((!plan) || (len!=plan->length()))
-      plan = get_plan<Tplan>(len, in.ndim()==1);
-
-    execParallel(
-      util::thread_count(nthreads, in, axes[iax], fft_simdlen<T0>),
-      [&](Scheduler &sched) {
-        constexpr auto vlen = fft_simdlen<T0>;
-        constexpr size_t nmax = 16;
-        const auto &tin(iax==0? in : out);
-        multi_iter<nmax> it(tin, out, axes[iax], sched.num_threads(), sched.thread_num());
-        size_t nvec = 1;
-        if (it.critical_stride_trans(sizeof(T)))  // do bunches of transforms
-          nvec = nmax/vlen;
-        TmpStorage<T,T0> storage(in.size()/len, len, plan->bufsize(), nvec, inplace);
-
-        if (nvec>1)
+    using lanes = buf_lanes<T>;
+    Ts *ptr = dst.data();
+    for (size_t i=0; i<it.length_out(); ++i)
+      for (size_t j0=0; j0<nvec; ++j0)
+        for (size_t j1=0; j1<lanes::n; ++j1)
           {
+          auto ofs = it.oofs(j0*lanes::n+j1,i);
+          auto v = lanes::get(src[j0*vstr+i], j1);
+          cb(v, i, ofs);
+          buf_lanes<Ts>::set(ptr[ofs], 0, v);
+          }
+    }
+  }
+template<typename Titer, typename T, typename Ts, typename Tcb> inline
+  void copy_output(const Titer &it, const T *src, vfmav<Ts> &dst,
+  const Tcb &cb)
+  {
+  if constexpr (is_same<Tcb, no_callback>::value)
+    copy_output(it, src, dst);
+  else
+    copy_output(it, src, dst, 1, 0, cb);
+  }
+/* Copies \a len contiguous values from \a src to \a dst (which may be
+   identical), calling \a cb(value, index, index) for each of them. */
+template<typename T, typename Tcb> inline void copy_simple(const T *src,
+  T *dst, size_t len, const Tcb &cb)
+  {
+  if constexpr (is_same<Tcb, no_callback>::value)
+    {
+    if (src!=dst) copy_n(src, len, dst);
+    }
+  else
+    for (size_t i=0; i<len; ++i)
+      {
+      auto v = buf_lanes<T>::get(src[i], 0);
+      cb(v, i, ptrdiff_t(i));
+      buf_lanes<T>::set(dst[i], 0, v);
+      }
+  }
+
+/* Support for arrays with 16-bit storage types (float16, bfloat16 and
+   Cmplx of these): their values are converted to float when being copied
+   into the work buffers and back when being copied out. */
+template<typename T> struct fft_storage
+  {
+  static constexpr bool is16 = is_float16_type<T>;
+  using compute = std::conditional_t<is16, float, T>;
+  };
+template<typename T> struct fft_storage<Cmplx<T>>
+  {
+  static constexpr bool is16 = is_float16_type<T>;
+  using compute = Cmplx<typename fft_storage<T>::compute>;
+  };
+/// Element type of the work buffers for arrays of type \a T
+template<typename T> using fft_compute_t = typename fft_storage<T>::compute;
+
+template<typename T> inline float fft_load16(const T &v)
+  { return float(v); }
+template<typename T> inline std::complex<float> fft_load16(const Cmplx<T> &v)
+  { return {float(v.r), float(v.i)}; }
+template<typename T, typename Tv> inline void fft_store16(T &dst, const Tv &v)
+  { dst = T(float(v)); }
+template<typename T, typename Tv> inline void fft_store16(Cmplx<T> &dst,
+  const std::complex<Tv> &v)
+  { dst.Set(T(float(v.real())), T(float(v.imag()))); }
+
+template <typename Titer, typename Ts, typename T> DUCC0_NOINLINE
+  std::enable_if_t<fft_storage<Ts>::is16> copy_input(const Titer &it,
+  const cfmav<Ts> &src, T *DUCC0_RESTRICT dst, size_t nvec=1, size_t vstr=0)
+  {
+  using lanes = buf_lanes<T>;
+  for (size_t i=0; i<it.length_in(); ++i)
+    for (size_t j0=0; j0<nvec; ++j0)
+      for (size_t j1=0; j1<lanes::n; ++j1)
+        lanes::set(dst[j0*vstr+i], j1,
+          fft_load16(src.raw(it.iofs(j0*lanes::n+j1,i))));
+  }
+template<typename Titer, typename T, typename Ts> DUCC0_NOINLINE
+  std::enable_if_t<fft_storage<Ts>::is16> copy_output(const Titer &it,
+  const T *DUCC0_RESTRICT src, vfmav<Ts> &dst, size_t nvec=1, size_t vstr=0)
+  {
+  using lanes = buf_lanes<T>;
+  Ts * DUCC0_RESTRICT ptr = dst.data();
+  for (size_t i=0; i<it.length_out(); ++i)
+    for (size_t j0=0; j0<nvec; ++j0)
+      for (size_t j1=0; j1<lanes::n; ++j1)
+        fft_store16(ptr[it.oofs(j0*lanes::n+j1,i)],
+          lanes::get(src[j0*vstr+i], j1));
+  }
+
+/* Transforms all lines of \a tin along \a axis with \a plan and stores the
+   result in \a out. */
+template<typename Tplan, typename T, typename T0, typename Exec>
+DUCC0_NOINLINE void general_nd_axis(const cfmav<T> &tin, vfmav<T> &out,
+  size_t axis, const Tplan &plan, T0 fct, size_t nthreads, const Exec &exec)
+  {
+  // element type of the work buffers; differs from T for 16-bit storage
+  using Tc = fft_compute_t<T>;
+  constexpr bool direct = is_same<T, Tc>::value;
+  size_t len=tin.shape(axis);
+  size_t nth1d = (tin.ndim()==1) ? nthreads : 1;
+  bool inplace = direct && (out.ndim()==1)&&(out.stride(0)==1);
+
+  execParallel(
+    util::thread_count(nthreads, tin, axis, fft_simdlen<T0>),
+    [&](Scheduler &sched) {
+      constexpr auto vlen = fft_simdlen<T0>;
+      constexpr size_t nmax = 16;
+      multi_iter<nmax> it(tin, out, axis, sched.num_threads(), sched.thread_num());
+      size_t nvec = 1;
+      if (it.critical_stride_trans(sizeof(T)))  // do bunches of transforms
+        nvec = nmax/vlen;
+      TmpStorage<Tc,T0> storage(tin.size()/len, len, plan.bufsize(), nvec, inplace);
+
+      if (nvec>1)
+        {
 #ifndef DUCC0_NO_SIMD
-          if constexpr (vlen>1)
-            {
-            TmpStorage2<add_vec_t<T, vlen>,T,T0> storage2(storage);
-            while (it.remaining()>=vlen*nvec)
-              {
-              it.advance(vlen*nvec);
-              exec.exec_n(it, tin, out, storage2, *plan, fct, nvec, nth1d);
-              }
-            }
-#endif
+        if constexpr (vlen>1)
           {
-          TmpStorage2<T,T,T0> storage2(storage);
-          while (it.remaining()>=nvec)
+          TmpStorage2<add_vec_t<Tc, vlen>,Tc,T0> storage2(storage);
+          while (it.remaining()>=vlen*nvec)
             {
-            it.advance(nvec);
-            exec.exec_n(it, tin, out, storage2, *plan, fct, nvec, nth1d);
+            it.advance(vlen*nvec);
+            exec.exec_n(it, tin, out, storage2, plan, fct, nvec, nth1d);
             }
           }
+#endif
+        {
+        TmpStorage2<Tc,Tc,T0> storage2(storage);
+        while (it.remaining()>=nvec)
+          {
+          it.advance(nvec);
+          exec.exec_n(it, tin, out, storage2, plan, fct, nvec, nth1d);
           }
+        }
+        }
 
 #ifndef DUCC0_NO_SIMD
-        if constexpr (vlen>1)
+      if constexpr (vlen>1)
+        {
+        TmpStorage2<add_vec_t<Tc, vlen>,Tc,T0> storage2(storage);
+        while (it.remaining()>=vlen)
           {
-          TmpStorage2<add_vec_t<T, vlen>,T,T0> storage2(storage);
-          while (it.remaining()>=vlen)
-            {
-            it.advance(vlen);
-            exec(it, tin, out, storage2, *plan, fct, nth1d);
-            }
+          it.advance(vlen);
+          exec(it, tin, out, storage2, plan, fct, nth1d);
           }
-        if constexpr (vlen>2)
-          if constexpr (simd_exists<T0,vlen/2>)
+        }
+      if constexpr (vlen>2)
+        if constexpr (simd_exists<T0,vlen/2>)
+          {
+          TmpStorage2<add_vec_t<Tc, vlen/2>,Tc,T0> storage2(storage);
+          if (it.remaining()>=vlen/2)
             {
-            TmpStorage2<add_vec_t<T, vlen/2>,T,T0> storage2(storage);
-            if (it.remaining()>=vlen/2)
-              {
-              it.advance(vlen/2);
-              exec(it, tin, out, storage2, *plan, fct, nth1d);
-              }
+            it.advance(vlen/2);
+            exec(it, tin, out, storage2, plan, fct, nth1d);
             }
-        if constexpr (vlen>4)
-          if constexpr (simd_exists<T0,vlen/4>)
+          }
+      if constexpr (vlen>4)
+        if constexpr (simd_exists<T0,vlen/4>)
+          {
+          TmpStorage2<add_vec_t<Tc, vlen/4>,Tc,T0> storage2(storage);
+          if (it.remaining()>=vlen/4)
             {
-            TmpStorage2<add_vec_t<T, vlen/4>,T,T0> storage2(storage);
-            if (it.remaining()>=vlen/4)
-              {
-              it.advance(vlen/4);
-              exec(it, tin, out, storage2, *plan, fct, nth1d);
-              }
+            it.advance(vlen/4);
+            exec(it, tin, out, storage2, plan, fct, nth1d);
             }
+          }
 #endif
+      {
+      TmpStorage2<Tc,Tc,T0> storage2(storage);
+      while (it.remaining()>0)
         {
-        TmpStorage2<T,T,T0> storage2(storage);
-        while (it.remaining()>0)
-          {
-          it.advance(1);
-          exec(it, tin, out, storage2, *plan, fct, nth1d, inplace);
-          }
+        it.advance(1);
+        exec(it, tin, out, storage2, plan, fct, nth1d, inplace);
         }
-      });  // end of parallel region
+      }
+    });  // end of parallel region
+  }
+
+template<typename Tplan, typename T, typename T0, typename Exec>
+DUCC0_NOINLINE void general_nd(const cfmav<T> &in, vfmav<T> &out,
+  const shape_t &axes, T0 fct, size_t nthreads, const Exec &exec,
+  const bool /*allow_inplace*/=true)
+  {
+  if constexpr (is_same<T, fft_compute_t<T>>::value)
+    if ((in.ndim()==1)&&(in.stride(0)==1)&&(out.stride(0)==1))
+      {
+      auto plan = get_plan<Tplan>(in.shape(0), true);
+      exec.exec_simple(in.data(), out.data(), *plan, fct, nthreads);
+      return;
+      }
+  std::shared_ptr<Tplan> plan;
+  for (size_t iax=0; iax<axes.size(); ++iax)
+    {
+    size_t len=in.shape(axes[iax]);
+    if ((!plan) || (len!=plan->length()))
+      plan = get_plan<Tplan>(len, in.ndim()==1);
+    general_nd_axis(iax==0 ? in : out, out, axes[iax], *plan, fct, nthreads,
+      exec);
     fct = T0(1); // factor has been applied, use 1 for remaining axes
     }
   }
 
-struct ExecC2C
+/* The optional callbacks \a load and \a store are applied to every element
+   right after it has been read from the input array and right before it is
+   written to the output array, respectively. */
+template<typename Tload, typename Tstore> struct ExecC2CCallback
   {
   bool forward;
+  Tload load;
+  Tstore store;
 
-  template <typename T0, typename Tstorage, typename Titer> DUCC0_NOINLINE void operator() (
-    const Titer &it, const cfmav<Cmplx<T0>> &in,
-    vfmav<Cmplx<T0>> &out, Tstorage &storage, const pocketfft_c<T0> &plan, T0 fct,
+  template <typename T0, typename Ts, typename Tstorage, typename Titer> DUCC0_NOINLINE void operator() (
+    const Titer &it, const cfmav<Ts> &in,
+    vfmav<Ts> &out, Tstorage &storage, const pocketfft_c<T0> &plan, T0 fct,
     size_t nthreads, bool inplace=false) const
     {
     using T = typename Tstorage::datatype;
-    if constexpr(is_same<Cmplx<T0>, T>::value)
-      if (inplace)
+    if constexpr(is_same<Ts, T>::value)
+      if (inplace)  // there is no data buffer in this case
         {
-        if (in.data()!=out.data())
-          copy_input(it, in, out.data());
+        copy_input(it, in, out.data(), load);
         plan.exec_copyback(out.data(), storage.transformBuf(), fct, forward, nthreads);
+        if constexpr (!is_same<Tstore, no_callback>::value)
+          copy_output(it, out.data(), out, store);
         return;
         }
     T *buf1=storage.transformBuf(), *buf2=storage.dataBuf();
-    copy_input(it, in, buf2);
+    copy_input(it, in, buf2, load);
     auto res = plan.exec(buf2, buf1, fct, forward, nthreads);
-    copy_output(it, res, out);
+    copy_output(it, res, out, store);
     }
-  template <typename T0, typename Tstorage, typename Titer> DUCC0_NOINLINE void exec_n (
-    const Titer &it, const cfmav<Cmplx<T0>> &in,
-    vfmav<Cmplx<T0>> &out, Tstorage &storage, const pocketfft_c<T0> &plan, T0 fct, size_t nvec,
+  template <typename T0, typename Ts, typename Tstorage, typename Titer> DUCC0_NOINLINE void exec_n (
+    const Titer &it, const cfmav<Ts> &in,
+    vfmav<Ts> &out, Tstorage &storage, const pocketfft_c<T0> &plan, T0 fct, size_t nvec,
     size_t nthreads) const
     {
     using T = typename Tstorage::datatype;
     size_t dstr = storage.data_stride();
     T *buf1=storage.transformBuf(), *buf2=storage.dataBuf();
-    copy_input(it, in, buf2, nvec, dstr);
+    copy_input(it, in, buf2, nvec, dstr, load);
     for (size_t i=0; i<nvec; ++i)
       plan.exec_copyback(buf2+i*dstr, buf1, fct, forward, nthreads);
-    copy_output(it, buf2, out, nvec, dstr);
+    copy_output(it, buf2, out, nvec, dstr, store);
     }
   template <typename T0> DUCC0_NOINLINE void exec_simple (
     const Cmplx<T0> *in, Cmplx<T0> *out, const pocketfft_c<T0> &plan, T0 fct,
     size_t nthreads) const
     {
-    if (in!=out) copy_n(in, plan.length(), out);
+    copy_simple(in, out, plan.length(), load);
     plan.exec(out, fct, forward, nthreads);
+    copy_simple(out, out, plan.length(), store);
     }
   };
+using ExecC2C = ExecC2CCallback<no_callback, no_callback>;
 
 struct ExecHartley
   {
@@ -1177,8 +1657,10 @@ struct ExecDcst
     }
   };
 
-template<typename T> DUCC0_NOINLINE void general_r2c(
-  const cfmav<T> &in, vfmav<Cmplx<T>> &out, size_t axis, bool forward, T fct,
+/* \a Ts is the storage type of the arrays, \a T the type used for
+   computation; they only differ for 16-bit storage types. */
+template<typename Ts, typename T> DUCC0_NOINLINE void general_r2c(
+  const cfmav<Ts> &in, vfmav<Cmplx<Ts>> &out, size_t axis, bool forward, T fct,
   size_t nthreads)
   {
   size_t nth1d = (in.ndim()==1) ? nthreads : 1;
@@ -1295,8 +1777,8 @@ template<typename T> DUCC0_NOINLINE void general_r2c(
     }
     });  // end of parallel region
   }
-template<typename T> DUCC0_NOINLINE void general_c2r(
-  const cfmav<Cmplx<T>> &in, vfmav<T> &out, size_t axis, bool forward, T fct,
+template<typename Ts, typename T> DUCC0_NOINLINE void general_c2r(
+  const cfmav<Cmplx<Ts>> &in, vfmav<Ts> &out, size_t axis, bool forward, T fct,
   size_t nthreads)
   {
   size_t nth1d = (in.ndim()==1) ? nthreads : 1;
@@ -1442,9 +1924,11 @@ template<typename T> DUCC0_NOINLINE void general_c2r(
     });  // end of parallel region
   }
 
-struct ExecR2R
+template<typename Tload, typename Tstore> struct ExecR2RCallback
   {
   bool r2c, forward;
+  Tload load;
+  Tstore store;
 
   template <typename T0, typename Tstorage, typename Titer> DUCC0_NOINLINE void operator() (
     const Titer &it, const cfmav<T0> &in, vfmav<T0> &out, Tstorage &storage,
@@ -1453,11 +1937,10 @@ struct ExecR2R
     {
     using T = typename Tstorage::datatype;
     if constexpr(is_same<T0, T>::value)
-      if (inplace)
+      if (inplace)  // there is no data buffer in this case
         {
         T *buf1=storage.transformBuf(), *buf2=out.data();
-        if (in.data()!=buf2)
-          copy_input(it, in, buf2);
+        copy_input(it, in, buf2, load);
         if ((!r2c) && forward)
           for (size_t i=2; i<it.length_out(); i+=2)
             buf2[i] = -buf2[i];
@@ -1465,11 +1948,13 @@ struct ExecR2R
         if (r2c && (!forward))
           for (size_t i=2; i<it.length_out(); i+=2)
             buf2[i] = -buf2[i];
+        if constexpr (!is_same<Tstore, no_callback>::value)
+          copy_output(it, buf2, out, store);
         return;
         }
 
     T *buf1=storage.transformBuf(), *buf2=storage.dataBuf();
-    copy_input(it, in, buf2);
+    copy_input(it, in, buf2, load);
     if ((!r2c) && forward)
       for (size_t i=2; i<it.length_out(); i+=2)
         buf2[i] = -buf2[i];
@@ -1477,7 +1962,7 @@ struct ExecR2R
     if (r2c && (!forward))
       for (size_t i=2; i<it.length_out(); i+=2)
         res[i] = -res[i];
-    copy_output(it, res, out);
+    copy_output(it, res, out, store);
     }
   template <typename T0, typename Tstorage, typename Titer> DUCC0_NOINLINE void exec_n (
     const Titer &it, const cfmav<T0> &in,
@@ -1487,7 +1972,7 @@ struct ExecR2R
     using T = typename Tstorage::datatype;
     size_t dstr = storage.data_stride();
     T *buf1=storage.transformBuf(), *buf2=storage.dataBuf();
-    copy_input(it, in, buf2, nvec, dstr);
+    copy_input(it, in, buf2, nvec, dstr, load);
     if ((!r2c) && forward)
       for (size_t k=0; k<nvec; ++k)
         for (size_t i=2; i<it.length_out(); i+=2)
@@ -1498,13 +1983,13 @@ struct ExecR2R
       for (size_t k=0; k<nvec; ++k)
         for (size_t i=2; i<it.length_out(); i+=2)
           buf2[i+k*dstr] = -buf2[i+k*dstr];
-    copy_output(it, buf2, out, nvec, dstr);
+    copy_output(it, buf2, out, nvec, dstr, store);
     }
   template <typename T0> DUCC0_NOINLINE void exec_simple (
     const T0 *in, T0 *out, const pocketfft_r<T0> &plan, T0 fct,
     size_t nthreads) const
     {
-    if (in!=out) copy_n(in, plan.length(), out);
+    copy_simple(in, out, plan.length(), load);
     if ((!r2c) && forward)
       for (size_t i=2; i<plan.length(); i+=2)
         out[i] = -out[i];
@@ -1512,8 +1997,68 @@ struct ExecR2R
     if (r2c && (!forward))
       for (size_t i=2; i<plan.length(); i+=2)
         out[i] = -out[i];
+    copy_simple(out, out, plan.length(), store);
     }
   };
+using ExecR2R = ExecR2RCallback<no_callback, no_callback>;
+
+/* Transforms along \a axis with the straight-line kernel for length N.
+   Lines are processed in bunches of fft_simdlen<T0>, one line per SIMD lane,
+   directly from the input to the output array without going through
+   per-line work buffers. */
+template<size_t N, bool fwd, typename T0> DUCC0_NOINLINE void small_c2c_axis(
+  const cfmav<Cmplx<T0>> &in, vfmav<Cmplx<T0>> &out, size_t axis, T0 fct,
+  size_t nthreads)
+  {
+  constexpr auto vlen = fft_simdlen<T0>;
+  execParallel(util::thread_count(nthreads, in, axis, vlen),
+    [&](Scheduler &sched)
+    {
+    multi_iter<vlen> it(in, out, axis, sched.num_threads(), sched.thread_num());
+    const Cmplx<T0> *pin = in.data();
+    Cmplx<T0> *pout = out.data();
+#ifndef DUCC0_NO_SIMD
+    if constexpr (vlen>1)
+      {
+      using Tv = fft_simd<T0>;
+      Cmplx<Tv> x[N], y[N];
+      while (it.remaining()>0)
+        {
+        // an incomplete last bunch is padded with copies of its last line
+        size_t nlines = min(vlen, it.remaining());
+        it.advance(nlines);
+        for (size_t i=0; i<N; ++i)
+          for (size_t j=0; j<vlen; ++j)
+            {
+            const auto &v(pin[it.iofs(min(j, nlines-1),i)]);
+            x[i].r[j] = v.r;
+            x[i].i[j] = v.i;
+            }
+        small_cfft<T0, N>::template exec<fwd>(x, y);
+        for (size_t i=0; i<N; ++i)
+          {
+          auto v = y[i]*fct;
+          for (size_t j=0; j<nlines; ++j)
+            pout[it.oofs(j,i)] = Cmplx<T0>(v.r[j], v.i[j]);
+          }
+        }
+      }
+    else
+#endif
+      {
+      Cmplx<T0> x[N], y[N];
+      while (it.remaining()>0)
+        {
+        it.advance(1);
+        for (size_t i=0; i<N; ++i)
+          x[i] = pin[it.iofs(i)];
+        small_cfft<T0, N>::template exec<fwd>(x, y);
+        for (size_t i=0; i<N; ++i)
+          pout[it.oofs(i)] = y[i]*fct;
+        }
+      }
+    });
+  }
 
 /// Complex-to-complex Fast Fourier Transform
 /** This executes a Fast Fourier Transform on \a in and stores the result in
@@ -1540,18 +2085,229 @@ template<typename T> DUCC0_NOINLINE void c2c(const cfmav<std::complex<T>> &in,
   if (in.size()==0) return;
   const auto &in2(reinterpret_cast<const cfmav<Cmplx<T> >&>(in));
   auto &out2(reinterpret_cast<vfmav<Cmplx<T> >&>(out));
+  shape_t axes2(axes);
   if ((axes.size()>1) && (in.data()!=out.data())) // optimize axis order
     for (size_t i=1; i<axes.size(); ++i)
       if ((in.stride(i)==1)&&(out.stride(i)==1))
         {
-        shape_t axes2(axes);
         swap(axes2[0],axes2[i]);
-        general_nd<pocketfft_c<T>>(in2, out2, axes2, fct, nthreads, ExecC2C{forward});
-        return;
+        break;
         }
-  general_nd<pocketfft_c<T>>(in2, out2, axes, fct, nthreads, ExecC2C{forward});
+  // batches of short transforms are done by specialized kernels; the
+  // remaining axes are transformed one by one, in the same order
+  if ((in.ndim()>1) && any_of(axes2.begin(), axes2.end(),
+    [&in](size_t ax) { return small_cfft_supported(in.shape(ax)); }))
+    {
+    for (size_t i=0; i<axes2.size(); ++i)
+      {
+      cfmav<Cmplx<T>> tin(i==0 ? in2 : out2);
+      T fct2 = (i==0) ? fct : T(1);
+      if (!small_cfft_dispatch(in.shape(axes2[i]), [&](auto len)
+        {
+        constexpr size_t N = decltype(len)::value;
+        forward ? small_c2c_axis<N, true>(tin, out2, axes2[i], fct2, nthreads)
+                : small_c2c_axis<N, false>(tin, out2, axes2[i], fct2, nthreads);
+        }))
+        general_nd<pocketfft_c<T>>(tin, out2, {axes2[i]}, fct2, nthreads,
+          ExecC2C{forward, {}, {}});
+      }
+    return;
+    }
+  general_nd<pocketfft_c<T>>(in2, out2, axes2, fct, nthreads, ExecC2C{forward, {}, {}});
+  }
+
+/* Runs general_nd() with the executor returned by
+   \a make_exec(load, store), where \a load is only applied during the pass
+   over the first axis and \a store only during the pass over the last one. */
+template<typename Tplan, typename T, typename T0, typename Tload,
+  typename Tstore, typename Tmake> void general_nd_callback(const cfmav<T> &in,
+  vfmav<T> &out, const shape_t &axes, T0 fct, size_t nthreads,
+  const Tload &load, const Tstore &store, const Tmake &make_exec)
+  {
+  if (axes.size()==1)
+    return general_nd<Tplan>(in, out, axes, fct, nthreads,
+      make_exec(load, store));
+  general_nd<Tplan>(in, out, {axes[0]}, fct, nthreads,
+    make_exec(load, no_callback()));
+  for (size_t i=1; i+1<axes.size(); ++i)
+    general_nd<Tplan>(out, out, {axes[i]}, T0(1), nthreads,
+      make_exec(no_callback(), no_callback()));
+  general_nd<Tplan>(out, out, {axes.back()}, T0(1), nthreads,
+    make_exec(no_callback(), store));
+  }
+
+/// Complex-to-complex FFT with load and store callbacks
+/** Same as c2c() above, but \a load is called as `load(v, idx, ofs)` for
+ *  every input value right after it has been read, and \a store in the same
+ *  way for every output value right before it is written. \a v is a
+ *  reference to the (modifiable) value of type `std::complex<T>`, \a idx is
+ *  its index along the transformed axis, and \a ofs its offset (in
+ *  elements) from the start of \a in or \a out, respectively.
+ *  For multidimensional transforms, \a load is used during the pass over
+ *  the first entry of \a axes and \a store during the pass over the last.
+ *  This allows fusing scaling, windowing, phase shifts and similar
+ *  operations into the transform without additional sweeps over memory.
+ *  Either callback can be replaced by `no_callback()`.
+ *  The callbacks will be called concurrently from several threads. */
+template<typename T, typename Tload, typename Tstore> DUCC0_NOINLINE void c2c(
+  const cfmav<std::complex<T>> &in, vfmav<std::complex<T>> &out,
+  const shape_t &axes, bool forward, T fct, const Tload &load,
+  const Tstore &store, size_t nthreads=1)
+  {
+  util::sanity_check_onetype(in, out, in.data()==out.data(), axes);
+  if (in.size()==0) return;
+  const auto &in2(reinterpret_cast<const cfmav<Cmplx<T> >&>(in));
+  auto &out2(reinterpret_cast<vfmav<Cmplx<T> >&>(out));
+  general_nd_callback<pocketfft_c<T>>(in2, out2, axes, fct, nthreads, load,
+    store, [forward](const auto &ld, const auto &st)
+      {
+      return ExecC2CCallback<std::decay_t<decltype(ld)>,
+        std::decay_t<decltype(st)>>{forward, ld, st};
+      });
   }
 
+/// Multidimensional DCT or DST with precomputed 1D plans
+/** The object keeps the 1D plans (including all twiddle factors) for every
+ *  transformed axis, so that repeated transforms of arrays with the same
+ *  shape do not need any plan lookups.
+ *
+ *  If several of the transformed axes lie within a trailing slab of the
+ *  array which fits into the cache, the array is processed slab by slab,
+ *  and every slab is transformed along all of these axes before moving on.
+ *  This way, only one sweep over main memory is needed for all of them.
+ *  The remaining axes are processed one after the other over the whole
+ *  array, as in dct() and dst(). */
+template<typename T> class DcstPlan
+  {
+  private:
+    // maximum size of a slab which is transformed along several axes
+    static constexpr size_t slab_bytes = size_t(1)<<19;
+
+    shape_t shape, axes, slab_axes, outer_axes;
+    int type;
+    bool cosine, ortho;
+    size_t kslab, nslab;  // a slab consists of dimensions kslab ... ndim-1
+    // plans for every dimension (empty for non-transformed ones),
+    // only the vector matching the transform type is used
+    std::tuple<vector<std::shared_ptr<T_dct1<T>>>,
+               vector<std::shared_ptr<T_dst1<T>>>,
+               vector<std::shared_ptr<T_dcst23<T>>>,
+               vector<std::shared_ptr<T_dcst4<T>>>> plans;
+
+    template<typename Tplan> void make_plans()
+      {
+      auto &pl(std::get<vector<std::shared_ptr<Tplan>>>(plans));
+      pl.resize(shape.size());
+      for (auto ax: axes)
+        pl[ax] = get_plan<Tplan>(shape[ax], shape.size()==1);
+      }
+
+    template<typename Tplan> void exec_impl(const cfmav<T> &in, vfmav<T> &out,
+      T fct, size_t nthreads) const
+      {
+      const auto &pl(std::get<vector<std::shared_ptr<Tplan>>>(plans));
+      const ExecDcst exec{ortho, type, cosine};
+      if ((in.ndim()==1)&&(in.stride(0)==1)&&(out.stride(0)==1))
+        {
+        exec.exec_simple(in.data(), out.data(), *pl[0], fct, nthreads);
+        return;
+        }
+      nthreads = adjust_nthreads(nthreads);
+      bool first = true;
+      // with fewer slabs than threads, the array is small anyway
+      bool fused = (!slab_axes.empty()) && (nslab>=nthreads);
+      if (fused)
+        {
+        execDynamic(nslab, nthreads, 1, [&](Scheduler &sched)
+          {
+          shape_t sshp(shape.begin()+ptrdiff_t(kslab), shape.end());
+          fmav_info::stride_t
+            istr(in.stride().begin()+ptrdiff_t(kslab), in.stride().end()),
+            ostr(out.stride().begin()+ptrdiff_t(kslab), out.stride().end());
+          while (auto rng=sched.getNext()) for(auto i=rng.lo; i<rng.hi; ++i)
+            {
+            ptrdiff_t iofs=0, oofs=0;
+            for (size_t d=kslab, rem=i; d-->0; rem/=shape[d])
+              {
+              auto idx = ptrdiff_t(rem%shape[d]);
+              iofs += idx*in.stride(d);
+              oofs += idx*out.stride(d);
+              }
+            cfmav<T> sin(in.data()+iofs, sshp, istr);
+            vfmav<T> sout(out.data()+oofs, sshp, ostr);
+            T f = fct;
+            for (size_t j=0; j<slab_axes.size(); ++j)
+              {
+              general_nd_axis(j==0 ? sin : sout, sout, slab_axes[j]-kslab,
+                *pl[slab_axes[j]], f, 1, exec);
+              f = T(1);
+              }
+            }
+          });
+        fct = T(1);
+        first = false;
+        }
+      for (auto ax: axes)
+        if ((!fused) || (ax<kslab))
+          {
+          general_nd_axis(first ? in : out, out, ax, *pl[ax], fct, nthreads,
+            exec);
+          fct = T(1);
+          first = false;
+          }
+      }
+
+  public:
+    /// Prepares transforms of arrays with shape \a shape_ over \a axes_.
+    /** \a type_ is the transform type (1-4); if \a cosine_ is \c true,
+     *  DCTs are computed, otherwise DSTs. For the meaning of \a ortho_,
+     *  see dct(). */
+    DcstPlan(const shape_t &shape_, const shape_t &axes_, int type_,
+      bool cosine_, bool ortho_)
+      : shape(shape_), axes(axes_), type(type_), cosine(cosine_),
+        ortho(ortho_), kslab(shape_.size()), nslab(1)
+      {
+      if ((type<1) || (type>4))
+        throw std::invalid_argument(cosine ? "invalid DCT type"
+                                           : "invalid DST type");
+      util::sanity_check_axes(shape.size(), axes);
+      if (type==1)
+        cosine ? make_plans<T_dct1<T>>() : make_plans<T_dst1<T>>();
+      else if (type==4)
+        make_plans<T_dcst4<T>>();
+      else
+        make_plans<T_dcst23<T>>();
+
+      size_t slabsz=sizeof(T);
+      while ((kslab>0) && (slabsz*shape[kslab-1]<=slab_bytes))
+        slabsz *= shape[--kslab];
+      for (auto ax: axes)
+        if (ax>=kslab) slab_axes.push_back(ax);
+      if (slab_axes.size()<2)  // nothing to gain
+        slab_axes.clear();
+      for (size_t i=0; i<kslab; ++i)
+        nslab *= shape[i];
+      }
+
+    /// Transforms \a in and stores the result in \a out.
+    /** Both arrays must have the shape passed to the constructor; the
+     *  remaining arguments have the same meaning as for dct(). */
+    void exec(const cfmav<T> &in, vfmav<T> &out, T fct,
+      size_t nthreads=1) const
+      {
+      util::sanity_check_onetype(in, out, in.data()==out.data(), axes);
+      MR_assert(in.shape()==shape, "array shape does not match the plan");
+      if (in.size()==0) return;
+      if (type==1)
+        cosine ? exec_impl<T_dct1<T>>(in, out, fct, nthreads)
+               : exec_impl<T_dst1<T>>(in, out, fct, nthreads);
+      else if (type==4)
+        exec_impl<T_dcst4<T>>(in, out, fct, nthreads);
+      else
+        exec_impl<T_dcst23<T>>(in, out, fct, nthreads);
+      }
+  };
+
 /// Fast Discrete Cosine Transform
 /** This executes a DCT on \a in and stores the result in \a out.
  *
@@ -1579,13 +2335,7 @@ template<typename T> DUCC0_NOINLINE void dct(const cfmav<T> &in, vfmav<T> &out,
   if ((type<1) || (type>4)) throw std::invalid_argument("invalid DCT type");
   util::sanity_check_onetype(in, out, in.data()==out.data(), axes);
   if (in.size()==0) return;
-  const ExecDcst exec{ortho, type, true};
-  if (type==1)
-    general_nd<T_dct1<T>>(in, out, axes, fct, nthreads, exec);
-  else if (type==4)
-    general_nd<T_dcst4<T>>(in, out, axes, fct, nthreads, exec);
-  else
-    general_nd<T_dcst23<T>>(in, out, axes, fct, nthreads, exec);
+  DcstPlan<T>(in.shape(), axes, type, true, ortho).exec(in, out, fct, nthreads);
   }
 
 /// Fast Discrete Sine Transform
@@ -1615,13 +2365,7 @@ template<typename T> DUCC0_NOINLINE void dst(const cfmav<T> &in, vfmav<T> &out,
   if ((type<1) || (type>4)) throw std::invalid_argument("invalid DST type");
   util::sanity_check_onetype(in, out, in.data()==out.data(), axes);
   if (in.size()==0) return;
-  const ExecDcst exec{ortho, type, false};
-  if (type==1)
-    general_nd<T_dst1<T>>(in, out, axes, fct, nthreads, exec);
-  else if (type==4)
-    general_nd<T_dcst4<T>>(in, out, axes, fct, nthreads, exec);
-  else
-    general_nd<T_dcst23<T>>(in, out, axes, fct, nthreads, exec);
+  DcstPlan<T>(in.shape(), axes, type, false, ortho).exec(in, out, fct, nthreads);
   }
 
 template<typename T> DUCC0_NOINLINE void r2c(const cfmav<T> &in,
@@ -1647,6 +2391,176 @@ template<typename T> DUCC0_NOINLINE void r2c(const cfmav<T> &in,
   c2c(out, out, newaxes, forward, T(1), nthreads);
   }
 
+/* Calls \a func for every box of the Cartesian product of the index
+   intervals in \a ranges (one list of intervals per dimension). Intervals
+   with beg==end are empty and skipped. */
+template<typename Func> void for_each_pruned_box
+  (const vector<vector<slice>> &ranges, Func &&func)
+  {
+  auto ndim = ranges.size();
+  vector<vector<slice>> rng(ndim);
+  for (size_t i=0; i<ndim; ++i)
+    {
+    for (const auto &r: ranges[i])
+      if (r.beg!=r.end) rng[i].push_back(r);
+    if (rng[i].empty()) return;
+    }
+  vector<size_t> idx(ndim, 0);
+  vector<slice> slc(ndim);
+  while (true)
+    {
+    for (size_t i=0; i<ndim; ++i) slc[i] = rng[i][idx[i]];
+    func(slc);
+    size_t i=0;
+    for (; i<ndim; ++i)
+      {
+      if (++idx[i]<rng[i].size()) break;
+      idx[i] = 0;
+      }
+    if (i==ndim) return;
+    }
+  }
+
+inline vector<vector<slice>> full_ranges(const vector<vector<slice>> &ranges,
+  size_t ndim)
+  {
+  if (ranges.empty()) return vector<vector<slice>>(ndim, {slice()});
+  MR_assert(ranges.size()==ndim, "need one list of ranges per dimension");
+  auto res = ranges;
+  for (auto &r: res)
+    if (r.empty()) r = {slice()};
+  return res;
+  }
+
+// shifts the offsets passed to \a cb by \a delta
+template<typename Tcb> auto offset_callback(const Tcb &cb, ptrdiff_t delta)
+  {
+  if constexpr (is_same<Tcb, no_callback>::value)
+    return no_callback();
+  else
+    return [&cb, delta](auto &v, size_t idx, ptrdiff_t ofs)
+      { cb(v, idx, ofs+delta); };
+  }
+
+/* Carries out the c2c steps of the pruned transforms. \a cur holds the
+   currently relevant index intervals for every dimension; the first
+   transform reads from \a in, all following ones work on \a out. */
+template<typename T, typename Tload, typename Tstore> void c2c_pruned_steps(
+  const cfmav<std::complex<T>> &in, vfmav<std::complex<T>> &out,
+  const shape_t &axes, vector<vector<slice>> cur,
+  const vector<vector<slice>> &needed_out, bool forward, T fct,
+  const Tload &load, const Tstore &store, size_t nthreads)
+  {
+  for (size_t i=0; i<axes.size(); ++i)
+    {
+    auto ax = axes[i];
+    bool first = (i==0), last = (i+1==axes.size());
+    cur[ax] = {slice()};
+    for_each_pruned_box(cur, [&](const vector<slice> &slc)
+      {
+      auto bout = out.subarray(slc);
+      auto st = offset_callback(store, bout.data()-out.data());
+      if (first)
+        {
+        auto bin = in.subarray(slc);
+        auto ld = offset_callback(load, bin.data()-in.data());
+        if (last)
+          c2c(bin, bout, {ax}, forward, fct, ld, st, nthreads);
+        else
+          c2c(bin, bout, {ax}, forward, fct, ld, no_callback(), nthreads);
+        }
+      else if (last)
+        c2c(bout, bout, {ax}, forward, T(1), no_callback(), st, nthreads);
+      else
+        c2c(bout, bout, {ax}, forward, T(1), nthreads);
+      });
+    cur[ax] = needed_out[ax];
+    }
+  }
+
+/// Complex-to-complex FFT with pruned input and output
+/** This computes the same result as c2c() (restricted to the requested
+ *  output region), but exploits that only parts of the input are
+ *  non-zero and only parts of the output are needed, which is typical for
+ *  zero-padded and oversampled arrays: 1D transforms of lines that are
+ *  known to be zero or whose result is not needed are skipped entirely.
+ *
+ *  \a nonzero_in and \a needed_out contain, for every dimension of the
+ *  arrays, a list of (non-wrapping, unit-stride) index intervals. Input
+ *  entries outside of \a nonzero_in must be zero; output entries outside of
+ *  \a needed_out have undefined values afterwards. An empty list (or an
+ *  empty \a nonzero_in or \a needed_out altogether) means "no restriction"
+ *  for the respective dimension(s). For dimensions not contained
+ *  in \a axes, the intervals of \a nonzero_in also limit the computation.
+ *
+ *  The transforms are carried out in the order given by \a axes, so it pays
+ *  off to list axes with restricted input first and axes with restricted
+ *  output last.
+ *
+ *  Operating in-place is most efficient; otherwise \a out has to be zeroed
+ *  first. */
+template<typename T> DUCC0_NOINLINE void c2c_pruned(
+  const cfmav<std::complex<T>> &in, vfmav<std::complex<T>> &out,
+  const shape_t &axes, const vector<vector<slice>> &nonzero_in,
+  const vector<vector<slice>> &needed_out, bool forward, T fct,
+  size_t nthreads=1)
+  {
+  c2c_pruned(in, out, axes, nonzero_in, needed_out, forward, fct,
+    no_callback(), no_callback(), nthreads);
+  }
+
+/// Pruned complex-to-complex FFT with load and store callbacks
+/** This combines c2c_pruned() with the callbacks of c2c(). The callbacks
+ *  are only invoked for the elements of lines which are actually
+ *  transformed, and the offsets passed to them always refer to the start
+ *  of \a in and \a out. */
+template<typename T, typename Tload, typename Tstore>
+  DUCC0_NOINLINE void c2c_pruned(const cfmav<std::complex<T>> &in,
+  vfmav<std::complex<T>> &out, const shape_t &axes,
+  const vector<vector<slice>> &nonzero_in,
+  const vector<vector<slice>> &needed_out, bool forward, T fct,
+  const Tload &load, const Tstore &store, size_t nthreads=1)
+  {
+  util::sanity_check_onetype(in, out, in.data()==out.data(), axes);
+  if (in.size()==0) return;
+  auto cur = full_ranges(nonzero_in, in.ndim());
+  auto needed = full_ranges(needed_out, in.ndim());
+  if (in.data()!=out.data())
+    mav_apply([](std::complex<T> &v){ v=std::complex<T>(0); }, nthreads, out);
+  c2c_pruned_steps(in, out, axes, cur, needed, forward, fct, load, store,
+    nthreads);
+  }
+
+/// Real-to-complex FFT with pruned input and output
+/** This is the pruned analogue of r2c(), with the same meaning of
+ *  \a nonzero_in and \a needed_out as in c2c_pruned(). Intervals in
+ *  \a nonzero_in refer to the shape of \a in, those in \a needed_out to
+ *  the shape of \a out. The real-to-complex transform over the last entry
+ *  of \a axes is carried out first. */
+template<typename T> DUCC0_NOINLINE void r2c_pruned(const cfmav<T> &in,
+  vfmav<std::complex<T>> &out, const shape_t &axes,
+  const vector<vector<slice>> &nonzero_in,
+  const vector<vector<slice>> &needed_out, bool forward, T fct,
+  size_t nthreads=1)
+  {
+  util::sanity_check_cr(out, in, axes);
+  if (in.size()==0) return;
+  auto cur = full_ranges(nonzero_in, in.ndim());
+  auto needed = full_ranges(needed_out, in.ndim());
+  auto ax = axes.back();
+  cur[ax] = {slice()};
+  mav_apply([](std::complex<T> &v){ v=std::complex<T>(0); }, nthreads, out);
+  for_each_pruned_box(cur, [&](const vector<slice> &slc)
+    {
+    auto bout = out.subarray(slc);
+    r2c(in.subarray(slc), bout, ax, forward, fct, nthreads);
+    });
+  if (axes.size()==1) return;
+  cur[ax] = needed[ax];
+  c2c_pruned_steps(out, out, shape_t{axes.begin(), --axes.end()}, cur,
+    needed, forward, T(1), no_callback(), no_callback(), nthreads);
+  }
+
 template<typename T> DUCC0_NOINLINE void c2r(const cfmav<std::complex<T>> &in,
   vfmav<T> &out,  size_t axis, bool forward, T fct, size_t nthreads=1)
   {
@@ -1683,6 +2597,55 @@ template<typename T> DUCC0_NOINLINE void c2r_mut(vfmav<std::complex<T>> &in,
   c2r(in, out, axes.back(), forward, fct, nthreads);
   }
 
+/// Complex-to-complex FFT of arrays with 16-bit storage
+/** Same as c2c() above, but for arrays of \c Cmplx<float16> or
+ *  \c Cmplx<bfloat16>. The values are converted to \c float while being
+ *  copied into the work buffers and rounded back to 16 bits while being
+ *  copied out, so all arithmetic is done in single precision, while memory
+ *  traffic is halved. For multidimensional transforms, the intermediate
+ *  results between the passes over the individual axes are also stored with
+ *  16 bits. Note that \c float16 overflows above 65504, so unnormalized
+ *  transforms of large arrays may require an appropriate \a fct. */
+template<typename Ts> DUCC0_NOINLINE std::enable_if_t<is_float16_type<Ts>>
+  c2c(const cfmav<Cmplx<Ts>> &in, vfmav<Cmplx<Ts>> &out,
+  const shape_t &axes, bool forward, float fct, size_t nthreads=1)
+  {
+  util::sanity_check_onetype(in, out, in.data()==out.data(), axes);
+  if (in.size()==0) return;
+  general_nd<pocketfft_c<float>>(in, out, axes, fct, nthreads,
+    ExecC2C{forward, {}, {}});
+  }
+
+/// Real-to-complex FFT of arrays with 16-bit storage
+/** Same as r2c() above, with \a in of type \c float16 or \c bfloat16;
+ *  see the 16-bit version of c2c() for details. */
+template<typename Ts> DUCC0_NOINLINE std::enable_if_t<is_float16_type<Ts>>
+  r2c(const cfmav<Ts> &in, vfmav<Cmplx<Ts>> &out, const shape_t &axes,
+  bool forward, float fct, size_t nthreads=1)
+  {
+  util::sanity_check_cr(out, in, axes);
+  if (in.size()==0) return;
+  general_r2c(in, out, axes.back(), forward, fct, nthreads);
+  if (axes.size()==1) return;
+  c2c(out, out, shape_t{axes.begin(), --axes.end()}, forward, 1.f, nthreads);
+  }
+
+/// Complex-to-real FFT of arrays with 16-bit storage
+/** Same as c2r() above, with \a out of type \c float16 or \c bfloat16;
+ *  see the 16-bit version of c2c() for details. */
+template<typename Ts> DUCC0_NOINLINE std::enable_if_t<is_float16_type<Ts>>
+  c2r(const cfmav<Cmplx<Ts>> &in, vfmav<Ts> &out, const shape_t &axes,
+  bool forward, float fct, size_t nthreads=1)
+  {
+  util::sanity_check_cr(in, out, axes);
+  if (in.size()==0) return;
+  if (axes.size()==1)
+    return general_c2r(in, out, axes[0], forward, fct, nthreads);
+  auto atmp(vfmav<Cmplx<Ts>>::build_noncritical(in.shape(), UNINITIALIZED));
+  c2c(in, atmp, shape_t{axes.begin(), --axes.end()}, forward, 1.f, nthreads);
+  general_c2r(atmp, out, axes.back(), forward, fct, nthreads);
+  }
+
 template<typename T> DUCC0_NOINLINE void r2r_fftpack(const cfmav<T> &in,
   vfmav<T> &out, const shape_t &axes, bool real2hermitian, bool forward,
   T fct, size_t nthreads=1)
@@ -1690,7 +2653,26 @@ template<typename T> DUCC0_NOINLINE void r2r_fftpack(const cfmav<T> &in,
   util::sanity_check_onetype(in, out, in.data()==out.data(), axes);
   if (in.size()==0) return;
   general_nd<pocketfft_r<T>>(in, out, axes, fct, nthreads,
-    ExecR2R{real2hermitian, forward});
+    ExecR2R{real2hermitian, forward, {}, {}});
+  }
+
+/// Real FFT in FFTPACK format with load and store callbacks
+/** Same as r2r_fftpack() above, with \a load and \a store working as
+ *  described for the c2c() variant with callbacks (the values are of type
+ *  \a T here). */
+template<typename T, typename Tload, typename Tstore>
+  DUCC0_NOINLINE void r2r_fftpack(const cfmav<T> &in, vfmav<T> &out,
+  const shape_t &axes, bool real2hermitian, bool forward, T fct,
+  const Tload &load, const Tstore &store, size_t nthreads=1)
+  {
+  util::sanity_check_onetype(in, out, in.data()==out.data(), axes);
+  if (in.size()==0) return;
+  general_nd_callback<pocketfft_r<T>>(in, out, axes, fct, nthreads, load,
+    store, [real2hermitian, forward](const auto &ld, const auto &st)
+      {
+      return ExecR2RCallback<std::decay_t<decltype(ld)>,
+        std::decay_t<decltype(st)>>{real2hermitian, forward, ld, st};
+      });
   }
 
 template<typename T> DUCC0_NOINLINE void r2r_fftw(const cfmav<T> &in,
@@ -2040,16 +3022,26 @@ template<typename T> DUCC0_NOINLINE void convolve_axis(const cfmav<complex<T>> &
 using detail_fft::FORWARD;
 using detail_fft::BACKWARD;
 using detail_fft::c2c;
+using detail_fft::c2c_pruned;
+using detail_fft::no_callback;
 using detail_fft::c2r;
 using detail_fft::c2r_mut;
 using detail_fft::r2c;
+using detail_fft::r2c_pruned;
 using detail_fft::r2r_fftpack;
 using detail_fft::r2r_fftw;
 using detail_fft::r2r_separable_hartley;
 using detail_fft::r2r_genuine_hartley;
 using detail_fft::dct;
 using detail_fft::dst;
+using detail_fft::DcstPlan;
 using detail_fft::convolve_axis;
+using detail_fft::PlanCacheStats;
+using detail_fft::plan_cache_stats;
+using detail_fft::set_plan_cache_capacity;
+using detail_fft::clear_plan_cache;
+using detail_fft::save_wisdom;
+using detail_fft::load_wisdom;
 
 } // namespace ducc0
 
@@ -62,8 +62,20 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <type_traits>
 #include <utility>
 #include <vector>
+#include <map>
+#include <tuple>
+#include <string>
+#include <ostream>
+#include <sstream>
+#include <chrono>
+#include <cstdlib>
+#include <cstdint>
+#include <limits>
 #include <typeinfo>
 #include <typeindex>
+#ifndef DUCC0_NO_THREADING
+#include <mutex>
+#endif
 #include "ducc0/infra/useful_macros.h"
 #include "ducc0/math/cmplx.h"
 #include "ducc0/infra/error_handling.h"
@@ -111,6 +123,46 @@ template<bool fwd, typename T, typename T2> void special_mul (const Cmplx<T> &v1
 
 template<bool fwd, typename T> void ROTX90(Cmplx<T> &a)
   { auto tmp_= fwd ? -a.r : a.r; a.r = fwd ? a.i : -a.i; a.i=tmp_; }
+template<bool fwd, typename Tfs, typename T> void ROTX45(Cmplx<T> &a)
+  {
+  constexpr Tfs hsqt2=Tfs(0.707106781186547524400844362104849L);
+  if constexpr (fwd)
+    { auto tmp_=a.r; a.r=hsqt2*(a.r+a.i); a.i=hsqt2*(a.i-tmp_); }
+  else
+    { auto tmp_=a.r; a.r=hsqt2*(a.r-a.i); a.i=hsqt2*(a.i+tmp_); }
+  }
+template<bool fwd, typename Tfs, typename T> void ROTX135(Cmplx<T> &a)
+  {
+  constexpr Tfs hsqt2=Tfs(0.707106781186547524400844362104849L);
+  if constexpr (fwd)
+    { auto tmp_=a.r; a.r=hsqt2*(a.i-a.r); a.i=hsqt2*(-tmp_-a.i); }
+  else
+    { auto tmp_=a.r; a.r=hsqt2*(-a.r-a.i); a.i=hsqt2*(tmp_-a.i); }
+  }
+
+/* in-place length-8 DFT, results in natural order */
+template<bool fwd, typename Tfs, typename Tcd> inline void BFLY8
+  (Tcd &v0, Tcd &v1, Tcd &v2, Tcd &v3, Tcd &v4, Tcd &v5, Tcd &v6, Tcd &v7)
+  {
+  Tcd a0, a1, a2, a3, a4, a5, a6, a7, t1, t2, t3, t4;
+  PM(a0,a4,v0,v4);
+  PM(a1,a5,v1,v5);
+  PM(a2,a6,v2,v6);
+  PM(a3,a7,v3,v7);
+  ROTX45<fwd,Tfs>(a5);
+  ROTX90<fwd>(a6);
+  ROTX135<fwd,Tfs>(a7);
+  PM(t2,t1,a0,a2);
+  PM(t3,t4,a1,a3);
+  ROTX90<fwd>(t4);
+  PM(v0,v4,t2,t3);
+  PM(v2,v6,t1,t4);
+  PM(t2,t1,a4,a6);
+  PM(t3,t4,a5,a7);
+  ROTX90<fwd>(t4);
+  PM(v1,v5,t2,t3);
+  PM(v3,v7,t1,t4);
+  }
 
 template<typename T> inline auto tidx() { return type_index(typeid(T)); }
 
@@ -189,8 +241,304 @@ struct util1d // hack to avoid duplicate symbols
     }
   };
 
+/// Planning strategies for 1D transforms
+enum class PlannerMode
+  {
+  estimate, ///< choose the algorithm by heuristics (fast)
+  measure   ///< benchmark candidate algorithms and keep the fastest one
+  };
+
+/// Description of the algorithm used for the outermost level of a 1D FFT
+struct PassChoice
+  {
+  enum Algo { multipass, bluestein, complexify, pfa };
+  Algo algo;
+  /// sub-pass lengths in order of application (only for multipass),
+  /// or the two coprime sub-lengths (only for pfa)
+  vector<size_t> factors;
+
+  bool operator==(const PassChoice &other) const
+    { return (algo==other.algo) && (factors==other.factors); }
+  };
+
+/// Process-wide store of planning decisions for 1D transforms.
+/** Entries are keyed by transform kind ('c' for complex, 'r' for real),
+ *  the size of the floating-point type in bytes, and the transform length.
+ *  In measure mode every benchmarked decision is recorded here, so that
+ *  the benchmark cost is only paid once per length. The store can be written
+ *  to and restored from wisdom files together with the plan cache. */
+class PlannerWisdom
+  {
+  private:
+    using Key = tuple<char, size_t, size_t>;
+    map<Key, PassChoice> choices;
+    PlannerMode mode_;
+#ifndef DUCC0_NO_THREADING
+    mutable mutex mut;
+#endif
+
+    static PlannerMode mode_from_env()
+      {
+      auto evar=getenv("DUCC0_FFT_PLANNER");
+      if (!evar) return PlannerMode::estimate;
+      string val(evar);
+      if (val=="measure") return PlannerMode::measure;
+      MR_assert(val=="estimate", "invalid value in DUCC0_FFT_PLANNER");
+      return PlannerMode::estimate;
+      }
+
+    PlannerWisdom() : mode_(mode_from_env()) {}
+
+  public:
+    static PlannerWisdom &instance()
+      {
+      static PlannerWisdom wisdom;
+      return wisdom;
+      }
+
+    PlannerMode mode() const
+      {
+#ifndef DUCC0_NO_THREADING
+      lock_guard<mutex> lock(mut);
+#endif
+      return mode_;
+      }
+    void set_mode(PlannerMode mode)
+      {
+#ifndef DUCC0_NO_THREADING
+      lock_guard<mutex> lock(mut);
+#endif
+      mode_ = mode;
+      }
+    bool lookup(char kind, size_t bytes, size_t length, PassChoice &res) const
+      {
+#ifndef DUCC0_NO_THREADING
+      lock_guard<mutex> lock(mut);
+#endif
+      auto it = choices.find(Key(kind, bytes, length));
+      if (it==choices.end()) return false;
+      res = it->second;
+      return true;
+      }
+    void store(char kind, size_t bytes, size_t length, const PassChoice &choice)
+      {
+#ifndef DUCC0_NO_THREADING
+      lock_guard<mutex> lock(mut);
+#endif
+      choices[Key(kind, bytes, length)] = choice;
+      }
+    void clear()
+      {
+#ifndef DUCC0_NO_THREADING
+      lock_guard<mutex> lock(mut);
+#endif
+      choices.clear();
+      }
+    size_t size() const
+      {
+#ifndef DUCC0_NO_THREADING
+      lock_guard<mutex> lock(mut);
+#endif
+      return choices.size();
+      }
+
+    /// Writes all decisions as "pass" lines of a wisdom file.
+    void save(ostream &os) const
+      {
+      static const char *names[] = {"multipass", "bluestein", "complexify",
+                                    "pfa"};
+#ifndef DUCC0_NO_THREADING
+      lock_guard<mutex> lock(mut);
+#endif
+      for (const auto &[key, choice]: choices)
+        {
+        os << "pass " << get<0>(key) << " " << get<1>(key) << " "
+           << get<2>(key) << " " << names[choice.algo];
+        for (auto f: choice.factors) os << " " << f;
+        os << "\n";
+        }
+      }
+    /// Parses the remainder of a "pass" line of a wisdom file.
+    void add_from_wisdom(istream &is)
+      {
+      char kind;
+      size_t bytes, length;
+      string algo;
+      MR_assert(is >> kind >> bytes >> length >> algo, "malformed pass entry");
+      PassChoice choice;
+      if (algo=="multipass") choice.algo = PassChoice::multipass;
+      else if (algo=="bluestein") choice.algo = PassChoice::bluestein;
+      else if (algo=="complexify") choice.algo = PassChoice::complexify;
+      else if (algo=="pfa") choice.algo = PassChoice::pfa;
+      else MR_fail("unknown algorithm '", algo, "' in pass entry");
+      size_t f, prod=1;
+      while (is >> f) { choice.factors.push_back(f); prod*=f; }
+      if ((choice.algo==PassChoice::multipass) || (choice.algo==PassChoice::pfa))
+        MR_assert(prod==length, "inconsistent pass entry");
+      if (choice.algo==PassChoice::pfa)
+        MR_assert(choice.factors.size()==2, "inconsistent pass entry");
+      store(kind, bytes, length, choice);
+      }
+  };
+
+/// Sets the planning strategy for all 1D transforms planned from now on.
+/** The initial value is taken from the environment variable
+ *  DUCC0_FFT_PLANNER ("estimate" or "measure"); default is "estimate". */
+inline void set_planner_mode(PlannerMode mode)
+  { PlannerWisdom::instance().set_mode(mode); }
+inline PlannerMode planner_mode()
+  { return PlannerWisdom::instance().mode(); }
+
+/// Helper for comparing and timing candidate plans in measure mode.
+/** \a Tpass is cfftpass<Tfs> or rfftpass<Tfs>, \a T the corresponding
+ *  data type. All candidates are checked against the result of a reference
+ *  plan, so that a faulty candidate can never be selected. */
+template<typename Tpass, typename T> class pass_tester
+  {
+  private:
+    size_t n;
+    vector<T> input, ref_fwd, ref_bwd;
+    mutable vector<T> a, b, buf;
+
+    template<typename Tf> static void fill(size_t i, Tf &v)
+      { v = Tf((i*7919+13)%1009)/Tf(1009) - Tf(0.5); }
+    template<typename Tf> static void fill(size_t i, Cmplx<Tf> &v)
+      { fill(2*i, v.r); fill(2*i+1, v.i); }
+    template<typename Tf> static Tf sqr(const Tf &v)
+      { return v*v; }
+    template<typename Tf> static Tf sqr(const Cmplx<Tf> &v)
+      { return v.r*v.r+v.i*v.i; }
+
+    const T *run(const Tpass &pass, bool fwd) const
+      {
+      static const auto ti = tidx<T *>();
+      buf.resize(pass.bufsize());
+      a = input;
+      return static_cast<T *>(pass.exec(ti, a.data(), b.data(), buf.data(),
+        fwd));
+      }
+    bool close(const T *res, const vector<T> &ref) const
+      {
+      double err=0, nrm=0;
+      for (size_t i=0; i<n; ++i)
+        {
+        err += double(sqr(res[i]-ref[i]));
+        nrm += double(sqr(ref[i]));
+        }
+      using Tf = decltype(sqr(T()));
+      double eps = double(numeric_limits<Tf>::epsilon());
+      return err <= nrm*sqr(1e3*eps);
+      }
+
+  public:
+    pass_tester(const Tpass &ref, size_t n_)
+      : n(n_), input(n), a(n), b(n)
+      {
+      for (size_t i=0; i<n; ++i)
+        fill(i, input[i]);
+      auto res = run(ref, true);
+      ref_fwd.assign(res, res+n);
+      res = run(ref, false);
+      ref_bwd.assign(res, res+n);
+      }
+
+    /// Returns \a true if \a pass reproduces the reference results.
+    bool matches(const Tpass &pass) const
+      { return close(run(pass, true), ref_fwd)
+            && close(run(pass, false), ref_bwd); }
+
+    /// Returns the best of three timings (in seconds) of a forward transform.
+    double time(const Tpass &pass) const
+      {
+      using clock = chrono::steady_clock;
+      double best = numeric_limits<double>::max();
+      size_t nrep = 1;
+      for (size_t trial=0; trial<3; ++trial)
+        for (;;)
+          {
+          auto t0 = clock::now();
+          for (size_t rep=0; rep<nrep; ++rep)
+            run(pass, true);
+          double dt = chrono::duration<double>(clock::now()-t0).count();
+          if ((dt<2e-4) && (nrep<(size_t(1)<<20)))
+            { nrep*=2; continue; }
+          best = min(best, dt/double(nrep));
+          break;
+          }
+      return best;
+      }
+  };
+
 template<typename T> using Troots = shared_ptr<const UnityRoots<T,Cmplx<T>>>;
 
+/// Process-wide store of read-only tables that can be shared between plans.
+/** A table is identified by its type and a key. The store only keeps weak
+ *  references, so a table is freed as soon as the last plan using it is
+ *  destroyed. */
+template<typename Tval, typename Tkey> class SharedTableStore
+  {
+  private:
+    map<Tkey, weak_ptr<const Tval>> tables;
+#ifndef DUCC0_NO_THREADING
+    mutex mut;
+#endif
+
+    SharedTableStore() {}
+
+  public:
+    static SharedTableStore &instance()
+      {
+      static SharedTableStore store;
+      return store;
+      }
+
+    /// Returns the table for \a key; if it does not exist yet, it is
+    /// produced by calling \a create().
+    template<typename Func> shared_ptr<const Tval> get(const Tkey &key,
+      Func &&create)
+      {
+      {
+#ifndef DUCC0_NO_THREADING
+      lock_guard<mutex> lock(mut);
+#endif
+      auto it = tables.find(key);
+      if (it!=tables.end())
+        if (auto res = it->second.lock())
+          return res;
+      }
+      // Creation can take long and may need other shared tables, so it is
+      // done without holding the lock.
+      shared_ptr<const Tval> res = create();
+#ifndef DUCC0_NO_THREADING
+      lock_guard<mutex> lock(mut);
+#endif
+      for (auto it=tables.begin(); it!=tables.end(); )
+        it = it->second.expired() ? tables.erase(it) : next(it);
+      auto &slot = tables[key];
+      if (auto other = slot.lock())  // another thread was faster
+        return other;
+      slot = res;
+      return res;
+      }
+    size_t size()
+      {
+#ifndef DUCC0_NO_THREADING
+      lock_guard<mutex> lock(mut);
+#endif
+      size_t res=0;
+      for (const auto &entry: tables)
+        res += !entry.second.expired();
+      return res;
+      }
+  };
+
+/// Returns the (shared) table of the \a n-th roots of unity.
+template<typename T> Troots<T> get_roots(size_t n)
+  {
+  return SharedTableStore<UnityRoots<T,Cmplx<T>>, size_t>::instance().get(n,
+    [n]() { return make_shared<const UnityRoots<T,Cmplx<T>>>(n); });
+  }
+
 // T: "type", f/c: "float/complex", s/v: "scalar/vector"
 template <typename Tfs> class cfftpass
   {
@@ -231,11 +579,9 @@ template <typename Tfs> class cfftpass
 
     static shared_ptr<cfftpass> make_pass(size_t l1, size_t ido, size_t ip,
       const Troots<Tfs> &roots, bool vectorize=false);
-    static shared_ptr<cfftpass> make_pass(size_t ip, bool vectorize=false)
-      {
-      return make_pass(1,1,ip,make_shared<UnityRoots<Tfs,Cmplx<Tfs>>>(ip),
-        vectorize);
-      }
+    /// Returns a plan for a complete transform of length \a ip, taking
+    /// recorded and (in measure mode) benchmarked decisions into account.
+    static shared_ptr<cfftpass> make_pass(size_t ip, bool vectorize=false);
   };
 
 #define POCKETFFT_EXEC_DISPATCH \
@@ -563,6 +909,169 @@ template <typename Tfs> class cfftp4: public cfftpass<Tfs>
     POCKETFFT_EXEC_DISPATCH
   };
 
+template <typename Tfs> class cfftp8: public cfftpass<Tfs>
+  {
+  private:
+    using typename cfftpass<Tfs>::Tcs;
+
+    size_t l1, ido;
+    static constexpr size_t ip=8;
+    quick_array<Tcs> wa;
+
+    auto WA(size_t x, size_t i) const
+      { return wa[x+(i-1)*(ip-1)]; }
+
+    template<bool fwd, typename Tcd> Tcd *exec_
+      (const Tcd * DUCC0_RESTRICT cc, Tcd * DUCC0_RESTRICT ch, Tcd * /*buf*/,
+      size_t /*nthreads*/) const
+      {
+      auto CH = [ch,this](size_t a, size_t b, size_t c) -> Tcd&
+        { return ch[a+ido*(b+l1*c)]; };
+      auto CC = [cc,this](size_t a, size_t b, size_t c) -> const Tcd&
+        { return cc[a+ido*(b+ip*c)]; };
+
+#define POCKETFFT_PREP8(idx) \
+        Tcd v0=CC(idx,0,k), v1=CC(idx,1,k), v2=CC(idx,2,k), v3=CC(idx,3,k), \
+            v4=CC(idx,4,k), v5=CC(idx,5,k), v6=CC(idx,6,k), v7=CC(idx,7,k); \
+        BFLY8<fwd,Tfs>(v0,v1,v2,v3,v4,v5,v6,v7);
+
+      if (ido==1)
+        for (size_t k=0; k<l1; ++k)
+          {
+          POCKETFFT_PREP8(0)
+          CH(0,k,0)=v0; CH(0,k,1)=v1; CH(0,k,2)=v2; CH(0,k,3)=v3;
+          CH(0,k,4)=v4; CH(0,k,5)=v5; CH(0,k,6)=v6; CH(0,k,7)=v7;
+          }
+      else
+        for (size_t k=0; k<l1; ++k)
+          {
+          {
+          POCKETFFT_PREP8(0)
+          CH(0,k,0)=v0; CH(0,k,1)=v1; CH(0,k,2)=v2; CH(0,k,3)=v3;
+          CH(0,k,4)=v4; CH(0,k,5)=v5; CH(0,k,6)=v6; CH(0,k,7)=v7;
+          }
+          for (size_t i=1; i<ido; ++i)
+            {
+            POCKETFFT_PREP8(i)
+            CH(i,k,0) = v0;
+            special_mul<fwd>(v1,WA(0,i),CH(i,k,1));
+            special_mul<fwd>(v2,WA(1,i),CH(i,k,2));
+            special_mul<fwd>(v3,WA(2,i),CH(i,k,3));
+            special_mul<fwd>(v4,WA(3,i),CH(i,k,4));
+            special_mul<fwd>(v5,WA(4,i),CH(i,k,5));
+            special_mul<fwd>(v6,WA(5,i),CH(i,k,6));
+            special_mul<fwd>(v7,WA(6,i),CH(i,k,7));
+            }
+          }
+
+#undef POCKETFFT_PREP8
+
+      return ch;
+      }
+
+  public:
+    cfftp8(size_t l1_, size_t ido_, const Troots<Tfs> &roots)
+      : l1(l1_), ido(ido_), wa((ip-1)*(ido-1))
+      {
+      size_t N=ip*l1*ido;
+      size_t rfct = roots->size()/N;
+      MR_assert(roots->size()==N*rfct, "mismatch");
+      for (size_t i=1; i<ido; ++i)
+        for (size_t j=1; j<ip; ++j)
+          wa[(j-1)+(i-1)*(ip-1)] = (*roots)[rfct*j*l1*i];
+      }
+
+    virtual size_t bufsize() const { return 0; }
+    virtual bool needs_copy() const { return true; }
+
+    POCKETFFT_EXEC_DISPATCH
+  };
+
+template <typename Tfs> class cfftp16: public cfftpass<Tfs>
+  {
+  private:
+    using typename cfftpass<Tfs>::Tcs;
+
+    size_t l1, ido;
+    static constexpr size_t ip=16;
+    quick_array<Tcs> wa;
+
+    auto WA(size_t x, size_t i) const
+      { return wa[x+(i-1)*(ip-1)]; }
+
+    // splits the 16 inputs into two length-8 DFTs over even and odd outputs
+    template<bool fwd, typename Tcd> static inline void prep16
+      (const Tcd *in, Tcd *ve, Tcd *vo)
+      {
+      const Tcs w1(Tfs(0.9238795325112867561281831893967883L),
+                   Tfs(0.3826834323650897717284599840303989L)),
+                w3(w1.i, w1.r), w5(-w1.i, w1.r), w7(-w1.r, w1.i);
+      for (size_t m=0; m<8; ++m)
+        PM(ve[m],vo[m],in[m],in[m+8]);
+      special_mul<fwd>(vo[1],w1,vo[1]);
+      ROTX45<fwd,Tfs>(vo[2]);
+      special_mul<fwd>(vo[3],w3,vo[3]);
+      ROTX90<fwd>(vo[4]);
+      special_mul<fwd>(vo[5],w5,vo[5]);
+      ROTX135<fwd,Tfs>(vo[6]);
+      special_mul<fwd>(vo[7],w7,vo[7]);
+      BFLY8<fwd,Tfs>(ve[0],ve[1],ve[2],ve[3],ve[4],ve[5],ve[6],ve[7]);
+      BFLY8<fwd,Tfs>(vo[0],vo[1],vo[2],vo[3],vo[4],vo[5],vo[6],vo[7]);
+      }
+
+    template<bool fwd, typename Tcd> Tcd *exec_
+      (const Tcd * DUCC0_RESTRICT cc, Tcd * DUCC0_RESTRICT ch, Tcd * /*buf*/,
+      size_t /*nthreads*/) const
+      {
+      auto CH = [ch,this](size_t a, size_t b, size_t c) -> Tcd&
+        { return ch[a+ido*(b+l1*c)]; };
+      auto CC = [cc,this](size_t a, size_t b, size_t c) -> const Tcd&
+        { return cc[a+ido*(b+ip*c)]; };
+
+      for (size_t k=0; k<l1; ++k)
+        {
+        {
+        Tcd v[ip], ve[8], vo[8];
+        for (size_t m=0; m<ip; ++m) v[m] = CC(0,m,k);
+        prep16<fwd>(v, ve, vo);
+        for (size_t m=0; m<8; ++m)
+          { CH(0,k,2*m) = ve[m]; CH(0,k,2*m+1) = vo[m]; }
+        }
+        for (size_t i=1; i<ido; ++i)
+          {
+          Tcd v[ip], ve[8], vo[8];
+          for (size_t m=0; m<ip; ++m) v[m] = CC(i,m,k);
+          prep16<fwd>(v, ve, vo);
+          CH(i,k,0) = ve[0];
+          special_mul<fwd>(vo[0],WA(0,i),CH(i,k,1));
+          for (size_t m=1; m<8; ++m)
+            {
+            special_mul<fwd>(ve[m],WA(2*m-1,i),CH(i,k,2*m));
+            special_mul<fwd>(vo[m],WA(2*m,i),CH(i,k,2*m+1));
+            }
+          }
+        }
+      return ch;
+      }
+
+  public:
+    cfftp16(size_t l1_, size_t ido_, const Troots<Tfs> &roots)
+      : l1(l1_), ido(ido_), wa((ip-1)*(ido-1))
+      {
+      size_t N=ip*l1*ido;
+      size_t rfct = roots->size()/N;
+      MR_assert(roots->size()==N*rfct, "mismatch");
+      for (size_t i=1; i<ido; ++i)
+        for (size_t j=1; j<ip; ++j)
+          wa[(j-1)+(i-1)*(ip-1)] = (*roots)[rfct*j*l1*i];
+      }
+
+    virtual size_t bufsize() const { return 0; }
+    virtual bool needs_copy() const { return true; }
+
+    POCKETFFT_EXEC_DISPATCH
+  };
+
 template <typename Tfs> class cfftp5: public cfftpass<Tfs>
   {
   private:
@@ -1029,15 +1538,67 @@ template <typename Tfs> class cfftpg: public cfftpass<Tfs>
     POCKETFFT_EXEC_DISPATCH
   };
 
+/* The chirp b_k and the Fourier transform of its zero-padded version only
+   depend on the Bluestein length ip, so they are shared between all
+   Bluestein passes of the same length and precision. */
+template<typename Tfs> struct BluesteinKernel
+  {
+  using Tcs = Cmplx<Tfs>;
+
+  size_t ip2;
+  Tcpass<Tfs> subplan;
+  quick_array<Tcs> bk, bkf;
+
+  BluesteinKernel(size_t ip, bool vectorize)
+    : ip2(util1d::good_size_cmplx(ip*2-1)),
+      subplan(cfftpass<Tfs>::make_pass(ip2, vectorize)), bk(ip), bkf(ip2/2+1)
+    {
+    /* initialize b_k */
+    bk[0].Set(1, 0);
+    size_t coeff=0;
+    auto roots2 = get_roots<Tfs>(2*ip);
+    for (size_t m=1; m<ip; ++m)
+      {
+      coeff+=2*m-1;
+      if (coeff>=2*ip) coeff-=2*ip;
+      bk[m] = (*roots2)[coeff];
+      }
+
+    /* initialize the zero-padded, Fourier transformed b_k. Add normalisation. */
+    quick_array<Tcs> tbkf(ip2), tbkf2(ip2);
+    Tfs xn2 = Tfs(1)/Tfs(ip2);
+    tbkf[0] = bk[0]*xn2;
+    for (size_t m=1; m<ip; ++m)
+      tbkf[m] = tbkf[ip2-m] = bk[m]*xn2;
+    for (size_t m=ip;m<=(ip2-ip);++m)
+      tbkf[m].Set(0.,0.);
+    quick_array<Tcs> buf(subplan->bufsize());
+    static const auto tics=tidx<Tcs *>();
+    auto res = static_cast<Tcs *>(subplan->exec(tics, tbkf.data(),
+      tbkf2.data(), buf.data(), true));
+    for (size_t i=0; i<ip2/2+1; ++i)
+      bkf[i] = res[i];
+    }
+
+  static shared_ptr<const BluesteinKernel> get(size_t ip, bool vectorize)
+    {
+    return SharedTableStore<BluesteinKernel, tuple<size_t, bool>>::instance()
+      .get({ip, vectorize}, [ip, vectorize]()
+        { return make_shared<const BluesteinKernel>(ip, vectorize); });
+    }
+  };
+
 template <typename Tfs> class cfftpblue: public cfftpass<Tfs>
   {
   private:
     using typename cfftpass<Tfs>::Tcs;
 
     const size_t l1, ido, ip;
+    const shared_ptr<const BluesteinKernel<Tfs>> kernel;
     const size_t ip2;
     const Tcpass<Tfs> subplan;
-    quick_array<Tcs> wa, bk, bkf;
+    quick_array<Tcs> wa;
+    const Tcs *bk, *bkf;
     size_t bufsz;
     bool need_cpy;
 
@@ -1119,9 +1680,10 @@ template <typename Tfs> class cfftpblue: public cfftpass<Tfs>
   public:
     cfftpblue(size_t l1_, size_t ido_, size_t ip_, const Troots<Tfs> &roots,
       bool vectorize=false)
-      : l1(l1_), ido(ido_), ip(ip_), ip2(util1d::good_size_cmplx(ip*2-1)),
-        subplan(cfftpass<Tfs>::make_pass(ip2, vectorize)), wa((ip-1)*(ido-1)),
-        bk(ip), bkf(ip2/2+1)
+      : l1(l1_), ido(ido_), ip(ip_),
+        kernel(BluesteinKernel<Tfs>::get(ip, vectorize)), ip2(kernel->ip2),
+        subplan(kernel->subplan), wa((ip-1)*(ido-1)), bk(kernel->bk.data()),
+        bkf(kernel->bkf.data())
       {
       size_t N=ip*l1*ido;
       auto rfct = roots->size()/N;
@@ -1130,34 +1692,6 @@ template <typename Tfs> class cfftpblue: public cfftpass<Tfs>
         for (size_t i=1; i<ido; ++i)
           wa[(j-1)*(ido-1)+i-1] = (*roots)[rfct*j*l1*i];
 
-      /* initialize b_k */
-      bk[0].Set(1, 0);
-      size_t coeff=0;
-      auto roots2 = ((roots->size()/(2*ip))*2*ip==roots->size()) ?
-                    roots : make_shared<const UnityRoots<Tfs,Tcs>>(2*ip);
-      size_t rfct2 = roots2->size()/(2*ip);
-      for (size_t m=1; m<ip; ++m)
-        {
-        coeff+=2*m-1;
-        if (coeff>=2*ip) coeff-=2*ip;
-        bk[m] = (*roots2)[coeff*rfct2];
-        }
-
-      /* initialize the zero-padded, Fourier transformed b_k. Add normalisation. */
-      quick_array<Tcs> tbkf(ip2), tbkf2(ip2);
-      Tfs xn2 = Tfs(1)/Tfs(ip2);
-      tbkf[0] = bk[0]*xn2;
-      for (size_t m=1; m<ip; ++m)
-        tbkf[m] = tbkf[ip2-m] = bk[m]*xn2;
-      for (size_t m=ip;m<=(ip2-ip);++m)
-        tbkf[m].Set(0.,0.);
-      quick_array<Tcs> buf(subplan->bufsize());
-      static const auto tics=tidx<Tcs *>();
-      auto res = static_cast<Tcs *>(subplan->exec(tics, tbkf.data(),
-        tbkf2.data(), buf.data(), true));
-      for (size_t i=0; i<ip2/2+1; ++i)
-        bkf[i] = res[i];
-
       need_cpy = l1>1;
       bufsz = ip2*(1+subplan->needs_copy()) + subplan->bufsize();
       }
@@ -1540,8 +2074,29 @@ MR_fail("must not get here");
       }
 
   public:
+    /// Returns the sequence of sub-pass lengths used by default for a
+    /// transform of length \a ip.
+    static vector<size_t> default_factors(size_t ip)
+      {
+      if (ip<=10000)
+        return cfftpass<Tfs>::factorize(ip);
+      vector<size_t> packets(2,1);
+      auto factors = util1d::prime_factors(ip);
+      sort(factors.begin(), factors.end(), std::greater<size_t>());
+      for (auto fct: factors)
+        (packets[0]>packets[1]) ? packets[1]*=fct : packets[0]*=fct;
+      return packets;
+      }
+
     cfft_multipass(size_t l1_, size_t ido_, size_t ip_,
       const Troots<Tfs> &roots, bool vectorize=false)
+      : cfft_multipass(l1_, ido_, ip_, roots, default_factors(ip_), vectorize)
+      {}
+    /// Builds a multipass with the sub-pass lengths given in \a factors,
+    /// in this order. Their product must be equal to \a ip_.
+    cfft_multipass(size_t l1_, size_t ido_, size_t ip_,
+      const Troots<Tfs> &roots, const vector<size_t> &factors,
+      bool /*vectorize*/=false)
       : l1(l1_), ido(ido_), ip(ip_), bufsz(0), need_cpy(false),
         myroots(roots)
       {
@@ -1549,33 +2104,13 @@ MR_fail("must not get here");
       rfct = roots->size()/N;
       MR_assert(roots->size()==N*rfct, "mismatch");
 
-      // FIXME TBD
-// do we need the vectorize flag at all?
-      size_t lim = vectorize ? 10000 : 10000;
-      if (ip<=lim)
-        {
-        auto factors = cfftpass<Tfs>::factorize(ip);
-        size_t l1l=1;
-        for (auto fct: factors)
-          {
-          passes.push_back(cfftpass<Tfs>::make_pass(l1l, ip/(fct*l1l), fct, roots, false));
-          l1l*=fct;
-          }
-        }
-      else
+      size_t l1l=1;
+      for (auto fct: factors)
         {
-        vector<size_t> packets(2,1);
-        auto factors = util1d::prime_factors(ip);
-        sort(factors.begin(), factors.end(), std::greater<size_t>());
-        for (auto fct: factors)
-          (packets[0]>packets[1]) ? packets[1]*=fct : packets[0]*=fct;
-        size_t l1l=1;
-        for (auto pkt: packets)
-          {
-          passes.push_back(cfftpass<Tfs>::make_pass(l1l, ip/(pkt*l1l), pkt, roots, false));
-          l1l*=pkt;
-          }
+        passes.push_back(cfftpass<Tfs>::make_pass(l1l, ip/(fct*l1l), fct, roots, false));
+        l1l*=fct;
         }
+      MR_assert(l1l==ip, "bad factorization");
       for (const auto &pass: passes)
         {
         bufsz = max(bufsz, pass->bufsize());
@@ -1594,6 +2129,164 @@ MR_fail("must not get here");
     POCKETFFT_EXEC_DISPATCH
   };
 
+/* Index maps of the prime factor algorithm for coprime lengths n1 and n2.
+   Entry i1*n2+i2 of "in" is the input index read for element (i1,i2) of the
+   intermediate n1 x n2 array; entry k1*n2+k2 of "out" is the output index
+   of the result with k=k1 mod n1, k=k2 mod n2 (Chinese remainder theorem). */
+struct PFAIndex
+  {
+  vector<size_t> in, out;
+
+  PFAIndex(size_t n1, size_t n2)
+    : in(n1*n2), out(n1*n2)
+    {
+    size_t n=n1*n2;
+    for (size_t i1=0, start=0; i1<n1; ++i1, start+=n2)
+      for (size_t i2=0, idx=start; i2<n2; ++i2)
+        {
+        in[i1*n2+i2] = idx;
+        idx += n1;
+        if (idx>=n) idx-=n;
+        }
+    for (size_t k=0, k1=0, k2=0; k<n; ++k)
+      {
+      out[k1*n2+k2] = k;
+      if (++k1==n1) k1=0;
+      if (++k2==n2) k2=0;
+      }
+    }
+
+  static shared_ptr<const PFAIndex> get(size_t n1, size_t n2)
+    {
+    return SharedTableStore<PFAIndex, tuple<size_t, size_t>>::instance()
+      .get({n1, n2}, [n1, n2]()
+        { return make_shared<const PFAIndex>(n1, n2); });
+    }
+  };
+
+/* Good-Thomas prime factor algorithm for lengths ip=n1*n2 with coprime n1
+   and n2: after re-indexing, the transform separates into n1 transforms of
+   length n2 and n2 transforms of length n1 without any twiddle factors in
+   between. */
+template <typename Tfs> class cfft_pfa: public cfftpass<Tfs>
+  {
+  private:
+    using typename cfftpass<Tfs>::Tcs;
+
+    size_t n1, n2;
+    Tcpass<Tfs> plan1, plan2;
+    shared_ptr<const PFAIndex> idx;
+    // buffer size (in units of Cmplx<T>) needed for transforming type T
+    size_t bufsz;
+    // buffer size (in units of Tcs) needed by the SIMD code path, which
+    // carves bufsz SIMD vectors out of the buffer
+    size_t bufsz_simd;
+
+    template<bool fwd, typename T> Cmplx<T> *exec_(Cmplx<T> *cc, Cmplx<T> *ch,
+      Cmplx<T> *buf, size_t /*nthreads*/) const
+      {
+      using Tc = Cmplx<T>;
+      size_t nmax = max(n1, n2);
+      if constexpr(is_same<T,Tfs>::value && fft1d_simd_exists<Tfs>)
+        {
+        // process several rows/columns at once in SIMD registers
+        using Tfv = fft1d_simd<Tfs>;
+        using Tcv = Cmplx<Tfv>;
+        constexpr size_t vlen = Tfv::size();
+        const type_index ticv = tidx<Tcv *>();
+        auto addr = reinterpret_cast<uintptr_t>(buf);
+        addr = (addr+alignof(Tcv)-1) & ~uintptr_t(alignof(Tcv)-1);
+        Tcv *line = reinterpret_cast<Tcv *>(addr), *line2 = line+nmax,
+            *buf2 = line+2*nmax;
+        for (size_t i1=0; i1<n1; i1+=vlen)
+          {
+          for (size_t i2=0; i2<n2; ++i2)
+            for (size_t j=0; j<vlen; ++j)
+              {
+              const auto &v(cc[idx->in[min(i1+j, n1-1)*n2+i2]]);
+              line[i2].r[j] = v.r;
+              line[i2].i[j] = v.i;
+              }
+          auto res = static_cast<Tcv *>(plan2->exec(ticv, line, line2, buf2, fwd));
+          for (size_t j=0; j<min(vlen, n1-i1); ++j)
+            for (size_t i2=0; i2<n2; ++i2)
+              ch[(i1+j)*n2+i2] = Tc(res[i2].r[j], res[i2].i[j]);
+          }
+        const size_t *iout = idx->out.data();
+        for (size_t i2=0; i2<n2; i2+=vlen)
+          {
+          for (size_t i1=0; i1<n1; ++i1)
+            for (size_t j=0; j<vlen; ++j)
+              {
+              const auto &v(ch[i1*n2+min(i2+j, n2-1)]);
+              line[i1].r[j] = v.r;
+              line[i1].i[j] = v.i;
+              }
+          auto res = static_cast<Tcv *>(plan1->exec(ticv, line, line2, buf2, fwd));
+          for (size_t i1=0; i1<n1; ++i1)
+            for (size_t j=0; j<min(vlen, n2-i2); ++j)
+              cc[iout[i1*n2+i2+j]] = Tc(res[i1].r[j], res[i1].i[j]);
+          }
+        return cc;
+        }
+      static const auto tic = tidx<Tc *>();
+      Tc *line = buf, *line2 = buf+nmax, *buf2 = buf+2*nmax;
+      // transforms of length n2 over the rows of the re-indexed input
+      for (size_t i1=0; i1<n1; ++i1)
+        {
+        Tc *row = ch+i1*n2;
+        const size_t *iin = idx->in.data()+i1*n2;
+        for (size_t i2=0; i2<n2; ++i2)
+          row[i2] = cc[iin[i2]];
+        auto res = static_cast<Tc *>(plan2->exec(tic, row, line, buf2, fwd));
+        if (res!=row) copy_n(res, n2, row);
+        }
+      // transforms of length n1 over the columns, scattered to their
+      // final positions
+      const size_t *iout = idx->out.data();
+      for (size_t i2=0; i2<n2; ++i2)
+        {
+        for (size_t i1=0; i1<n1; ++i1)
+          line[i1] = ch[i1*n2+i2];
+        auto res = static_cast<Tc *>(plan1->exec(tic, line, line2, buf2, fwd));
+        for (size_t i1=0; i1<n1; ++i1)
+          cc[iout[i1*n2+i2]] = res[i1];
+        }
+      return cc;
+      }
+
+  public:
+    cfft_pfa(size_t ip, size_t n1_, size_t n2_, bool vectorize=false)
+      : n1(n1_), n2(n2_)
+      {
+      MR_assert((n1>1) && (n2>1) && (n1*n2==ip), "bad factorization");
+      size_t a=n1, b=n2;
+      while (b!=0) { auto t=a%b; a=b; b=t; }
+      MR_assert(a==1, "factors must be coprime");
+      plan1 = cfftpass<Tfs>::make_pass(n1, vectorize);
+      plan2 = cfftpass<Tfs>::make_pass(n2, vectorize);
+      idx = PFAIndex::get(n1, n2);
+      bufsz = 2*max(n1, n2) + max(plan1->bufsize(), plan2->bufsize());
+      bufsz_simd = 0;
+      if constexpr(fft1d_simd_exists<Tfs>)
+        {
+        // a SIMD vector of complex values occupies vlen entries of type Tcs;
+        // the extra vlen entries allow for alignment
+        constexpr size_t vlen = fft1d_simd<Tfs>::size();
+        static_assert(sizeof(Cmplx<fft1d_simd<Tfs>>)==vlen*sizeof(Tcs),
+          "unexpected SIMD type size");
+        static_assert(alignof(Cmplx<fft1d_simd<Tfs>>)<=vlen*sizeof(Tcs),
+          "unexpected SIMD type alignment");
+        bufsz_simd = (bufsz+1)*vlen;
+        }
+      }
+
+    virtual size_t bufsize() const { return max(bufsz, bufsz_simd); }
+    virtual bool needs_copy() const { return true; }
+
+    POCKETFFT_EXEC_DISPATCH
+  };
+
 #undef POCKETFFT_EXEC_DISPATCH
 
 #if 0  // leaving in for potential future use; but doesn't seem beneficial
@@ -1667,6 +2360,8 @@ template <size_t vlen, typename Tfs> class cfftp_vecpass: public cfftpass<Tfs>
   };
 #endif
 
+template<typename Tfs> struct cfft_planner;
+
 template<typename Tfs> Tcpass<Tfs> cfftpass<Tfs>::make_pass(size_t l1,
   size_t ido, size_t ip, const Troots<Tfs> &roots, bool vectorize)
   {
@@ -1682,32 +2377,212 @@ template<typename Tfs> Tcpass<Tfs> cfftpass<Tfs>::make_pass(size_t l1,
 #endif
 
   if (ip==1) return make_shared<cfftp1<Tfs>>();
-  auto factors=cfftpass<Tfs>::factorize(ip);
-  if (factors.size()==1)
+  auto choice = cfft_planner<Tfs>::default_choice(ip);
+  if (choice.algo==PassChoice::bluestein)
+    return make_shared<cfftpblue<Tfs>>(l1, ido, ip, roots, vectorize);
+  if (choice.factors.size()>1) // more than one factor, need a multipass
+    return make_shared<cfft_multipass<Tfs>>(l1, ido, ip, roots,
+      choice.factors, vectorize);
+  switch(ip)
+    {
+    case 2:
+      return make_shared<cfftp2<Tfs>>(l1, ido, roots);
+    case 3:
+      return make_shared<cfftp3<Tfs>>(l1, ido, roots);
+    case 4:
+      return make_shared<cfftp4<Tfs>>(l1, ido, roots);
+    case 5:
+      return make_shared<cfftp5<Tfs>>(l1, ido, roots);
+    case 7:
+      return make_shared<cfftp7<Tfs>>(l1, ido, roots);
+    // radix 8 and 16 are never produced by factorize(), but can be
+    // requested explicitly, e.g. by the measuring planner
+    case 8:
+      return make_shared<cfftp8<Tfs>>(l1, ido, roots);
+    case 11:
+      return make_shared<cfftp11<Tfs>>(l1, ido, roots);
+    case 16:
+      return make_shared<cfftp16<Tfs>>(l1, ido, roots);
+    default:
+      return make_shared<cfftpg<Tfs>>(l1, ido, ip, roots);
+    }
+  }
+
+/// Candidate generation and plan construction for complex 1D transforms.
+template<typename Tfs> struct cfft_planner
+  {
+  // the algorithm used by make_pass() if nothing is measured
+  static PassChoice default_choice(size_t ip)
+    {
+    auto factors = cfftpass<Tfs>::factorize(ip);
+    if ((factors.size()==1) || (ip==8) || (ip==16))
+      return (ip<110) ? PassChoice{PassChoice::multipass, {ip}}
+                      : PassChoice{PassChoice::bluestein, {}};
+    return PassChoice{PassChoice::multipass,
+      cfft_multipass<Tfs>::default_factors(ip)};
+    }
+
+  static vector<PassChoice> candidates(size_t ip)
+    {
+    vector<PassChoice> res{default_choice(ip)};
+    auto add = [&res](const PassChoice &choice)
+      {
+      if (find(res.begin(), res.end(), choice)==res.end())
+        res.push_back(choice);
+      };
+    auto factors = cfftpass<Tfs>::factorize(ip);
+    if (factors.size()==1)
+      {
+      if ((ip>11) && (ip<=1000))
+        add({PassChoice::multipass, {ip}});
+      if (ip>11)
+        add({PassChoice::bluestein, {}});
+      return res;
+      }
+    if (ip>10000)
+      {
+      auto packets = res[0].factors;
+      reverse(packets.begin(), packets.end());
+      add({PassChoice::multipass, packets});
+      }
+    else
+      {
+      auto tmp = factors;
+      reverse(tmp.begin(), tmp.end());
+      add({PassChoice::multipass, tmp});
+      sort(tmp.begin(), tmp.end());
+      add({PassChoice::multipass, tmp});
+      reverse(tmp.begin(), tmp.end());
+      add({PassChoice::multipass, tmp});
+      }
+    for (size_t radix: {8, 16})
+      if ((ip&(radix-1))==0)
+        add({PassChoice::multipass, pow2_factors(ip, radix)});
+    for (const auto &split: pfa_splits(ip))
+      add({PassChoice::pfa, split});
+    if (util1d::prime_factors(ip).back()>11)
+      add({PassChoice::bluestein, {}});
+    return res;
+    }
+
+  // candidate splittings of ip into two coprime factors for the prime
+  // factor algorithm: a balanced one, and the power of 2 vs. the rest
+  static vector<vector<size_t>> pfa_splits(size_t ip)
     {
-    switch(ip)
-      {
-      case 2:
-        return make_shared<cfftp2<Tfs>>(l1, ido, roots);
-      case 3:
-        return make_shared<cfftp3<Tfs>>(l1, ido, roots);
-      case 4:
-        return make_shared<cfftp4<Tfs>>(l1, ido, roots);
-      case 5:
-        return make_shared<cfftp5<Tfs>>(l1, ido, roots);
-      case 7:
-        return make_shared<cfftp7<Tfs>>(l1, ido, roots);
-      case 11:
-        return make_shared<cfftp11<Tfs>>(l1, ido, roots);
+    vector<size_t> powers;  // the prime powers contained in ip
+    size_t last=0;
+    for (auto p: util1d::prime_factors(ip))
+      {
+      if (p==last)
+        powers.back()*=p;
+      else
+        powers.push_back(p);
+      last=p;
+      }
+    if (powers.size()<2) return {};
+    vector<vector<size_t>> res;
+    auto add = [&res](size_t a, size_t b)
+      {
+      vector<size_t> split{min(a,b), max(a,b)};
+      if (find(res.begin(), res.end(), split)==res.end())
+        res.push_back(split);
+      };
+    sort(powers.begin(), powers.end(), std::greater<size_t>());
+    size_t a=1, b=1;
+    for (auto q: powers)
+      (a>b) ? b*=q : a*=q;
+    add(a, b);
+    if ((ip&1)==0)
+      {
+      size_t p2 = ip&(~ip+1);  // largest power of 2 dividing ip
+      add(p2, ip/p2);
+      }
+    return res;
+    }
+
+  // like cfftpass::factorize(), but with powers of 2 in chunks of \a radix
+  static vector<size_t> pow2_factors(size_t ip, size_t radix)
+    {
+    vector<size_t> res;
+    size_t rest=ip;
+    while ((rest&(radix-1))==0)
+      { res.push_back(radix); rest/=radix; }
+    size_t p2=1;
+    while ((rest&1)==0)
+      { p2*=2; rest/=2; }
+    if (p2>1) res.insert(res.begin(), p2);
+    if (rest>1)
+      for (auto f: cfftpass<Tfs>::factorize(rest))
+        res.push_back(f);
+    return res;
+    }
+
+  static Tcpass<Tfs> build(size_t ip, const Troots<Tfs> &roots,
+    const PassChoice &choice, bool vectorize)
+    {
+    switch (choice.algo)
+      {
+      case PassChoice::multipass:
+        if (choice.factors.size()==1)
+          {
+          MR_assert(choice.factors[0]==ip, "bad factorization");
+          if ((ip<=11) || (ip==16))
+            return cfftpass<Tfs>::make_pass(1, 1, ip, roots, vectorize);
+          return make_shared<cfftpg<Tfs>>(1, 1, ip, roots);
+          }
+        return make_shared<cfft_multipass<Tfs>>(1, 1, ip, roots,
+          choice.factors, vectorize);
+      case PassChoice::bluestein:
+        return make_shared<cfftpblue<Tfs>>(1, 1, ip, roots, vectorize);
+      case PassChoice::pfa:
+        MR_assert(choice.factors.size()==2, "bad factorization");
+        return make_shared<cfft_pfa<Tfs>>(ip, choice.factors[0],
+          choice.factors[1], vectorize);
       default:
-        if (ip<110)
-          return make_shared<cfftpg<Tfs>>(l1, ido, ip, roots);
-        else
-          return make_shared<cfftpblue<Tfs>>(l1, ido, ip, roots, vectorize);
+        MR_fail("unsupported algorithm for complex FFT");
+      }
+    }
+
+  static Tcpass<Tfs> measure(size_t ip, const Troots<Tfs> &roots,
+    bool vectorize, PassChoice &best)
+    {
+    auto cands = candidates(ip);
+    best = cands[0];
+    auto res = build(ip, roots, best, vectorize);
+    if (cands.size()==1) return res;
+    pass_tester<cfftpass<Tfs>, Cmplx<Tfs>> tester(*res, ip);
+    double tbest = tester.time(*res);
+    for (size_t i=1; i<cands.size(); ++i)
+      {
+      Tcpass<Tfs> pass;
+      try
+        { pass = build(ip, roots, cands[i], vectorize); }
+      catch (const exception &)
+        { continue; }
+      if (!tester.matches(*pass)) continue;
+      double t = tester.time(*pass);
+      if (t<tbest)
+        { tbest=t; best=cands[i]; res=pass; }
       }
+    return res;
     }
-  else // more than one factor, need a multipass
-    return make_shared<cfft_multipass<Tfs>>(l1, ido, ip, roots, vectorize);
+  };
+
+template<typename Tfs> Tcpass<Tfs> cfftpass<Tfs>::make_pass(size_t ip,
+  bool vectorize)
+  {
+  MR_assert(ip>=1, "no zero-sized FFTs");
+  auto roots = get_roots<Tfs>(ip);
+  if (ip==1) return make_pass(1, 1, ip, roots, vectorize);
+  auto &wisdom = PlannerWisdom::instance();
+  PassChoice choice;
+  if (wisdom.lookup('c', sizeof(Tfs), ip, choice))
+    return cfft_planner<Tfs>::build(ip, roots, choice, vectorize);
+  if (wisdom.mode()==PlannerMode::estimate)
+    return make_pass(1, 1, ip, roots, vectorize);
+  auto res = cfft_planner<Tfs>::measure(ip, roots, vectorize, choice);
+  wisdom.store('c', sizeof(Tfs), ip, choice);
+  return res;
   }
 
 template<typename Tfs> class pocketfft_c
@@ -1796,11 +2671,9 @@ template <typename Tfs> class rfftpass
 
     static shared_ptr<rfftpass> make_pass(size_t l1, size_t ido, size_t ip,
        const Troots<Tfs> &roots, bool vectorize=false);
-    static shared_ptr<rfftpass> make_pass(size_t ip, bool vectorize=false)
-      {
-      return make_pass(1,1,ip,make_shared<UnityRoots<Tfs,Cmplx<Tfs>>>(ip),
-        vectorize);
-      }
+    /// Returns a plan for a complete transform of length \a ip, taking
+    /// recorded and (in measure mode) benchmarked decisions into account.
+    static shared_ptr<rfftpass> make_pass(size_t ip, bool vectorize=false);
   };
 
 #define POCKETFFT_EXEC_DISPATCH \
@@ -2860,7 +3733,14 @@ template <typename Tfs> class rfft_multipass: public rfftpass<Tfs>
 
   public:
     rfft_multipass(size_t l1_, size_t ido_, size_t ip_,
-      const Troots<Tfs> &roots, bool /*vectorize*/=false)
+      const Troots<Tfs> &roots, bool vectorize=false)
+      : rfft_multipass(l1_, ido_, ip_, roots, rfftpass<Tfs>::factorize(ip_),
+          vectorize) {}
+    /// Builds a multipass with the radices given in \a factors, in this
+    /// order. Their product must be equal to \a ip_.
+    rfft_multipass(size_t l1_, size_t ido_, size_t ip_,
+      const Troots<Tfs> &roots, const vector<size_t> &factors,
+      bool /*vectorize*/=false)
       : l1(l1_), ido(ido_), ip(ip_), bufsz(0), need_cpy(false),
         wa((ip-1)*(ido-1))
       {
@@ -2875,14 +3755,13 @@ template <typename Tfs> class rfft_multipass: public rfftpass<Tfs>
           wa[(j-1)*(ido-1)+2*i-1] = val.i;
           }
 
-      auto factors = rfftpass<Tfs>::factorize(ip);
-
       size_t l1l=1;
       for (auto fct: factors)
         {
         passes.push_back(rfftpass<Tfs>::make_pass(l1l, ip/(fct*l1l), fct, roots));
         l1l*=fct;
         }
+      MR_assert(l1l==ip, "bad factorization");
       for (const auto &pass: passes)
         {
         bufsz = max(bufsz, pass->bufsize());
@@ -2974,35 +3853,156 @@ template <typename Tfs> class rfftp_complexify: public rfftpass<Tfs>
   };
 #undef POCKETFFT_EXEC_DISPATCH
 
+template<typename Tfs> struct rfft_planner;
+
 template<typename Tfs> Trpass<Tfs> rfftpass<Tfs>::make_pass(size_t l1,
   size_t ido, size_t ip, const Troots<Tfs> &roots, bool vectorize)
   {
   MR_assert(ip>=1, "no zero-sized FFTs");
   if (ip==1) return make_shared<rfftp1<Tfs>>();
-  if ((ip>1000) && ((ip&1)==0))  // use complex transform
+  auto choice = rfft_planner<Tfs>::default_choice(ip);
+  if (choice.algo==PassChoice::complexify)  // use complex transform
     return make_shared<rfftp_complexify<Tfs>>(ip, roots, vectorize);
-  auto factors=rfftpass<Tfs>::factorize(ip);
-  if (factors.size()==1)
+  if (choice.algo==PassChoice::bluestein)
+    return make_shared<rfftpblue<Tfs>>(l1, ido, ip, roots, vectorize);
+  if (choice.factors.size()>1) // more than one factor, need a multipass
+    return make_shared<rfft_multipass<Tfs>>(l1, ido, ip, roots,
+      choice.factors, vectorize);
+  switch(ip)
+    {
+    case 2:
+      return make_shared<rfftp2<Tfs>>(l1, ido, roots);
+    case 3:
+      return make_shared<rfftp3<Tfs>>(l1, ido, roots);
+    case 4:
+      return make_shared<rfftp4<Tfs>>(l1, ido, roots);
+    case 5:
+      return make_shared<rfftp5<Tfs>>(l1, ido, roots);
+    default:
+      return make_shared<rfftpg<Tfs>>(l1, ido, ip, roots);
+    }
+  }
+
+/// Candidate generation and plan construction for real 1D transforms.
+template<typename Tfs> struct rfft_planner
+  {
+  // the algorithm used by make_pass() if nothing is measured
+  static PassChoice default_choice(size_t ip)
     {
-    switch(ip)
-      {
-      case 2:
-        return make_shared<rfftp2<Tfs>>(l1, ido, roots);
-      case 3:
-        return make_shared<rfftp3<Tfs>>(l1, ido, roots);
-      case 4:
-        return make_shared<rfftp4<Tfs>>(l1, ido, roots);
-      case 5:
-        return make_shared<rfftp5<Tfs>>(l1, ido, roots);
+    if ((ip>1000) && ((ip&1)==0))
+      return {PassChoice::complexify, {}};
+    auto factors = rfftpass<Tfs>::factorize(ip);
+    if (factors.size()==1)
+      return (ip<135) ? PassChoice{PassChoice::multipass, {ip}}
+                      : PassChoice{PassChoice::bluestein, {}};
+    return {PassChoice::multipass, factors};
+    }
+
+  static vector<PassChoice> candidates(size_t ip)
+    {
+    vector<PassChoice> res{default_choice(ip)};
+    auto add = [&res](const PassChoice &choice)
+      {
+      if (find(res.begin(), res.end(), choice)==res.end())
+        res.push_back(choice);
+      };
+    auto factors = rfftpass<Tfs>::factorize(ip);
+    if (factors.size()==1)
+      {
+      if ((ip>5) && (ip<=1000))
+        add({PassChoice::multipass, {ip}});
+      if ((ip>5) && (ip&1))
+        add({PassChoice::bluestein, {}});
+      return res;
+      }
+    // even radices must come first, since the odd-length passes require an
+    // odd "ido"; only the order within both groups can be changed.
+    auto odd = find_if(factors.begin(), factors.end(),
+      [](size_t f){ return (f&1)!=0; });
+    add({PassChoice::multipass, factors});
+    auto tmp = factors;
+    auto todd = tmp.begin()+(odd-factors.begin());
+    reverse(tmp.begin(), todd);
+    reverse(todd, tmp.end());
+    add({PassChoice::multipass, tmp});
+    sort(todd, tmp.end());
+    add({PassChoice::multipass, tmp});
+    sort(todd, tmp.end(), std::greater<size_t>());
+    add({PassChoice::multipass, tmp});
+    if ((ip&1)==0)
+      add({PassChoice::complexify, {}});
+    else if (util1d::prime_factors(ip).back()>5)
+      add({PassChoice::bluestein, {}});
+    return res;
+    }
+
+  static Trpass<Tfs> build(size_t ip, const Troots<Tfs> &roots,
+    const PassChoice &choice, bool vectorize)
+    {
+    switch (choice.algo)
+      {
+      case PassChoice::multipass:
+        for (auto f: choice.factors)
+          MR_assert(rfftpass<Tfs>::factorize(f).size()==1,
+            "composite factor in real multipass");
+        if (choice.factors.size()==1)
+          {
+          MR_assert(choice.factors[0]==ip, "bad factorization");
+          if (ip<=5)
+            return rfftpass<Tfs>::make_pass(1, 1, ip, roots, vectorize);
+          return make_shared<rfftpg<Tfs>>(1, 1, ip, roots);
+          }
+        return make_shared<rfft_multipass<Tfs>>(1, 1, ip, roots,
+          choice.factors, vectorize);
+      case PassChoice::bluestein:
+        return make_shared<rfftpblue<Tfs>>(1, 1, ip, roots, vectorize);
+      case PassChoice::complexify:
+        return make_shared<rfftp_complexify<Tfs>>(ip, roots, vectorize);
       default:
-        if (ip<135)
-          return make_shared<rfftpg<Tfs>>(l1, ido, ip, roots);
-        else
-          return make_shared<rfftpblue<Tfs>>(l1, ido, ip, roots, vectorize);
+        MR_fail("unsupported algorithm for real FFT");
       }
     }
-  else // more than one factor, need a multipass
-    return make_shared<rfft_multipass<Tfs>>(l1, ido, ip, roots, vectorize);
+
+  static Trpass<Tfs> measure(size_t ip, const Troots<Tfs> &roots,
+    bool vectorize, PassChoice &best)
+    {
+    auto cands = candidates(ip);
+    best = cands[0];
+    auto res = build(ip, roots, best, vectorize);
+    if (cands.size()==1) return res;
+    pass_tester<rfftpass<Tfs>, Tfs> tester(*res, ip);
+    double tbest = tester.time(*res);
+    for (size_t i=1; i<cands.size(); ++i)
+      {
+      Trpass<Tfs> pass;
+      try
+        { pass = build(ip, roots, cands[i], vectorize); }
+      catch (const exception &)
+        { continue; }
+      if (!tester.matches(*pass)) continue;
+      double t = tester.time(*pass);
+      if (t<tbest)
+        { tbest=t; best=cands[i]; res=pass; }
+      }
+    return res;
+    }
+  };
+
+template<typename Tfs> Trpass<Tfs> rfftpass<Tfs>::make_pass(size_t ip,
+  bool vectorize)
+  {
+  MR_assert(ip>=1, "no zero-sized FFTs");
+  auto roots = get_roots<Tfs>(ip);
+  if (ip==1) return make_pass(1, 1, ip, roots, vectorize);
+  auto &wisdom = PlannerWisdom::instance();
+  PassChoice choice;
+  if (wisdom.lookup('r', sizeof(Tfs), ip, choice))
+    return rfft_planner<Tfs>::build(ip, roots, choice, vectorize);
+  if (wisdom.mode()==PlannerMode::estimate)
+    return make_pass(1, 1, ip, roots, vectorize);
+  auto res = rfft_planner<Tfs>::measure(ip, roots, vectorize, choice);
+  wisdom.store('r', sizeof(Tfs), ip, choice);
+  return res;
   }
 
 template<typename Tfs> class pocketfft_r
@@ -3169,6 +4169,9 @@ template<typename Tfs> class pocketfft_fftw
 
 }
 
+using detail_fft::PlannerMode;
+using detail_fft::set_planner_mode;
+using detail_fft::planner_mode;
 using detail_fft::pocketfft_c;
 using detail_fft::pocketfft_r;
 using detail_fft::pocketfft_hartley;
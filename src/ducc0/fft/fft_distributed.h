@@ -0,0 +1,394 @@
+/*
+ *  This file is part of DUCC.
+ *
+ *  DUCC is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  DUCC is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with DUCC; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+/*
+ *  DUCC is being developed at the Max-Planck-Institut fuer Astrophysik
+ */
+
+/*
+ *  Copyright (C) 2023 Max-Planck-Society
+ */
+
+/*! \file fft_distributed.h
+ *  Multi-dimensional FFTs of arrays which are distributed over the ranks of
+ *  a Communicator.
+ *
+ *  Two decompositions are supported:
+ *  - "slab": the array is distributed along axis 0; every rank holds a
+ *    contiguous range of indices along this axis and the full extent of all
+ *    other axes. Every rank can hold an arbitrary number of indices
+ *    (including 0).
+ *  - "pencil": the ranks form a 2D grid of shape (nproc0, nranks/nproc0),
+ *    with rank = r0*(nranks/nproc0) + r1. The array is distributed along axis
+ *    0 over the ranks sharing r1, and along axis 1 over the ranks sharing r0.
+ *
+ *  If \a transposed_out is true, the output of the transforms is left in
+ *  "transposed" layout, which saves the communication steps needed for
+ *  restoring the input layout:
+ *  - slab: distributed along axis 1, full axis 0
+ *  - pencil: axis 0 is complete, axis 1 is distributed over the ranks sharing
+ *    r1 (indexed by r0), axis 2 over the ranks sharing r0 (indexed by r1).
+ *  The local index ranges of these axes are given by distributed_range().
+ *
+ *  If \a nblocks is larger than 1, the local FFTs and the data exchange
+ *  are carried out in this many chunks along an axis which is not involved
+ *  in the exchange, and the communication of one chunk is overlapped with
+ *  the computation of the next one. This requires at least 3 dimensions
+ *  and, when MPI is used, MPI_THREAD_SERIALIZED support.
+ */
+
+#ifndef DUCC0_FFT_DISTRIBUTED_H
+#define DUCC0_FFT_DISTRIBUTED_H
+
+#include <cstddef>
+#include <complex>
+#include <tuple>
+#include <vector>
+#ifndef DUCC0_NO_THREADING
+#include <future>
+#endif
+#include "ducc0/infra/error_handling.h"
+#include "ducc0/infra/misc_utils.h"
+#include "ducc0/infra/mav.h"
+#include "ducc0/infra/communication.h"
+#include "ducc0/fft/fft.h"
+
+namespace ducc0 {
+
+namespace detail_fft_distributed {
+
+using namespace std;
+using shape_t = fmav_info::shape_t;
+
+/// Returns the index range [lo; hi) of an axis with \a n entries that is
+/// held by \a rank out of \a nranks in a transposed output layout.
+inline tuple<size_t, size_t> distributed_range(size_t n, size_t nranks,
+  size_t rank)
+  { return calcShare(nranks, rank, n); }
+
+inline size_t local_length(size_t n, size_t nranks, size_t rank)
+  {
+  auto [lo, hi] = distributed_range(n, nranks, rank);
+  return hi-lo;
+  }
+
+inline size_t global_length(const Communicator &comm, size_t nlocal)
+  { return size_t(comm.allreduce(long(nlocal), Communicator::Sum)); }
+
+inline shape_t axis_range(size_t lo, size_t hi)
+  {
+  shape_t res;
+  for (size_t i=lo; i<hi; ++i) res.push_back(i);
+  return res;
+  }
+
+/* Carries out FFTs over \a axes from \a src to \a buf (they may be identical)
+   and redistributes the result from \a buf to \a dst, where the distributed
+   axis changes from \a axin to \a axout. If \a axes is empty, \a src is
+   sent directly. The work is split into up to \a nblocks chunks along
+   \a blockaxis (which must be neither \a axin, \a axout, nor in \a axes,
+   and must have the same length on all ranks of \a comm); the
+   communication of one chunk runs concurrently with the FFTs of the next. */
+template<typename T> void fft_and_redistribute(const Communicator &comm,
+  const cfmav<complex<T>> &src, vfmav<complex<T>> &buf,
+  vfmav<complex<T>> &dst, const shape_t &axes, bool forward, T fct,
+  size_t axin, size_t axout, size_t blockaxis, size_t nblocks,
+  size_t nthreads)
+  {
+  size_t nblk = (blockaxis<src.ndim()) ?
+    max<size_t>(1, min(nblocks, src.shape(blockaxis))) : 1;
+  auto block = [nblk, blockaxis](auto &arr, size_t iblk)
+    {
+    using Tarr = std::decay_t<decltype(arr)>;
+    if (nblk==1) return Tarr(arr);
+    auto [lo, hi] = calcShare(nblk, iblk, arr.shape(blockaxis));
+    // subarray() cannot handle arrays without elements
+    if (arr.size()==0)
+      {
+      auto shp = arr.shape();
+      shp[blockaxis] = hi-lo;
+      return Tarr(arr.data(), shp, arr.stride());
+      }
+    vector<slice> slc(arr.ndim());
+    slc[blockaxis] = slice(lo, hi);
+    return arr.subarray(slc);
+    };
+  auto work = [&](size_t iblk)
+    {
+    if (axes.empty()) return;
+    auto bsrc = block(src, iblk);
+    auto bbuf = block(buf, iblk);
+    c2c(bsrc, bbuf, axes, forward, fct, nthreads);
+    };
+  auto send = [&](size_t iblk)
+    {
+    auto bdst = block(dst, iblk);
+    if (axes.empty())
+      comm.redistribute(block(src, iblk), bdst, axin, axout);
+    else
+      comm.redistribute(block(buf, iblk), bdst, axin, axout);
+    };
+
+  bool overlap = (nblk>1) && Communication::supports_threads();
+#ifdef DUCC0_NO_THREADING
+  overlap = false;
+#endif
+  if (!overlap)
+    {
+    for (size_t iblk=0; iblk<nblk; ++iblk)
+      { work(iblk); send(iblk); }
+    return;
+    }
+#ifndef DUCC0_NO_THREADING
+  future<void> pending;
+  for (size_t iblk=0; iblk<nblk; ++iblk)
+    {
+    work(iblk);
+    if (pending.valid()) pending.get();
+    pending = async(launch::async, [&send, iblk]{ send(iblk); });
+    }
+  pending.get();
+#endif
+  }
+
+/* FFTs over axes 0, 1 and \a axes1 of a slab-distributed array;
+   \a axes1 is transformed from \a src into \a buf, all other axes not
+   mentioned have already been transformed. */
+template<typename T> void slab_core(const Communicator &comm,
+  const cfmav<complex<T>> &src, vfmav<complex<T>> &buf,
+  vfmav<complex<T>> &out, const shape_t &axes1, bool forward, T fct,
+  bool transposed_out, size_t nblocks, size_t nthreads)
+  {
+  auto nranks = size_t(comm.num_ranks()), rank = size_t(comm.rank());
+  auto tshp = src.shape();
+  tshp[0] = global_length(comm, src.shape(0));
+  tshp[1] = local_length(src.shape(1), nranks, rank);
+  if (transposed_out)
+    {
+    MR_assert(out.shape()==tshp, "bad output shape");
+    fft_and_redistribute(comm, src, buf, out, axes1, forward, T(1), 0, 1, 2,
+      nblocks, nthreads);
+    c2c(out, out, {0}, forward, fct, nthreads);
+    }
+  else
+    {
+    auto tmp(vfmav<complex<T>>::build_noncritical(tshp, UNINITIALIZED));
+    fft_and_redistribute(comm, src, buf, tmp, axes1, forward, T(1), 0, 1, 2,
+      nblocks, nthreads);
+    fft_and_redistribute(comm, tmp, tmp, out, {0}, forward, fct, 1, 0, 2,
+      nblocks, nthreads);
+    }
+  }
+
+/* FFTs over axes 0, 1 and \a axes1 of a pencil-distributed array. */
+template<typename T> void pencil_core(const Communicator &rowcomm,
+  const Communicator &colcomm, const cfmav<complex<T>> &src,
+  vfmav<complex<T>> &buf, vfmav<complex<T>> &out, const shape_t &axes1,
+  bool forward, T fct, bool transposed_out, size_t nblocks, size_t nthreads)
+  {
+  auto shp2 = src.shape();
+  shp2[1] = global_length(rowcomm, src.shape(1));
+  shp2[2] = local_length(src.shape(2), size_t(rowcomm.num_ranks()),
+    size_t(rowcomm.rank()));
+  auto tmp2(vfmav<complex<T>>::build_noncritical(shp2, UNINITIALIZED));
+  fft_and_redistribute(rowcomm, src, buf, tmp2, axes1, forward, T(1), 1, 2,
+    0, nblocks, nthreads);
+  auto shp3 = shp2;
+  shp3[0] = global_length(colcomm, src.shape(0));
+  shp3[1] = local_length(shp2[1], size_t(colcomm.num_ranks()),
+    size_t(colcomm.rank()));
+  if (transposed_out)
+    {
+    MR_assert(out.shape()==shp3, "bad output shape");
+    fft_and_redistribute(colcomm, tmp2, tmp2, out, {1}, forward, T(1), 0, 1,
+      2, nblocks, nthreads);
+    c2c(out, out, {0}, forward, fct, nthreads);
+    }
+  else
+    {
+    auto tmp3(vfmav<complex<T>>::build_noncritical(shp3, UNINITIALIZED));
+    fft_and_redistribute(colcomm, tmp2, tmp2, tmp3, {1}, forward, T(1), 0, 1,
+      2, nblocks, nthreads);
+    fft_and_redistribute(colcomm, tmp3, tmp3, tmp2, {0}, forward, fct, 1, 0,
+      2, nblocks, nthreads);
+    fft_and_redistribute(rowcomm, tmp2, tmp2, out, {}, forward, T(1), 2, 1,
+      0, nblocks, nthreads);
+    }
+  }
+
+/// Complex FFT over all axes of a slab-distributed array.
+/** \a in and \a out hold the local part of the input and output arrays.
+ *  Without \a transposed_out they must have identical shapes and may be
+ *  identical.
+ *  \a in must have at least 2 dimensions. */
+template<typename T> void c2c_slab(const Communicator &comm,
+  const cfmav<complex<T>> &in, vfmav<complex<T>> &out, bool forward, T fct,
+  bool transposed_out=false, size_t nblocks=1, size_t nthreads=1)
+  {
+  auto ndim = in.ndim();
+  MR_assert(ndim>=2, "need at least 2 dimensions");
+  if (!transposed_out)
+    MR_assert(in.shape()==out.shape(), "shape mismatch");
+  auto buf(transposed_out ?
+    vfmav<complex<T>>::build_noncritical(in.shape(), UNINITIALIZED) : out);
+  if (ndim>2)
+    {
+    c2c(in, buf, axis_range(2, ndim), forward, T(1), nthreads);
+    slab_core(comm, buf, buf, out, {1}, forward, fct, transposed_out,
+      nblocks, nthreads);
+    }
+  else
+    slab_core(comm, in, buf, out, {1}, forward, fct, transposed_out,
+      nblocks, nthreads);
+  }
+
+/// Real-to-complex FFT over all axes of a slab-distributed array.
+/** The last axis of \a out has the length n/2+1, where n is the length of
+ *  the last axis of \a in. Without \a transposed_out, the other axes of
+ *  \a in and \a out have identical lengths.
+ *  \a in must have at least 2 dimensions. */
+template<typename T> void r2c_slab(const Communicator &comm,
+  const cfmav<T> &in, vfmav<complex<T>> &out, bool forward, T fct,
+  bool transposed_out=false, size_t nblocks=1, size_t nthreads=1)
+  {
+  auto ndim = in.ndim();
+  MR_assert(ndim>=2, "need at least 2 dimensions");
+  auto cshp = in.shape();
+  cshp.back() = cshp.back()/2+1;
+  if (!transposed_out)
+    MR_assert(out.shape()==cshp, "shape mismatch");
+  auto buf(transposed_out ?
+    vfmav<complex<T>>::build_noncritical(cshp, UNINITIALIZED) : out);
+  r2c(in, buf, axis_range((ndim>2) ? 2 : 1, ndim), forward, T(1), nthreads);
+  slab_core(comm, buf, buf, out, (ndim>2) ? shape_t{1} : shape_t{}, forward,
+    fct, transposed_out, nblocks, nthreads);
+  }
+
+/// Complex-to-real FFT over all axes of a slab-distributed array.
+/** This is the inverse of r2c_slab() without \a transposed_out.
+ *  \a in must have at least 2 dimensions. */
+template<typename T> void c2r_slab(const Communicator &comm,
+  const cfmav<complex<T>> &in, vfmav<T> &out, bool forward, T fct,
+  size_t nblocks=1, size_t nthreads=1)
+  {
+  auto ndim = in.ndim();
+  MR_assert(ndim>=2, "need at least 2 dimensions");
+  auto cshp = out.shape();
+  cshp.back() = cshp.back()/2+1;
+  MR_assert(in.shape()==cshp, "shape mismatch");
+  auto buf(vfmav<complex<T>>::build_noncritical(cshp, UNINITIALIZED));
+  if (ndim>3)
+    {
+    c2c(in, buf, axis_range(2, ndim-1), forward, T(1), nthreads);
+    slab_core(comm, buf, buf, buf, {1}, forward, T(1), false, nblocks,
+      nthreads);
+    }
+  else
+    slab_core(comm, in, buf, buf, (ndim>2) ? shape_t{1} : shape_t{},
+      forward, T(1), false, nblocks, nthreads);
+  c2r(buf, out, ndim-1, forward, fct, nthreads);
+  }
+
+/// Complex FFT over all axes of a pencil-distributed array.
+/** \a nproc0 is the number of ranks along the first dimension of the
+ *  process grid; it must divide the number of ranks.
+ *  Without \a transposed_out, \a in and \a out must have identical shapes
+ *  and may be identical.
+ *  \a in must have at least 3 dimensions. */
+template<typename T> void c2c_pencil(const Communicator &comm, size_t nproc0,
+  const cfmav<complex<T>> &in, vfmav<complex<T>> &out, bool forward, T fct,
+  bool transposed_out=false, size_t nblocks=1, size_t nthreads=1)
+  {
+  auto ndim = in.ndim();
+  MR_assert(ndim>=3, "need at least 3 dimensions");
+  auto nranks = size_t(comm.num_ranks()), rank = size_t(comm.rank());
+  MR_assert((nproc0>0) && (nranks%nproc0==0), "bad process grid");
+  auto nproc1 = nranks/nproc0;
+  auto rowcomm = comm.split(rank/nproc1);
+  auto colcomm = comm.split(rank%nproc1);
+  if (!transposed_out)
+    MR_assert(in.shape()==out.shape(), "shape mismatch");
+  auto buf(transposed_out ?
+    vfmav<complex<T>>::build_noncritical(in.shape(), UNINITIALIZED) : out);
+  pencil_core(rowcomm, colcomm, in, buf, out, axis_range(2, ndim), forward,
+    fct, transposed_out, nblocks, nthreads);
+  }
+
+/// Real-to-complex FFT over all axes of a pencil-distributed array.
+/** The last axis of \a out has the length n/2+1, where n is the length of
+ *  the last axis of \a in. This axis is distributed in the transposed
+ *  layout if \a in has 3 dimensions.
+ *  \a in must have at least 3 dimensions. */
+template<typename T> void r2c_pencil(const Communicator &comm, size_t nproc0,
+  const cfmav<T> &in, vfmav<complex<T>> &out, bool forward, T fct,
+  bool transposed_out=false, size_t nblocks=1, size_t nthreads=1)
+  {
+  auto ndim = in.ndim();
+  MR_assert(ndim>=3, "need at least 3 dimensions");
+  auto nranks = size_t(comm.num_ranks()), rank = size_t(comm.rank());
+  MR_assert((nproc0>0) && (nranks%nproc0==0), "bad process grid");
+  auto nproc1 = nranks/nproc0;
+  auto rowcomm = comm.split(rank/nproc1);
+  auto colcomm = comm.split(rank%nproc1);
+  auto cshp = in.shape();
+  cshp.back() = cshp.back()/2+1;
+  if (!transposed_out)
+    MR_assert(out.shape()==cshp, "shape mismatch");
+  auto buf(transposed_out ?
+    vfmav<complex<T>>::build_noncritical(cshp, UNINITIALIZED) : out);
+  r2c(in, buf, axis_range(2, ndim), forward, T(1), nthreads);
+  pencil_core(rowcomm, colcomm, buf, buf, out, {}, forward, fct,
+    transposed_out, nblocks, nthreads);
+  }
+
+/// Complex-to-real FFT over all axes of a pencil-distributed array.
+/** This is the inverse of r2c_pencil() without \a transposed_out.
+ *  \a in must have at least 3 dimensions. */
+template<typename T> void c2r_pencil(const Communicator &comm, size_t nproc0,
+  const cfmav<complex<T>> &in, vfmav<T> &out, bool forward, T fct,
+  size_t nblocks=1, size_t nthreads=1)
+  {
+  auto ndim = in.ndim();
+  MR_assert(ndim>=3, "need at least 3 dimensions");
+  auto nranks = size_t(comm.num_ranks()), rank = size_t(comm.rank());
+  MR_assert((nproc0>0) && (nranks%nproc0==0), "bad process grid");
+  auto nproc1 = nranks/nproc0;
+  auto rowcomm = comm.split(rank/nproc1);
+  auto colcomm = comm.split(rank%nproc1);
+  auto cshp = out.shape();
+  cshp.back() = cshp.back()/2+1;
+  MR_assert(in.shape()==cshp, "shape mismatch");
+  auto buf(vfmav<complex<T>>::build_noncritical(cshp, UNINITIALIZED));
+  pencil_core(rowcomm, colcomm, in, buf, buf, axis_range(2, ndim-1), forward,
+    T(1), false, nblocks, nthreads);
+  c2r(buf, out, ndim-1, forward, fct, nthreads);
+  }
+
+}
+
+using detail_fft_distributed::distributed_range;
+using detail_fft_distributed::c2c_slab;
+using detail_fft_distributed::r2c_slab;
+using detail_fft_distributed::c2r_slab;
+using detail_fft_distributed::c2c_pencil;
+using detail_fft_distributed::r2c_pencil;
+using detail_fft_distributed::c2r_pencil;
+
+}
+
+#endif
@@ -0,0 +1,202 @@
+/*
+ *  This file is part of DUCC.
+ *
+ *  DUCC is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  DUCC is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with DUCC; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+/*
+ *  DUCC is being developed at the Max-Planck-Institut fuer Astrophysik
+ */
+
+/*
+ *  Copyright (C) 2023 Max-Planck-Society
+ */
+
+/*! \file fft_ooc.h
+ *  Multidimensional FFTs of arrays which are larger than main memory.
+ *
+ *  The data are expected in a memory-mapped file (see MappedFile). They are
+ *  transformed in place, one block after the other; after a block has been
+ *  processed, its pages are written back and removed from the resident set,
+ *  so that the memory consumption of the process stays close to a
+ *  user-defined limit.
+ *
+ *  All transformed axes whose combined extent (together with the
+ *  non-transformed axes behind them) fits into this limit are handled in a
+ *  single pass over contiguous chunks of the file. Every remaining axis
+ *  needs one additional pass, which gathers blocks of neighbouring columns
+ *  into a contiguous buffer, transforms them there and scatters them back.
+ *  Each of the lines read for such a block is a contiguous run of
+ *  (memory limit)/(axis length) bytes, so the file is still accessed in
+ *  large sequential pieces.
+ */
+
+#ifndef DUCC0_FFT_OOC_H
+#define DUCC0_FFT_OOC_H
+
+#include <cstddef>
+#include <complex>
+#include <vector>
+#include <algorithm>
+#include "ducc0/infra/error_handling.h"
+#include "ducc0/infra/mav.h"
+#include "ducc0/infra/system.h"
+#include "ducc0/infra/mmap_file.h"
+#include "ducc0/fft/fft.h"
+
+namespace ducc0 {
+
+namespace detail_fft_ooc {
+
+using namespace std;
+using shape_t = fmav_info::shape_t;
+
+/// Statistics of an out-of-core transform
+struct OocInfo
+  {
+  /// number of passes over the data
+  size_t npasses=0;
+  /// number of processed blocks
+  size_t nblocks=0;
+  /// size of the largest block in bytes
+  size_t max_block=0;
+  /// largest resident set size of the process observed after processing
+  /// a block, in bytes (0 if not available)
+  size_t peak_rss=0;
+  };
+
+/// Complex FFT of a C-contiguous array in a memory-mapped file.
+/** The transform is done in place over the axes \a axes. At most around
+ *  \a max_memory bytes of \a data are kept in memory at the same time; if
+ *  a single line along a transformed axis is larger than this, memory
+ *  consumption will exceed the limit accordingly.
+ *
+ *  If \a release_pages is \c true and \a data lies in a shared mapping of
+ *  a file (see in_shared_file_mapping()), the pages of every processed
+ *  block are written back to the file and removed from memory via
+ *  release_mapped_pages(). Otherwise the function performs a blocked, but
+ *  otherwise normal in-place transform. */
+template<typename T> OocInfo c2c_out_of_core(vfmav<complex<T>> &data,
+  const shape_t &axes, bool forward, T fct, size_t max_memory,
+  size_t nthreads=1, bool release_pages=false)
+  {
+  using Tc = complex<T>;
+  MR_assert(data.contiguous(), "data must be C-contiguous");
+  MR_assert(max_memory>0, "max_memory must be positive");
+  auto ndim = data.ndim();
+  const auto &shp(data.shape());
+  vector<bool> todo(ndim, false);
+  for (auto ax: axes)
+    {
+    MR_assert(ax<ndim, "bad axis number");
+    MR_assert(!todo[ax], "axis specified repeatedly");
+    todo[ax] = true;
+    }
+  OocInfo info;
+  if ((data.size()==0) || axes.empty()) return info;
+  // dropping pages of anonymous memory would destroy their contents
+  release_pages = release_pages
+    && in_shared_file_mapping(data.data(), data.size()*sizeof(Tc));
+
+  auto record_block = [&](size_t nelem)
+    {
+    ++info.nblocks;
+    info.max_block = max(info.max_block, nelem*sizeof(Tc));
+    info.peak_rss = max(info.peak_rss, resident_memory());
+    };
+  auto release = [&](const Tc *ptr, size_t nelem)
+    { if (release_pages) release_mapped_pages(ptr, nelem*sizeof(Tc)); };
+
+  size_t budget = max<size_t>(1, max_memory/sizeof(Tc));
+  // find the largest trailing set of dimensions which fits into memory
+  size_t kslab=ndim, slabsz=1;
+  while ((kslab>0) && (slabsz*shp[kslab-1]<=budget))
+    slabsz *= shp[--kslab];
+
+  // first pass: all transformed axes within the slab, processing groups
+  // of consecutive slabs in place
+  shape_t slabaxes;
+  for (size_t i=kslab; i<ndim; ++i)
+    if (todo[i]) slabaxes.push_back(i-kslab+1);
+  if (!slabaxes.empty())
+    {
+    size_t nslab = data.size()/slabsz,
+           nchunk = max<size_t>(1, budget/slabsz);
+    for (size_t a0=0; a0<nslab; a0+=nchunk)
+      {
+      shape_t bshp(1, min(nslab, a0+nchunk)-a0);
+      bshp.insert(bshp.end(), shp.begin()+ptrdiff_t(kslab), shp.end());
+      vfmav<Tc> blk(data.data()+a0*slabsz, bshp);
+      c2c(blk, blk, slabaxes, forward, fct, nthreads);
+      record_block(blk.size());
+      release(blk.data(), blk.size());
+      }
+    fct = T(1);
+    ++info.npasses;
+    }
+
+  // one pass for each remaining axis, processing blocks of columns
+  // (the data are viewed as an array of shape (n0, n, n1)).
+  // When pages are released, blocks are gathered into a contiguous buffer
+  // and scattered back, releasing the whole range spanned by the block
+  // after each of these steps. Releasing the pieces of the individual rows
+  // would be much slower, and ineffective if the kernel maps file pages in
+  // units which are larger than these pieces (large folios).
+  const size_t minwidth = max<size_t>(1, 4096/sizeof(Tc));
+  for (size_t k=kslab; k-->0; )
+    {
+    if (!todo[k]) continue;
+    size_t n0=1, n=shp[k], n1=1;
+    for (size_t i=0; i<k; ++i) n0 *= shp[i];
+    for (size_t i=k+1; i<ndim; ++i) n1 *= shp[i];
+    size_t width = min(n1, max(minwidth, budget/n));
+    vector<Tc> buf(release_pages ? n*width : 0);
+    for (size_t i0=0; i0<n0; ++i0)
+      for (size_t j0=0; j0<n1; j0+=width)
+        {
+        size_t w = min(n1, j0+width)-j0;
+        Tc *ptr = data.data()+i0*n*n1+j0;
+        if (!release_pages)
+          {
+          vfmav<Tc> blk(ptr, {n, w}, {ptrdiff_t(n1), 1});
+          c2c(blk, blk, {0}, forward, fct, nthreads);
+          record_block(n*w);
+          continue;
+          }
+        size_t span = (n-1)*n1+w;
+        for (size_t i=0; i<n; ++i)
+          copy(ptr+i*n1, ptr+i*n1+w, buf.data()+i*w);
+        release(ptr, span);
+        vfmav<Tc> blk(buf.data(), {n, w});
+        c2c(blk, blk, {0}, forward, fct, nthreads);
+        record_block(n*w);
+        for (size_t i=0; i<n; ++i)
+          copy(buf.data()+i*w, buf.data()+(i+1)*w, ptr+i*n1);
+        release(ptr, span);
+        }
+    fct = T(1);
+    ++info.npasses;
+    }
+  return info;
+  }
+
+}
+
+using detail_fft_ooc::OocInfo;
+using detail_fft_ooc::c2c_out_of_core;
+
+}
+
+#endif
@@ -0,0 +1,229 @@
+/*
+This file is part of the ducc FFT library
+
+Copyright (C) 2023 Max-Planck-Society
+
+Author: Martin Reinecke
+*/
+
+/* SPDX-License-Identifier: BSD-3-Clause OR GPL-2.0-or-later */
+
+/*
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+* Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+* Neither the name of the copyright holder nor the names of its contributors may
+  be used to endorse or promote products derived from this software without
+  specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/*
+ *  This code is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This code is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this code; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+/** \file fft_small.h
+ *  Straight-line kernels for short complex FFTs.
+ *
+ *  For a fixed set of short lengths, the transform is unrolled at compile
+ *  time into a sequence of butterflies operating on local arrays. The
+ *  kernels work on any type that behaves like a floating-point number, in
+ *  particular on SIMD vectors, so that many independent transforms can be
+ *  computed side by side, one per vector lane.
+ */
+
+#ifndef DUCC0_FFT_SMALL_H
+#define DUCC0_FFT_SMALL_H
+
+#include <cstddef>
+#include <array>
+#include <type_traits>
+#include "ducc0/math/cmplx.h"
+#include "ducc0/math/unity_roots.h"
+#include "ducc0/fft/fft1d.h"
+
+namespace ducc0 {
+
+namespace detail_fft {
+
+/// Table of the \a N-th roots of unity, shared by all kernels of length \a N.
+template<typename Tfs, size_t N> const Cmplx<Tfs> *small_roots()
+  {
+  static const auto tab = []()
+    {
+    array<Cmplx<Tfs>, N> res;
+    UnityRoots<Tfs, Cmplx<Tfs>> roots(N);
+    for (size_t i=0; i<N; ++i)
+      res[i] = roots[i];
+    return res;
+    }();
+  return tab.data();
+  }
+
+template<size_t N> constexpr size_t small_radix()
+  {
+  if (N%8==0) return 8;
+  if (N%4==0) return 4;
+  for (size_t p=2; p*p<=N; ++p)
+    if (N%p==0) return p;
+  return N;
+  }
+
+/* in-place length-p DFT of t[0..p); twiddles taken from the table of the
+   NT-th roots of unity */
+template<size_t p, size_t NT, bool fwd, typename Tfs, typename T>
+  inline void small_butterfly(Cmplx<T> *t, const Cmplx<Tfs> *roots)
+  {
+  if constexpr (p==2)
+    PMINPLACE(t[0], t[1]);
+  else if constexpr (p==3)
+    {
+    constexpr Tfs tw1r=-0.5,
+                  tw1i= (fwd ? -1: 1) * Tfs(0.8660254037844386467637231707529362L);
+    Cmplx<T> t0=t[0], t1, t2;
+    PM(t1, t2, t[1], t[2]);
+    t[0] = t0+t1;
+    Cmplx<T> ca = t0+t1*tw1r, cb{-t2.i*tw1i, t2.r*tw1i};
+    PM(t[1], t[2], ca, cb);
+    }
+  else if constexpr (p==4)
+    {
+    Cmplx<T> t0, t1, t2, t3;
+    PM(t0, t1, t[0], t[2]);
+    PM(t2, t3, t[1], t[3]);
+    ROTX90<fwd>(t3);
+    PM(t[0], t[2], t0, t2);
+    PM(t[1], t[3], t1, t3);
+    }
+  else if constexpr (p==5)
+    {
+    constexpr Tfs tw1r= Tfs(0.3090169943749474241022934171828191L),
+                  tw1i= (fwd ? -1: 1) * Tfs(0.9510565162951535721164393333793821L),
+                  tw2r= Tfs(-0.8090169943749474241022934171828191L),
+                  tw2i= (fwd ? -1: 1) * Tfs(0.5877852522924731291687059546390728L);
+    Cmplx<T> t0=t[0], t1, t2, t3, t4;
+    PM(t1, t4, t[1], t[4]);
+    PM(t2, t3, t[2], t[3]);
+    t[0] = t0+t1+t2;
+    Cmplx<T> ca = t0+t1*tw1r+t2*tw2r,
+             cb{-(t4.i*tw1i+t3.i*tw2i), t4.r*tw1i+t3.r*tw2i};
+    PM(t[1], t[4], ca, cb);
+    ca = t0+t1*tw2r+t2*tw1r;
+    cb = Cmplx<T>{-(t4.i*tw2i-t3.i*tw1i), t4.r*tw2i-t3.r*tw1i};
+    PM(t[2], t[3], ca, cb);
+    }
+  else if constexpr (p==8)
+    BFLY8<fwd, Tfs>(t[0], t[1], t[2], t[3], t[4], t[5], t[6], t[7]);
+  else
+    {
+    Cmplx<T> res[p];
+    for (size_t q=0; q<p; ++q)
+      {
+      res[q] = t[0];
+      for (size_t r=1; r<p; ++r)
+        res[q] = res[q] + t[r].template special_mul<fwd>(roots[((r*q)%p)*(NT/p)]);
+      }
+    for (size_t q=0; q<p; ++q)
+      t[q] = res[q];
+    }
+  }
+
+/* y[0..N) = DFT of x[0], x[S], ..., x[(N-1)*S] (decimation in time);
+   NT is the length of the outermost transform, whose roots of unity are
+   passed in \a roots. */
+template<size_t N, size_t S, size_t NT, bool fwd, typename Tfs, typename T>
+  inline void small_dft(const Cmplx<T> *x, Cmplx<T> *y, const Cmplx<Tfs> *roots)
+  {
+  if constexpr (N==1)
+    y[0] = x[0];
+  else
+    {
+    constexpr size_t p=small_radix<N>(), m=N/p;
+    Cmplx<T> sub[N];
+    for (size_t r=0; r<p; ++r)
+      small_dft<m, S*p, NT, fwd>(x+r*S, sub+r*m, roots);
+    for (size_t k=0; k<m; ++k)
+      {
+      Cmplx<T> t[p];
+      t[0] = sub[k];
+      for (size_t r=1; r<p; ++r)
+        t[r] = (k==0) ? sub[r*m]
+          : sub[r*m+k].template special_mul<fwd>(roots[r*k*(NT/N)]);
+      small_butterfly<p, NT, fwd>(t, roots);
+      for (size_t q=0; q<p; ++q)
+        y[k+q*m] = t[q];
+      }
+    }
+  }
+
+/// Complex FFT of compile-time length \a N on local data.
+/** \a T can be \a Tfs or a SIMD vector of \a Tfs; in the latter case, every
+ *  lane holds a separate transform. */
+template<typename Tfs, size_t N> struct small_cfft
+  {
+  template<bool fwd, typename T> static void exec(const Cmplx<T> *in,
+    Cmplx<T> *out)
+    { small_dft<N, 1, N, fwd>(in, out, small_roots<Tfs, N>()); }
+  };
+
+/// If a specialized kernel exists for length \a n, calls
+/// \a func(integral_constant<size_t, n>()) and returns \c true.
+/** Kernels are provided for the lengths 2^k, 3*2^k, 5*2^k and 15*2^k up to
+ *  64. Other short lengths are handled by the kernel templates as well,
+ *  but are not instantiated to limit compilation time. */
+template<typename Func> bool small_cfft_dispatch(size_t n, Func &&func)
+  {
+  switch (n)
+    {
+#define DUCC0_SMALL_CASE(N) \
+    case N: func(integral_constant<size_t, N>()); return true;
+    DUCC0_SMALL_CASE(2) DUCC0_SMALL_CASE(4) DUCC0_SMALL_CASE(8)
+    DUCC0_SMALL_CASE(16) DUCC0_SMALL_CASE(32) DUCC0_SMALL_CASE(64)
+    DUCC0_SMALL_CASE(3) DUCC0_SMALL_CASE(6) DUCC0_SMALL_CASE(12)
+    DUCC0_SMALL_CASE(24) DUCC0_SMALL_CASE(48)
+    DUCC0_SMALL_CASE(5) DUCC0_SMALL_CASE(10) DUCC0_SMALL_CASE(20)
+    DUCC0_SMALL_CASE(40)
+    DUCC0_SMALL_CASE(15) DUCC0_SMALL_CASE(30) DUCC0_SMALL_CASE(60)
+#undef DUCC0_SMALL_CASE
+    default: return false;
+    }
+  }
+
+/// Returns \c true if a specialized kernel exists for length \a n.
+inline bool small_cfft_supported(size_t n)
+  { return small_cfft_dispatch(n, [](auto) {}); }
+
+}
+
+}
+
+#endif
@@ -0,0 +1,361 @@
+/*
+ *  This file is part of DUCC.
+ *
+ *  DUCC is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  DUCC is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with DUCC; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+/*
+ *  DUCC is being developed at the Max-Planck-Institut fuer Astrophysik
+ */
+
+/*
+ *  Copyright (C) 2023 Max-Planck-Society
+ */
+
+/*! \file fft_streaming.h
+ *  Stateful FFT-based operations on data streams of unknown length.
+ *
+ *  The objects in this file accept their input in chunks of arbitrary size
+ *  and produce output as soon as it can be computed. Only the samples which
+ *  are still needed for future output are kept between calls, so memory
+ *  consumption does not grow with the length of the stream.
+ */
+
+#ifndef DUCC0_FFT_STREAMING_H
+#define DUCC0_FFT_STREAMING_H
+
+#include <cstddef>
+#include <complex>
+#include <memory>
+#include <vector>
+#include <algorithm>
+#include "ducc0/infra/error_handling.h"
+#include "ducc0/infra/mav.h"
+#include "ducc0/infra/threading.h"
+#include "ducc0/infra/aligned_array.h"
+#include "ducc0/math/cmplx.h"
+#include "ducc0/fft/fft1d.h"
+#include "ducc0/fft/fft.h"
+
+namespace ducc0 {
+
+namespace detail_fft_streaming {
+
+using namespace std;
+
+template<typename T> struct stream_traits
+  {
+  using Treal = T;
+  using Tplan = pocketfft_r<T>;
+  static size_t good_size(size_t n) { return good_size_real(n); }
+  };
+template<typename T> struct stream_traits<complex<T>>
+  {
+  using Treal = T;
+  using Tplan = pocketfft_c<T>;
+  static size_t good_size(size_t n) { return good_size_complex(n); }
+  };
+
+// forward transform of buf (length plan.length()), result in buf
+template<typename T> void stream_fwd(const pocketfft_r<T> &plan, T *buf,
+  T *scratch)
+  { plan.exec_copyback(buf, scratch, T(1), true); }
+template<typename T> void stream_fwd(const pocketfft_c<T> &plan,
+  complex<T> *buf, complex<T> *scratch)
+  {
+  plan.exec_copyback(reinterpret_cast<Cmplx<T> *>(buf),
+    reinterpret_cast<Cmplx<T> *>(scratch), T(1), true);
+  }
+template<typename T> void stream_bwd(const pocketfft_r<T> &plan, T *buf,
+  T *scratch)
+  { plan.exec_copyback(buf, scratch, T(1), false); }
+template<typename T> void stream_bwd(const pocketfft_c<T> &plan,
+  complex<T> *buf, complex<T> *scratch)
+  {
+  plan.exec_copyback(reinterpret_cast<Cmplx<T> *>(buf),
+    reinterpret_cast<Cmplx<T> *>(scratch), T(1), false);
+  }
+
+// multiplies the spectrum in buf with fkernel (both in the output format of
+// stream_fwd())
+template<typename T> void stream_mul(T *buf, const T *fkernel, size_t n)
+  {
+  buf[0] *= fkernel[0];
+  size_t i;
+  for (i=1; 2*i<n; ++i)
+    {
+    auto t = Cmplx<T>(buf[2*i-1], buf[2*i])
+            *Cmplx<T>(fkernel[2*i-1], fkernel[2*i]);
+    buf[2*i-1] = t.r;
+    buf[2*i] = t.i;
+    }
+  if (2*i==n)
+    buf[2*i-1] *= fkernel[2*i-1];
+  }
+template<typename T> void stream_mul(complex<T> *buf,
+  const complex<T> *fkernel, size_t n)
+  { for (size_t i=0; i<n; ++i) buf[i] *= fkernel[i]; }
+
+// copies the spectrum in buf (output format of stream_fwd()) to out
+template<typename T> void stream_spectrum(const T *buf, size_t n,
+  vmav<complex<T>,2> &out, size_t iframe)
+  {
+  out(iframe,0) = buf[0];
+  size_t i;
+  for (i=1; 2*i<n; ++i)
+    out(iframe,i) = complex<T>(buf[2*i-1], buf[2*i]);
+  if (2*i==n)
+    out(iframe,i) = buf[2*i-1];
+  }
+template<typename T> void stream_spectrum(const complex<T> *buf, size_t n,
+  vmav<complex<T>,2> &out, size_t iframe)
+  { for (size_t i=0; i<n; ++i) out(iframe,i) = buf[i]; }
+
+/// Causal FIR filter for a data stream, using the overlap-save method.
+/** For a kernel \a h of length M, the output sample n is
+ *  sum_{k=0}^{M-1} h[k]*x[n-k], where samples before the start of the stream
+ *  are taken as zero. The stream is processed in blocks of
+ *  block_length()==nfft-M+1 samples; \a push() emits the output for all
+ *  blocks that have been completed by the new chunk, \a flush() emits the
+ *  output for the remaining samples and resets the stream.
+ *
+ *  \a T can be \c float, \c double, \c long \c double or the corresponding
+ *  \c std::complex types. */
+template<typename T> class StreamingConvolver
+  {
+  private:
+    using Tplan = typename stream_traits<T>::Tplan;
+    using Treal = typename stream_traits<T>::Treal;
+
+    size_t nkernel, nfft, nblock;
+    shared_ptr<Tplan> plan;
+    vector<T> fkernel;
+    // the last nkernel-1 samples of the previous blocks, followed by the
+    // samples of the current, incomplete block
+    vector<T> hist;
+
+    void process(const vector<T> &stage, size_t nblocks, size_t nlast,
+      vmav<T,1> &out, size_t nthreads) const
+      {
+      execParallel(nblocks, nthreads, [&](size_t lo, size_t hi)
+        {
+        aligned_array<T> buf(nfft), scratch(plan->bufsize());
+        for (size_t iblk=lo; iblk<hi; ++iblk)
+          {
+          size_t ofs = iblk*nblock;
+          size_t nin = min(nfft, stage.size()-ofs);
+          copy_n(stage.data()+ofs, nin, buf.data());
+          fill(buf.data()+nin, buf.data()+nfft, T(0));
+          stream_fwd(*plan, buf.data(), scratch.data());
+          stream_mul(buf.data(), fkernel.data(), nfft);
+          stream_bwd(*plan, buf.data(), scratch.data());
+          size_t nout = (iblk+1==nblocks) ? nlast : nblock;
+          for (size_t i=0; i<nout; ++i)
+            out(ofs+i) = buf[nkernel-1+i];
+          }
+        });
+      }
+
+  public:
+    /// Creates a convolver for \a kernel.
+    /** If \a nfft_ is 0, a suitable FFT length is chosen automatically;
+     *  otherwise it must be at least kernel.shape(0). */
+    StreamingConvolver(const cmav<T,1> &kernel, size_t nfft_=0)
+      : nkernel(kernel.shape(0)),
+        nfft((nfft_==0) ? stream_traits<T>::good_size(max<size_t>(4*nkernel, 64))
+                        : nfft_),
+        nblock(nfft-nkernel+1),
+        plan(detail_fft::get_plan<Tplan>(nfft)),
+        fkernel(nfft, T(0))
+      {
+      MR_assert(nkernel>0, "kernel must not be empty");
+      MR_assert(nfft>=nkernel, "FFT length must not be smaller than kernel");
+      Treal fct = Treal(1)/Treal(nfft);
+      for (size_t i=0; i<nkernel; ++i)
+        fkernel[i] = kernel(i)*fct;
+      aligned_array<T> scratch(plan->bufsize());
+      stream_fwd(*plan, fkernel.data(), scratch.data());
+      reset();
+      }
+
+    size_t kernel_length() const { return nkernel; }
+    size_t fft_length() const { return nfft; }
+    /// Number of samples per processed block.
+    size_t block_length() const { return nblock; }
+    /// Number of input samples whose output has not yet been produced.
+    size_t n_pending() const { return hist.size()-(nkernel-1); }
+    /// Number of output samples that \a push() will produce for \a nin new
+    /// input samples.
+    size_t n_output(size_t nin) const
+      { return ((n_pending()+nin)/nblock)*nblock; }
+
+    /// Forgets all previous input; the next sample starts a new stream.
+    void reset()
+      { hist.assign(nkernel-1, T(0)); }
+
+    /// Appends \a in to the stream and stores the newly available output
+    /// samples at the start of \a out.
+    /** \a out must have at least n_output(in.shape(0)) entries.
+     *  \returns the number of output samples written. */
+    size_t push(const cmav<T,1> &in, vmav<T,1> &out, size_t nthreads=1)
+      {
+      size_t nin = in.shape(0);
+      size_t nout = n_output(nin);
+      MR_assert(out.shape(0)>=nout, "output array too small");
+      if (nout==0)
+        {
+        for (size_t i=0; i<nin; ++i) hist.push_back(in(i));
+        return 0;
+        }
+      vector<T> stage(hist.size()+nin);
+      copy(hist.begin(), hist.end(), stage.begin());
+      for (size_t i=0; i<nin; ++i) stage[hist.size()+i] = in(i);
+      process(stage, nout/nblock, nblock, out, nthreads);
+      hist.assign(stage.begin()+nout, stage.end());
+      return nout;
+      }
+
+    /// Stores the output for all pending samples at the start of \a out
+    /// and resets the stream.
+    /** \a out must have at least n_pending() entries. In order to obtain
+     *  the full linear convolution, push kernel_length()-1 zeros before
+     *  calling this method.
+     *  \returns the number of output samples written. */
+    size_t flush(vmav<T,1> &out, size_t nthreads=1)
+      {
+      size_t nout = n_pending();
+      MR_assert(out.shape(0)>=nout, "output array too small");
+      if (nout>0)
+        process(hist, 1, nout, out, nthreads);
+      reset();
+      return nout;
+      }
+  };
+
+/// Short-time Fourier transform of a data stream.
+/** Frame \a j covers the input samples [j*hop; j*hop+nwin[, which are
+ *  multiplied with the window, zero-padded to length \a nfft and
+ *  transformed forward without normalization. For real-valued input, only
+ *  the nfft/2+1 non-negative frequencies are returned, otherwise all \a nfft
+ *  frequencies in the usual FFT ordering. Frames are emitted as soon as all
+ *  their samples have been pushed.
+ *
+ *  \a T can be \c float, \c double, \c long \c double or the corresponding
+ *  \c std::complex types. */
+template<typename T> class StreamingSTFT
+  {
+  public:
+    using Treal = typename stream_traits<T>::Treal;
+
+  private:
+    using Tplan = typename stream_traits<T>::Tplan;
+    static constexpr bool is_real = is_same<T, Treal>::value;
+
+    size_t nwin, hop, nfft;
+    shared_ptr<Tplan> plan;
+    vector<Treal> window;
+    // samples starting at the first sample of the next frame
+    vector<T> hist;
+    // number of incoming samples to discard before the next frame starts
+    // (only nonzero if hop>nwin)
+    size_t nskip;
+
+  public:
+    /// Creates an STFT object with the given window and hop length.
+    /** If \a nfft_ is 0, the FFT length is set to window.shape(0);
+     *  otherwise it must be at least window.shape(0). */
+    StreamingSTFT(const cmav<Treal,1> &window_, size_t hop_, size_t nfft_=0)
+      : nwin(window_.shape(0)), hop(hop_), nfft((nfft_==0) ? nwin : nfft_),
+        plan(detail_fft::get_plan<Tplan>(nfft)), window(nwin)
+      {
+      MR_assert(nwin>0, "window must not be empty");
+      MR_assert(hop>0, "hop length must be positive");
+      MR_assert(nfft>=nwin, "FFT length must not be smaller than window");
+      for (size_t i=0; i<nwin; ++i)
+        window[i] = window_(i);
+      reset();
+      }
+
+    size_t window_length() const { return nwin; }
+    size_t hop_length() const { return hop; }
+    size_t fft_length() const { return nfft; }
+    /// Number of frequency bins per frame.
+    size_t n_bins() const { return is_real ? nfft/2+1 : nfft; }
+    /// Number of frames that \a push() will produce for \a nin new
+    /// input samples.
+    size_t n_frames(size_t nin) const
+      {
+      size_t ntot = hist.size() + ((nin>nskip) ? nin-nskip : 0);
+      return (ntot<nwin) ? 0 : (ntot-nwin)/hop+1;
+      }
+
+    /// Forgets all previous input; the next sample starts a new stream.
+    void reset()
+      { hist.clear(); nskip=0; }
+
+    /// Appends \a in to the stream and stores the newly completed frames
+    /// at the start of \a out.
+    /** \a out must have the shape (n, n_bins()) with n>=n_frames(in.shape(0)).
+     *  \returns the number of frames written. */
+    size_t push(const cmav<T,1> &in, vmav<complex<Treal>,2> &out,
+      size_t nthreads=1)
+      {
+      size_t nin = in.shape(0);
+      size_t nframes = n_frames(nin);
+      MR_assert(out.shape(0)>=nframes, "output array too small");
+      MR_assert(out.shape(1)==n_bins(), "bad number of frequency bins");
+      size_t skip = min(nskip, nin);
+      nskip -= skip;
+      if (nframes==0)
+        {
+        for (size_t i=skip; i<nin; ++i) hist.push_back(in(i));
+        return 0;
+        }
+      vector<T> stage(hist.size()+nin-skip);
+      copy(hist.begin(), hist.end(), stage.begin());
+      for (size_t i=skip; i<nin; ++i) stage[hist.size()+i-skip] = in(i);
+      execParallel(nframes, nthreads, [&](size_t lo, size_t hi)
+        {
+        aligned_array<T> buf(nfft), scratch(plan->bufsize());
+        for (size_t iframe=lo; iframe<hi; ++iframe)
+          {
+          const T *ptr = stage.data()+iframe*hop;
+          for (size_t i=0; i<nwin; ++i)
+            buf[i] = ptr[i]*window[i];
+          fill(buf.data()+nwin, buf.data()+nfft, T(0));
+          stream_fwd(*plan, buf.data(), scratch.data());
+          stream_spectrum(buf.data(), nfft, out, iframe);
+          }
+        });
+      size_t next = nframes*hop;
+      if (next<=stage.size())
+        hist.assign(stage.begin()+next, stage.end());
+      else
+        {
+        nskip = next-stage.size();
+        hist.clear();
+        }
+      return nframes;
+      }
+  };
+
+} // namespace detail_fft_streaming
+
+using detail_fft_streaming::StreamingConvolver;
+using detail_fft_streaming::StreamingSTFT;
+
+} // namespace ducc0
+
+#endif
@@ -21,6 +21,7 @@
 
 #include <cstdlib>
 #include <cstring>
+#include <complex>
 #include <numeric>
 #include <unordered_map>
 #include "ducc0/infra/communication.h"
@@ -44,6 +45,10 @@ class Typemap: public TypeMapper<MPI_Datatype>
       {
       add<double>(MPI_DOUBLE);
       add<float>(MPI_FLOAT);
+      add<long double>(MPI_LONG_DOUBLE);
+      add<complex<float>>(MPI_CXX_FLOAT_COMPLEX);
+      add<complex<double>>(MPI_CXX_DOUBLE_COMPLEX);
+      add<complex<long double>>(MPI_CXX_LONG_DOUBLE_COMPLEX);
       add<int>(MPI_INT);
       add<long>(MPI_LONG);
       add<char>(MPI_CHAR);
@@ -72,10 +77,21 @@ MPI_Op op2mop (Communicator::redOp op)
 //static
 void Communication::init()
   {
-  MPI_Init(0,0);
+  // request serialized thread support, so that communication can be
+  // overlapped with computation (see supports_threads())
+  int provided;
+  MPI_Init_thread(0, 0, MPI_THREAD_SERIALIZED, &provided);
   MPI_Comm_set_errhandler(MPI_COMM_WORLD, MPI_ERRORS_ARE_FATAL);
   }
 
+//static
+bool Communication::supports_threads()
+  {
+  int provided;
+  MPI_Query_thread(&provided);
+  return provided>=MPI_THREAD_SERIALIZED;
+  }
+
 //static
 bool Communication::initialized()
   {
@@ -269,6 +285,10 @@ bool Communication::initialized()
 //static
 void Communication::finalize() {}
 
+//static
+bool Communication::supports_threads()
+  { return true; }
+
 //static
 void Communication::abort()
   { exit(1); }
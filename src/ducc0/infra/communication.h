@@ -50,6 +50,9 @@ class Communication
     static bool initialized();
     static void finalize();
     static void abort();
+    /*! Returns \c true if communication may be carried out by a thread other
+        than the main one, as long as only one thread communicates at a time. */
+    static bool supports_threads();
   };
 
 class Communicator
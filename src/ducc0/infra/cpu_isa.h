@@ -0,0 +1,137 @@
+/*
+ *  This file is part of the MR utility library.
+ *
+ *  This code is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This code is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this code; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+/** \file ducc0/infra/cpu_isa.h
+ *  Run-time detection and selection of x86 instruction set levels.
+ *
+ *  The SIMD width used by DUCC's kernels is fixed at compile time (see
+ *  simd.h). To obtain fast code on a range of CPUs from a single portable
+ *  build, the complete library can be compiled several times for different
+ *  instruction set levels; the functions in this file help to pick the
+ *  most suitable of these builds at run time.
+ *
+ *  The choice can be overridden via the environment variable DUCC0_ISA,
+ *  which accepts "auto" (the default) or one of the level names returned by
+ *  isa_levels().
+ *
+ *  \copyright Copyright (C) 2023 Max-Planck-Society
+ *  \author Martin Reinecke
+ */
+
+#ifndef DUCC0_CPU_ISA_H
+#define DUCC0_CPU_ISA_H
+
+#include <cstdlib>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#include "ducc0/infra/error_handling.h"
+
+namespace ducc0 {
+
+namespace detail_cpu_isa {
+
+using namespace std;
+
+/// Names of the supported instruction set levels, in ascending order.
+/** "generic" stands for code without any x86-specific SIMD support. */
+inline const vector<string> &isa_levels()
+  {
+  static const vector<string> levels{"generic", "sse2", "avx2", "avx512"};
+  return levels;
+  }
+
+/// Returns the position of \a isa in isa_levels().
+inline size_t isa_index(const string &isa)
+  {
+  const auto &levels(isa_levels());
+  auto it = find(levels.begin(), levels.end(), isa);
+  MR_assert(it!=levels.end(), "unknown instruction set level '", isa, "'");
+  return size_t(it-levels.begin());
+  }
+
+/// Returns the instruction set level the calling code was compiled for.
+inline string compiled_isa()
+  {
+#if defined(__AVX512F__)
+  return "avx512";
+#elif defined(__AVX2__) && defined(__FMA__)
+  return "avx2";
+#elif defined(__SSE2__)
+  return "sse2";
+#else
+  return "generic";
+#endif
+  }
+
+/// Returns \c true if the CPU and operating system support \a isa.
+inline bool isa_supported(const string &isa)
+  {
+  auto idx = isa_index(isa);
+  if (idx==0) return true;
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+  __builtin_cpu_init();
+  if (idx>=1 && !__builtin_cpu_supports("sse2")) return false;
+  if (idx>=2 && !(__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")))
+    return false;
+  if (idx>=3 && !__builtin_cpu_supports("avx512f")) return false;
+  return true;
+#else
+  return false;
+#endif
+  }
+
+/// Returns the most capable level in \a available which the CPU supports.
+/** If the environment variable DUCC0_ISA is set to a value other than
+ *  "auto", exactly this level is returned instead; it is an error if it is
+ *  not contained in \a available or not supported by the CPU. */
+inline string select_isa(const vector<string> &available)
+  {
+  auto evar = getenv("DUCC0_ISA");
+  string req = evar ? string(evar) : string("auto");
+  if (req!="auto")
+    {
+    isa_index(req);
+    MR_assert(find(available.begin(), available.end(), req)!=available.end(),
+      "DUCC0_ISA=", req, ": this instruction set level is not available in "
+      "this build");
+    MR_assert(isa_supported(req), "DUCC0_ISA=", req,
+      ": this instruction set level is not supported by the CPU");
+    return req;
+    }
+  string res;
+  for (const auto &isa: available)
+    if (isa_supported(isa) && (res.empty() || (isa_index(isa)>isa_index(res))))
+      res = isa;
+  MR_assert(!res.empty(), "none of the available instruction set levels is "
+    "supported by the CPU");
+  return res;
+  }
+
+}
+
+using detail_cpu_isa::isa_levels;
+using detail_cpu_isa::compiled_isa;
+using detail_cpu_isa::isa_supported;
+using detail_cpu_isa::select_isa;
+
+}
+
+#endif
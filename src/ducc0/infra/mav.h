@@ -57,6 +57,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <vector>
 #include <memory>
 #include <numeric>
+#include <algorithm>
 #include <cstddef>
 #include <functional>
 #include <tuple>
@@ -639,6 +640,8 @@ template<typename T> class vfmav: public cfmav<T>
     static vfmav build_noncritical(const shape_t &shape)
       {
       auto ndim = shape.size();
+      if (std::find(shape.begin(), shape.end(), 0)!=shape.end())
+        return vfmav(shape);
       auto shape2 = noncritical_shape(shape, sizeof(T));
       vfmav tmp(shape2);
       vector<slice> slc(ndim);
@@ -653,7 +656,8 @@ template<typename T> class vfmav: public cfmav<T>
     static vfmav build_noncritical(const shape_t &shape, uninitialized_dummy)
       {
       auto ndim = shape.size();
-      if (ndim<=1) return vfmav(shape, UNINITIALIZED);
+      if ((ndim<=1) || (std::find(shape.begin(), shape.end(), 0)!=shape.end()))
+        return vfmav(shape, UNINITIALIZED);
       auto shape2 = noncritical_shape(shape, sizeof(T));
       vfmav tmp(shape2, UNINITIALIZED);
       vector<slice> slc(ndim);
@@ -821,6 +825,8 @@ template<typename T, size_t ndim> class vmav: public cmav<T, ndim>
 
     static vmav build_noncritical(const shape_t &shape)
       {
+      if (std::find(shape.begin(), shape.end(), 0)!=shape.end())
+        return vmav(shape);
       auto shape2 = noncritical_shape(shape, sizeof(T));
       vmav tmp(shape2);
       vector<slice> slc(ndim);
@@ -829,7 +835,8 @@ template<typename T, size_t ndim> class vmav: public cmav<T, ndim>
       }
     static vmav build_noncritical(const shape_t &shape, uninitialized_dummy)
       {
-      if (ndim<=1) return vmav(shape, UNINITIALIZED);
+      if ((ndim<=1) || (std::find(shape.begin(), shape.end(), 0)!=shape.end()))
+        return vmav(shape, UNINITIALIZED);
       auto shape2 = noncritical_shape(shape, sizeof(T));
       vmav tmp(shape2, UNINITIALIZED);
       vector<slice> slc(ndim);
@@ -0,0 +1,222 @@
+/*
+ *  This file is part of the MR utility library.
+ *
+ *  This code is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This code is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this code; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+/** \file ducc0/infra/mmap_file.h
+ *  Memory-mapped files for data sets which do not fit into main memory
+ *
+ *  \note MappedFile is only available on POSIX systems; on other platforms
+ *        release_mapped_pages() does nothing, and in_shared_file_mapping()
+ *        returns \c false.
+ *  \copyright Copyright (C) 2023 Max-Planck-Society
+ *  \author Martin Reinecke
+ */
+
+#ifndef DUCC0_MMAP_FILE_H
+#define DUCC0_MMAP_FILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cerrno>
+#include <cstring>
+#include <cstdio>
+#include <string>
+#include <fstream>
+#include <vector>
+#include <mutex>
+#include <algorithm>
+#if __has_include(<sys/mman.h>) && __has_include(<unistd.h>)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#define DUCC0_HAVE_MMAP
+#endif
+
+#include "ducc0/infra/error_handling.h"
+#include "ducc0/infra/mav.h"
+
+namespace ducc0 {
+
+namespace detail_mmap_file {
+
+using namespace std;
+
+#ifdef DUCC0_HAVE_MMAP
+
+/// Writes modified pages in [ptr; ptr+nbytes) back to their file and
+/// removes them from the resident set of the process.
+/** The range is extended to whole pages. It must lie completely within a
+ *  shared mapping of a file (see in_shared_file_mapping()); for anonymous
+ *  or private mappings, the contents of the affected pages would be lost. */
+inline void release_mapped_pages(const void *ptr, size_t nbytes)
+  {
+  if (nbytes==0) return;
+  auto psz = uintptr_t(sysconf(_SC_PAGESIZE));
+  auto lo = reinterpret_cast<uintptr_t>(ptr)/psz*psz;
+  auto hi = (reinterpret_cast<uintptr_t>(ptr)+nbytes+psz-1)/psz*psz;
+  auto p = reinterpret_cast<void *>(lo);
+  MR_assert(msync(p, hi-lo, MS_SYNC)==0, "msync failed: ", strerror(errno));
+  MR_assert(madvise(p, hi-lo, MADV_DONTNEED)==0, "madvise failed: ",
+    strerror(errno));
+  }
+
+// address ranges of all existing MappedFile objects
+struct MappingRegistry
+  {
+  mutex mut;
+  vector<pair<uintptr_t, uintptr_t>> ranges;
+  };
+inline MappingRegistry &mapping_registry()
+  {
+  static MappingRegistry reg;
+  return reg;
+  }
+
+/// Returns \c true if [ptr; ptr+nbytes) lies completely within shared
+/// mappings of files, i.e. if release_mapped_pages() can be called safely.
+/** Mappings of MappedFile objects are always recognized; other mappings
+ *  (e.g. those created by numpy.memmap) only where /proc/self/maps is
+ *  available. */
+inline bool in_shared_file_mapping(const void *ptr, size_t nbytes)
+  {
+  auto lo = reinterpret_cast<uintptr_t>(ptr), hi = lo+nbytes;
+  {
+  auto &reg(mapping_registry());
+  lock_guard<mutex> lock(reg.mut);
+  for (const auto &r: reg.ranges)
+    if ((r.first<=lo) && (hi<=r.second)) return true;
+  }
+  // the entries of /proc/self/maps are sorted by address, so a range
+  // spanning several adjacent mappings is covered in a single sweep
+  ifstream maps("/proc/self/maps");
+  string line;
+  while ((lo<hi) && getline(maps, line))
+    {
+    unsigned long start, end, inode;
+    char perms[5];
+    if (sscanf(line.c_str(), "%lx-%lx %4s %*s %*s %lu", &start, &end, perms,
+      &inode)!=4) continue;
+    if ((start<=lo) && (lo<end) && (perms[3]=='s') && (inode!=0))
+      lo = end;
+    }
+  return lo>=hi;
+  }
+
+/// A file which is mapped into memory for reading and writing.
+/** Changes to the data are written back to the file at the latest when the
+ *  object is destroyed. */
+class MappedFile
+  {
+  private:
+    int fd=-1;
+    void *ptr=nullptr;
+    size_t sz=0;
+
+  public:
+    /// Maps the file \a name.
+    /** If \a nbytes is nonzero, the file is created if necessary and resized
+     *  to \a nbytes bytes; otherwise it must exist and is mapped completely. */
+    MappedFile(const string &name, size_t nbytes=0)
+      {
+      fd = open(name.c_str(), (nbytes>0) ? (O_RDWR|O_CREAT) : O_RDWR, 0644);
+      MR_assert(fd>=0, "could not open file '", name, "': ", strerror(errno));
+      if (nbytes>0)
+        {
+        if (ftruncate(fd, off_t(nbytes))!=0)
+          {
+          close(fd);
+          MR_fail("could not resize file '", name, "': ", strerror(errno));
+          }
+        sz = nbytes;
+        }
+      else
+        {
+        struct stat st;
+        if (fstat(fd, &st)!=0)
+          {
+          close(fd);
+          MR_fail("could not stat file '", name, "': ", strerror(errno));
+          }
+        sz = size_t(st.st_size);
+        }
+      if (sz==0) return;
+      ptr = mmap(nullptr, sz, PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
+      if (ptr==MAP_FAILED)
+        {
+        ptr = nullptr;
+        close(fd);
+        MR_fail("could not map file '", name, "': ", strerror(errno));
+        }
+      auto &reg(mapping_registry());
+      lock_guard<mutex> lock(reg.mut);
+      auto lo = reinterpret_cast<uintptr_t>(ptr);
+      reg.ranges.emplace_back(lo, lo+sz);
+      }
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+    ~MappedFile()
+      {
+      if (ptr)
+        {
+        auto &reg(mapping_registry());
+        lock_guard<mutex> lock(reg.mut);
+        auto lo = reinterpret_cast<uintptr_t>(ptr);
+        reg.ranges.erase(find(reg.ranges.begin(), reg.ranges.end(),
+          make_pair(lo, lo+sz)));
+        munmap(ptr, sz);
+        }
+      if (fd>=0) close(fd);
+      }
+
+    /// Returns the size of the mapping in bytes.
+    size_t size() const { return sz; }
+    /// Returns a pointer to the start of the mapping.
+    void *data() { return ptr; }
+
+    /// Returns a C-contiguous view of the file contents with the given
+    /// \a shape, starting at byte offset \a ofs.
+    template<typename T> vfmav<T> array(const fmav_info::shape_t &shape,
+      size_t ofs=0)
+      {
+      MR_assert(ofs%alignof(T)==0, "bad alignment");
+      vfmav<T> res(reinterpret_cast<T *>(reinterpret_cast<char *>(ptr)+ofs),
+        shape);
+      MR_assert(ofs+res.size()*sizeof(T)<=sz, "array exceeds file size");
+      return res;
+      }
+  };
+
+#else
+
+inline bool in_shared_file_mapping(const void * /*ptr*/, size_t /*nbytes*/)
+  { return false; }
+inline void release_mapped_pages(const void * /*ptr*/, size_t /*nbytes*/) {}
+
+#endif
+
+}
+
+using detail_mmap_file::in_shared_file_mapping;
+using detail_mmap_file::release_mapped_pages;
+#ifdef DUCC0_HAVE_MMAP
+using detail_mmap_file::MappedFile;
+#endif
+
+}
+
+#endif
@@ -73,4 +73,42 @@ size_t usable_memory()
   return MemTotal-Committed;
   }
 
+size_t resident_memory()
+  {
+  string text = fileToString("/proc/self/status");
+  if (text.empty()) return 0;
+  return find<size_t>(text, R"(VmRSS:\s+(\d+) kB)")*1024;
+  }
+
+size_t available_memory()
+  {
+  string text = fileToString("/proc/meminfo");
+  if (text.find("MemAvailable:")==string::npos) return 0;
+  return find<size_t>(text, R"(MemAvailable:\s+(\d+) kB)")*1024;
+  }
+
+size_t l2_cache_size()
+  {
+  static const size_t res = []
+    {
+    const string base("/sys/devices/system/cpu/cpu0/cache/index");
+    for (size_t i=0; i<8; ++i)
+      {
+      string dir = base+dataToString(i)+"/";
+      istringstream level(fileToString(dir+"level")),
+                    type(fileToString(dir+"type")),
+                    size(fileToString(dir+"size"));
+      size_t lvl, val;
+      string tp, unit;
+      if ((!(level>>lvl)) || (!(type>>tp)) || (lvl!=2) || (tp=="Instruction"))
+        continue;
+      if (!(size>>val)) return size_t(0);
+      size >> unit;
+      return val*((unit=="K") ? 1024 : ((unit=="M") ? 1024*1024 : 1));
+      }
+    return size_t(0);
+    }();
+  return res;
+  }
+
 }}
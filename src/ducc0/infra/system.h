@@ -38,12 +38,24 @@ namespace detail_system {
 std::size_t getProcessInfo(const std::string &quantity);
 std::size_t getMemInfo(const std::string &quantity);
 std::size_t usable_memory();
+/// Returns the current resident set size of the process in bytes
+/// (0 if this information is not available).
+std::size_t resident_memory();
+/// Returns the amount of memory in bytes which is available for new
+/// allocations without swapping (0 if this information is not available).
+std::size_t available_memory();
+/// Returns the size of the level-2 cache of the first CPU in bytes
+/// (0 if this information is not available).
+std::size_t l2_cache_size();
 
 }
 
 using detail_system::getProcessInfo;
 using detail_system::getMemInfo;
 using detail_system::usable_memory;
+using detail_system::resident_memory;
+using detail_system::available_memory;
+using detail_system::l2_cache_size;
 
 }
 
@@ -60,6 +60,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <condition_variable>
 #include <thread>
 #include <queue>
+#include <memory>
 #include <atomic>
 #include <vector>
 #include <exception>
@@ -385,6 +386,106 @@ inline thread_pool &get_pool()
   return pool;
   }
 
+// Executes queued jobs one after the other on a single thread which does
+// not belong to the thread pool.
+class async_driver
+  {
+  private:
+    // everything which is abandoned in a forked child process
+    struct State
+      {
+      std::mutex mut;
+      std::condition_variable work_ready;
+      std::queue<std::function<void()>> jobs;
+      std::thread thread;
+      bool shutdown=false;
+      };
+    std::unique_ptr<State> state_=std::make_unique<State>();
+    using lock_t = std::unique_lock<std::mutex>;
+
+    static void driver_main(State &s)
+      {
+      while (true)
+        {
+        std::function<void()> job;
+        {
+        lock_t lock(s.mut);
+        s.work_ready.wait(lock, [&s]{ return s.shutdown || !s.jobs.empty(); });
+        // on shutdown, finish all jobs which are already queued
+        if (s.jobs.empty()) return;
+        job = std::move(s.jobs.front());
+        s.jobs.pop();
+        }
+        job();
+        }
+      }
+
+  public:
+    ~async_driver() { shutdown(); }
+
+    void submit(std::function<void()> job)
+      {
+      auto &s(*state_);
+      lock_t lock(s.mut);
+      // the thread is started lazily and after every shutdown
+      if (!s.thread.joinable())
+        {
+        s.shutdown = false;
+        s.thread = std::thread([&s]{ driver_main(s); });
+        }
+      s.jobs.push(std::move(job));
+      s.work_ready.notify_one();
+      }
+
+    void shutdown()
+      {
+      auto &s(*state_);
+      {
+      lock_t lock(s.mut);
+      s.shutdown = true;
+      s.work_ready.notify_all();
+      }
+      if (s.thread.joinable()) s.thread.join();
+      }
+
+    // Holding the lock across fork() guarantees a consistent queue in the
+    // child. The lock is never held while a job is running, so this does not
+    // wait for any jobs (which might need a lock held by the forking thread,
+    // e.g. Python's GIL).
+    void prepare_fork() { state_->mut.lock(); }
+    void parent_after_fork() { state_->mut.unlock(); }
+    // The driver thread does not exist in the child. Its handle, the mutex
+    // and the condition variable are abandoned, and the jobs which were still
+    // queued are discarded (their futures report a broken promise); the
+    // next submitted job starts a new thread.
+    void child_after_fork()
+      {
+      auto jobs = std::move(state_->jobs);
+      (void)state_.release();  // deliberately leaked
+      state_ = std::make_unique<State>();
+      }
+  };
+
+inline async_driver &get_async_driver()
+  {
+  // make sure the pool is constructed first and destroyed last, since
+  // pending jobs may still need it
+  get_pool();
+  static async_driver driver;
+#if __has_include(<pthread.h>)
+  static std::once_flag f;
+  call_once(f,
+    []{
+    pthread_atfork(
+      +[]{ get_async_driver().prepare_fork(); },
+      +[]{ get_async_driver().parent_after_fork(); },
+      +[]{ get_async_driver().child_after_fork(); });
+    });
+#endif
+
+  return driver;
+  }
+
 class Distribution
   {
   private:
@@ -610,6 +711,9 @@ void execParallel(size_t work_lo, size_t work_hi, size_t nthreads,
     });
   }
 
+void submitAsync(std::function<void()> func)
+  { get_async_driver().submit(std::move(func)); }
+
 #else
 
 size_t max_threads() { return 1; }
@@ -667,6 +771,9 @@ void execParallel(size_t work_lo, size_t work_hi, size_t,
   std::function<void(size_t, size_t, size_t)> func)
   { func(0, work_lo, work_hi); }
 
+void submitAsync(std::function<void()> func)
+  { func(); }
+
 #endif
 
 }}
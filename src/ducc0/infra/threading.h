@@ -58,6 +58,9 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <mutex>
 #include <condition_variable>
 #include <optional>
+#include <future>
+#include <memory>
+#include <type_traits>
 
 namespace ducc0 {
 
@@ -201,6 +204,36 @@ template<typename T, typename Func> auto execWorklist
     });
   }
 
+/// Appends \a func to the queue of asynchronous jobs.
+/** Jobs are executed one after the other, in submission order, on a
+ *  dedicated thread which does not belong to the thread pool. Parallel
+ *  regions inside a job can therefore use all threads of the pool.
+ *  \a func must not throw; use execAsync() for functions that might.
+ *  Jobs which have not started when the process forks are not carried over
+ *  into the child process; there, they are discarded without being run. A
+ *  job running at the time of the fork continues in the parent only. */
+void submitAsync(std::function<void()> func);
+
+/// Executes \a func asynchronously and returns a std::future for its result.
+/** The job is run as described for submitAsync(). Exceptions thrown by
+ *  \a func are stored in the returned future.
+ *
+ *  Example: overlapping an FFT with other work
+ *  \code
+ *  auto done = execAsync([&]{ c2c(in, out, axes, true, 1., nthreads); });
+ *  // ... do something else ...
+ *  done.get();  // wait for completion, rethrow exceptions
+ *  \endcode */
+template<typename Func> auto execAsync(Func &&func)
+  {
+  using Tres = std::invoke_result_t<std::decay_t<Func> &>;
+  auto task = std::make_shared<std::packaged_task<Tres()>>
+    (std::forward<Func>(func));
+  auto res = task->get_future();
+  submitAsync([task]() { (*task)(); });
+  return res;
+  }
+
 } // end of namespace detail_threading
 
 using detail_threading::max_threads;
@@ -212,6 +245,7 @@ using detail_threading::execDynamic;
 using detail_threading::execGuided;
 using detail_threading::execParallel;
 using detail_threading::execWorklist;
+using detail_threading::execAsync;
 
 } // end of namespace ducc0
 
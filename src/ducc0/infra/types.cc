@@ -20,6 +20,7 @@
    Author: Martin Reinecke */
 
 #include <cstdint>
+#include <complex>
 
 #include "ducc0/infra/types.h"
 
@@ -43,8 +44,9 @@ class Sizemap: public TypeMapper<size_t>
   public:
     Sizemap()
       {
-      addTypes<double, float, int, long, size_t, ptrdiff_t,
-               int32_t, int64_t, uint32_t, uint64_t>();
+      addTypes<double, float, long double, int, long, size_t, ptrdiff_t,
+               int32_t, int64_t, uint32_t, uint64_t, char, unsigned char,
+               complex<float>, complex<double>, complex<long double>>();
       }
    };
 
@@ -0,0 +1,130 @@
+/*
+ *  This file is part of DUCC.
+ *
+ *  DUCC is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  DUCC is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with DUCC; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+/*
+ *  DUCC is being developed at the Max-Planck-Institut fuer Astrophysik
+ */
+
+/*
+ *  Copyright (C) 2023 Max-Planck-Society
+ */
+
+/*! \file float16.h
+ *  16-bit floating point storage types.
+ *
+ *  These types are only meant for storing data compactly; all arithmetic
+ *  is carried out after conversion to \c float. Conversions from \c float
+ *  round to nearest (ties to even) and handle subnormals, infinities and
+ *  NaNs.
+ */
+
+#ifndef DUCC0_FLOAT16_H
+#define DUCC0_FLOAT16_H
+
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+namespace ducc0 {
+
+namespace detail_float16 {
+
+using namespace std;
+
+inline uint32_t float_bits(float f)
+  { uint32_t res; memcpy(&res, &f, sizeof(res)); return res; }
+inline float bits_float(uint32_t u)
+  { float res; memcpy(&res, &u, sizeof(res)); return res; }
+
+/// IEEE 754 binary16 ("half precision") number
+struct float16
+  {
+  uint16_t bits;
+
+  static uint16_t from_float(float f)
+    {
+    uint32_t x = float_bits(f);
+    uint16_t sign = uint16_t((x>>16)&0x8000u);
+    x &= 0x7fffffffu;
+    if (x>=0x7f800000u) // Inf or NaN
+      return uint16_t(sign | ((x>0x7f800000u) ? 0x7e00u : 0x7c00u));
+    if (x>=0x477ff000u) // rounds to Inf
+      return uint16_t(sign | 0x7c00u);
+    if (x<0x38800000u) // subnormal result: let the FPU do the rounding
+      return uint16_t(sign | (float_bits(bits_float(x)+0.5f)-0x3f000000u));
+    // rebias the exponent and round to nearest even
+    x += 0xc8000fffu + ((x>>13)&1u);
+    return uint16_t(sign | (x>>13));
+    }
+
+  float16() = default;
+  /// Converts anything that is convertible to float (e.g. SIMD lanes)
+  template<typename T, typename=enable_if_t<is_convertible<T, float>::value>>
+    float16(const T &v) : bits(from_float(float(v))) {}
+  operator float() const
+    {
+    uint32_t sign = uint32_t(bits&0x8000u)<<16;
+    uint32_t expo = (bits>>10)&0x1fu, mant = bits&0x3ffu;
+    if (expo==0) // zero or subnormal
+      {
+      float res = float(mant)*(1.f/16777216.f);
+      return sign ? -res : res;
+      }
+    if (expo==31) // Inf or NaN
+      return bits_float(sign|0x7f800000u|(mant<<13));
+    return bits_float(sign|((expo+112)<<23)|(mant<<13));
+    }
+  };
+
+/// "Brain floating point" number (the upper 16 bits of an IEEE float)
+struct bfloat16
+  {
+  uint16_t bits;
+
+  static uint16_t from_float(float f)
+    {
+    uint32_t x = float_bits(f);
+    if ((x&0x7fffffffu)>0x7f800000u) // NaN: keep it quiet
+      return uint16_t((x>>16)|0x40u);
+    return uint16_t((x + 0x7fffu + ((x>>16)&1u))>>16);
+    }
+
+  bfloat16() = default;
+  /// Converts anything that is convertible to float (e.g. SIMD lanes)
+  template<typename T, typename=enable_if_t<is_convertible<T, float>::value>>
+    bfloat16(const T &v) : bits(from_float(float(v))) {}
+  operator float() const
+    { return bits_float(uint32_t(bits)<<16); }
+  };
+
+static_assert(sizeof(float16)==2, "unexpected size of float16");
+static_assert(sizeof(bfloat16)==2, "unexpected size of bfloat16");
+
+/// True for the 16-bit storage types defined in this file
+template<typename T> constexpr bool is_float16_type =
+  is_same<T, float16>::value || is_same<T, bfloat16>::value;
+
+}
+
+using detail_float16::float16;
+using detail_float16::bfloat16;
+using detail_float16::is_float16_type;
+
+}
+
+#endif
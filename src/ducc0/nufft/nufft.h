@@ -29,6 +29,9 @@
 #include <utility>
 #include <mutex>
 #include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
 #include <algorithm>
 #include <cstdlib>
 #include <cmath>
@@ -37,6 +40,7 @@
 #include <atomic>
 #include <memory>
 #include <numeric>
+#include <random>
 #if ((!defined(DUCC0_NO_SIMD)) && (defined(__AVX__)||defined(__SSE3__)))
 #include <x86intrin.h>
 #endif
@@ -50,6 +54,7 @@
 #include "ducc0/infra/mav.h"
 #include "ducc0/infra/simd.h"
 #include "ducc0/infra/timers.h"
+#include "ducc0/infra/system.h"
 #include "ducc0/infra/bucket_sort.h"
 #include "ducc0/math/gridding_kernel.h"
 
@@ -147,6 +152,171 @@ inline auto comp_indices(size_t idx, size_t nuni, size_t nbig, bool fft_order)
   return make_tuple(icf, i1, i2);
   }
 
+/*! Machine-dependent coefficients of the cost model which is used by
+    findNufftParameters() to select kernel and oversampling factor.
+    The defaults were measured on a typical workstation; better values for
+    the running machine can be obtained with calibrate_nufft_cost_model(). */
+struct NufftCostModel
+  {
+  /// run time (in s) of a 2048x2048 complex FFT on a single thread
+  double fft_ref=0.0693;
+  /// run time (in s) per unit of spreading/interpolation work on a single
+  /// thread (see nufft_grid_units())
+  double grid_ref=2.2e-10;
+  /// asymptotic speedup of FFTs for many threads
+  double max_fft_scaling=6;
+  /// asymptotic speedup of spreading/interpolation for many threads
+  /// (the default corresponds to practically perfect scaling)
+  double max_grid_scaling=1e6;
+  /// sharpness of the transition between linear and saturated speedup
+  double scaling_power=2;
+
+  /// Speedup for \a nthreads threads, given its asymptotic value \a maxval.
+  double speedup(double nthreads, double maxval) const
+    {
+    auto x2 = nthreads-1;
+    auto m2 = maxval-1;
+    return 1.+x2/pow((1.+pow(x2/m2,scaling_power)),1./scaling_power);
+    }
+  /// Estimated run time of a complex FFT over \a gridsize points.
+  double fft_cost(double gridsize, size_t nthreads) const
+    {
+    constexpr double nref_fft=2048;
+    double logterm = log(gridsize)/log(nref_fft*nref_fft);
+    return gridsize/(nref_fft*nref_fft)*logterm*fft_ref
+          /speedup(double(nthreads), max_fft_scaling);
+    }
+  /// Estimated run time for \a units units of spreading work.
+  double grid_cost(double units, size_t nthreads) const
+    { return grid_ref*units/speedup(double(nthreads), max_grid_scaling); }
+  };
+
+/*! Returns the amount of work for spreading or interpolating \a npoints
+    points with a kernel of support \a supp, computed with SIMD vectors of
+    length \a vlen. */
+inline double nufft_grid_units(size_t ndim, size_t supp, size_t vlen,
+  size_t npoints)
+  {
+  auto nvec = (supp+vlen-1)/vlen;
+  size_t kernelpoints = nvec*vlen;
+  for (size_t idim=0; idim+1<ndim; ++idim)
+    kernelpoints*=supp;
+  return double(npoints)*double(kernelpoints + (ndim*nvec*(supp+3)*vlen));
+  }
+
+/// Writes \a model to the file \a filename.
+inline void write_nufft_cost_model(const NufftCostModel &model,
+  const string &filename)
+  {
+  ofstream os(filename);
+  MR_assert(os, "could not open NUFFT cost model file '", filename,
+    "' for writing");
+  os.precision(17);
+  os << "# ducc0 NUFFT cost model v1\n"
+     << "fft_ref " << model.fft_ref << "\n"
+     << "grid_ref " << model.grid_ref << "\n"
+     << "max_fft_scaling " << model.max_fft_scaling << "\n"
+     << "max_grid_scaling " << model.max_grid_scaling << "\n"
+     << "scaling_power " << model.scaling_power << "\n";
+  MR_assert(os, "error writing NUFFT cost model file '", filename, "'");
+  }
+
+/*! Reads a file written by write_nufft_cost_model(). Coefficients which are
+    not listed in the file keep their default values. */
+inline NufftCostModel read_nufft_cost_model(const string &filename)
+  {
+  ifstream is(filename);
+  MR_assert(is, "could not open NUFFT cost model file '", filename,
+    "' for reading");
+  NufftCostModel res;
+  string line;
+  while (getline(is, line))
+    {
+    istringstream iss(line);
+    string key;
+    if ((!(iss >> key)) || (key[0]=='#')) continue;
+    double val;
+    MR_assert(iss >> val, "malformed line in NUFFT cost model file: '",
+      line, "'");
+    MR_assert(val>0, "bad value in NUFFT cost model file: '", line, "'");
+    if (key=="fft_ref") res.fft_ref = val;
+    else if (key=="grid_ref") res.grid_ref = val;
+    else if (key=="max_fft_scaling") res.max_fft_scaling = val;
+    else if (key=="max_grid_scaling") res.max_grid_scaling = val;
+    else if (key=="scaling_power") res.scaling_power = val;
+    else
+      MR_fail("unknown entry in NUFFT cost model file: '", line, "'");
+    }
+  MR_assert((res.max_fft_scaling>1) && (res.max_grid_scaling>1),
+    "maximum speedups in NUFFT cost model file must be larger than 1");
+  return res;
+  }
+
+/*! Process-wide cost model used for all NUFFT plans.
+    If the environment variable DUCC0_NUFFT_PROFILE is set, the initial
+    model is read from the file it points to, otherwise the defaults of
+    NufftCostModel are used. */
+class NufftCostProfile
+  {
+  private:
+    NufftCostModel model_;
+#ifndef DUCC0_NO_THREADING
+    mutable mutex mut;
+#endif
+
+    NufftCostProfile()
+      {
+      auto evar=getenv("DUCC0_NUFFT_PROFILE");
+      if (evar && (*evar!='\0')) model_ = read_nufft_cost_model(evar);
+      }
+
+  public:
+    static NufftCostProfile &instance()
+      {
+      static NufftCostProfile profile;
+      return profile;
+      }
+
+    NufftCostModel model() const
+      {
+#ifndef DUCC0_NO_THREADING
+      lock_guard<mutex> lock(mut);
+#endif
+      return model_;
+      }
+    void set_model(const NufftCostModel &model)
+      {
+#ifndef DUCC0_NO_THREADING
+      lock_guard<mutex> lock(mut);
+#endif
+      model_ = model;
+      }
+  };
+
+/// Returns the cost model currently used for planning NUFFTs.
+inline NufftCostModel get_nufft_cost_model()
+  { return NufftCostProfile::instance().model(); }
+/// Sets the cost model used for all NUFFT plans created from now on.
+inline void set_nufft_cost_model(const NufftCostModel &model)
+  { NufftCostProfile::instance().set_model(model); }
+/// Writes the current NUFFT cost model to the file \a filename.
+inline void save_nufft_cost_model(const string &filename)
+  { write_nufft_cost_model(get_nufft_cost_model(), filename); }
+/// Reads a NUFFT cost model from \a filename and makes it the current one.
+inline void load_nufft_cost_model(const string &filename)
+  { set_nufft_cost_model(read_nufft_cost_model(filename)); }
+
+/*! Returns the oversampled grid dimensions for the uniform grid dimensions
+    \a dims and the oversampling factor \a ofactor of a kernel. */
+inline vector<size_t> oversampled_dims(const vector<size_t> &dims,
+  double ofactor)
+  {
+  vector<size_t> res(dims.size());
+  for (size_t i=0; i<dims.size(); ++i)
+    res[i] = 2*good_size_complex(size_t(dims[i]*ofactor*0.5)+1);
+  return res;
+  }
+
 /*! Selects the most efficient combination of gridding kernel and oversampled
     grid size for the provided problem parameters. */
 template<typename Tcalc, typename Tacc> auto findNufftParameters(double epsilon,
@@ -156,42 +326,21 @@ template<typename Tcalc, typename Tacc> auto findNufftParameters(double epsilon,
   auto vlen = gridding ? mysimd<Tacc>::size() : mysimd<Tcalc>::size();
   auto ndim = dims.size();
   auto idx = getAvailableKernels<Tcalc>(epsilon, ndim, sigma_min, sigma_max);
+  auto model = get_nufft_cost_model();
   double mincost = 1e300;
-  constexpr double nref_fft=2048;
-  constexpr double costref_fft=0.0693;
   vector<size_t> bigdims(ndim, 0);
   size_t minidx=~(size_t(0));
   for (size_t i=0; i<idx.size(); ++i)
     {
     const auto &krn(getKernel(idx[i]));
     auto supp = krn.W;
-    auto nvec = (supp+vlen-1)/vlen;
-    auto ofactor = krn.ofactor;
-    vector<size_t> lbigdims(ndim,0);
+    auto lbigdims = oversampled_dims(dims, krn.ofactor);
     double gridsize=1;
-    for (size_t idim=0; idim<ndim; ++idim)
-      {
-      lbigdims[idim] = 2*good_size_complex(size_t(dims[idim]*ofactor*0.5)+1);
-      gridsize *= lbigdims[idim];
-      }
-    double logterm = log(gridsize)/log(nref_fft*nref_fft);
-    double fftcost = gridsize/(nref_fft*nref_fft)*logterm*costref_fft;
-    size_t kernelpoints = nvec*vlen;
-    for (size_t idim=0; idim+1<ndim; ++idim)
-      kernelpoints*=supp;
-    double gridcost = 2.2e-10*npoints*(kernelpoints + (ndim*nvec*(supp+3)*vlen));
-    if (gridding) gridcost *= sizeof(Tacc)/sizeof(Tcalc);
-    // FIXME: heuristics could be improved
-    gridcost /= nthreads;  // assume perfect scaling for now
-    constexpr double max_fft_scaling = 6;
-    constexpr double scaling_power=2;
-    auto sigmoid = [](double x, double m, double s)
-      {
-      auto x2 = x-1;
-      auto m2 = m-1;
-      return 1.+x2/pow((1.+pow(x2/m2,s)),1./s);
-      };
-    fftcost /= sigmoid(nthreads, max_fft_scaling, scaling_power);
+    for (auto d: lbigdims) gridsize *= d;
+    double fftcost = model.fft_cost(gridsize, nthreads);
+    double gridunits = nufft_grid_units(ndim, supp, vlen, npoints);
+    if (gridding) gridunits *= sizeof(Tacc)/sizeof(Tcalc);
+    double gridcost = model.grid_cost(gridunits, nthreads);
     double cost = fftcost+gridcost;
     if (cost<mincost)
       {
@@ -224,6 +373,13 @@ template<> constexpr inline size_t max_ntile<1> = (~uint32_t(0))-10;
 template<> constexpr inline size_t max_ntile<2> = (uint32_t(1<<16))-10;
 template<> constexpr inline size_t max_ntile<3> = (uint32_t(1<<10))-10;
 
+// upper limits for the tile size, keeping the local buffers of a thread
+// at a few MB
+template<size_t ndim> constexpr inline int max_log2tile=-1;
+template<> constexpr inline int max_log2tile<1> = 16;
+template<> constexpr inline int max_log2tile<2> = 9;
+template<> constexpr inline int max_log2tile<3> = 6;
+
 template<typename Tcalc, typename Tacc, size_t ndim> class Nufft_ancestor
   {
   protected:
@@ -236,6 +392,9 @@ template<typename Tcalc, typename Tacc, size_t ndim> class Nufft_ancestor
     // 1./<periodicity of coordinates>
     double coordfct;
 
+    // permitted range of oversampling factors
+    double sigma_min, sigma_max;
+
     // if true, start with zero mode
     // if false, start with most negative mode
     bool fft_order;
@@ -252,6 +411,12 @@ template<typename Tcalc, typename Tacc, size_t ndim> class Nufft_ancestor
     // holds the indices of the nonuniform points in the order in which they
     // should be processed
     quick_array<uint32_t> coord_idx;
+    // tile_start[i] is the position in coord_idx of the first point in
+    // tile i (numbered in processing order; filled by build_index()).
+    // tile_div consecutive tiles share the same tile index along the first
+    // dimension.
+    vector<size_t> tile_start;
+    size_t tile_div=1;
 
     shared_ptr<PolynomialKernel> krn;
 
@@ -262,12 +427,59 @@ template<typename Tcalc, typename Tacc, size_t ndim> class Nufft_ancestor
 
     vector<vector<double>> corfac;
 
-    // the base-2 logarithm of the linear dimension of a computational tile.
-    constexpr static int log2tile = log2tile_<Tacc,ndim>;
+    // Fourier transform of the point spread function on the doubled grid
+    // (real-valued, laid out like the grid used in apply_toeplitz()).
+    // Empty unless make_toeplitz() has been called.
+    vmav<Tcalc,ndim> toeplitz_kernel;
+
+    // if true, the kernel weights of all nonuniform points are computed once
+    // and stored (see set_kernel_cache())
+    bool kcache_requested=false;
+    // start indices in the oversampled grid (ndim per point) and kernel
+    // weights (ndim*supp per point) of all nonuniform points, in processing
+    // order. The weights are stored in kcache_wf if single precision is
+    // sufficient for the requested accuracy, else in kcache_wc.
+    quick_array<int> kcache_i0;
+    quick_array<float> kcache_wf;
+    quick_array<Tcalc> kcache_wc;
+
+    // the base-2 logarithm of the linear dimension of a computational tile
+    // (see choose_log2tile()).
+    int log2tile;
 
     static_assert(sizeof(Tcalc)<=sizeof(Tacc),
       "Tacc must be at least as accurate as Tcalc");
 
+    /*! Index ranges along dimension \a idim of the oversampled grid which
+        correspond to the uniform grid (i.e. which are occupied before the
+        FFT in uni2nonuni and needed after the FFT in nonuni2uni). */
+    vector<slice> uni_ranges(size_t idim) const
+      {
+      return {slice(0, (nuni[idim]+1)/2),
+              slice(nover[idim]-nuni[idim]/2, MAXIDX)};
+      }
+
+    struct UniMapEntry
+      {
+      bool valid;     // false if there is no corresponding uniform index
+      ptrdiff_t ofs;  // offset of the corresponding uniform entry
+      double cf;      // grid correction factor
+      };
+    /*! Returns, for every index along dimension \a idim of the oversampled
+        grid, the offset of the corresponding entry of a uniform grid with
+        stride \a ustride along this dimension, and its correction factor.
+        This saves calling comp_indices() for every grid element. */
+    vector<UniMapEntry> uni_map(size_t idim, ptrdiff_t ustride) const
+      {
+      vector<UniMapEntry> res(nover[idim], UniMapEntry{false, 0, 0.});
+      for (size_t i=0; i<nuni[idim]; ++i)
+        {
+        auto [icf, iout, iin] = comp_indices(i, nuni[idim], nover[idim], fft_order);
+        res[iin] = {true, ptrdiff_t(iout)*ustride, corfac[idim][icf]};
+        }
+      return res;
+      }
+
     /*! Compute minimum index in the oversampled grid touched by the kernel
         around coordinate \a in. */
     template<typename Tcoord> [[gnu::always_inline]] void getpix(array<double,ndim> in,
@@ -285,6 +497,229 @@ template<typename Tcalc, typename Tacc, size_t ndim> class Nufft_ancestor
         }
       }
 
+    /*! Returns true if cached kernel weights are stored as \c float. */
+    bool kernel_cache_float() const
+      { return is_same<Tcalc,float>::value || (epsilon>=1e-6); }
+
+    bool kernel_cached() const
+      { return kcache_i0.size()!=0; }
+
+    /*! Computes and stores the grid indices and kernel weights for the
+        coordinates \a coords (given in processing order), if this was
+        requested and has not been done yet. The polynomial approximation of
+        the kernel is evaluated in double precision. */
+    template<typename Tcoord> void update_kernel_cache(const cmav<Tcoord,2> &coords)
+      {
+      if ((!kcache_requested) || kernel_cached() || (npoints==0)) return;
+      timers.push("kernel cache");
+      MR_assert(coords.shape(0)==npoints, "number of points mismatch");
+      bool single = kernel_cache_float();
+      kcache_i0.resize(npoints*ndim);
+      if (single)
+        kcache_wf.resize(npoints*ndim*supp);
+      else
+        kcache_wc.resize(npoints*ndim*supp);
+      const auto &coeff(krn->Coeff());
+      size_t deg = krn->degree();
+      execParallel(npoints, nthreads, [&](size_t lo, size_t hi)
+        {
+        vector<double> w(supp);
+        for (size_t ix=lo; ix<hi; ++ix)
+          {
+          array<double,ndim> in, frac;
+          array<int,ndim> i0;
+          for (size_t d=0; d<ndim; ++d) in[d] = coords(ix,d);
+          getpix<Tcoord>(in, frac, i0);
+          for (size_t d=0; d<ndim; ++d)
+            {
+            kcache_i0[ix*ndim+d] = i0[d];
+            double x = -frac[d]*2+(supp-1);
+            for (size_t i=0; i<supp; ++i)
+              {
+              w[i] = coeff[i];
+              for (size_t j=1; j<=deg; ++j)
+                w[i] = w[i]*x + coeff[j*supp+i];
+              }
+            size_t ofs = (ix*ndim+d)*supp;
+            if (single)
+              for (size_t i=0; i<supp; ++i) kcache_wf[ofs+i] = float(w[i]);
+            else
+              for (size_t i=0; i<supp; ++i) kcache_wc[ofs+i] = Tcalc(w[i]);
+            }
+          }
+        });
+      timers.pop();
+      }
+
+    /*! Retrieves the grid start index and kernel weights of the point with
+        processing index \a ix from the cache. For every dimension, \a bstride
+        entries of \a buf are written; the ones beyond \a SUPP are set to 0. */
+    template<size_t SUPP, typename T> [[gnu::always_inline]] void get_cached_kernel
+      (size_t ix, array<int,ndim> &i0, T * DUCC0_RESTRICT buf, size_t bstride) const
+      {
+      for (size_t d=0; d<ndim; ++d)
+        i0[d] = kcache_i0[ix*ndim+d];
+      auto fill = [&](const auto * DUCC0_RESTRICT w)
+        {
+        for (size_t d=0; d<ndim; ++d, buf+=bstride, w+=SUPP)
+          {
+          for (size_t i=0; i<SUPP; ++i) buf[i] = T(w[i]);
+          for (size_t i=SUPP; i<bstride; ++i) buf[i] = T(0);
+          }
+        };
+      if (kcache_wf.size()!=0)
+        fill(kcache_wf.data()+ix*ndim*SUPP);
+      else
+        fill(kcache_wc.data()+ix*ndim*SUPP);
+      }
+
+    /*! Partition of the spreading work into per-thread private slabs of
+        the oversampled grid: thread k accumulates its points into a slab
+        holding nrows[k] rows of the grid, starting at (unwrapped) row
+        row0[k]. It processes the points with processing indices
+        [lo; hi) for every entry of pieces[k]; within a piece, the slab
+        starts at the (unwrapped) row ofs. */
+    struct SlabPlan
+      {
+      struct Piece { size_t lo, hi; ptrdiff_t ofs; };
+      vector<vector<Piece>> pieces;
+      vector<size_t> nrows;
+      vector<ptrdiff_t> row0;
+      };
+
+    /*! Determines tile_start from the sort keys \a key of the points, for
+        which the tile number is key>>\a shift.
+        Must be called before the keys are sorted (bucket_sort2() uses them
+        as scratch space). */
+    void count_tiles(const quick_array<uint32_t> &key, size_t ntiles,
+      size_t shift)
+      {
+      tile_start.assign(ntiles+1, 0);
+      mutex mtx;
+      execParallel(key.size(), nthreads, [&](size_t lo, size_t hi)
+        {
+        vector<size_t> cnt(ntiles, 0);
+        for (size_t i=lo; i<hi; ++i)
+          ++cnt[key[i]>>shift];
+        lock_guard<mutex> lock(mtx);
+        for (size_t i=0; i<ntiles; ++i)
+          tile_start[i+1] += cnt[i];
+        });
+      for (size_t i=0; i<ntiles; ++i)
+        tile_start[i+1] += tile_start[i];
+      }
+
+    /*! Decides whether spreading should use private slabs (see SlabPlan)
+        instead of locking rows of the shared grid, and sets up \a plan if
+        it should. Since build_index() orders the points primarily by their
+        tile index along the first dimension, a contiguous range of points
+        only touches a contiguous range of grid rows; for clustered point
+        distributions, these ranges are small. The ranges are taken
+        cyclically, starting behind the largest gap between occupied tiles,
+        so that clusters extending across the periodic boundary of the grid
+        are kept together. Private slabs are used if their combined size
+        does not exceed that of the grid. */
+    bool plan_slabs(SlabPlan &plan) const
+      {
+      // number of indexed points
+      size_t npts = coord_idx.size();
+      if ((nthreads<2) || (npts<nthreads)
+        || (tile_start.size()<2) || (tile_start.back()!=npts))
+        return false;
+      auto tsz = ptrdiff_t(1)<<log2tile,
+           n0 = ptrdiff_t(nover[0]);
+      // tile index along the first dimension of the point at position ix
+      auto tile = [&](size_t ix)
+        {
+        return ptrdiff_t((upper_bound(tile_start.begin(), tile_start.end(), ix)
+                         - tile_start.begin() - 1)/ptrdiff_t(tile_div));
+        };
+      // position of the first point with tile index u along the first
+      // dimension
+      auto ustart = [&](size_t u) { return tile_start[u*tile_div]; };
+      size_t ntiles_u = (tile_start.size()-1)/tile_div;
+      // find the largest gap (in grid rows) between occupied tiles
+      size_t start=0;
+      ptrdiff_t maxgap = tile(0)*tsz + n0 - tile(npts-1)*tsz;
+      for (size_t u=1; u<ntiles_u; ++u)
+        if ((ustart(u)>0) && (ustart(u)<npts) && (ustart(u+1)>ustart(u)))
+          {
+          auto gap = (ptrdiff_t(u)-tile(ustart(u)-1))*tsz;
+          if (gap>maxgap) { maxgap=gap; start=ustart(u); }
+          }
+      plan.pieces.assign(nthreads, {});
+      plan.nrows.resize(nthreads);
+      plan.row0.resize(nthreads);
+      size_t total=0;
+      for (size_t k=0; k<nthreads; ++k)
+        {
+        size_t lo = start+(npts*k)/nthreads,
+               hi = start+(npts*(k+1))/nthreads;
+        if (lo>=npts) { lo-=npts; hi-=npts; }
+        auto r0 = tile(lo)*tsz - ptrdiff_t(nsafe);
+        auto r1 = tile((hi-1)%npts)*tsz + tsz + ptrdiff_t(nsafe);
+        if (hi<=npts)
+          plan.pieces[k].push_back({lo, hi, r0});
+        else
+          {
+          plan.pieces[k].push_back({lo, npts, r0});
+          plan.pieces[k].push_back({0, hi-npts, r0-n0});
+          r1 += n0;
+          }
+        plan.row0[k] = r0;
+        plan.nrows[k] = size_t(r1-r0);
+        total += plan.nrows[k];
+        }
+      return total<=nover[0];
+      }
+
+    /*! Allocates the (uninitialized) private slabs described by \a plan
+        for \a ntrans simultaneous transforms. */
+    vector<vmav<complex<Tcalc>,ndim+1>> alloc_slabs(size_t ntrans,
+      const SlabPlan &plan) const
+      {
+      vector<vmav<complex<Tcalc>,ndim+1>> res;
+      array<size_t,ndim+1> shp;
+      shp[0] = ntrans;
+      for (size_t d=1; d<ndim; ++d) shp[d+1] = nover[d];
+      for (size_t k=0; k<plan.nrows.size(); ++k)
+        {
+        shp[1] = plan.nrows[k];
+        res.emplace_back(shp, UNINITIALIZED);
+        }
+      return res;
+      }
+
+    /*! Adds the private slabs \a slabs (set up according to \a plan) to
+        \a grid. The grid rows are distributed over the threads, so that no
+        locking is required. */
+    void merge_slabs(const vector<vmav<complex<Tcalc>,ndim+1>> &slabs,
+      const SlabPlan &plan, vmav<complex<Tcalc>,ndim+1> &grid) const
+      {
+      vfmav<complex<Tcalc>> fgrid(grid);
+      auto n0 = ptrdiff_t(nover[0]);
+      execParallel(nover[0], nthreads, [&](size_t lo, size_t hi)
+        {
+        for (size_t k=0; k<slabs.size(); ++k)
+          {
+          cfmav<complex<Tcalc>> fslab(slabs[k]);
+          ptrdiff_t r0 = plan.row0[k], r1 = r0+ptrdiff_t(plan.nrows[k]);
+          // unwrapped rows [s*n0; (s+1)*n0) correspond to grid rows [0; n0)
+          for (ptrdiff_t s=(r0>=0) ? r0/n0 : -((n0-1-r0)/n0); s*n0<r1; ++s)
+            {
+            auto a = max<ptrdiff_t>(max(r0, s*n0)-s*n0, ptrdiff_t(lo)),
+                 b = min<ptrdiff_t>(min(r1, (s+1)*n0)-s*n0, ptrdiff_t(hi));
+            if (a>=b) continue;
+            vector<slice> sg(ndim+1), ss(ndim+1);
+            sg[1] = slice(size_t(a), size_t(b));
+            ss[1] = slice(size_t(a+s*n0-r0), size_t(b+s*n0-r0));
+            mav_apply([](complex<Tcalc> &g, const complex<Tcalc> &v){ g+=v; },
+              1, fgrid.subarray(sg), fslab.subarray(ss));
+            }
+          }
+        });
+      }
+
     /*! Compute index of the tile into which \a in falls. */
     template<typename Tcoord> [[gnu::always_inline]] array<uint32_t,ndim> get_tile(const array<double,ndim> &in) const
       {
@@ -307,6 +742,158 @@ template<typename Tcalc, typename Tacc, size_t ndim> class Nufft_ancestor
       return res;
       }
 
+    /*! Sort key of the nonuniform points, as used by build_index():
+        func(coords, i) returns the key of point i of coords, which is
+        smaller than nkeys. key>>shift is the number of the tile containing
+        the point, which is smaller than ntiles; div consecutive tiles share
+        the same tile index along the first dimension. */
+    template<typename Tfunc> struct SortKey
+      {
+      size_t nkeys, ntiles, shift, div;
+      Tfunc func;
+      };
+    template<typename Tfunc> static SortKey<Tfunc> make_sort_key(size_t nkeys,
+      size_t ntiles, size_t shift, size_t div, Tfunc func)
+      { return SortKey<Tfunc>{nkeys, ntiles, shift, div, func}; }
+
+    /*! Computes coord_idx (the points of \a coords in the order of their
+        sort keys) and tile_start. \a coords usually holds all points of
+        the plan, but for streaming nu2u only the current chunk. */
+    template<typename Tcoord, typename Tfunc> void build_index
+      (const cmav<Tcoord,2> &coords, const SortKey<Tfunc> &skey)
+      {
+      timers.push("building index");
+      size_t npts = coords.shape(0);
+      MR_assert(npts<=(~uint32_t(0)), "too many nonuniform points");
+      MR_assert(coords.shape(1)==ndim, "ndim mismatch");
+      coord_idx.resize(npts);
+      quick_array<uint32_t> key(npts);
+      execParallel(npts, nthreads, [&](size_t lo, size_t hi)
+        {
+        for (size_t i=lo; i<hi; ++i)
+          key[i] = skey.func(coords, i);
+        });
+      count_tiles(key, skey.ntiles, skey.shift);
+      tile_div = skey.div;
+      bucket_sort2(key, coord_idx, skey.nkeys, nthreads);
+      timers.pop();
+      }
+
+    /*! Adapts coord_idx, tile_start and \a coords_sorted to the new
+        coordinates \a coords. The new coordinates are gathered in the old
+        processing order; only the points which have left their tile are
+        then taken out and reinserted at the end of their new tile. This
+        replaces the sort and the separate coordinate gather of a rebuild.
+        If too many points have changed their tile, \c false is returned;
+        coord_idx and tile_start are unchanged in this case, and
+        build_index() and sort_coords() must be called. */
+    template<typename Tcoord, typename Tfunc> bool update_index
+      (const cmav<Tcoord,2> &coords, vmav<Tcoord,2> &coords_sorted,
+      const SortKey<Tfunc> &skey)
+      {
+      timers.push("updating index");
+      struct Move { uint32_t tile, pos, oldtile; };
+      vector<vector<Move>> moved(nthreads);
+      // give up as soon as it is clear that a full rebuild is cheaper
+      size_t maxmoved = npoints/16;
+      atomic<size_t> nmoved=0;
+      execParallel(npoints, nthreads, [&](size_t tid, size_t lo, size_t hi)
+        {
+        // old tile of the point at position i
+        auto t = size_t(upper_bound(tile_start.begin(), tile_start.end(), lo)
+                        - tile_start.begin()) - 1;
+        for (size_t i=lo; i<hi; ++i)
+          {
+          constexpr size_t lookahead=16;
+          if (i+lookahead<hi)
+            DUCC0_PREFETCH_R(&coords(coord_idx[i+lookahead],0));
+          while (tile_start[t+1]<=i) ++t;
+          for (size_t d=0; d<ndim; ++d)
+            coords_sorted(i,d) = coords(coord_idx[i],d);
+          auto tnew = skey.func(coords_sorted, i)>>skey.shift;
+          if (tnew!=t)
+            {
+            moved[tid].push_back({uint32_t(tnew), uint32_t(i), uint32_t(t)});
+            if (++nmoved>maxmoved) return;
+            }
+          }
+        });
+      if (nmoved>maxmoved)
+        { timers.pop(); return false; }
+      vector<Move> mv;
+      for (const auto &m: moved)
+        mv.insert(mv.end(), m.begin(), m.end());
+
+      vector<uint32_t> pos(mv.size());
+      for (size_t j=0; j<mv.size(); ++j)
+        pos[j] = mv[j].pos;
+      sort(pos.begin(), pos.end());
+      sort(mv.begin(), mv.end(), [](const Move &a, const Move &b)
+        { return (a.tile<b.tile) || ((a.tile==b.tile) && (a.pos<b.pos)); });
+
+      // merge the points which stayed in their tiles (and are therefore still
+      // ordered correctly) with the moved ones
+      quick_array<uint32_t> idx(npoints);
+      vmav<Tcoord,2> crd({npoints, ndim}, UNINITIALIZED);
+      size_t nout=0, src=0, k=0;
+      // both coordinate arrays are C-contiguous
+      auto copy_range = [&](size_t lo, size_t hi)
+        {
+        copy(coord_idx.data()+lo, coord_idx.data()+hi, idx.data()+nout);
+        copy(coords_sorted.data()+lo*ndim, coords_sorted.data()+hi*ndim,
+             crd.data()+nout*ndim);
+        nout += hi-lo;
+        };
+      // copies the unmoved points at positions [src; hi)
+      auto copy_stayers = [&](size_t hi)
+        {
+        for (; (k<pos.size()) && (pos[k]<hi); ++k)
+          {
+          if (pos[k]>=src) copy_range(src, pos[k]);
+          src = max<size_t>(src, pos[k]+1);
+          }
+        if (src<hi) copy_range(src, hi);
+        src = max(src, hi);
+        };
+      vector<size_t> cnt(skey.ntiles);
+      for (size_t i=0; i<skey.ntiles; ++i)
+        cnt[i] = tile_start[i+1]-tile_start[i];
+      for (const auto &m: mv)
+        {
+        copy_stayers(tile_start[m.tile+1]);
+        idx[nout] = coord_idx[m.pos];
+        for (size_t d=0; d<ndim; ++d)
+          crd(nout,d) = coords_sorted(m.pos,d);
+        ++nout;
+        --cnt[m.oldtile];
+        ++cnt[m.tile];
+        }
+      copy_stayers(npoints);
+      for (size_t i=0; i<skey.ntiles; ++i)
+        tile_start[i+1] = tile_start[i]+cnt[i];
+      coord_idx = move(idx);
+      coords_sorted.assign(crd);
+      timers.pop();
+      return true;
+      }
+
+    /*! Discards the stored kernel weights (see set_kernel_cache()); they are
+        recomputed on demand. */
+    void clear_kernel_cache()
+      {
+      kcache_i0.resize(0);
+      kcache_wf.resize(0);
+      kcache_wc.resize(0);
+      }
+
+    /*! Discards all data which depend on the coordinates of the points. */
+    void coords_changed()
+      {
+      clear_kernel_cache();
+      vmav<Tcalc,ndim> empty;
+      toeplitz_kernel.assign(empty);
+      }
+
     template<typename Tcoord> void sort_coords(const cmav<Tcoord,2> &coords,
       vmav<Tcoord,2> &coords_sorted)
       {
@@ -320,32 +907,169 @@ template<typename Tcalc, typename Tacc, size_t ndim> class Nufft_ancestor
       timers.pop();
       }
 
-    template<typename Tpoints, typename Tgrid> bool prep_nu2u
-      (const cmav<complex<Tpoints>,1> &points, vmav<complex<Tgrid>,ndim> &uniform)
+    /*! Returns a view of \a arr with an additional leading axis of length 1,
+        so that single transforms can be passed to the batched code. */
+    template<typename T, size_t nd> static cmav<T,nd+1> batch_view
+      (const cmav<T,nd> &arr)
+      {
+      array<size_t,nd+1> shp;
+      array<ptrdiff_t,nd+1> str;
+      shp[0] = 1; str[0] = 0;
+      for (size_t i=0; i<nd; ++i)
+        { shp[i+1] = arr.shape(i); str[i+1] = arr.stride(i); }
+      return cmav<T,nd+1>(arr.data(), shp, str);
+      }
+    template<typename T, size_t nd> static vmav<T,nd+1> batch_view
+      (vmav<T,nd> &arr)
+      {
+      array<size_t,nd+1> shp;
+      array<ptrdiff_t,nd+1> str;
+      shp[0] = 1; str[0] = 0;
+      for (size_t i=0; i<nd; ++i)
+        { shp[i+1] = arr.shape(i); str[i+1] = arr.stride(i); }
+      return vmav<T,nd+1>(arr.data(), shp, str);
+      }
+
+    /*! Checks the dimensions of a (possibly batched) set of point values
+        and uniform grids; the first axis of both arrays runs over the
+        individual transforms. */
+    template<typename Tpoints, typename Tgrid> void check_batch_shapes
+      (const cmav<complex<Tpoints>,2> &points,
+       const cmav<complex<Tgrid>,ndim+1> &uniform) const
       {
       static_assert(sizeof(Tpoints)<=sizeof(Tcalc),
         "Tcalc must be at least as accurate as Tpoints");
       static_assert(sizeof(Tgrid)<=sizeof(Tcalc),
         "Tcalc must be at least as accurate as Tgrid");
-      MR_assert(points.shape(0)==npoints, "number of points mismatch");
-      MR_assert(uniform.shape()==nuni, "uniform grid dimensions mismatch");
+      MR_assert(points.shape(1)==npoints, "number of points mismatch");
+      MR_assert(points.shape(0)==uniform.shape(0),
+        "number of transforms mismatch");
+      for (size_t i=0; i<ndim; ++i)
+        MR_assert(uniform.shape(i+1)==nuni[i],
+          "uniform grid dimensions mismatch");
+      }
+    template<typename Tpoints, typename Tgrid> bool prep_nu2u
+      (const cmav<complex<Tpoints>,2> &points,
+       vmav<complex<Tgrid>,ndim+1> &uniform)
+      {
+      check_batch_shapes(points, uniform);
       if (npoints==0)
         {
         mav_apply([](complex<Tgrid> &v){v=complex<Tgrid>(0);}, nthreads, uniform);
         return true;
         }
-      return false;
+      return uniform.shape(0)==0;
       }
     template<typename Tpoints, typename Tgrid> bool prep_u2nu
-      (const cmav<complex<Tpoints>,1> &points, const cmav<complex<Tgrid>,ndim> &uniform)
+      (const cmav<complex<Tpoints>,2> &points,
+       const cmav<complex<Tgrid>,ndim+1> &uniform)
       {
-      static_assert(sizeof(Tpoints)<=sizeof(Tcalc),
-        "Tcalc must be at least as accurate as Tpoints");
-      static_assert(sizeof(Tgrid)<=sizeof(Tcalc),
-        "Tcalc must be at least as accurate as Tgrid");
-      MR_assert(points.shape(0)==npoints, "number of points mismatch");
-      MR_assert(uniform.shape()==nuni, "uniform grid dimensions mismatch");
-      return npoints==0;
+      check_batch_shapes(points, uniform);
+      return (npoints==0) || (uniform.shape(0)==0);
+      }
+
+    /*! Number of transforms which are spread or interpolated together.
+        They share kernel evaluation and tile bookkeeping for every point,
+        but each of them needs its own local tile buffer and oversampled
+        grid; the size of the group is limited so that the buffers of a
+        thread stay in cache and the grids fit into grid_budget().
+        For large kernel supports in 3D (e.g. double precision at high
+        accuracy), a single buffer already fills the cache, and the
+        transforms are processed one at a time; there, the work per point
+        is dominated by the supp^3 buffer updates anyway, and processing
+        pairs of transforms together was measured to be slower. */
+    size_t trans_batch(size_t ntrans, size_t elemsz) const
+      {
+      size_t tilesz = elemsz, gridsz = sizeof(complex<Tcalc>);
+      for (size_t i=0; i<ndim; ++i)
+        {
+        tilesz *= supp+(size_t(1)<<log2tile);
+        gridsz *= nover[i];
+        }
+      size_t nmax = min(tile_budget()/tilesz, grid_budget()/gridsz);
+      return max<size_t>(1, min(ntrans, nmax));
+      }
+
+    /*! Amount of memory (in bytes) which the oversampled grids of a
+        batched transform should not exceed: half of the available memory,
+        or 1GB if its size is unknown. */
+    static size_t grid_budget()
+      {
+      size_t avail = available_memory();
+      return (avail==0) ? (size_t(1)<<30) : avail/2;
+      }
+
+    /*! Amount of memory (in bytes) which the local tile buffers of a thread
+        should not exceed: half of the L2 cache, or 256kB if its size is
+        unknown. */
+    static size_t tile_budget()
+      {
+      size_t l2 = l2_cache_size();
+      return (l2==0) ? (size_t(1)<<18) : max(size_t(1)<<17, l2/2);
+      }
+
+    /*! Sets the tile size to 2^\a lt. If \a lt is 0, the tile size is
+        chosen from kernel support, point density and cache size:
+        starting from the default for the precision and dimensionality
+        (log2tile_), tiles are enlarged as long as they contain so few points
+        that loading or flushing their local buffer costs more than a
+        quarter of the kernel work for the points, and the enlarged buffer
+        for a single transform does not exceed tile_budget().
+        Tiles are never made smaller than the default, even if its buffer
+        exceeds the budget: for large supports, the buffer then mostly
+        consists of the margins of width supp, and e.g. 3D double precision
+        transforms at eps=1e-12 (supp=13) became about twice as slow with
+        tile size 4 instead of 16 (see ducc_bench --nufft-log2tile).
+        In any case, the number of tiles along every dimension must not
+        exceed max_ntile. */
+    void choose_log2tile(int lt)
+      {
+      int lmin = 1;
+      for (size_t i=0; i<ndim; ++i)
+        while ((nover[i]>>lmin)>max_ntile<ndim>) ++lmin;
+      MR_assert(lmin<=max_log2tile<ndim>, "oversampled grid too large");
+      if (lt!=0)
+        {
+        MR_assert((lt>=lmin) && (lt<=max_log2tile<ndim>),
+          "log2tile must lie in [", lmin, "; ", max_log2tile<ndim>, "]");
+        log2tile = lt;
+        return;
+        }
+      double density = double(npoints);
+      for (size_t i=0; i<ndim; ++i) density /= double(nover[i]);
+      // number of cells in the local buffer
+      auto cells = [&](int l)
+        { return pow(double(supp+(size_t(1)<<l)), double(ndim)); };
+      auto bufsize = [&](int l)
+        { return cells(l)*double(sizeof(complex<Tacc>)); };
+      auto sparse = [&](int l)
+        {
+        double work = density*pow(double(size_t(1)<<l)*double(supp),
+                                  double(ndim));
+        return 4*cells(l)>work;
+        };
+      double budget = double(tile_budget());
+      lt = log2tile_<Tacc,ndim>;
+      while ((lt<max_log2tile<ndim>) && sparse(lt) && (bufsize(lt+1)<=budget))
+        ++lt;
+      log2tile = max(lt, lmin);
+      }
+
+    /*! Allocates the oversampled grids for \a ntrans simultaneous
+        transforms. */
+    vmav<complex<Tcalc>,ndim+1> build_grids(size_t ntrans) const
+      {
+      array<size_t,ndim+1> shp;
+      shp[0] = ntrans;
+      for (size_t i=0; i<ndim; ++i) shp[i+1] = nover[i];
+      return vmav<complex<Tcalc>,ndim+1>::build_noncritical(shp, UNINITIALIZED);
+      }
+    /*! Slices selecting the transforms [t0; t1) of a batched grid. */
+    static vector<slice> trans_slices(size_t t0, size_t t1)
+      {
+      vector<slice> res(ndim+1);
+      res[0] = slice(t0, t1);
+      return res;
       }
 
    static string dim2string(const array<size_t, ndim> &arr)
@@ -356,42 +1080,129 @@ template<typename Tcalc, typename Tacc, size_t ndim> class Nufft_ancestor
       return str.str();
       }
 
-    void report(bool gridding)
+    void report(bool gridding, size_t ntrans=1)
       {
       cout << (gridding ? "Nu2u:" : "U2nu:") << endl
            << "  nthreads=" << nthreads << ", grid=(" << dim2string(nuni)
            << "), oversampled grid=(" << dim2string(nover) << "), supp="
-           << supp << ", eps=" << epsilon << endl << "  npoints=" << npoints
-           << endl << "  memory overhead: "
+           << supp << ", eps=" << epsilon << ", tile size=" << (1<<log2tile)
+           << endl << "  npoints=" << npoints;
+      if (ntrans!=1) cout << ", ntrans=" << ntrans;
+      cout << endl << "  memory overhead: "
            << npoints*sizeof(uint32_t)/double(1<<30) << "GB (index) + "
-           << accumulate(nover.begin(), nover.end(), 1, multiplies<>())*sizeof(complex<Tcalc>)/double(1<<30) << "GB (oversampled grid)" << endl;
+           << trans_batch(ntrans, sizeof(complex<Tcalc>))
+             *accumulate(nover.begin(), nover.end(), 1, multiplies<>())*sizeof(complex<Tcalc>)/double(1<<30) << "GB (oversampled grid)" << endl;
+      if (kcache_requested)
+        cout << "  kernel cache: " << kernel_cache_size()/double(1<<30)
+             << "GB" << (kernel_cached() ? "" : " (to be computed)") << endl;
+      }
+
+    /*! Calls \a func(slc_uni, slc_big) for all pairs of boxes in the uniform
+        grid and in the doubled grid used by the Toeplitz operator which hold
+        the same Fourier modes. In the doubled grid, mode k is stored at index
+        k mod (2*nuni). */
+    template<typename Func> void toeplitz_boxes(Func &&func) const
+      {
+      for (size_t mask=0; mask<(size_t(1)<<ndim); ++mask)
+        {
+        vector<slice> su(ndim), sb(ndim);
+        bool empty=false;
+        for (size_t d=0; d<ndim; ++d)
+          {
+          size_t n=nuni[d], nneg=n/2, npos=n-nneg;
+          bool neg = (mask>>d)&1;
+          su[d] = neg ? (fft_order ? slice(npos, n) : slice(0, nneg))
+                      : (fft_order ? slice(0, npos) : slice(nneg, n));
+          sb[d] = neg ? slice(2*n-nneg, 2*n) : slice(0, npos);
+          empty = empty || (su[d].beg==su[d].end);
+          }
+        if (!empty) func(su, sb);
+        }
+      }
+
+    /*! Computes the Toeplitz kernel for the operator
+        nu2u(!forward, weights*u2nu(forward, .)) from the point spread
+        function, i.e. the nu2u transform of \a weights onto a grid of twice
+        the uniform size. If \a weights is empty, unit weights are used.
+        If \a sorted is true, \a coords are the sorted coordinates of the
+        plan, and \a weights are given in the original order. */
+    template<typename Tplan, typename Tcoord, typename Tw> void make_toeplitz(
+      bool forward, const cmav<Tcoord,2> &coords, const cmav<Tw,1> &weights,
+      bool sorted)
+      {
+      MR_assert((weights.shape(0)==npoints) || (weights.shape(0)==0),
+        "number of weights mismatch");
+      timers.push("Toeplitz kernel");
+      array<size_t,ndim> shp2;
+      size_t ntot=1;
+      for (size_t d=0; d<ndim; ++d)
+        ntot *= (shp2[d] = 2*nuni[d]);
+      vmav<complex<Tcalc>,1> wgt({npoints}, UNINITIALIZED);
+      execParallel(npoints, nthreads, [&](size_t lo, size_t hi)
+        {
+        for (size_t i=lo; i<hi; ++i)
+          wgt(i) = (weights.shape(0)==0) ? Tcalc(1)
+                 : Tcalc(weights(sorted ? size_t(coord_idx[i]) : i));
+        });
+      auto psf = vmav<complex<Tcalc>,ndim>::build_noncritical(shp2, UNINITIALIZED);
+      {
+      Tplan plan(true, npoints, shp2, epsilon, nthreads, sigma_min, sigma_max,
+        1./coordfct, true);
+      plan.nu2u(!forward, 0, coords, wgt, psf);
+      }
+      // differences of modes on the uniform grid never reach +-nuni, so the
+      // corresponding entries are dropped; this makes the kernel Hermitian
+      // and its Fourier transform real.
+      vfmav<complex<Tcalc>> fpsf(psf);
+      for (size_t d=0; d<ndim; ++d)
+        {
+        vector<slice> slc(ndim);
+        slc[d] = slice(nuni[d], nuni[d]+1);
+        auto sub = fpsf.subarray(slc);
+        mav_apply([](complex<Tcalc> &v){v=complex<Tcalc>(0);}, nthreads, sub);
+        }
+      fmav_info::shape_t axes(ndim);
+      iota(axes.begin(), axes.end(), 0);
+      c2c(fpsf, fpsf, axes, true, Tcalc(1./ntot), nthreads);
+      // use the same element strides as the grids in apply_toeplitz()
+      auto shp3 = noncritical_shape(shp2, sizeof(complex<Tcalc>));
+      vmav<Tcalc,ndim> tmp(shp3, UNINITIALIZED);
+      vector<slice> slc(ndim);
+      for (size_t d=0; d<ndim; ++d) slc[d] = slice(0, shp2[d]);
+      auto kernel = tmp.template subarray<ndim>(slc);
+      toeplitz_kernel.assign(kernel);
+      mav_apply([](const complex<Tcalc> &a, Tcalc &b){b=a.real();}, nthreads,
+        psf, toeplitz_kernel);
+      timers.pop();
       }
 
   public:
+    /*! If \a kidx is given, the plan uses this kernel (e.g. as selected by
+        an earlier call of findNufftParameters()) instead of selecting one
+        via the cost model. */
     Nufft_ancestor(bool gridding, size_t npoints_,
       const array<size_t,ndim> &uniform_shape, double epsilon_,
-      size_t nthreads_, double sigma_min, double sigma_max,
-      double periodicity, bool fft_order_)
+      size_t nthreads_, double sigma_min_, double sigma_max_,
+      double periodicity, bool fft_order_, size_t kidx=~size_t(0))
       : timers(gridding ? "nu2u" : "u2nu"), epsilon(epsilon_),
         nthreads(adjust_nthreads(nthreads_)), coordfct(1./periodicity),
+        sigma_min(sigma_min_), sigma_max(sigma_max_),
         fft_order(fft_order_), npoints(npoints_), nuni(uniform_shape)
       {
-      MR_assert(npoints<=(~uint32_t(0)), "too many nonuniform points");
-
       timers.push("parameter calculation");
       vector<size_t> tdims{nuni.begin(), nuni.end()};
-      auto [kidx, dims] = findNufftParameters<Tcalc,Tacc>
-        (epsilon, sigma_min, sigma_max, tdims, npoints, gridding, nthreads);
+      if (kidx==~size_t(0))
+        kidx = get<0>(findNufftParameters<Tcalc,Tacc>
+          (epsilon, sigma_min, sigma_max, tdims, npoints, gridding, nthreads));
+      auto dims = oversampled_dims(tdims, getKernel(kidx).ofactor);
       for (size_t i=0; i<ndim; ++i)
-        {
         nover[i] = dims[i];
-        MR_assert((nover[i]>>log2tile)<=max_ntile<ndim>, "oversampled grid too large");
-        }
       timers.pop();
 
       krn = selectKernel(kidx);
       supp = krn->support();
       nsafe = (supp+1)/2;
+      choose_log2tile(0);
 
       for (size_t i=0; i<ndim; ++i)
         {
@@ -410,6 +1221,83 @@ template<typename Tcalc, typename Tacc, size_t ndim> class Nufft_ancestor
           corfac.push_back(corfac.back());
       timers.pop();
       }
+
+    /*! Returns the base-2 logarithm of the linear tile size; see
+        set_log2tile(). */
+    int get_log2tile() const
+      { return log2tile; }
+
+    /*! Returns the amount of memory (in bytes) needed for storing the grid
+        indices and kernel weights of all nonuniform points; see
+        set_kernel_cache(). */
+    size_t kernel_cache_size() const
+      {
+      size_t wsz = kernel_cache_float() ? sizeof(float) : sizeof(Tcalc);
+      return npoints*ndim*(sizeof(int)+supp*wsz);
+      }
+
+    /*! Switches storage of the kernel weights on or off. When switched on,
+        grid indices and kernel weights of all nonuniform points are computed
+        at the start of the next transform and reused by all later ones, so
+        that spreading and interpolation no longer evaluate the kernel.
+        This requires kernel_cache_size() bytes of memory and only has an
+        effect for plans whose coordinates were passed to the constructor. */
+    void set_kernel_cache(bool enable)
+      {
+      kcache_requested = enable;
+      if (!enable) clear_kernel_cache();
+      }
+
+    /*! Applies the normal operator nu2u(!forward, weights*u2nu(forward, .))
+        to \a in and stores the result in \a out, using the kernel computed
+        by prep_toeplitz(). This only requires two FFTs of twice the size of
+        the uniform grid; no spreading or interpolation is performed.
+        \a in and \a out may be identical. */
+    template<typename Tgrid> void apply_toeplitz(
+      const cmav<complex<Tgrid>,ndim> &in, vmav<complex<Tgrid>,ndim> &out)
+      {
+      static_assert(sizeof(Tgrid)<=sizeof(Tcalc),
+        "Tcalc must be at least as accurate as Tgrid");
+      MR_assert(toeplitz_kernel.size()!=0, "Toeplitz kernel is not available");
+      MR_assert(in.shape()==nuni, "uniform grid dimensions mismatch");
+      MR_assert(out.shape()==nuni, "uniform grid dimensions mismatch");
+      timers.push("Toeplitz operator");
+      auto grid = vmav<complex<Tcalc>,ndim>::build_noncritical
+        (toeplitz_kernel.shape(), UNINITIALIZED);
+      MR_assert(grid.stride()==toeplitz_kernel.stride(), "stride mismatch");
+      mav_apply([](complex<Tcalc> &v){v=complex<Tcalc>(0);},nthreads,grid);
+      vfmav<complex<Tcalc>> fgrid(grid);
+      cfmav<complex<Tgrid>> fin(in);
+      vfmav<complex<Tgrid>> fout(out);
+      toeplitz_boxes([&](const vector<slice> &su, const vector<slice> &sb)
+        {
+        auto g = fgrid.subarray(sb);
+        mav_apply([](complex<Tcalc> &v, const complex<Tgrid> &x)
+          { v=complex<Tcalc>(x); }, nthreads, g, fin.subarray(su));
+        });
+      fmav_info::shape_t axes(ndim);
+      iota(axes.begin(), axes.end(), 0);
+      vector<vector<slice>> ranges;
+      for (size_t d=0; d<ndim; ++d)
+        ranges.push_back({slice(0, (nuni[d]+1)/2),
+                          slice(2*nuni[d]-nuni[d]/2, MAXIDX)});
+      // multiplication with the kernel is done while storing the results of
+      // the last forward FFT pass
+      const Tcalc *kptr = toeplitz_kernel.data();
+      auto mult = [kptr](complex<Tcalc> &v, size_t, ptrdiff_t ofs)
+        { v *= kptr[ofs]; };
+      c2c_pruned(fgrid, fgrid, axes, ranges, {}, true, Tcalc(1), no_callback(),
+        mult, nthreads);
+      reverse(axes.begin(), axes.end());
+      c2c_pruned(fgrid, fgrid, axes, {}, ranges, false, Tcalc(1), nthreads);
+      toeplitz_boxes([&](const vector<slice> &su, const vector<slice> &sb)
+        {
+        auto o = fout.subarray(su);
+        mav_apply([](const complex<Tcalc> &v, complex<Tgrid> &x)
+          { x=complex<Tgrid>(v); }, nthreads, fgrid.subarray(sb), o);
+        });
+      timers.pop();
+      }
   };
 
 
@@ -422,63 +1310,290 @@ template<typename Tcalc, typename Tacc, typename Tcoord, size_t ndim> class Nuff
           parent::timers, parent::krn, parent::fft_order, parent::nuni, \
           parent::nover, parent::shift, parent::maxi0, parent::report, \
           parent::log2tile, parent::corfac, parent::sort_coords, \
-          parent::prep_nu2u, parent::prep_u2nu; \
+          parent::prep_nu2u, parent::prep_u2nu, parent::uni_ranges, \
+          parent::build_grids, parent::trans_batch, parent::uni_map; \
  \
     vmav<Tcoord,2> coords_sorted; \
+    /* oversampled grids of a streaming nu2u transform (see nu2u_begin()) */ \
+    vmav<complex<Tcalc>,ndim+1> stream_grid; \
  \
   public: \
     using parent::parent; /* inherit constructor */ \
     Nufft(bool gridding, const cmav<Tcoord,2> &coords, \
           const array<size_t, ndim> &uniform_shape_, double epsilon_,  \
           size_t nthreads_, double sigma_min, double sigma_max, \
-          double periodicity, bool fft_order_) \
+          double periodicity, bool fft_order_, size_t kidx=~size_t(0)) \
       : parent(gridding, coords.shape(0), uniform_shape_, epsilon_, nthreads_, \
-               sigma_min, sigma_max, periodicity, fft_order_), \
+               sigma_min, sigma_max, periodicity, fft_order_, kidx), \
         coords_sorted({npoints,ndim},UNINITIALIZED) \
       { \
       build_index(coords); \
       sort_coords(coords, coords_sorted); \
       } \
+ \
+    /* Replaces the coordinates of the non-uniform points by \a coords. */ \
+    /* If only a few points move to a different tile, the processing order */ \
+    /* is patched instead of being recomputed from scratch. Stored kernel */ \
+    /* weights are recomputed on demand; prep_toeplitz() must be called */ \
+    /* again before the next apply_toeplitz(). */ \
+    void update_coords(const cmav<Tcoord,2> &coords) \
+      { \
+      MR_assert(coords_sorted.size()!=0, "bad call"); \
+      MR_assert(coords.shape(0)==npoints, "number of points mismatch"); \
+      MR_assert(coords.shape(1)==ndim, "ndim mismatch"); \
+      if (!parent::update_index(coords, coords_sorted, sort_key())) \
+        { \
+        build_index(coords); \
+        sort_coords(coords, coords_sorted); \
+        } \
+      parent::coords_changed(); \
+      } \
+ \
+    /* Sets the linear tile size to 2^log2tile grid cells; if log2tile */ \
+    /* is 0, it is chosen automatically (this is also done by the */ \
+    /* constructor). Stored coordinates are re-sorted accordingly. */ \
+    void set_log2tile(int log2tile) \
+      { \
+      parent::choose_log2tile(log2tile); \
+      if (coords_sorted.size()==0) return; \
+      vmav<Tcoord,2> tmp(coords_sorted.shape(), UNINITIALIZED); \
+      mav_apply([](Tcoord &a, Tcoord b) { a=b; }, nthreads, tmp, \
+        coords_sorted); \
+      auto idx_old(move(coord_idx)); \
+      build_index(tmp); \
+      sort_coords(tmp, coords_sorted); \
+      execParallel(npoints, nthreads, [&](size_t lo, size_t hi) \
+        { for (size_t i=lo; i<hi; ++i) coord_idx[i] = idx_old[coord_idx[i]]; }); \
+      parent::clear_kernel_cache(); \
+      } \
  \
     template<typename Tpoints, typename Tgrid> void nu2u(bool forward, size_t verbosity, \
       const cmav<complex<Tpoints>,1> &points, vmav<complex<Tgrid>,ndim> &uniform) \
       { \
+      auto uniform2 = parent::batch_view(uniform); \
+      nu2u(forward, verbosity, parent::batch_view(points), uniform2); \
+      } \
+    template<typename Tpoints, typename Tgrid> void u2nu(bool forward, size_t verbosity, \
+      const cmav<complex<Tgrid>,ndim> &uniform, vmav<complex<Tpoints>,1> &points) \
+      { \
+      auto points2 = parent::batch_view(points); \
+      u2nu(forward, verbosity, parent::batch_view(uniform), points2); \
+      } \
+    template<typename Tpoints, typename Tgrid> void nu2u(bool forward, size_t verbosity, \
+      const cmav<Tcoord,2> &coords, const cmav<complex<Tpoints>,1> &points, \
+      vmav<complex<Tgrid>,ndim> &uniform) \
+      { \
+      auto uniform2 = parent::batch_view(uniform); \
+      nu2u(forward, verbosity, coords, parent::batch_view(points), uniform2); \
+      } \
+    template<typename Tpoints, typename Tgrid> void u2nu(bool forward, size_t verbosity, \
+      const cmav<complex<Tgrid>,ndim> &uniform, const cmav<Tcoord,2> &coords, \
+      vmav<complex<Tpoints>,1> &points) \
+      { \
+      auto points2 = parent::batch_view(points); \
+      u2nu(forward, verbosity, parent::batch_view(uniform), coords, points2); \
+      } \
+    /* Batched transforms: the first axis of points and uniform runs over */ \
+    /* ntrans independent data sets sharing the same coordinates. Kernel */ \
+    /* evaluation and tile bookkeeping are done once per point, and the */ \
+    /* FFTs of all data sets are carried out together. Groups of */ \
+    /* trans_batch() data sets are held in oversampled grids at a time. */ \
+    template<typename Tpoints, typename Tgrid> void nu2u(bool forward, size_t verbosity, \
+      const cmav<complex<Tpoints>,2> &points, vmav<complex<Tgrid>,ndim+1> &uniform) \
+      { \
       if (prep_nu2u(points, uniform)) return; \
       MR_assert(coords_sorted.size()!=0, "bad call"); \
-      if (verbosity>0) report(true); \
-      nonuni2uni(forward, coords_sorted, points, uniform); \
+      if (verbosity>0) report(true, points.shape(0)); \
+      parent::template update_kernel_cache<Tcoord>(coords_sorted); \
+      nonuni2uni_batched(forward, coords_sorted, points, uniform); \
       if (verbosity>0) timers.report(cout); \
       } \
     template<typename Tpoints, typename Tgrid> void u2nu(bool forward, size_t verbosity, \
-      const cmav<complex<Tgrid>,ndim> &uniform, vmav<complex<Tpoints>,1> &points) \
+      const cmav<complex<Tgrid>,ndim+1> &uniform, vmav<complex<Tpoints>,2> &points) \
       { \
       if (prep_u2nu(points, uniform)) return; \
       MR_assert(coords_sorted.size()!=0, "bad call"); \
-      if (verbosity>0) report(false); \
-      uni2nonuni(forward, uniform, coords_sorted, points); \
+      if (verbosity>0) report(false, points.shape(0)); \
+      parent::template update_kernel_cache<Tcoord>(coords_sorted); \
+      uni2nonuni_batched(forward, uniform, coords_sorted, points); \
       if (verbosity>0) timers.report(cout); \
       } \
     template<typename Tpoints, typename Tgrid> void nu2u(bool forward, size_t verbosity, \
-      const cmav<Tcoord,2> &coords, const cmav<complex<Tpoints>,1> &points, \
-      vmav<complex<Tgrid>,ndim> &uniform) \
+      const cmav<Tcoord,2> &coords, const cmav<complex<Tpoints>,2> &points, \
+      vmav<complex<Tgrid>,ndim+1> &uniform) \
       { \
       if (prep_nu2u(points, uniform)) return; \
       MR_assert(coords_sorted.size()==0, "bad call"); \
-      if (verbosity>0) report(true); \
+      if (verbosity>0) report(true, points.shape(0)); \
       build_index(coords); \
-      nonuni2uni(forward, coords, points, uniform); \
+      nonuni2uni_batched(forward, coords, points, uniform); \
       if (verbosity>0) timers.report(cout); \
       } \
     template<typename Tpoints, typename Tgrid> void u2nu(bool forward, size_t verbosity, \
-      const cmav<complex<Tgrid>,ndim> &uniform, const cmav<Tcoord,2> &coords, \
-      vmav<complex<Tpoints>,1> &points) \
+      const cmav<complex<Tgrid>,ndim+1> &uniform, const cmav<Tcoord,2> &coords, \
+      vmav<complex<Tpoints>,2> &points) \
       { \
       if (prep_u2nu(points, uniform)) return; \
       MR_assert(coords_sorted.size()==0, "bad call"); \
-      if (verbosity>0) report(false); \
+      if (verbosity>0) report(false, points.shape(0)); \
       build_index(coords); \
-      uni2nonuni(forward, uniform, coords, points); \
+      uni2nonuni_batched(forward, uniform, coords, points); \
       if (verbosity>0) timers.report(cout); \
+      } \
+ \
+    /* Streaming type 1 transforms (only for plans without stored */ \
+    /* coordinates): nu2u_begin() sets up oversampled grids for ntrans */ \
+    /* transforms, which stay resident until nu2u_finish(). Every call of */ \
+    /* nu2u_add() sorts and spreads one chunk of points of arbitrary size */ \
+    /* onto them, so that only a single chunk of coordinates and values */ \
+    /* has to be in memory at any time. nu2u_finish() carries out FFT and */ \
+    /* grid correction and releases the grids; its argument checks leave */ \
+    /* the transform intact, but afterwards it is over even if an error */ \
+    /* occurs. Only one streaming transform can be in progress at a time. */ \
+    /* The number of points passed to the constructor is only used for */ \
+    /* choosing kernel and oversampling factor and should be the total */ \
+    /* number of points. */ \
+    void nu2u_begin(size_t ntrans=1) \
+      { \
+      MR_assert(coords_sorted.size()==0, "bad call"); \
+      MR_assert(stream_grid.size()==0, \
+        "a streaming transform is already in progress"); \
+      MR_assert(ntrans>0, "ntrans must be positive"); \
+      timers.push("allocating grid"); \
+      auto grid = build_grids(ntrans); \
+      timers.poppush("zeroing grid"); \
+      mav_apply([](complex<Tcalc> &v){v=complex<Tcalc>(0);},nthreads,grid); \
+      timers.pop(); \
+      stream_grid.assign(grid); \
+      } \
+    template<typename Tpoints> void nu2u_add(const cmav<Tcoord,2> &coords, \
+      const cmav<complex<Tpoints>,1> &points) \
+      { nu2u_add(coords, parent::batch_view(points)); } \
+    template<typename Tpoints> void nu2u_add(const cmav<Tcoord,2> &coords, \
+      const cmav<complex<Tpoints>,2> &points) \
+      { \
+      static_assert(sizeof(Tpoints)<=sizeof(Tcalc), \
+        "Tcalc must be at least as accurate as Tpoints"); \
+      MR_assert(stream_grid.size()!=0, "no streaming transform in progress"); \
+      MR_assert(points.shape(0)==stream_grid.shape(0), \
+        "number of transforms mismatch"); \
+      MR_assert(points.shape(1)==coords.shape(0), "number of points mismatch"); \
+      if (coords.shape(0)==0) return; \
+      /* the index only covers this chunk */ \
+      parent::build_index(coords, sort_key()); \
+      timers.push("spreading"); \
+      constexpr size_t maxsupp = is_same<Tacc, float>::value ? 8 : 16; \
+      spreading_helper<maxsupp>(supp, coords, points, stream_grid); \
+      timers.pop(); \
+      } \
+    template<typename Tgrid> void nu2u_finish(bool forward, size_t verbosity, \
+      vmav<complex<Tgrid>,ndim> &uniform) \
+      { \
+      auto uniform2 = parent::batch_view(uniform); \
+      nu2u_finish(forward, verbosity, uniform2); \
+      } \
+    template<typename Tgrid> void nu2u_finish(bool forward, size_t verbosity, \
+      vmav<complex<Tgrid>,ndim+1> &uniform) \
+      { \
+      static_assert(sizeof(Tgrid)<=sizeof(Tcalc), \
+        "Tcalc must be at least as accurate as Tgrid"); \
+      MR_assert(stream_grid.size()!=0, "no streaming transform in progress"); \
+      MR_assert(uniform.shape(0)==stream_grid.shape(0), \
+        "number of transforms mismatch"); \
+      for (size_t i=0; i<ndim; ++i) \
+        MR_assert(uniform.shape(i+1)==nuni[i], \
+          "uniform grid dimensions mismatch"); \
+      if (verbosity>0) report(true, uniform.shape(0)); \
+      /* the streaming transform ends here, even if grid2uni() throws */ \
+      auto grid(stream_grid); \
+      vmav<complex<Tcalc>,ndim+1> empty; \
+      stream_grid.assign(empty); \
+      coord_idx.resize(0); \
+      grid2uni(forward, grid, uniform); \
+      if (verbosity>0) timers.report(cout); \
+      } \
+    /* Returns whether a streaming transform is in progress, i.e. */ \
+    /* nu2u_begin() has been called without a successful nu2u_finish(). */ \
+    bool nu2u_active() const \
+      { return stream_grid.size()!=0; } \
+  private: \
+    /* The transforms are processed in groups of trans_batch() data sets, */ \
+    /* which share a single pass over the points. */ \
+    template<typename Tpoints, typename Tgrid> void nonuni2uni_batched(bool forward, \
+      const cmav<Tcoord,2> &coords, const cmav<complex<Tpoints>,2> &points, \
+      vmav<complex<Tgrid>,ndim+1> &uniform) \
+      { \
+      size_t ntrans = points.shape(0); \
+      size_t nbatch = parent::trans_batch(ntrans, sizeof(complex<Tacc>)); \
+      timers.push("nu2u proper"); \
+      timers.push("allocating grid"); \
+      auto grid = build_grids(nbatch); \
+      timers.pop(); \
+      for (size_t t0=0; t0<ntrans; t0+=nbatch) \
+        { \
+        size_t t1 = min(ntrans, t0+nbatch); \
+        auto pts = subarray<2>(points, {{t0, t1}, {}}); \
+        auto uni = subarray<ndim+1>(uniform, parent::trans_slices(t0, t1)); \
+        auto grd = subarray<ndim+1>(grid, parent::trans_slices(0, t1-t0)); \
+        nonuni2uni(forward, coords, pts, uni, grd); \
+        } \
+      timers.pop(); \
+      } \
+    template<typename Tpoints, typename Tgrid> void uni2nonuni_batched(bool forward, \
+      const cmav<complex<Tgrid>,ndim+1> &uniform, const cmav<Tcoord,2> &coords, \
+      vmav<complex<Tpoints>,2> &points) \
+      { \
+      size_t ntrans = points.shape(0); \
+      size_t nbatch = parent::trans_batch(ntrans, sizeof(complex<Tcalc>)); \
+      timers.push("u2nu proper"); \
+      timers.push("allocating grid"); \
+      auto grid = build_grids(nbatch); \
+      timers.pop(); \
+      for (size_t t0=0; t0<ntrans; t0+=nbatch) \
+        { \
+        size_t t1 = min(ntrans, t0+nbatch); \
+        auto uni = subarray<ndim+1>(uniform, parent::trans_slices(t0, t1)); \
+        auto pts = subarray<2>(points, {{t0, t1}, {}}); \
+        auto grd = subarray<ndim+1>(grid, parent::trans_slices(0, t1-t0)); \
+        uni2nonuni(forward, uni, coords, pts, grd); \
+        } \
+      timers.pop(); \
+      } \
+ \
+  public: \
+    /* Prepares apply_toeplitz() for the operator */ \
+    /* nu2u(!forward, weights*u2nu(forward, .)). */ \
+    template<typename Tw> void prep_toeplitz(bool forward, size_t verbosity, \
+      const cmav<Tw,1> &weights) \
+      { \
+      MR_assert(coords_sorted.size()!=0, "bad call"); \
+      parent::template make_toeplitz<Nufft>(forward, coords_sorted, weights, \
+        true); \
+      if (verbosity>0) timers.report(cout); \
+      } \
+    template<typename Tw> void prep_toeplitz(bool forward, size_t verbosity, \
+      const cmav<Tcoord,2> &coords, const cmav<Tw,1> &weights) \
+      { \
+      MR_assert(coords_sorted.size()==0, "bad call"); \
+      MR_assert(coords.shape(0)==npoints, "number of points mismatch"); \
+      parent::template make_toeplitz<Nufft>(forward, coords, weights, \
+        false); \
+      if (verbosity>0) timers.report(cout); \
+      } \
+    /* Spreads \a points onto the oversampled grid, without FFT and grid */ \
+    /* correction (used by Nufft3). */ \
+    template<typename Tpoints> void spread(const cmav<complex<Tpoints>,1> &points, \
+      vmav<complex<Tcalc>,ndim> &grid) \
+      { \
+      MR_assert(coords_sorted.size()!=0, "bad call"); \
+      MR_assert(points.shape(0)==npoints, "number of points mismatch"); \
+      MR_assert(grid.shape()==nover, "oversampled grid dimensions mismatch"); \
+      parent::template update_kernel_cache<Tcoord>(coords_sorted); \
+      mav_apply([](complex<Tcalc> &v){v=complex<Tcalc>(0);},nthreads,grid); \
+      auto grid2 = parent::batch_view(grid); \
+      constexpr size_t maxsupp = is_same<Tacc, float>::value ? 8 : 16; \
+      spreading_helper<maxsupp>(supp, coords_sorted, parent::batch_view(points), \
+        grid2); \
       }
 
 /*! Helper class for carrying out 1D nonuniform FFTs of types 1 and 2.
@@ -510,35 +1625,41 @@ template<typename Tcalc, typename Tacc, typename Tcoord> class Nufft<Tcalc, Tacc
 
       private:
         static constexpr int nsafe = (supp+1)/2;
-        static constexpr int su = 2*nsafe+(1<<log2tile);
-        static constexpr int suvec = su+vlen-1;
+        const int log2tile, su, suvec;
         static constexpr double xsupp=2./supp;
         const Nufft *parent;
         TemplateKernel<supp, mysimd<Tacc>> tkrn;
-        vmav<complex<Tcalc>,ndim> &grid;
+        vmav<complex<Tcalc>,ndim+1> &grid;
         array<int,ndim> i0; // start index of the current nonuniform point
         array<int,ndim> b0; // start index of the current buffer
 
-        vmav<Tacc,ndim> bufr, bufi;
+        vmav<Tacc,ndim+1> bufr, bufi;
         Tacc *px0r, *px0i;
-        mutex &mylock;
+        // if nullptr, grid is private to this helper (see constructor)
+        mutex *mylock;
+        // (unwrapped) index in the oversampled grid of the first row of grid
+        int uofs;
 
-        // add the acumulated local tile to the global oversampled grid
+        // add the acumulated local tiles to the global oversampled grids
         DUCC0_NOINLINE void dump()
           {
           if (b0[0]<-nsafe) return; // nothing written into buffer yet
-          int inu = int(parent->nover[0]);
+          int inu = int(grid.shape(1));
           {
-          lock_guard<mutex> lock(mylock);
-          for (int iu=0, idxu=(b0[0]+inu)%inu; iu<su; ++iu, idxu=(idxu+1<inu)?(idxu+1):0)
-            {
-            grid(idxu) += complex<Tcalc>(Tcalc(bufr(iu)), Tcalc(bufi(iu)));
-            bufr(iu) = bufi(iu) = 0;
-            }
+          auto lock = mylock ? unique_lock<mutex>(*mylock) : unique_lock<mutex>();
+          for (size_t t=0; t<ntrans; ++t)
+            for (int iu=0, idxu=(b0[0]-uofs+inu)%inu; iu<su; ++iu, idxu=(idxu+1<inu)?(idxu+1):0)
+              {
+              grid(t,idxu) += complex<Tcalc>(Tcalc(bufr(t,iu)), Tcalc(bufi(t,iu)));
+              bufr(t,iu) = bufi(t,iu) = 0;
+              }
           }
           }
 
       public:
+        // number of simultaneous transforms, and distance between their
+        // local buffers
+        const size_t ntrans, tstride;
         Tacc * DUCC0_RESTRICT p0r, * DUCC0_RESTRICT p0i;
         union kbuf {
           Tacc scalar[nvec*vlen];
@@ -549,14 +1670,31 @@ template<typename Tcalc, typename Tacc, typename Tcoord> class Nufft<Tcalc, Tacc
           };
         kbuf buf;
 
-        HelperNu2u(const Nufft *parent_, vmav<complex<Tcalc>,ndim> &grid_,
-          mutex &mylock_)
-          : parent(parent_), tkrn(*parent->krn), grid(grid_),
+        // If mylock_ is nullptr, grid_ is private to this helper and holds
+        // a range of rows of the oversampled grid (see set_row_offset()),
+        // so that no locking is required. Otherwise grid_ is the full
+        // oversampled grid.
+        HelperNu2u(const Nufft *parent_, vmav<complex<Tcalc>,ndim+1> &grid_,
+          mutex *mylock_)
+          : log2tile(parent_->log2tile), su(2*nsafe+(1<<log2tile)),
+            suvec(su+int(vlen)-1), parent(parent_), tkrn(*parent->krn), grid(grid_),
             i0{-1000000}, b0{-1000000},
-            bufr({size_t(suvec)}), bufi({size_t(suvec)}),
-            px0r(bufr.data()), px0i(bufi.data()), mylock(mylock_) {}
+            bufr({grid.shape(0),size_t(suvec)}),
+            bufi({grid.shape(0),size_t(suvec)}),
+            px0r(bufr.data()), px0i(bufi.data()), mylock(mylock_), uofs(0),
+            ntrans(grid.shape(0)), tstride(size_t(bufr.stride(0))) {}
         ~HelperNu2u() { dump(); }
 
+        // Flushes the local buffer and sets the (unwrapped) index in the
+        // oversampled grid of the first row of grid.
+        void set_row_offset(int uofs_)
+          {
+          dump();
+          i0.fill(-1000000);
+          b0.fill(-1000000);
+          uofs = uofs_;
+          }
+
         [[gnu::always_inline]] [[gnu::hot]] void prep(array<double,ndim> in)
           {
           array<double,ndim> frac;
@@ -564,6 +1702,18 @@ template<typename Tcalc, typename Tacc, typename Tcoord> class Nufft<Tcalc, Tacc
           parent->template getpix<Tcoord>(in, frac, i0);
           auto x0 = -frac[0]*2+(supp-1);
           tkrn.eval1(Tacc(x0), &buf.simd[0]);
+          update_buffer(i0old);
+          }
+        [[gnu::always_inline]] [[gnu::hot]] void prep_cached(size_t ix)
+          {
+          auto i0old = i0;
+          parent->template get_cached_kernel<supp>(ix, i0, buf.scalar, nvec*vlen);
+          update_buffer(i0old);
+          }
+
+      private:
+        [[gnu::always_inline]] void update_buffer(const array<int,ndim> &i0old)
+          {
           if (i0==i0old) return;
           if ((i0[0]<b0[0]) || (i0[0]+int(supp)>b0[0]+su))
             {
@@ -584,28 +1734,31 @@ template<typename Tcalc, typename Tacc, typename Tcoord> class Nufft<Tcalc, Tacc
 
       private:
         static constexpr int nsafe = (supp+1)/2;
-        static constexpr int su = 2*nsafe+(1<<log2tile);
-        static constexpr int suvec = su+vlen-1;
+        const int log2tile, su, suvec;
         static constexpr double xsupp=2./supp;
         const Nufft *parent;
 
         TemplateKernel<supp, mysimd<Tcalc>> tkrn;
-        const cmav<complex<Tcalc>,ndim> &grid;
+        const cmav<complex<Tcalc>,ndim+1> &grid;
         array<int,ndim> i0; // start index of the current nonuniform point
         array<int,ndim> b0; // start index of the current buffer
 
-        vmav<Tcalc,ndim> bufr, bufi;
+        vmav<Tcalc,ndim+1> bufr, bufi;
         const Tcalc *px0r, *px0i;
 
-        // load a tile from the global oversampled grid into local buffer
+        // load a tile from the global oversampled grids into local buffers
         DUCC0_NOINLINE void load()
           {
           int inu = int(parent->nover[0]);
-          for (int iu=0, idxu=(b0[0]+inu)%inu; iu<su; ++iu, idxu=(idxu+1<inu)?(idxu+1):0)
-            { bufr(iu) = grid(idxu).real(); bufi(iu) = grid(idxu).imag(); }
+          for (size_t t=0; t<ntrans; ++t)
+            for (int iu=0, idxu=(b0[0]+inu)%inu; iu<su; ++iu, idxu=(idxu+1<inu)?(idxu+1):0)
+              { bufr(t,iu) = grid(t,idxu).real(); bufi(t,iu) = grid(t,idxu).imag(); }
           }
 
       public:
+        // number of simultaneous transforms, and distance between their
+        // local buffers
+        const size_t ntrans, tstride;
         const Tcalc * DUCC0_RESTRICT p0r, * DUCC0_RESTRICT p0i;
         union kbuf {
           Tcalc scalar[nvec*vlen];
@@ -616,11 +1769,14 @@ template<typename Tcalc, typename Tacc, typename Tcoord> class Nufft<Tcalc, Tacc
           };
         kbuf buf;
 
-        HelperU2nu(const Nufft *parent_, const cmav<complex<Tcalc>,ndim> &grid_)
-          : parent(parent_), tkrn(*parent->krn), grid(grid_),
-            i0{-1000000}, b0{-1000000},
-            bufr({size_t(suvec)}), bufi({size_t(suvec)}),
-            px0r(bufr.data()), px0i(bufi.data()) {}
+        HelperU2nu(const Nufft *parent_, const cmav<complex<Tcalc>,ndim+1> &grid_)
+          : log2tile(parent_->log2tile), su(2*nsafe+(1<<log2tile)),
+            suvec(su+int(vlen)-1), parent(parent_), tkrn(*parent->krn),
+            grid(grid_), i0{-1000000}, b0{-1000000},
+            bufr({grid.shape(0),size_t(suvec)}),
+            bufi({grid.shape(0),size_t(suvec)}),
+            px0r(bufr.data()), px0i(bufi.data()),
+            ntrans(grid.shape(0)), tstride(size_t(bufr.stride(0))) {}
 
         [[gnu::always_inline]] [[gnu::hot]] void prep(array<double,ndim> in)
           {
@@ -629,6 +1785,18 @@ template<typename Tcalc, typename Tacc, typename Tcoord> class Nufft<Tcalc, Tacc
           parent->template getpix<Tcoord>(in, frac, i0);
           auto x0 = -frac[0]*2+(supp-1);
           tkrn.eval1(Tcalc(x0), &buf.simd[0]);
+          update_buffer(i0old);
+          }
+        [[gnu::always_inline]] [[gnu::hot]] void prep_cached(size_t ix)
+          {
+          auto i0old = i0;
+          parent->template get_cached_kernel<supp>(ix, i0, buf.scalar, nvec*vlen);
+          update_buffer(i0old);
+          }
+
+      private:
+        [[gnu::always_inline]] void update_buffer(const array<int,ndim> &i0old)
+          {
           if (i0==i0old) return;
           if ((i0[0]<b0[0]) || (i0[0]+int(supp)>b0[0]+su))
             {
@@ -643,8 +1811,8 @@ template<typename Tcalc, typename Tacc, typename Tcoord> class Nufft<Tcalc, Tacc
 
     template<size_t SUPP, typename Tpoints> [[gnu::hot]] void spreading_helper
       (size_t supp, const cmav<Tcoord,2> &coords,
-      const cmav<complex<Tpoints>,1> &points,
-      vmav<complex<Tcalc>,ndim> &grid) const
+      const cmav<complex<Tpoints>,2> &points,
+      vmav<complex<Tcalc>,ndim+1> &grid) const
       {
       if constexpr (SUPP>=8)
         if (supp<=SUPP/2) return spreading_helper<SUPP/2>(supp, coords, points, grid);
@@ -652,48 +1820,81 @@ template<typename Tcalc, typename Tacc, typename Tcoord> class Nufft<Tcalc, Tacc
         if (supp<SUPP) return spreading_helper<SUPP-1>(supp, coords, points, grid);
       MR_assert(supp==SUPP, "requested support out of range");
       bool sorted = coords_sorted.size()!=0;
+      bool cached = sorted && parent::kernel_cached();
+      // number of points to process (the chunk size for streaming nu2u)
+      const size_t npts = points.shape(1);
 
-      mutex mylock;
-
-      size_t chunksz = max<size_t>(1000, npoints/(10*nthreads));
-      execDynamic(npoints, nthreads, chunksz, [&](Scheduler &sched)
+      // spreads the points with processing indices [lo; hi) via hlp
+      auto spread = [&](HelperNu2u<SUPP> &hlp, size_t lo, size_t hi)
         {
-        HelperNu2u<SUPP> hlp(this, grid, mylock);
         const auto * DUCC0_RESTRICT ku = hlp.buf.simd;
 
         constexpr size_t lookahead=10;
-        while (auto rng=sched.getNext()) for(auto ix=rng.lo; ix<rng.hi; ++ix)
+        for (auto ix=lo; ix<hi; ++ix)
           {
-          if (ix+lookahead<npoints)
+          if (ix+lookahead<npts)
             {
             auto nextidx = coord_idx[ix+lookahead];
-            DUCC0_PREFETCH_R(&points(nextidx));
+            for (size_t t=0; t<hlp.ntrans; ++t)
+              DUCC0_PREFETCH_R(&points(t,nextidx));
             if (!sorted)
               DUCC0_PREFETCH_R(&coords(nextidx,0));
             }
           size_t row = coord_idx[ix];
-          sorted ? hlp.prep({coords(ix,0)}) : hlp.prep({coords(row,0)});
-          auto v(points(row));
+          if (cached) hlp.prep_cached(ix);
+          else sorted ? hlp.prep({coords(ix,0)}) : hlp.prep({coords(row,0)});
 
-          Tacc vr(v.real()), vi(v.imag());
-          for (size_t cu=0; cu<hlp.nvec; ++cu)
+          for (size_t t=0; t<hlp.ntrans; ++t)
             {
-            auto * DUCC0_RESTRICT pxr = hlp.p0r+cu*hlp.vlen;
-            auto * DUCC0_RESTRICT pxi = hlp.p0i+cu*hlp.vlen;
-            auto tr = mysimd<Tacc>(pxr,element_aligned_tag());
-            tr += vr*ku[cu];
-            tr.copy_to(pxr,element_aligned_tag());
-            auto ti = mysimd<Tacc>(pxi, element_aligned_tag());
-            ti += vi*ku[cu];
-            ti.copy_to(pxi,element_aligned_tag());
+            auto v(points(t,row));
+
+            Tacc vr(v.real()), vi(v.imag());
+            for (size_t cu=0; cu<hlp.nvec; ++cu)
+              {
+              auto * DUCC0_RESTRICT pxr = hlp.p0r+t*hlp.tstride+cu*hlp.vlen;
+              auto * DUCC0_RESTRICT pxi = hlp.p0i+t*hlp.tstride+cu*hlp.vlen;
+              auto tr = mysimd<Tacc>(pxr,element_aligned_tag());
+              tr += vr*ku[cu];
+              tr.copy_to(pxr,element_aligned_tag());
+              auto ti = mysimd<Tacc>(pxi, element_aligned_tag());
+              ti += vi*ku[cu];
+              ti.copy_to(pxi,element_aligned_tag());
+              }
             }
           }
+        };
+
+      typename parent::SlabPlan slabs;
+      if (parent::plan_slabs(slabs))
+        {
+        auto priv = parent::alloc_slabs(grid.shape(0), slabs);
+        execParallel(nthreads, [&](Scheduler &sched)
+          {
+          auto k = sched.thread_num();
+          mav_apply([](complex<Tcalc> &v){v=complex<Tcalc>(0);}, 1, priv[k]);
+          HelperNu2u<SUPP> hlp(this, priv[k], nullptr);
+          for (const auto &pc: slabs.pieces[k])
+            {
+            hlp.set_row_offset(int(pc.ofs));
+            spread(hlp, pc.lo, pc.hi);
+            }
+          });
+        parent::merge_slabs(priv, slabs, grid);
+        return;
+        }
+
+      mutex mylock;
+      size_t chunksz = max<size_t>(1000, npts/(10*nthreads));
+      execDynamic(npts, nthreads, chunksz, [&](Scheduler &sched)
+        {
+        HelperNu2u<SUPP> hlp(this, grid, &mylock);
+        while (auto rng=sched.getNext()) spread(hlp, rng.lo, rng.hi);
         });
       }
 
     template<size_t SUPP, typename Tpoints> [[gnu::hot]] void interpolation_helper
-      (size_t supp, const cmav<complex<Tcalc>,ndim> &grid,
-      const cmav<Tcoord,2> &coords, vmav<complex<Tpoints>,1> &points) const
+      (size_t supp, const cmav<complex<Tcalc>,ndim+1> &grid,
+      const cmav<Tcoord,2> &coords, vmav<complex<Tpoints>,2> &points) const
       {
       if constexpr (SUPP>=8)
         if (supp<=SUPP/2) return interpolation_helper<SUPP/2>(supp, grid, coords, points);
@@ -701,6 +1902,7 @@ template<typename Tcalc, typename Tacc, typename Tcoord> class Nufft<Tcalc, Tacc
         if (supp<SUPP) return interpolation_helper<SUPP-1>(supp, grid, coords, points);
       MR_assert(supp==SUPP, "requested support out of range");
       bool sorted = coords_sorted.size()!=0;
+      bool cached = sorted && parent::kernel_cached();
 
       size_t chunksz = max<size_t>(1000, npoints/(10*nthreads));
       execDynamic(npoints, nthreads, chunksz, [&](Scheduler &sched)
@@ -714,61 +1916,71 @@ template<typename Tcalc, typename Tacc, typename Tcoord> class Nufft<Tcalc, Tacc
           if (ix+lookahead<npoints)
             {
             auto nextidx = coord_idx[ix+lookahead];
-            DUCC0_PREFETCH_W(&points(nextidx));
+            for (size_t t=0; t<hlp.ntrans; ++t)
+              DUCC0_PREFETCH_W(&points(t,nextidx));
             if (!sorted) DUCC0_PREFETCH_R(&coords(nextidx,0));
             }
           size_t row = coord_idx[ix];
-          sorted ? hlp.prep({coords(ix,0)})
-                 : hlp.prep({coords(row,0)});
-          mysimd<Tcalc> rr=0, ri=0;
-          for (size_t cu=0; cu<hlp.nvec; ++cu)
+          if (cached) hlp.prep_cached(ix);
+          else sorted ? hlp.prep({coords(ix,0)})
+                      : hlp.prep({coords(row,0)});
+          for (size_t t=0; t<hlp.ntrans; ++t)
             {
-            const auto * DUCC0_RESTRICT pxr = hlp.p0r + cu*hlp.vlen;
-            const auto * DUCC0_RESTRICT pxi = hlp.p0i + cu*hlp.vlen;
-            rr += ku[cu]*mysimd<Tcalc>(pxr,element_aligned_tag());
-            ri += ku[cu]*mysimd<Tcalc>(pxi,element_aligned_tag());
+            mysimd<Tcalc> rr=0, ri=0;
+            for (size_t cu=0; cu<hlp.nvec; ++cu)
+              {
+              const auto * DUCC0_RESTRICT pxr = hlp.p0r + t*hlp.tstride + cu*hlp.vlen;
+              const auto * DUCC0_RESTRICT pxi = hlp.p0i + t*hlp.tstride + cu*hlp.vlen;
+              rr += ku[cu]*mysimd<Tcalc>(pxr,element_aligned_tag());
+              ri += ku[cu]*mysimd<Tcalc>(pxi,element_aligned_tag());
+              }
+            points(t,row) = hsum_cmplx<Tcalc>(rr,ri);
             }
-          points(row) = hsum_cmplx<Tcalc>(rr,ri);
           }
         });
       }
 
     template<typename Tpoints, typename Tgrid> void nonuni2uni(bool forward,
-      const cmav<Tcoord,2> &coords, const cmav<complex<Tpoints>,1> &points,
-      vmav<complex<Tgrid>,ndim> &uniform)
+      const cmav<Tcoord,2> &coords, const cmav<complex<Tpoints>,2> &points,
+      vmav<complex<Tgrid>,ndim+1> &uniform, vmav<complex<Tcalc>,ndim+1> &grid)
       {
-      timers.push("nu2u proper");
-      timers.push("allocating grid");
-      auto grid = vmav<complex<Tcalc>,ndim>::build_noncritical(nover, UNINITIALIZED);
-      timers.poppush("zeroing grid");
+      timers.push("zeroing grid");
       mav_apply([](complex<Tcalc> &v){v=complex<Tcalc>(0);},nthreads,grid);
       timers.poppush("spreading");
       constexpr size_t maxsupp = is_same<Tacc, float>::value ? 8 : 16;
       spreading_helper<maxsupp>(supp, coords, points, grid);
-      timers.poppush("FFT");
+      timers.pop();
+      grid2uni(forward, grid, uniform);
+      }
+
+    // FFT and grid correction of the oversampled grid(s); the contents of
+    // grid are destroyed
+    template<typename Tgrid> void grid2uni(bool forward,
+      vmav<complex<Tcalc>,ndim+1> &grid, vmav<complex<Tgrid>,ndim+1> &uniform)
+      {
+      size_t ntrans = grid.shape(0);
+      timers.push("FFT");
       vfmav<complex<Tcalc>> fgrid(grid);
-      c2c(fgrid, fgrid, {0}, forward, Tcalc(1), nthreads);
+      c2c(fgrid, fgrid, {1}, forward, Tcalc(1), nthreads);
       timers.poppush("grid correction");
       execParallel(nuni[0], nthreads, [&](size_t lo, size_t hi)
         {
         for (auto i=lo; i<hi; ++i)
           {
           auto [icfu, iout, iin] = comp_indices(i, nuni[0], nover[0], fft_order);
-          uniform(iout) = complex<Tgrid>(grid(iin)*Tcalc(corfac[0][icfu]));
+          for (size_t t=0; t<ntrans; ++t)
+            uniform(t,iout) = complex<Tgrid>(grid(t,iin)*Tcalc(corfac[0][icfu]));
           }
         });
       timers.pop();
-      timers.pop();
       }
 
     template<typename Tpoints, typename Tgrid> void uni2nonuni(bool forward,
-      const cmav<complex<Tgrid>,ndim> &uniform, const cmav<Tcoord,2> &coords,
-      vmav<complex<Tpoints>,1> &points)
+      const cmav<complex<Tgrid>,ndim+1> &uniform, const cmav<Tcoord,2> &coords,
+      vmav<complex<Tpoints>,2> &points, vmav<complex<Tcalc>,ndim+1> &grid)
       {
-      timers.push("u2nu proper");
-      timers.push("allocating grid");
-      auto grid = vmav<complex<Tcalc>,ndim>::build_noncritical(nover, UNINITIALIZED);
-      timers.poppush("zeroing grid");
+      size_t ntrans = points.shape(0);
+      timers.push("zeroing grid");
       mav_apply([](complex<Tcalc> &v){v=complex<Tcalc>(0);},nthreads,grid);
       timers.poppush("grid correction");
       execParallel(nuni[0], nthreads, [&](size_t lo, size_t hi)
@@ -776,34 +1988,31 @@ template<typename Tcalc, typename Tacc, typename Tcoord> class Nufft<Tcalc, Tacc
         for (auto i=lo; i<hi; ++i)
           {
           auto [icfu, iin, iout] = comp_indices(i, nuni[0], nover[0], fft_order);
-          grid(iout) = complex<Tcalc>(uniform(iin))*Tcalc(corfac[0][icfu]);
+          for (size_t t=0; t<ntrans; ++t)
+            grid(t,iout) = complex<Tcalc>(uniform(t,iin))*Tcalc(corfac[0][icfu]);
           }
         });
       timers.poppush("FFT");
       vfmav<complex<Tcalc>> fgrid(grid);
-      c2c(fgrid, fgrid, {0}, forward, Tcalc(1), nthreads);
+      c2c(fgrid, fgrid, {1}, forward, Tcalc(1), nthreads);
       timers.poppush("interpolation");
       constexpr size_t maxsupp = is_same<Tcalc, float>::value ? 8 : 16;
       interpolation_helper<maxsupp>(supp, grid, coords, points);
       timers.pop();
-      timers.pop();
+      }
+
+    auto sort_key() const
+      {
+      size_t ntiles_u = (nover[0]>>log2tile) + 3;
+      return parent::make_sort_key(ntiles_u, ntiles_u, 0, 1,
+        [this](const cmav<Tcoord,2> &coords, size_t i)
+        { return parent::template get_tile<Tcoord>({coords(i,0)})[0]; });
       }
 
     void build_index(const cmav<Tcoord,2> &coords)
       {
-      timers.push("building index");
       MR_assert(coords.shape(0)==npoints, "number of coords mismatch");
-      MR_assert(coords.shape(1)==ndim, "ndim mismatch");
-      size_t ntiles_u = (nover[0]>>log2tile) + 3;
-      coord_idx.resize(npoints);
-      quick_array<uint32_t> key(npoints);
-      execParallel(npoints, nthreads, [&](size_t lo, size_t hi)
-        {
-        for (size_t i=lo; i<hi; ++i)
-          key[i] = parent::template get_tile<Tcoord>({coords(i,0)})[0];
-        });
-      bucket_sort2(key, coord_idx, ntiles_u, nthreads);
-      timers.pop();
+      parent::build_index(coords, sort_key());
       }
   };
 
@@ -822,37 +2031,44 @@ template<typename Tcalc, typename Tacc, typename Tcoord> class Nufft<Tcalc, Tacc
 
       private:
         static constexpr int nsafe = (supp+1)/2;
-        static constexpr int su = supp+(1<<log2tile), sv = su;
+        const int log2tile, su, sv;
         static constexpr double xsupp=2./supp;
         const Nufft *parent;
         TemplateKernel<supp, mysimd<Tacc>> tkrn;
-        vmav<complex<Tcalc>,ndim> &grid;
+        vmav<complex<Tcalc>,ndim+1> &grid;
         array<int,ndim> i0; // start index of the current nonuniform point
         array<int,ndim> b0; // start index of the current buffer
 
-        vmav<complex<Tacc>,ndim> gbuf;
+        vmav<complex<Tacc>,ndim+1> gbuf;
         complex<Tacc> *px0;
-        vector<mutex> &locks;
+        // if nullptr, grid is private to this helper (see constructor)
+        vector<mutex> *locks;
+        // (unwrapped) index in the oversampled grid of the first row of grid
+        int uofs;
 
         DUCC0_NOINLINE void dump()
           {
           if (b0[0]<-nsafe) return; // nothing written into buffer yet
-          int inu = int(parent->nover[0]);
+          int inu = int(grid.shape(1));
           int inv = int(parent->nover[1]);
 
           int idxv0 = (b0[1]+inv)%inv;
-          for (int iu=0, idxu=(b0[0]+inu)%inu; iu<su; ++iu, idxu=(idxu+1<inu)?(idxu+1):0)
+          for (int iu=0, idxu=(b0[0]-uofs+inu)%inu; iu<su; ++iu, idxu=(idxu+1<inu)?(idxu+1):0)
             {
-            lock_guard<mutex> lock(locks[idxu]);
-            for (int iv=0, idxv=idxv0; iv<sv; ++iv, idxv=(idxv+1<inv)?(idxv+1):0)
-              {
-              grid(idxu,idxv) += complex<Tcalc>(gbuf(iu,iv));
-              gbuf(iu,iv) = 0;
-              }
+            auto lock = locks ? unique_lock<mutex>((*locks)[idxu]) : unique_lock<mutex>();
+            for (size_t t=0; t<ntrans; ++t)
+              for (int iv=0, idxv=idxv0; iv<sv; ++iv, idxv=(idxv+1<inv)?(idxv+1):0)
+                {
+                grid(t,idxu,idxv) += complex<Tcalc>(gbuf(t,iu,iv));
+                gbuf(t,iu,iv) = 0;
+                }
             }
           }
 
       public:
+        // number of simultaneous transforms, and distance between their
+        // local buffers
+        const size_t ntrans, tstride;
         complex<Tacc> * DUCC0_RESTRICT p0;
         union kbuf {
           Tacc scalar[2*nvec*vlen];
@@ -863,15 +2079,31 @@ template<typename Tcalc, typename Tacc, typename Tcoord> class Nufft<Tcalc, Tacc
           };
         kbuf buf;
 
-        HelperNu2u(const Nufft *parent_, vmav<complex<Tcalc>,ndim> &grid_,
-          vector<mutex> &locks_)
-          : parent(parent_), tkrn(*parent->krn), grid(grid_),
+        // If locks_ is nullptr, grid_ is private to this helper and holds
+        // a range of rows of the oversampled grid (see set_row_offset()),
+        // so that no locking is required. Otherwise grid_ is the full
+        // oversampled grid.
+        HelperNu2u(const Nufft *parent_, vmav<complex<Tcalc>,ndim+1> &grid_,
+          vector<mutex> *locks_)
+          : log2tile(parent_->log2tile), su(int(supp)+(1<<log2tile)), sv(su),
+            parent(parent_), tkrn(*parent->krn), grid(grid_),
             i0{-1000000, -1000000}, b0{-1000000, -1000000},
-            gbuf({size_t(su+1),size_t(sv)}),
-            px0(gbuf.data()), locks(locks_) {}
+            gbuf({grid.shape(0),size_t(su+1),size_t(sv)}),
+            px0(gbuf.data()), locks(locks_), uofs(0),
+            ntrans(grid.shape(0)), tstride(size_t(gbuf.stride(0))) {}
         ~HelperNu2u() { dump(); }
 
-        constexpr int lineJump() const { return sv; }
+        // Flushes the local buffer and sets the (unwrapped) index in the
+        // oversampled grid of the first row of grid.
+        void set_row_offset(int uofs_)
+          {
+          dump();
+          i0.fill(-1000000);
+          b0.fill(-1000000);
+          uofs = uofs_;
+          }
+
+        int lineJump() const { return sv; }
 
         [[gnu::always_inline]] [[gnu::hot]] void prep(array<double,ndim> in)
           {
@@ -881,6 +2113,18 @@ template<typename Tcalc, typename Tacc, typename Tcoord> class Nufft<Tcalc, Tacc
           auto x0 = -frac[0]*2+(supp-1);
           auto y0 = -frac[1]*2+(supp-1);
           tkrn.eval2(Tacc(x0), Tacc(y0), &buf.simd[0]);
+          update_buffer(i0old);
+          }
+        [[gnu::always_inline]] [[gnu::hot]] void prep_cached(size_t ix)
+          {
+          auto i0old = i0;
+          parent->template get_cached_kernel<supp>(ix, i0, buf.scalar, nvec*vlen);
+          update_buffer(i0old);
+          }
+
+      private:
+        [[gnu::always_inline]] void update_buffer(const array<int,ndim> &i0old)
+          {
           if (i0==i0old) return;
           if ((i0[0]<b0[0]) || (i0[1]<b0[1]) || (i0[0]+int(supp)>b0[0]+su) || (i0[1]+int(supp)>b0[1]+sv))
             {
@@ -900,17 +2144,16 @@ template<typename Tcalc, typename Tacc, typename Tcoord> class Nufft<Tcalc, Tacc
 
       private:
         static constexpr int nsafe = (supp+1)/2;
-        static constexpr int su = supp+(1<<log2tile), sv = su;
-        static constexpr int svvec = max<size_t>(sv, ((supp+2*vlen-2)/vlen)*vlen);
+        const int log2tile, su, sv, svvec;
         static constexpr double xsupp=2./supp;
         const Nufft *parent;
 
         TemplateKernel<supp, mysimd<Tcalc>> tkrn;
-        const cmav<complex<Tcalc>,ndim> &grid;
+        const cmav<complex<Tcalc>,ndim+1> &grid;
         array<int,ndim> i0; // start index of the current nonuniform point
         array<int,ndim> b0; // start index of the current buffer
 
-        vmav<Tcalc,ndim> bufri;
+        vmav<Tcalc,ndim+1> bufri;
         const Tcalc *px0r, *px0i;
 
         DUCC0_NOINLINE void load()
@@ -918,15 +2161,19 @@ template<typename Tcalc, typename Tacc, typename Tcoord> class Nufft<Tcalc, Tacc
           int inu = int(parent->nover[0]);
           int inv = int(parent->nover[1]);
           int idxv0 = (b0[1]+inv)%inv;
-          for (int iu=0, idxu=(b0[0]+inu)%inu; iu<su; ++iu, idxu=(idxu+1<inu)?(idxu+1):0)
-            for (int iv=0, idxv=idxv0; iv<sv; ++iv, idxv=(idxv+1<inv)?(idxv+1):0)
-              {
-              bufri(2*iu  ,iv) = grid(idxu, idxv).real();
-              bufri(2*iu+1,iv) = grid(idxu, idxv).imag();
-              }
+          for (size_t t=0; t<ntrans; ++t)
+            for (int iu=0, idxu=(b0[0]+inu)%inu; iu<su; ++iu, idxu=(idxu+1<inu)?(idxu+1):0)
+              for (int iv=0, idxv=idxv0; iv<sv; ++iv, idxv=(idxv+1<inv)?(idxv+1):0)
+                {
+                bufri(t,2*iu  ,iv) = grid(t, idxu, idxv).real();
+                bufri(t,2*iu+1,iv) = grid(t, idxu, idxv).imag();
+                }
           }
 
       public:
+        // number of simultaneous transforms, and distance between their
+        // local buffers
+        const size_t ntrans, tstride;
         const Tcalc * DUCC0_RESTRICT p0r, * DUCC0_RESTRICT p0i;
         union kbuf {
           Tcalc scalar[2*nvec*vlen];
@@ -937,13 +2184,16 @@ template<typename Tcalc, typename Tacc, typename Tcoord> class Nufft<Tcalc, Tacc
           };
         kbuf buf;
 
-        HelperU2nu(const Nufft *parent_, const cmav<complex<Tcalc>,ndim> &grid_)
-          : parent(parent_), tkrn(*parent->krn), grid(grid_),
+        HelperU2nu(const Nufft *parent_, const cmav<complex<Tcalc>,ndim+1> &grid_)
+          : log2tile(parent_->log2tile), su(int(supp)+(1<<log2tile)), sv(su),
+            svvec(max<int>(sv, int(((supp+2*vlen-2)/vlen)*vlen))),
+            parent(parent_), tkrn(*parent->krn), grid(grid_),
             i0{-1000000, -1000000}, b0{-1000000, -1000000},
-            bufri({size_t(2*su+1),size_t(svvec)}),
-            px0r(bufri.data()), px0i(bufri.data()+svvec) {}
+            bufri({grid.shape(0),size_t(2*su+1),size_t(svvec)}),
+            px0r(bufri.data()), px0i(bufri.data()+svvec),
+            ntrans(grid.shape(0)), tstride(size_t(bufri.stride(0))) {}
 
-        constexpr int lineJump() const { return 2*svvec; }
+        int lineJump() const { return 2*svvec; }
 
         [[gnu::always_inline]] [[gnu::hot]] void prep(array<double,ndim> in)
           {
@@ -953,6 +2203,18 @@ template<typename Tcalc, typename Tacc, typename Tcoord> class Nufft<Tcalc, Tacc
           auto x0 = -frac[0]*2+(supp-1);
           auto y0 = -frac[1]*2+(supp-1);
           tkrn.eval2(Tcalc(x0), Tcalc(y0), &buf.simd[0]);
+          update_buffer(i0old);
+          }
+        [[gnu::always_inline]] [[gnu::hot]] void prep_cached(size_t ix)
+          {
+          auto i0old = i0;
+          parent->template get_cached_kernel<supp>(ix, i0, buf.scalar, nvec*vlen);
+          update_buffer(i0old);
+          }
+
+      private:
+        [[gnu::always_inline]] void update_buffer(const array<int,ndim> &i0old)
+          {
           if (i0==i0old) return;
           if ((i0[0]<b0[0]) || (i0[1]<b0[1]) || (i0[0]+int(supp)>b0[0]+su) || (i0[1]+int(supp)>b0[1]+sv))
             {
@@ -968,8 +2230,8 @@ template<typename Tcalc, typename Tacc, typename Tcoord> class Nufft<Tcalc, Tacc
 
     template<size_t SUPP, typename Tpoints> [[gnu::hot]] void spreading_helper
       (size_t supp, const cmav<Tcoord,2> &coords,
-      const cmav<complex<Tpoints>,1> &points,
-      vmav<complex<Tcalc>,ndim> &grid) const
+      const cmav<complex<Tpoints>,2> &points,
+      vmav<complex<Tcalc>,ndim+1> &grid) const
       {
       if constexpr (SUPP>=8)
         if (supp<=SUPP/2) return spreading_helper<SUPP/2>(supp, coords, points, grid);
@@ -977,61 +2239,99 @@ template<typename Tcalc, typename Tacc, typename Tcoord> class Nufft<Tcalc, Tacc
         if (supp<SUPP) return spreading_helper<SUPP-1>(supp, coords, points, grid);
       MR_assert(supp==SUPP, "requested support out of range");
       bool sorted = coords_sorted.size()!=0;
+      bool cached = sorted && parent::kernel_cached();
+      // number of points to process (the chunk size for streaming nu2u)
+      const size_t npts = points.shape(1);
 
-      vector<mutex> locks(nover[0]);
-
-      size_t chunksz = max<size_t>(1000, coord_idx.size()/(10*nthreads));
-      execDynamic(coord_idx.size(), nthreads, chunksz, [&](Scheduler &sched)
+      using Helper = HelperNu2u<SUPP>;
+      // spreads the points with processing indices [lo; hi) via hlp
+      auto spread = [&](Helper &hlp, size_t lo, size_t hi)
         {
-        HelperNu2u<SUPP> hlp(this, grid, locks);
-        constexpr auto jump = hlp.lineJump();
+        const auto jump = hlp.lineJump();
         const auto * DUCC0_RESTRICT ku = hlp.buf.scalar;
-        const auto * DUCC0_RESTRICT kv = hlp.buf.scalar+hlp.nvec*hlp.vlen;
-        constexpr size_t NVEC2 = (2*SUPP+hlp.vlen-1)/hlp.vlen;
-        union Txdata{
-          array<complex<Tacc>,SUPP> c;
-          array<mysimd<Tacc>,NVEC2> v;
-          Txdata(){for (size_t i=0; i<v.size(); ++i) v[i]=0;}
-          };
-        Txdata xdata;
+        const auto * DUCC0_RESTRICT kv = hlp.buf.scalar+Helper::nvec*Helper::vlen;
+        constexpr size_t NVEC2 = (2*SUPP+Helper::vlen-1)/Helper::vlen;
+        // interleaved real and imaginary parts of kernel weights times point
+        // value, padded with zeros to a multiple of the vector length
+        array<Tacc,NVEC2*Helper::vlen> xdata;
+        xdata.fill(0);
 
         constexpr size_t lookahead=3;
-        while (auto rng=sched.getNext()) for(auto ix=rng.lo; ix<rng.hi; ++ix)
+        for (auto ix=lo; ix<hi; ++ix)
           {
           if (ix+lookahead<coord_idx.size())
             {
             auto nextidx = coord_idx[ix+lookahead];
-            DUCC0_PREFETCH_R(&points(nextidx));
+            for (size_t t=0; t<hlp.ntrans; ++t)
+              DUCC0_PREFETCH_R(&points(t,nextidx));
             if (!sorted)
               for (size_t d=0; d<ndim; ++d) DUCC0_PREFETCH_R(&coords(nextidx,d));
             }
           size_t row = coord_idx[ix];
-          sorted ? hlp.prep({coords(ix,0), coords(ix,1)})
-                 : hlp.prep({coords(row,0), coords(row,1)});
-          complex<Tacc> v(points(row));
+          if (cached) hlp.prep_cached(ix);
+          else sorted ? hlp.prep({coords(ix,0), coords(ix,1)})
+                      : hlp.prep({coords(row,0), coords(row,1)});
 
-          for (size_t cv=0; cv<SUPP; ++cv)
-            xdata.c[cv] = kv[cv]*v;
-
-          Tacc * DUCC0_RESTRICT xpx = reinterpret_cast<Tacc *>(hlp.p0);
-          for (size_t cu=0; cu<SUPP; ++cu)
+          for (size_t t=0; t<hlp.ntrans; ++t)
             {
-            Tacc tmpx=ku[cu];
+            complex<Tacc> v(points(t,row));
+
+            for (size_t cv=0; cv<SUPP; ++cv)
+              {
+              xdata[2*cv  ] = kv[cv]*v.real();
+              xdata[2*cv+1] = kv[cv]*v.imag();
+              }
+            array<mysimd<Tacc>,NVEC2> xv;
             for (size_t cv=0; cv<NVEC2; ++cv)
+              xv[cv] = mysimd<Tacc>(&xdata[cv*hlp.vlen],element_aligned_tag());
+
+            Tacc * DUCC0_RESTRICT xpx = reinterpret_cast<Tacc *>(hlp.p0+t*hlp.tstride);
+            for (size_t cu=0; cu<SUPP; ++cu)
               {
-              auto * DUCC0_RESTRICT px = xpx+cu*2*jump+cv*hlp.vlen;
-              auto tval = mysimd<Tacc>(px,element_aligned_tag());
-              tval += tmpx*xdata.v[cv];
-              tval.copy_to(px,element_aligned_tag());
+              Tacc tmpx=ku[cu];
+              for (size_t cv=0; cv<NVEC2; ++cv)
+                {
+                auto * DUCC0_RESTRICT px = xpx+cu*2*jump+cv*hlp.vlen;
+                auto tval = mysimd<Tacc>(px,element_aligned_tag());
+                tval += tmpx*xv[cv];
+                tval.copy_to(px,element_aligned_tag());
+                }
               }
             }
           }
+        };
+
+      typename parent::SlabPlan slabs;
+      if (parent::plan_slabs(slabs))
+        {
+        auto priv = parent::alloc_slabs(grid.shape(0), slabs);
+        execParallel(nthreads, [&](Scheduler &sched)
+          {
+          auto k = sched.thread_num();
+          mav_apply([](complex<Tcalc> &v){v=complex<Tcalc>(0);}, 1, priv[k]);
+          Helper hlp(this, priv[k], nullptr);
+          for (const auto &pc: slabs.pieces[k])
+            {
+            hlp.set_row_offset(int(pc.ofs));
+            spread(hlp, pc.lo, pc.hi);
+            }
+          });
+        parent::merge_slabs(priv, slabs, grid);
+        return;
+        }
+
+      vector<mutex> locks(nover[0]);
+      size_t chunksz = max<size_t>(1000, npts/(10*nthreads));
+      execDynamic(npts, nthreads, chunksz, [&](Scheduler &sched)
+        {
+        Helper hlp(this, grid, &locks);
+        while (auto rng=sched.getNext()) spread(hlp, rng.lo, rng.hi);
         });
       }
 
     template<size_t SUPP, typename Tpoints> [[gnu::hot]] void interpolation_helper
-      (size_t supp, const cmav<complex<Tcalc>,ndim> &grid,
-      const cmav<Tcoord,2> &coords, vmav<complex<Tpoints>,1> &points) const
+      (size_t supp, const cmav<complex<Tcalc>,ndim+1> &grid,
+      const cmav<Tcoord,2> &coords, vmav<complex<Tpoints>,2> &points) const
       {
       if constexpr (SUPP>=8)
         if (supp<=SUPP/2) return interpolation_helper<SUPP/2>(supp, grid, coords, points);
@@ -1039,12 +2339,13 @@ template<typename Tcalc, typename Tacc, typename Tcoord> class Nufft<Tcalc, Tacc
         if (supp<SUPP) return interpolation_helper<SUPP-1>(supp, grid, coords, points);
       MR_assert(supp==SUPP, "requested support out of range");
       bool sorted = coords_sorted.size()!=0;
+      bool cached = sorted && parent::kernel_cached();
 
       size_t chunksz = max<size_t>(1000, coord_idx.size()/(10*nthreads));
       execDynamic(npoints, nthreads, chunksz, [&](Scheduler &sched)
         {
         HelperU2nu<SUPP> hlp(this, grid);
-        constexpr int jump = hlp.lineJump();
+        const int jump = hlp.lineJump();
         const auto * DUCC0_RESTRICT ku = hlp.buf.scalar;
         const auto * DUCC0_RESTRICT kv = hlp.buf.simd+hlp.nvec;
 
@@ -1054,147 +2355,161 @@ template<typename Tcalc, typename Tacc, typename Tcoord> class Nufft<Tcalc, Tacc
           if (ix+lookahead<npoints)
             {
             auto nextidx = coord_idx[ix+lookahead];
-            DUCC0_PREFETCH_W(&points(nextidx));
+            for (size_t t=0; t<hlp.ntrans; ++t)
+              DUCC0_PREFETCH_W(&points(t,nextidx));
             if (!sorted)
               for (size_t d=0; d<ndim; ++d) DUCC0_PREFETCH_R(&coords(nextidx,d));
             }
           size_t row = coord_idx[ix];
-          sorted ? hlp.prep({coords(ix,0), coords(ix,1)})
-                 : hlp.prep({coords(row,0), coords(row,1)});
-          mysimd<Tcalc> rr=0, ri=0;
-          if constexpr (hlp.nvec==1)
+          if (cached) hlp.prep_cached(ix);
+          else sorted ? hlp.prep({coords(ix,0), coords(ix,1)})
+                      : hlp.prep({coords(row,0), coords(row,1)});
+          for (size_t t=0; t<hlp.ntrans; ++t)
             {
-            for (size_t cu=0; cu<SUPP; ++cu)
+            const auto * DUCC0_RESTRICT p0r = hlp.p0r + t*hlp.tstride;
+            const auto * DUCC0_RESTRICT p0i = hlp.p0i + t*hlp.tstride;
+            mysimd<Tcalc> rr=0, ri=0;
+            if constexpr (hlp.nvec==1)
               {
-              const auto * DUCC0_RESTRICT pxr = hlp.p0r + cu*jump;
-              const auto * DUCC0_RESTRICT pxi = hlp.p0i + cu*jump;
-              rr += mysimd<Tcalc>(pxr,element_aligned_tag())*ku[cu];
-              ri += mysimd<Tcalc>(pxi,element_aligned_tag())*ku[cu];
+              for (size_t cu=0; cu<SUPP; ++cu)
+                {
+                const auto * DUCC0_RESTRICT pxr = p0r + cu*jump;
+                const auto * DUCC0_RESTRICT pxi = p0i + cu*jump;
+                rr += mysimd<Tcalc>(pxr,element_aligned_tag())*ku[cu];
+                ri += mysimd<Tcalc>(pxi,element_aligned_tag())*ku[cu];
+                }
+              rr *= kv[0];
+              ri *= kv[0];
               }
-            rr *= kv[0];
-            ri *= kv[0];
-            }
-          else
-            {
-            for (size_t cu=0; cu<SUPP; ++cu)
+            else
               {
-              mysimd<Tcalc> tmpr(0), tmpi(0);
-              for (size_t cv=0; cv<hlp.nvec; ++cv)
+              for (size_t cu=0; cu<SUPP; ++cu)
                 {
-                const auto * DUCC0_RESTRICT pxr = hlp.p0r + cu*jump + hlp.vlen*cv;
-                const auto * DUCC0_RESTRICT pxi = hlp.p0i + cu*jump + hlp.vlen*cv;
-                tmpr += kv[cv]*mysimd<Tcalc>(pxr,element_aligned_tag());
-                tmpi += kv[cv]*mysimd<Tcalc>(pxi,element_aligned_tag());
+                mysimd<Tcalc> tmpr(0), tmpi(0);
+                for (size_t cv=0; cv<hlp.nvec; ++cv)
+                  {
+                  const auto * DUCC0_RESTRICT pxr = p0r + cu*jump + hlp.vlen*cv;
+                  const auto * DUCC0_RESTRICT pxi = p0i + cu*jump + hlp.vlen*cv;
+                  tmpr += kv[cv]*mysimd<Tcalc>(pxr,element_aligned_tag());
+                  tmpi += kv[cv]*mysimd<Tcalc>(pxi,element_aligned_tag());
+                  }
+                rr += ku[cu]*tmpr;
+                ri += ku[cu]*tmpi;
                 }
-              rr += ku[cu]*tmpr;
-              ri += ku[cu]*tmpi;
               }
+            points(t,row) = hsum_cmplx<Tcalc>(rr,ri);
             }
-          points(row) = hsum_cmplx<Tcalc>(rr,ri);
           }
         });
       }
 
     template<typename Tpoints, typename Tgrid> void nonuni2uni(bool forward,
-      const cmav<Tcoord,2> &coords, const cmav<complex<Tpoints>,1> &points,
-      vmav<complex<Tgrid>,ndim> &uniform)
+      const cmav<Tcoord,2> &coords, const cmav<complex<Tpoints>,2> &points,
+      vmav<complex<Tgrid>,ndim+1> &uniform, vmav<complex<Tcalc>,ndim+1> &grid)
       {
-      timers.push("nu2u proper");
-      timers.push("allocating grid");
-      auto grid = vmav<complex<Tcalc>,ndim>::build_noncritical(nover, UNINITIALIZED);
-      timers.poppush("zeroing grid");
+      timers.push("zeroing grid");
       mav_apply([](complex<Tcalc> &v){v=complex<Tcalc>(0);},nthreads,grid);
       timers.poppush("spreading");
       constexpr size_t maxsupp = is_same<Tacc, float>::value ? 8 : 16;
       spreading_helper<maxsupp>(supp, coords, points, grid);
+      timers.pop();
+      grid2uni(forward, grid, uniform);
+      }
 
-      timers.poppush("FFT");
+    // FFT and grid correction of the oversampled grid(s); the contents of
+    // grid are destroyed
+    template<typename Tgrid> void grid2uni(bool forward,
+      vmav<complex<Tcalc>,ndim+1> &grid, vmav<complex<Tgrid>,ndim+1> &uniform)
       {
+      timers.push("FFT and grid correction");
+      {
+      // the grid correction is done while storing the results of the last
+      // FFT pass
+      // ofs = t*gs0 + iin*gs1 + jin*gs2; the divisions are skipped in the
+      // common cases of a single transform and a contiguous last dimension
+      auto map0 = uni_map(0, uniform.stride(1)), map1 = uni_map(1, uniform.stride(2));
+      const size_t gs0=size_t(grid.stride(0)), gs1=size_t(grid.stride(1)),
+                   gs2=size_t(grid.stride(2));
+      const bool single = grid.shape(0)==1;
+      const ptrdiff_t us0 = uniform.stride(0);
+      complex<Tgrid> *uptr = uniform.data();
+      auto correct = [&](const complex<Tcalc> &v, size_t iin, ptrdiff_t ofs)
+        {
+        const auto &mi = map0[iin];
+        if (!mi.valid) return;
+        size_t rest = size_t(ofs)-iin*gs1;
+        size_t t = single ? 0 : rest/gs0;
+        rest -= t*gs0;
+        const auto &mj = map1[(gs2==1) ? rest : rest/gs2];
+        if (!mj.valid) return;
+        uptr[ptrdiff_t(t)*us0+mi.ofs+mj.ofs] = complex<Tgrid>(v*Tcalc(mi.cf*mj.cf));
+        };
       vfmav<complex<Tcalc>> fgrid(grid);
-      c2c(fgrid, fgrid, {1}, forward, Tcalc(1), nthreads);
-      auto fgridl=fgrid.subarray({{},{0,(nuni[1]+1)/2}});
-      c2c(fgridl, fgridl, {0}, forward, Tcalc(1), nthreads);
-      auto fgridh=fgrid.subarray({{},{fgrid.shape(1)-nuni[1]/2,MAXIDX}});
-      c2c(fgridh, fgridh, {0}, forward, Tcalc(1), nthreads);
+      c2c_pruned(fgrid, fgrid, {2,1}, {}, {{}, uni_ranges(0), uni_ranges(1)},
+        forward, Tcalc(1), no_callback(), correct, nthreads);
       }
-      timers.poppush("grid correction");
-      execParallel(nuni[0], nthreads, [&](size_t lo, size_t hi)
-        {
-        for (auto i=lo; i<hi; ++i)
-          {
-          auto [icfu, iout, iin] = comp_indices(i, nuni[0], nover[0], fft_order);
-          for (size_t j=0; j<nuni[1]; ++j)
-            {
-            auto [icfv, jout, jin] = comp_indices(j, nuni[1], nover[1], fft_order);
-            uniform(iout,jout) = complex<Tgrid>(grid(iin,jin)
-              *Tcalc(corfac[0][icfu]*corfac[1][icfv]));
-            }
-          }
-        });
-      timers.pop();
       timers.pop();
       }
 
     template<typename Tpoints, typename Tgrid> void uni2nonuni(bool forward,
-      const cmav<complex<Tgrid>,ndim> &uniform, const cmav<Tcoord,2> &coords,
-      vmav<complex<Tpoints>,1> &points)
+      const cmav<complex<Tgrid>,ndim+1> &uniform, const cmav<Tcoord,2> &coords,
+      vmav<complex<Tpoints>,2> &points, vmav<complex<Tcalc>,ndim+1> &grid)
       {
-      timers.push("u2nu proper");
-      timers.push("allocating grid");
-      auto grid = vmav<complex<Tcalc>,ndim>::build_noncritical(nover, UNINITIALIZED);
-      timers.poppush("zeroing grid");
+      size_t ntrans = points.shape(0);
+      timers.push("zeroing grid");
 
       // only zero the parts of the grid that are not filled afterwards anyway
-      { auto a0 = subarray<2>(grid, {{0,nuni[0]/2}, {nuni[1]/2,nover[1]-nuni[1]/2+1}}); quickzero(a0, nthreads); }
-      { auto a0 = subarray<2>(grid, {{nuni[0]/2, nover[0]-nuni[0]/2+1}, {}}); quickzero(a0, nthreads); }
-      { auto a0 = subarray<2>(grid, {{nover[0]-nuni[0]/2+1,MAXIDX}, {nuni[1]/2, nover[1]-nuni[1]/2+1}}); quickzero(a0, nthreads); }
+      for (size_t t=0; t<ntrans; ++t)
+        {
+        auto g = subarray<2>(grid, {{t}, {}, {}});
+        { auto a0 = subarray<2>(g, {{0,nuni[0]/2}, {nuni[1]/2,nover[1]-nuni[1]/2+1}}); quickzero(a0, nthreads); }
+        { auto a0 = subarray<2>(g, {{nuni[0]/2, nover[0]-nuni[0]/2+1}, {}}); quickzero(a0, nthreads); }
+        { auto a0 = subarray<2>(g, {{nover[0]-nuni[0]/2+1,MAXIDX}, {nuni[1]/2, nover[1]-nuni[1]/2+1}}); quickzero(a0, nthreads); }
+        }
       timers.poppush("grid correction");
       execParallel(nuni[0], nthreads, [&](size_t lo, size_t hi)
         {
         for (auto i=lo; i<hi; ++i)
           {
           auto [icfu, iin, iout] = comp_indices(i, nuni[0], nover[0], fft_order);
-          for (size_t j=0; j<nuni[1]; ++j)
-            {
-            auto [icfv, jin, jout] = comp_indices(j, nuni[1], nover[1], fft_order);
-            grid(iout,jout) = complex<Tcalc>(uniform(iin,jin))
-              *Tcalc(corfac[0][icfu]*corfac[1][icfv]);
-            }
+          for (size_t t=0; t<ntrans; ++t)
+            for (size_t j=0; j<nuni[1]; ++j)
+              {
+              auto [icfv, jin, jout] = comp_indices(j, nuni[1], nover[1], fft_order);
+              grid(t,iout,jout) = complex<Tcalc>(uniform(t,iin,jin))
+                *Tcalc(corfac[0][icfu]*corfac[1][icfv]);
+              }
           }
         });
       timers.poppush("FFT");
       {
       vfmav<complex<Tcalc>> fgrid(grid);
-      auto fgridl=fgrid.subarray({{},{0,(nuni[1]+1)/2}});
-      c2c(fgridl, fgridl, {0}, forward, Tcalc(1), nthreads);
-      auto fgridh=fgrid.subarray({{},{fgrid.shape(1)-nuni[1]/2,MAXIDX}});
-      c2c(fgridh, fgridh, {0}, forward, Tcalc(1), nthreads);
-      c2c(fgrid, fgrid, {1}, forward, Tcalc(1), nthreads);
+      c2c_pruned(fgrid, fgrid, {1,2}, {{}, uni_ranges(0), uni_ranges(1)}, {},
+        forward, Tcalc(1), nthreads);
       }
       timers.poppush("interpolation");
       constexpr size_t maxsupp = is_same<Tcalc, float>::value ? 8 : 16;
       interpolation_helper<maxsupp>(supp, grid, coords, points);
       timers.pop();
-      timers.pop();
       }
 
-    void build_index(const cmav<Tcoord,2> &coords)
+    auto sort_key() const
       {
-      timers.push("building index");
       size_t ntiles_u = (nover[0]>>log2tile) + 3;
       size_t ntiles_v = (nover[1]>>log2tile) + 3;
-      coord_idx.resize(npoints);
-      quick_array<uint32_t> key(npoints);
-      execParallel(npoints, nthreads, [&](size_t lo, size_t hi)
+      return parent::make_sort_key(ntiles_u*ntiles_v, ntiles_u*ntiles_v, 0,
+        ntiles_v,
+        [this,ntiles_v](const cmav<Tcoord,2> &coords, size_t i)
         {
-        for (size_t i=lo; i<hi; ++i)
-          {
-          auto tile = parent::template get_tile<Tcoord>({coords(i,0), coords(i,1)});
-          key[i] = tile[0]*ntiles_v + tile[1];
-          }
+        auto tile = parent::template get_tile<Tcoord>({coords(i,0), coords(i,1)});
+        return uint32_t(tile[0]*ntiles_v + tile[1]);
         });
-      bucket_sort2(key, coord_idx, ntiles_u*ntiles_v, nthreads);
-      timers.pop();
+      }
+
+    void build_index(const cmav<Tcoord,2> &coords)
+      {
+      MR_assert(coords.shape(0)==npoints, "number of coords mismatch");
+      parent::build_index(coords, sort_key());
       }
   };
 
@@ -1213,61 +2528,67 @@ template<typename Tcalc, typename Tacc, typename Tcoord> class Nufft<Tcalc, Tacc
 
       private:
         static constexpr int nsafe = (supp+1)/2;
-        static constexpr int su = supp+(1<<log2tile), sv = su, sw = su;
+        const int log2tile, su, sv, sw;
         static constexpr double xsupp=2./supp;
         const Nufft *parent;
         TemplateKernel<supp, mysimd<Tacc>> tkrn;
-        vmav<complex<Tcalc>,ndim> &grid;
+        vmav<complex<Tcalc>,ndim+1> &grid;
         array<int,ndim> i0; // start index of the current nonuniform point
         array<int,ndim> b0; // start index of the current buffer
 #ifdef NEW_DUMP
         array<int,ndim> imin,imax;
 #endif
 
-        vmav<complex<Tacc>,ndim> gbuf;
+        vmav<complex<Tacc>,ndim+1> gbuf;
         complex<Tacc> *px0;
-        vector<mutex> &locks;
+        // if nullptr, grid is private to this helper (see constructor)
+        vector<mutex> *locks;
+        // (unwrapped) index in the oversampled grid of the first row of grid
+        int uofs;
 
         DUCC0_NOINLINE void dump()
           {
           if (b0[0]<-nsafe) return; // nothing written into buffer yet
-          int inu = int(parent->nover[0]);
+          int inu = int(grid.shape(1));
           int inv = int(parent->nover[1]);
           int inw = int(parent->nover[2]);
 
 #ifdef NEW_DUMP
           int idxv0 = (imin[1]+b0[1]+inv)%inv;
           int idxw0 = (imin[2]+b0[2]+inw)%inw;
-          for (int iu=imin[0], idxu=(imin[0]+b0[0]+inu)%inu; iu<imax[0]; ++iu, idxu=(idxu+1<inu)?(idxu+1):0)
+          for (int iu=imin[0], idxu=(imin[0]+b0[0]-uofs+inu)%inu; iu<imax[0]; ++iu, idxu=(idxu+1<inu)?(idxu+1):0)
             {
-            lock_guard<mutex> lock(locks[idxu]);
-            for (int iv=imin[1], idxv=idxv0; iv<imax[1]; ++iv, idxv=(idxv+1<inv)?(idxv+1):0)
-              for (int iw=imin[2], idxw=idxw0; iw<imax[2]; ++iw, idxw=(idxw+1<inw)?(idxw+1):0)
-                {
-                auto t=gbuf(iu,iv,iw);
-                grid(idxu,idxv,idxw) += complex<Tcalc>(t);
-                gbuf(iu,iv,iw) = 0;
-                }
+            auto lock = locks ? unique_lock<mutex>((*locks)[idxu]) : unique_lock<mutex>();
+            for (size_t t=0; t<ntrans; ++t)
+              for (int iv=imin[1], idxv=idxv0; iv<imax[1]; ++iv, idxv=(idxv+1<inv)?(idxv+1):0)
+                for (int iw=imin[2], idxw=idxw0; iw<imax[2]; ++iw, idxw=(idxw+1<inw)?(idxw+1):0)
+                  {
+                  grid(t,idxu,idxv,idxw) += complex<Tcalc>(gbuf(t,iu,iv,iw));
+                  gbuf(t,iu,iv,iw) = 0;
+                  }
             }
           imin={1000,1000,1000}; imax={-1000,-1000,-1000};
 #else
           int idxv0 = (b0[1]+inv)%inv;
           int idxw0 = (b0[2]+inw)%inw;
-          for (int iu=0, idxu=(b0[0]+inu)%inu; iu<su; ++iu, idxu=(idxu+1<inu)?(idxu+1):0)
+          for (int iu=0, idxu=(b0[0]-uofs+inu)%inu; iu<su; ++iu, idxu=(idxu+1<inu)?(idxu+1):0)
             {
-            lock_guard<mutex> lock(locks[idxu]);
-            for (int iv=0, idxv=idxv0; iv<sv; ++iv, idxv=(idxv+1<inv)?(idxv+1):0)
-              for (int iw=0, idxw=idxw0; iw<sw; ++iw, idxw=(idxw+1<inw)?(idxw+1):0)
-                {
-                auto t=gbuf(iu,iv,iw);
-                grid(idxu,idxv,idxw) += complex<Tcalc>(t);
-                gbuf(iu,iv,iw) = 0;
-                }
+            auto lock = locks ? unique_lock<mutex>((*locks)[idxu]) : unique_lock<mutex>();
+            for (size_t t=0; t<ntrans; ++t)
+              for (int iv=0, idxv=idxv0; iv<sv; ++iv, idxv=(idxv+1<inv)?(idxv+1):0)
+                for (int iw=0, idxw=idxw0; iw<sw; ++iw, idxw=(idxw+1<inw)?(idxw+1):0)
+                  {
+                  grid(t,idxu,idxv,idxw) += complex<Tcalc>(gbuf(t,iu,iv,iw));
+                  gbuf(t,iu,iv,iw) = 0;
+                  }
             }
 #endif
           }
 
       public:
+        // number of simultaneous transforms, and distance between their
+        // local buffers
+        const size_t ntrans, tstride;
         complex<Tacc> * DUCC0_RESTRICT p0;
         union kbuf {
           Tacc scalar[3*nvec*vlen];
@@ -1278,30 +2599,57 @@ template<typename Tcalc, typename Tacc, typename Tcoord> class Nufft<Tcalc, Tacc
           };
         kbuf buf;
 
-        HelperNu2u(const Nufft *parent_, vmav<complex<Tcalc>,ndim> &grid_,
-          vector<mutex> &locks_)
-          : parent(parent_), tkrn(*parent->krn), grid(grid_),
+        // If locks_ is nullptr, grid_ is private to this helper and holds
+        // a range of rows of the oversampled grid (see set_row_offset()),
+        // so that no locking is required. Otherwise grid_ is the full
+        // oversampled grid.
+        HelperNu2u(const Nufft *parent_, vmav<complex<Tcalc>,ndim+1> &grid_,
+          vector<mutex> *locks_)
+          : log2tile(parent_->log2tile), su(int(supp)+(1<<log2tile)), sv(su),
+            sw(su), parent(parent_), tkrn(*parent->krn), grid(grid_),
             i0{-1000000, -1000000, -1000000}, b0{-1000000, -1000000, -1000000},
 #ifdef NEW_DUMP
             imin{1000,1000,1000},imax{-1000,-1000,-1000},
 #endif
-            gbuf({size_t(su),size_t(sv),size_t(sw)}),
-            px0(gbuf.data()), locks(locks_) {}
+            gbuf({grid.shape(0),size_t(su),size_t(sv),size_t(sw)}),
+            px0(gbuf.data()), locks(locks_), uofs(0),
+            ntrans(grid.shape(0)), tstride(size_t(gbuf.stride(0))) {}
         ~HelperNu2u() { dump(); }
 
-        constexpr int lineJump() const { return sw; }
-        constexpr int planeJump() const { return sv*sw; }
+        // Flushes the local buffer and sets the (unwrapped) index in the
+        // oversampled grid of the first row of grid.
+        void set_row_offset(int uofs_)
+          {
+          dump();
+          i0.fill(-1000000);
+          b0.fill(-1000000);
+          uofs = uofs_;
+          }
+
+        int lineJump() const { return sw; }
+        int planeJump() const { return sv*sw; }
 
         [[gnu::always_inline]] [[gnu::hot]] void prep(array<double,ndim> in)
           {
           array<double,ndim> frac;
-          
           auto i0old = i0;
           parent->template getpix<Tcoord>(in, frac, i0);
           auto x0 = -frac[0]*2+(supp-1);
           auto y0 = -frac[1]*2+(supp-1);
           auto z0 = -frac[2]*2+(supp-1);
           tkrn.eval3(Tacc(x0), Tacc(y0), Tacc(z0), &buf.simd[0]);
+          update_buffer(i0old);
+          }
+        [[gnu::always_inline]] [[gnu::hot]] void prep_cached(size_t ix)
+          {
+          auto i0old = i0;
+          parent->template get_cached_kernel<supp>(ix, i0, buf.scalar, nvec*vlen);
+          update_buffer(i0old);
+          }
+
+      private:
+        [[gnu::always_inline]] void update_buffer(const array<int,ndim> &i0old)
+          {
           if (i0==i0old) return;
           if ((i0[0]<b0[0]) || (i0[1]<b0[1]) || (i0[2]<b0[2])
            || (i0[0]+int(supp)>b0[0]+su) || (i0[1]+int(supp)>b0[1]+sv) || (i0[2]+int(supp)>b0[2]+sw))
@@ -1330,17 +2678,16 @@ template<typename Tcalc, typename Tacc, typename Tcoord> class Nufft<Tcalc, Tacc
 
       private:
         static constexpr int nsafe = (supp+1)/2;
-        static constexpr int su = 2*nsafe+(1<<log2tile), sv = su, sw = su;
-        static constexpr int swvec = max<size_t>(sw, ((supp+2*nvec-2)/nvec)*nvec);
+        const int log2tile, su, sv, sw, swvec;
         static constexpr double xsupp=2./supp;
         const Nufft *parent;
 
         TemplateKernel<supp, mysimd<Tcalc>> tkrn;
-        const cmav<complex<Tcalc>,ndim> &grid;
+        const cmav<complex<Tcalc>,ndim+1> &grid;
         array<int,ndim> i0; // start index of the nonuniform point
         array<int,ndim> b0; // start index of the current buffer
 
-        vmav<Tcalc,ndim> bufri;
+        vmav<Tcalc,ndim+1> bufri;
         const Tcalc *px0r, *px0i;
 
         DUCC0_NOINLINE void load()
@@ -1350,16 +2697,20 @@ template<typename Tcalc, typename Tacc, typename Tcoord> class Nufft<Tcalc, Tacc
           int inw = int(parent->nover[2]);
           int idxv0 = (b0[1]+inv)%inv;
           int idxw0 = (b0[2]+inw)%inw;
-          for (int iu=0, idxu=(b0[0]+inu)%inu; iu<su; ++iu, idxu=(idxu+1<inu)?(idxu+1):0)
-            for (int iv=0, idxv=idxv0; iv<sv; ++iv, idxv=(idxv+1<inv)?(idxv+1):0)
-              for (int iw=0, idxw=idxw0; iw<sw; ++iw, idxw=(idxw+1<inw)?(idxw+1):0)
-                {
-                bufri(iu,2*iv,iw) = grid(idxu, idxv, idxw).real();
-                bufri(iu,2*iv+1,iw) = grid(idxu, idxv, idxw).imag();
-                }
+          for (size_t t=0; t<ntrans; ++t)
+            for (int iu=0, idxu=(b0[0]+inu)%inu; iu<su; ++iu, idxu=(idxu+1<inu)?(idxu+1):0)
+              for (int iv=0, idxv=idxv0; iv<sv; ++iv, idxv=(idxv+1<inv)?(idxv+1):0)
+                for (int iw=0, idxw=idxw0; iw<sw; ++iw, idxw=(idxw+1<inw)?(idxw+1):0)
+                  {
+                  bufri(t,iu,2*iv,iw) = grid(t, idxu, idxv, idxw).real();
+                  bufri(t,iu,2*iv+1,iw) = grid(t, idxu, idxv, idxw).imag();
+                  }
           }
 
       public:
+        // number of simultaneous transforms, and distance between their
+        // local buffers
+        const size_t ntrans, tstride;
         const Tcalc * DUCC0_RESTRICT p0r, * DUCC0_RESTRICT p0i;
         union kbuf {
           Tcalc scalar[3*nvec*vlen];
@@ -1370,14 +2721,17 @@ template<typename Tcalc, typename Tacc, typename Tcoord> class Nufft<Tcalc, Tacc
           };
         kbuf buf;
 
-        HelperU2nu(const Nufft *parent_, const cmav<complex<Tcalc>,ndim> &grid_)
-          : parent(parent_), tkrn(*parent->krn), grid(grid_),
+        HelperU2nu(const Nufft *parent_, const cmav<complex<Tcalc>,ndim+1> &grid_)
+          : log2tile(parent_->log2tile), su(2*nsafe+(1<<log2tile)), sv(su),
+            sw(su), swvec(max<int>(sw, int(((supp+2*nvec-2)/nvec)*nvec))),
+            parent(parent_), tkrn(*parent->krn), grid(grid_),
             i0{-1000000, -1000000, -1000000}, b0{-1000000, -1000000, -1000000},
-            bufri({size_t(su+1),size_t(2*sv),size_t(swvec)}),
-            px0r(bufri.data()), px0i(bufri.data()+swvec) {}
+            bufri({grid.shape(0),size_t(su+1),size_t(2*sv),size_t(swvec)}),
+            px0r(bufri.data()), px0i(bufri.data()+swvec),
+            ntrans(grid.shape(0)), tstride(size_t(bufri.stride(0))) {}
 
-        constexpr int lineJump() const { return 2*swvec; }
-        constexpr int planeJump() const { return 2*sv*swvec; }
+        int lineJump() const { return 2*swvec; }
+        int planeJump() const { return 2*sv*swvec; }
 
         [[gnu::always_inline]] [[gnu::hot]] void prep(array<double,ndim> in)
           {
@@ -1388,6 +2742,18 @@ template<typename Tcalc, typename Tacc, typename Tcoord> class Nufft<Tcalc, Tacc
           auto y0 = -frac[1]*2+(supp-1);
           auto z0 = -frac[2]*2+(supp-1);
           tkrn.eval3(Tcalc(x0), Tcalc(y0), Tcalc(z0), &buf.simd[0]);
+          update_buffer(i0old);
+          }
+        [[gnu::always_inline]] [[gnu::hot]] void prep_cached(size_t ix)
+          {
+          auto i0old = i0;
+          parent->template get_cached_kernel<supp>(ix, i0, buf.scalar, nvec*vlen);
+          update_buffer(i0old);
+          }
+
+      private:
+        [[gnu::always_inline]] void update_buffer(const array<int,ndim> &i0old)
+          {
           if (i0==i0old) return;
           if ((i0[0]<b0[0]) || (i0[1]<b0[1]) || (i0[2]<b0[2])
            || (i0[0]+int(supp)>b0[0]+su) || (i0[1]+int(supp)>b0[1]+sv) || (i0[2]+int(supp)>b0[2]+sw))
@@ -1405,8 +2771,8 @@ template<typename Tcalc, typename Tacc, typename Tcoord> class Nufft<Tcalc, Tacc
 
     template<size_t SUPP, typename Tpoints> [[gnu::hot]] void spreading_helper
       (size_t supp, const cmav<Tcoord,2> &coords,
-      const cmav<complex<Tpoints>,1> &points,
-      vmav<complex<Tcalc>,ndim> &grid) const
+      const cmav<complex<Tpoints>,2> &points,
+      vmav<complex<Tcalc>,ndim+1> &grid) const
       {
       if constexpr (SUPP>=8)
         if (supp<=SUPP/2) return spreading_helper<SUPP/2>(supp, coords, points, grid);
@@ -1414,60 +2780,93 @@ template<typename Tcalc, typename Tacc, typename Tcoord> class Nufft<Tcalc, Tacc
         if (supp<SUPP) return spreading_helper<SUPP-1>(supp, coords, points, grid);
       MR_assert(supp==SUPP, "requested support out of range");
       bool sorted = coords_sorted.size()!=0;
+      bool cached = sorted && parent::kernel_cached();
+      // number of points to process (the chunk size for streaming nu2u)
+      const size_t npts = points.shape(1);
 
-      vector<mutex> locks(nover[0]);
-
-      size_t chunksz = max<size_t>(1000, npoints/(10*nthreads));
-      execDynamic(npoints, nthreads, chunksz, [&](Scheduler &sched)
+      using Helper = HelperNu2u<SUPP>;
+      // spreads the points with processing indices [lo; hi) via hlp
+      auto spread = [&](Helper &hlp, size_t lo, size_t hi)
         {
-        HelperNu2u<SUPP> hlp(this, grid, locks);
-        constexpr auto ljump = hlp.lineJump();
-        constexpr auto pjump = hlp.planeJump();
+        const auto ljump = hlp.lineJump();
+        const auto pjump = hlp.planeJump();
         const auto * DUCC0_RESTRICT ku = hlp.buf.scalar;
-        const auto * DUCC0_RESTRICT kv = hlp.buf.scalar+hlp.vlen*hlp.nvec;
-        const auto * DUCC0_RESTRICT kw = hlp.buf.scalar+2*hlp.vlen*hlp.nvec;
-        union Txdata{
-          array<complex<Tacc>,SUPP> c;
-          array<Tacc,2*SUPP> f;
-          Txdata(){for (size_t i=0; i<f.size(); ++i) f[i]=0;}
-          };
-        Txdata xdata;
+        const auto * DUCC0_RESTRICT kv = hlp.buf.scalar+Helper::vlen*Helper::nvec;
+        const auto * DUCC0_RESTRICT kw = hlp.buf.scalar+2*Helper::vlen*Helper::nvec;
+        // interleaved real and imaginary parts of kernel weights times point
+        // value
+        array<Tacc,2*SUPP> xdata;
 
-        while (auto rng=sched.getNext()) for(auto ix=rng.lo; ix<rng.hi; ++ix)
+        for (auto ix=lo; ix<hi; ++ix)
           {
           constexpr size_t lookahead=3;
-          if (ix+lookahead<npoints)
+          if (ix+lookahead<npts)
             {
             auto nextidx = coord_idx[ix+lookahead];
-            DUCC0_PREFETCH_R(&points(nextidx));
+            for (size_t t=0; t<hlp.ntrans; ++t)
+              DUCC0_PREFETCH_R(&points(t,nextidx));
             if (!sorted)
               for (size_t d=0; d<ndim; ++d) DUCC0_PREFETCH_R(&coords(nextidx,d));
             }
           size_t row = coord_idx[ix];
-          sorted ? hlp.prep({coords(ix,0), coords(ix,1), coords(ix,2)})
-                 : hlp.prep({coords(row,0), coords(row,1), coords(row,2)});
-          complex<Tacc> v(points(row));
-
-          for (size_t cw=0; cw<SUPP; ++cw)
-            xdata.c[cw]=kw[cw]*v;
-          const Tacc * DUCC0_RESTRICT fptr1=xdata.f.data();
-          Tacc * DUCC0_RESTRICT fptr2=reinterpret_cast<Tacc *>(hlp.p0);
-          const auto j1 = 2*ljump;
-          const auto j2 = 2*(pjump-SUPP*ljump);
-          for (size_t cu=0; cu<SUPP; ++cu, fptr2+=j2)
-            for (size_t cv=0; cv<SUPP; ++cv, fptr2+=j1)
+          if (cached) hlp.prep_cached(ix);
+          else sorted ? hlp.prep({coords(ix,0), coords(ix,1), coords(ix,2)})
+                      : hlp.prep({coords(row,0), coords(row,1), coords(row,2)});
+          for (size_t t=0; t<hlp.ntrans; ++t)
+            {
+            complex<Tacc> v(points(t,row));
+
+            for (size_t cw=0; cw<SUPP; ++cw)
               {
-              Tacc tmp2x=ku[cu]*kv[cv];
-              for (size_t cw=0; cw<2*SUPP; ++cw)
-                fptr2[cw] += tmp2x*fptr1[cw];
+              xdata[2*cw  ] = kw[cw]*v.real();
+              xdata[2*cw+1] = kw[cw]*v.imag();
               }
+            const Tacc * DUCC0_RESTRICT fptr1=xdata.data();
+            Tacc * DUCC0_RESTRICT fptr2=reinterpret_cast<Tacc *>(hlp.p0+t*hlp.tstride);
+            const auto j1 = 2*ljump;
+            const auto j2 = 2*(pjump-SUPP*ljump);
+            for (size_t cu=0; cu<SUPP; ++cu, fptr2+=j2)
+              for (size_t cv=0; cv<SUPP; ++cv, fptr2+=j1)
+                {
+                Tacc tmp2x=ku[cu]*kv[cv];
+                for (size_t cw=0; cw<2*SUPP; ++cw)
+                  fptr2[cw] += tmp2x*fptr1[cw];
+                }
+            }
           }
+        };
+
+      typename parent::SlabPlan slabs;
+      if (parent::plan_slabs(slabs))
+        {
+        auto priv = parent::alloc_slabs(grid.shape(0), slabs);
+        execParallel(nthreads, [&](Scheduler &sched)
+          {
+          auto k = sched.thread_num();
+          mav_apply([](complex<Tcalc> &v){v=complex<Tcalc>(0);}, 1, priv[k]);
+          Helper hlp(this, priv[k], nullptr);
+          for (const auto &pc: slabs.pieces[k])
+            {
+            hlp.set_row_offset(int(pc.ofs));
+            spread(hlp, pc.lo, pc.hi);
+            }
+          });
+        parent::merge_slabs(priv, slabs, grid);
+        return;
+        }
+
+      vector<mutex> locks(nover[0]);
+      size_t chunksz = max<size_t>(1000, npts/(10*nthreads));
+      execDynamic(npts, nthreads, chunksz, [&](Scheduler &sched)
+        {
+        Helper hlp(this, grid, &locks);
+        while (auto rng=sched.getNext()) spread(hlp, rng.lo, rng.hi);
         });
       }
 
     template<size_t SUPP, typename Tpoints> [[gnu::hot]] void interpolation_helper
-      (size_t supp, const cmav<complex<Tcalc>,ndim> &grid,
-      const cmav<Tcoord,2> &coords, vmav<complex<Tpoints>,1> &points) const
+      (size_t supp, const cmav<complex<Tcalc>,ndim+1> &grid,
+      const cmav<Tcoord,2> &coords, vmav<complex<Tpoints>,2> &points) const
       {
       if constexpr (SUPP>=8)
         if (supp<=SUPP/2) return interpolation_helper<SUPP/2>(supp, grid, coords, points);
@@ -1475,13 +2874,14 @@ template<typename Tcalc, typename Tacc, typename Tcoord> class Nufft<Tcalc, Tacc
         if (supp<SUPP) return interpolation_helper<SUPP-1>(supp, grid, coords, points);
       MR_assert(supp==SUPP, "requested support out of range");
       bool sorted = coords_sorted.size()!=0;
+      bool cached = sorted && parent::kernel_cached();
 
       size_t chunksz = max<size_t>(1000, npoints/(10*nthreads));
       execDynamic(npoints, nthreads, chunksz, [&](Scheduler &sched)
         {
         HelperU2nu<SUPP> hlp(this, grid);
-        constexpr auto ljump = hlp.lineJump();
-        constexpr auto pjump = hlp.planeJump();
+        const auto ljump = hlp.lineJump();
+        const auto pjump = hlp.planeJump();
         const auto * DUCC0_RESTRICT ku = hlp.buf.scalar;
         const auto * DUCC0_RESTRICT kv = hlp.buf.scalar+hlp.vlen*hlp.nvec;
         const auto * DUCC0_RESTRICT kw = hlp.buf.simd+2*hlp.nvec;
@@ -1492,120 +2892,127 @@ template<typename Tcalc, typename Tacc, typename Tcoord> class Nufft<Tcalc, Tacc
           if (ix+lookahead<npoints)
             {
             auto nextidx = coord_idx[ix+lookahead];
-            DUCC0_PREFETCH_W(&points(nextidx));
+            for (size_t t=0; t<hlp.ntrans; ++t)
+              DUCC0_PREFETCH_W(&points(t,nextidx));
             if (!sorted)
               for (size_t d=0; d<ndim; ++d) DUCC0_PREFETCH_R(&coords(nextidx,d));
             }
           size_t row = coord_idx[ix];
-          sorted ? hlp.prep({coords(ix,0), coords(ix,1), coords(ix,2)})
-                 : hlp.prep({coords(row,0), coords(row,1), coords(row,2)});
-          mysimd<Tcalc> rr=0, ri=0;
-          if constexpr (hlp.nvec==1)
+          if (cached) hlp.prep_cached(ix);
+          else sorted ? hlp.prep({coords(ix,0), coords(ix,1), coords(ix,2)})
+                      : hlp.prep({coords(row,0), coords(row,1), coords(row,2)});
+          for (size_t t=0; t<hlp.ntrans; ++t)
             {
-            for (size_t cu=0; cu<SUPP; ++cu)
+            const auto * DUCC0_RESTRICT p0r = hlp.p0r + t*hlp.tstride;
+            const auto * DUCC0_RESTRICT p0i = hlp.p0i + t*hlp.tstride;
+            mysimd<Tcalc> rr=0, ri=0;
+            if constexpr (hlp.nvec==1)
               {
-              mysimd<Tcalc> r2r=0, r2i=0;
-              for (size_t cv=0; cv<SUPP; ++cv)
+              for (size_t cu=0; cu<SUPP; ++cu)
                 {
-                const auto * DUCC0_RESTRICT pxr = hlp.p0r + cu*pjump + cv*ljump;
-                const auto * DUCC0_RESTRICT pxi = hlp.p0i + cu*pjump + cv*ljump;
-                r2r += mysimd<Tcalc>(pxr,element_aligned_tag())*kv[cv];
-                r2i += mysimd<Tcalc>(pxi,element_aligned_tag())*kv[cv];
+                mysimd<Tcalc> r2r=0, r2i=0;
+                for (size_t cv=0; cv<SUPP; ++cv)
+                  {
+                  const auto * DUCC0_RESTRICT pxr = p0r + cu*pjump + cv*ljump;
+                  const auto * DUCC0_RESTRICT pxi = p0i + cu*pjump + cv*ljump;
+                  r2r += mysimd<Tcalc>(pxr,element_aligned_tag())*kv[cv];
+                  r2i += mysimd<Tcalc>(pxi,element_aligned_tag())*kv[cv];
+                  }
+                rr += r2r*ku[cu];
+                ri += r2i*ku[cu];
                 }
-              rr += r2r*ku[cu];
-              ri += r2i*ku[cu];
+              rr *= kw[0];
+              ri *= kw[0];
               }
-            rr *= kw[0];
-            ri *= kw[0];
-            }
-          else
-            {
-            for (size_t cu=0; cu<SUPP; ++cu)
+            else
               {
-              mysimd<Tcalc> tmpr(0), tmpi(0);
-              for (size_t cv=0; cv<SUPP; ++cv)
+              for (size_t cu=0; cu<SUPP; ++cu)
                 {
-                mysimd<Tcalc> tmp2r(0), tmp2i(0);
-                for (size_t cw=0; cw<hlp.nvec; ++cw)
+                mysimd<Tcalc> tmpr(0), tmpi(0);
+                for (size_t cv=0; cv<SUPP; ++cv)
                   {
-                  const auto * DUCC0_RESTRICT pxr = hlp.p0r + cu*pjump + cv*ljump + hlp.vlen*cw;
-                  const auto * DUCC0_RESTRICT pxi = hlp.p0i + cu*pjump + cv*ljump + hlp.vlen*cw;
-                  tmp2r += kw[cw]*mysimd<Tcalc>(pxr,element_aligned_tag());
-                  tmp2i += kw[cw]*mysimd<Tcalc>(pxi,element_aligned_tag());
+                  mysimd<Tcalc> tmp2r(0), tmp2i(0);
+                  for (size_t cw=0; cw<hlp.nvec; ++cw)
+                    {
+                    const auto * DUCC0_RESTRICT pxr = p0r + cu*pjump + cv*ljump + hlp.vlen*cw;
+                    const auto * DUCC0_RESTRICT pxi = p0i + cu*pjump + cv*ljump + hlp.vlen*cw;
+                    tmp2r += kw[cw]*mysimd<Tcalc>(pxr,element_aligned_tag());
+                    tmp2i += kw[cw]*mysimd<Tcalc>(pxi,element_aligned_tag());
+                    }
+                  tmpr += kv[cv]*tmp2r;
+                  tmpi += kv[cv]*tmp2i;
                   }
-                tmpr += kv[cv]*tmp2r;
-                tmpi += kv[cv]*tmp2i;
+                rr += ku[cu]*tmpr;
+                ri += ku[cu]*tmpi;
                 }
-              rr += ku[cu]*tmpr;
-              ri += ku[cu]*tmpi;
               }
+            points(t,row) = hsum_cmplx<Tcalc>(rr,ri);
             }
-          points(row) = hsum_cmplx<Tcalc>(rr,ri);
           }
         });
       }
 
     template<typename Tpoints, typename Tgrid> void nonuni2uni(bool forward,
-      const cmav<Tcoord,2> &coords, const cmav<complex<Tpoints>,1> &points,
-      vmav<complex<Tgrid>,ndim> &uniform)
+      const cmav<Tcoord,2> &coords, const cmav<complex<Tpoints>,2> &points,
+      vmav<complex<Tgrid>,ndim+1> &uniform, vmav<complex<Tcalc>,ndim+1> &grid)
       {
-      timers.push("nu2u proper");
-      timers.push("allocating grid");
-      auto grid = vmav<complex<Tcalc>,ndim>::build_noncritical(nover, UNINITIALIZED);
-      timers.poppush("zeroing grid");
+      timers.push("zeroing grid");
       mav_apply([](complex<Tcalc> &v){v=complex<Tcalc>(0);},nthreads,grid);
       timers.poppush("spreading");
       constexpr size_t maxsupp = is_same<Tacc, float>::value ? 8 : 16;
       spreading_helper<maxsupp>(supp, coords, points, grid);
-      timers.poppush("FFT");
+      timers.pop();
+      grid2uni(forward, grid, uniform);
+      }
+
+    // FFT and grid correction of the oversampled grid(s); the contents of
+    // grid are destroyed
+    template<typename Tgrid> void grid2uni(bool forward,
+      vmav<complex<Tcalc>,ndim+1> &grid, vmav<complex<Tgrid>,ndim+1> &uniform)
       {
+      timers.push("FFT and grid correction");
+      {
+      // the grid correction is done while storing the results of the last
+      // FFT pass
+      // ofs = t*gs0 + iin*gs1 + jin*gs2 + kin*gs3; the divisions are
+      // skipped in the common cases of a single transform and a contiguous
+      // last dimension
+      auto map0 = uni_map(0, uniform.stride(1)), map1 = uni_map(1, uniform.stride(2)),
+           map2 = uni_map(2, uniform.stride(3));
+      const size_t gs0=size_t(grid.stride(0)), gs1=size_t(grid.stride(1)),
+                   gs2=size_t(grid.stride(2)), gs3=size_t(grid.stride(3));
+      const bool single = grid.shape(0)==1;
+      const ptrdiff_t us0 = uniform.stride(0);
+      complex<Tgrid> *uptr = uniform.data();
+      auto correct = [&](const complex<Tcalc> &v, size_t iin, ptrdiff_t ofs)
+        {
+        const auto &mi = map0[iin];
+        if (!mi.valid) return;
+        size_t rest = size_t(ofs)-iin*gs1;
+        size_t t = single ? 0 : rest/gs0;
+        rest -= t*gs0;
+        size_t jin = rest/gs2;
+        rest -= jin*gs2;
+        const auto &mj = map1[jin];
+        const auto &mk = map2[(gs3==1) ? rest : rest/gs3];
+        if (!(mj.valid && mk.valid)) return;
+        uptr[ptrdiff_t(t)*us0+mi.ofs+mj.ofs+mk.ofs]
+          = complex<Tgrid>(v*Tcalc(mi.cf*mj.cf*mk.cf));
+        };
       vfmav<complex<Tcalc>> fgrid(grid);
-      slice slz{0,(nuni[2]+1)/2}, shz{fgrid.shape(2)-nuni[2]/2,MAXIDX};
-      slice sly{0,(nuni[1]+1)/2}, shy{fgrid.shape(1)-nuni[1]/2,MAXIDX};
-      c2c(fgrid, fgrid, {2}, forward, Tcalc(1), nthreads);
-      auto fgridl=fgrid.subarray({{},{},slz});
-      c2c(fgridl, fgridl, {1}, forward, Tcalc(1), nthreads);
-      auto fgridh=fgrid.subarray({{},{},shz});
-      c2c(fgridh, fgridh, {1}, forward, Tcalc(1), nthreads);
-      auto fgridll=fgrid.subarray({{},sly,slz});
-      c2c(fgridll, fgridll, {0}, forward, Tcalc(1), nthreads);
-      auto fgridlh=fgrid.subarray({{},sly,shz});
-      c2c(fgridlh, fgridlh, {0}, forward, Tcalc(1), nthreads);
-      auto fgridhl=fgrid.subarray({{},shy,slz});
-      c2c(fgridhl, fgridhl, {0}, forward, Tcalc(1), nthreads);
-      auto fgridhh=fgrid.subarray({{},shy,shz});
-      c2c(fgridhh, fgridhh, {0}, forward, Tcalc(1), nthreads);
+      c2c_pruned(fgrid, fgrid, {3,2,1}, {},
+        {{}, uni_ranges(0), uni_ranges(1), uni_ranges(2)}, forward, Tcalc(1),
+        no_callback(), correct, nthreads);
       }
-      timers.poppush("grid correction");
-      execParallel(nuni[0], nthreads, [&](size_t lo, size_t hi)
-        {
-        for (auto i=lo; i<hi; ++i)
-          {
-          auto [icfu, iout, iin] = comp_indices(i, nuni[0], nover[0], fft_order);
-          for (size_t j=0; j<nuni[1]; ++j)
-            {
-            auto [icfv, jout, jin] = comp_indices(j, nuni[1], nover[1], fft_order);
-            for (size_t k=0; k<nuni[2]; ++k)
-              {
-              auto [icfw, kout, kin] = comp_indices(k, nuni[2], nover[2], fft_order);
-              uniform(iout,jout,kout) = complex<Tgrid>(grid(iin,jin,kin)
-                *Tcalc(corfac[0][icfu]*corfac[1][icfv]*corfac[2][icfw]));
-              }
-            }
-          }
-        });
-      timers.pop();
       timers.pop();
       }
 
     template<typename Tpoints, typename Tgrid> void uni2nonuni(bool forward,
-      const cmav<complex<Tgrid>,ndim> &uniform, const cmav<Tcoord,2> &coords,
-      vmav<complex<Tpoints>,1> &points)
+      const cmav<complex<Tgrid>,ndim+1> &uniform, const cmav<Tcoord,2> &coords,
+      vmav<complex<Tpoints>,2> &points, vmav<complex<Tcalc>,ndim+1> &grid)
       {
-      timers.push("u2nu proper");
-      timers.push("allocating grid");
-      auto grid = vmav<complex<Tcalc>,ndim>::build_noncritical(nover, UNINITIALIZED);
-      timers.poppush("zeroing grid");
+      size_t ntrans = points.shape(0);
+      timers.push("zeroing grid");
       // TODO: not all entries need to be zeroed, perhaps some time can be saved here
       mav_apply([](complex<Tcalc> &v){v=complex<Tcalc>(0);},nthreads,grid);
       timers.poppush("grid correction");
@@ -1614,47 +3021,34 @@ template<typename Tcalc, typename Tacc, typename Tcoord> class Nufft<Tcalc, Tacc
         for (auto i=lo; i<hi; ++i)
           {
           auto [icfu, iin, iout] = comp_indices(i, nuni[0], nover[0], fft_order);
-          for (size_t j=0; j<nuni[1]; ++j)
-            {
-            auto [icfv, jin, jout] = comp_indices(j, nuni[1], nover[1], fft_order);
-            for (size_t k=0; k<nuni[2]; ++k)
+          for (size_t t=0; t<ntrans; ++t)
+            for (size_t j=0; j<nuni[1]; ++j)
               {
-              auto [icfw, kin, kout] = comp_indices(k, nuni[2], nover[2], fft_order);
-              grid(iout,jout,kout) = complex<Tcalc>(uniform(iin,jin,kin))
-                *Tcalc(corfac[0][icfu]*corfac[1][icfv]*corfac[2][icfw]);
+              auto [icfv, jin, jout] = comp_indices(j, nuni[1], nover[1], fft_order);
+              for (size_t k=0; k<nuni[2]; ++k)
+                {
+                auto [icfw, kin, kout] = comp_indices(k, nuni[2], nover[2], fft_order);
+                grid(t,iout,jout,kout) = complex<Tcalc>(uniform(t,iin,jin,kin))
+                  *Tcalc(corfac[0][icfu]*corfac[1][icfv]*corfac[2][icfw]);
+                }
               }
-            }
           }
         });
       timers.poppush("FFT");
       {
       vfmav<complex<Tcalc>> fgrid(grid);
-      slice slz{0,(nuni[2]+1)/2}, shz{fgrid.shape(2)-nuni[2]/2,MAXIDX};
-      slice sly{0,(nuni[1]+1)/2}, shy{fgrid.shape(1)-nuni[1]/2,MAXIDX};
-      auto fgridll=fgrid.subarray({{},sly,slz});
-      c2c(fgridll, fgridll, {0}, forward, Tcalc(1), nthreads);
-      auto fgridlh=fgrid.subarray({{},sly,shz});
-      c2c(fgridlh, fgridlh, {0}, forward, Tcalc(1), nthreads);
-      auto fgridhl=fgrid.subarray({{},shy,slz});
-      c2c(fgridhl, fgridhl, {0}, forward, Tcalc(1), nthreads);
-      auto fgridhh=fgrid.subarray({{},shy,shz});
-      c2c(fgridhh, fgridhh, {0}, forward, Tcalc(1), nthreads);
-      auto fgridl=fgrid.subarray({{},{},slz});
-      c2c(fgridl, fgridl, {1}, forward, Tcalc(1), nthreads);
-      auto fgridh=fgrid.subarray({{},{},shz});
-      c2c(fgridh, fgridh, {1}, forward, Tcalc(1), nthreads);
-      c2c(fgrid, fgrid, {2}, forward, Tcalc(1), nthreads);
+      c2c_pruned(fgrid, fgrid, {1,2,3},
+        {{}, uni_ranges(0), uni_ranges(1), uni_ranges(2)}, {}, forward, Tcalc(1),
+        nthreads);
       }
       timers.poppush("interpolation");
       constexpr size_t maxsupp = is_same<Tcalc, float>::value ? 8 : 16;
       interpolation_helper<maxsupp>(supp, grid, coords, points);
       timers.pop();
-      timers.pop();
       }
 
-    void build_index(const cmav<Tcoord,2> &coords)
+    auto sort_key() const
       {
-      timers.push("building index");
       size_t ntiles_u = (nover[0]>>log2tile) + 3;
       size_t ntiles_v = (nover[1]>>log2tile) + 3;
       size_t ntiles_w = (nover[2]>>log2tile) + 3;
@@ -1664,28 +3058,234 @@ template<typename Tcalc, typename Tacc, typename Tcoord> class Nufft<Tcalc, Tacc
       auto ssmall = log2tile-lsq2;
       auto msmall = (size_t(1)<<ssmall) - 1;
 
-      coord_idx.resize(npoints);
-      quick_array<uint32_t> key(npoints);
-      execParallel(npoints, nthreads, [&](size_t lo, size_t hi)
+      return parent::make_sort_key((ntiles_u*ntiles_v*ntiles_w)<<(3*ssmall),
+        ntiles_u*ntiles_v*ntiles_w, 3*ssmall, ntiles_v*ntiles_w,
+        [this,ntiles_v,ntiles_w,lsq2,ssmall,msmall]
+        (const cmav<Tcoord,2> &coords, size_t i)
+        {
+        auto tile = parent::template get_tile<Tcoord>({coords(i,0),coords(i,1),coords(i,2)},lsq2);
+        auto lowkey = ((tile[0]&msmall)<<(2*ssmall))
+                    | ((tile[1]&msmall)<<   ssmall)
+                    |  (tile[2]&msmall);
+        auto hikey = ((tile[0]>>ssmall)*ntiles_v*ntiles_w)
+                   + ((tile[1]>>ssmall)*ntiles_w)
+                   +  (tile[2]>>ssmall);
+        return uint32_t((hikey<<(3*ssmall)) | lowkey);
+        });
+      }
+
+    void build_index(const cmav<Tcoord,2> &coords)
+      {
+      MR_assert(coords.shape(0)==npoints, "number of coords mismatch");
+      parent::build_index(coords, sort_key());
+      }
+  };
+
+#undef DUCC0_NUFFT_BOILERPLATE
+
+/*! Helper class for carrying out type-3 (nonuniform to nonuniform) FFTs in
+    1 to 3 dimensions, i.e. for computing
+      out_k = sum_j in_j exp(+-i s_k.x_j)
+    for arbitrary source coordinates x_j and target frequencies s_k.
+    The (centered) input values are spread onto an intermediate grid as in a
+    type-1 transform, a type-2 transform evaluates the Fourier series of this
+    grid at the rescaled target frequencies, and the result is divided by the
+    Fourier transform of the spreading kernel. Both steps use Nufft objects
+    of the same kernel family and accuracy.
+    The size of the intermediate grid is proportional to the product of the
+    extents of the source and target coordinates in every dimension.
+    Template parameters are as for Nufft.
+ */
+template<typename Tcalc, typename Tacc, typename Tcoord, size_t ndim> class Nufft3
+  {
+  private:
+    using Tplan = Nufft<Tcalc, Tacc, Tcoord, ndim>;
+    TimerHierarchy timers;
+    size_t nthreads, npoints_in, npoints_out;
+    // number of Fourier modes and size of the intermediate grid
+    array<size_t,ndim> nmodes, nf;
+    // s_c.(x_j-x_c) for every source and s_k.x_c for every target, where
+    // x_c and s_c are the centers of the source and target coordinates
+    vector<double> phase_in, phase_out;
+    // inverse Fourier transform of the spreading kernel at every target
+    vector<double> corr_out;
+    unique_ptr<Tplan> spreader, interpolator;
+
+    static void get_bounds(const cmav<Tcoord,2> &coords,
+      array<double,ndim> &center, array<double,ndim> &halfwidth)
+      {
+      for (size_t d=0; d<ndim; ++d)
+        {
+        double lo=1e300, hi=-1e300;
+        for (size_t i=0; i<coords.shape(0); ++i)
+          {
+          lo = min(lo, double(coords(i,d)));
+          hi = max(hi, double(coords(i,d)));
+          }
+        center[d] = (coords.shape(0)==0) ? 0. : 0.5*(lo+hi);
+        halfwidth[d] = (coords.shape(0)==0) ? 0. : 0.5*(hi-lo);
+        }
+      }
+
+  public:
+    /*! Prepares transforms from the sources at \a coords_in to the target
+        frequencies \a coords_out. */
+    Nufft3(const cmav<Tcoord,2> &coords_in, const cmav<Tcoord,2> &coords_out,
+      double epsilon, size_t nthreads_, double sigma_min, double sigma_max)
+      : timers("nu2nu"), nthreads(adjust_nthreads(nthreads_)),
+        npoints_in(coords_in.shape(0)), npoints_out(coords_out.shape(0)),
+        phase_in(npoints_in), phase_out(npoints_out), corr_out(npoints_out)
+      {
+      MR_assert(coords_in.shape(1)==ndim, "dimensionality mismatch");
+      MR_assert(coords_out.shape(1)==ndim, "dimensionality mismatch");
+      timers.push("parameter calculation");
+      array<double,ndim> xcen, xhw, scen, shw;
+      get_bounds(coords_in, xcen, xhw);
+      get_bounds(coords_out, scen, shw);
+      // The sources are rescaled to grid positions x/gamma, the targets to
+      // angular frequencies s*gamma (per grid cell). The kernel is accurate
+      // for frequencies up to pi*nmodes/nf, which fixes gamma; nmodes must
+      // be large enough that the rescaled sources stay away from the grid
+      // boundary by more than half the kernel support.
+      array<double,ndim> need;
+      for (size_t d=0; d<ndim; ++d)
+        {
+        if (shw[d]==0) shw[d] = (xhw[d]>0) ? 1./xhw[d] : 1.;
+        need[d] = 2*xhw[d]*shw[d]/pi;
+        nmodes[d] = max<size_t>(32, size_t(ceil(need[d])));
+        }
+      size_t kidx;
+      while (true)
+        {
+        vector<size_t> dims;
+        tie(kidx, dims) = findNufftParameters<Tcalc,Tacc>(epsilon, sigma_min,
+          sigma_max, vector<size_t>(nmodes.begin(), nmodes.end()), npoints_in,
+          true, nthreads);
+        double supp = double(getKernel(kidx).W);
+        bool ok=true;
+        for (size_t d=0; d<ndim; ++d)
+          {
+          nf[d] = dims[d];
+          double req = need[d]/max(1e-3, 1.-(supp+2)/double(nf[d]));
+          if (double(nmodes[d])<req)
+            {
+            nmodes[d] = size_t(ceil(req))+1;
+            ok = false;
+            }
+          }
+        if (ok) break;
+        }
+      array<double,ndim> gamma;
+      for (size_t d=0; d<ndim; ++d)
+        gamma[d] = pi*double(nmodes[d])/(double(nf[d])*shw[d]);
+      auto krn = selectKernel(kidx);
+
+      timers.poppush("rescaling coordinates");
+      vmav<Tcoord,2> xscaled({npoints_in, ndim}, UNINITIALIZED);
+      execParallel(npoints_in, nthreads, [&](size_t lo, size_t hi)
+        {
+        for (size_t i=lo; i<hi; ++i)
+          {
+          double ph=0;
+          for (size_t d=0; d<ndim; ++d)
+            {
+            double x = double(coords_in(i,d))-xcen[d];
+            ph += scen[d]*x;
+            xscaled(i,d) = Tcoord(x/(gamma[d]*double(nf[d])));
+            }
+          phase_in[i] = ph;
+          }
+        });
+      vmav<Tcoord,2> sscaled({npoints_out, ndim}, UNINITIALIZED);
+      execParallel(npoints_out, nthreads, [&](size_t lo, size_t hi)
         {
         for (size_t i=lo; i<hi; ++i)
           {
-          auto tile = parent::template get_tile<Tcoord>({coords(i,0),coords(i,1),coords(i,2)},lsq2);
-          auto lowkey = ((tile[0]&msmall)<<(2*ssmall))
-                      | ((tile[1]&msmall)<<   ssmall)
-                      |  (tile[2]&msmall);
-          auto hikey = ((tile[0]>>ssmall)*ntiles_v*ntiles_w)
-                     + ((tile[1]>>ssmall)*ntiles_w)
-                     +  (tile[2]>>ssmall);
-          key[i] = (hikey<<(3*ssmall)) | lowkey;
+          double ph=0, corr=1;
+          for (size_t d=0; d<ndim; ++d)
+            {
+            double s = double(coords_out(i,d));
+            ph += s*xcen[d];
+            double w = (s-scen[d])*gamma[d];
+            corr *= krn->corfunc(abs(w)/(2*pi));
+            sscaled(i,d) = Tcoord(w);
+            }
+          phase_out[i] = ph;
+          corr_out[i] = corr;
           }
         });
-      bucket_sort2(key, coord_idx, (ntiles_u*ntiles_v*ntiles_w)<<(3*ssmall), nthreads);
       timers.pop();
+      // the spreader must use the kernel selected above, whatever the cost
+      // model says by now
+      spreader = make_unique<Tplan>(true, xscaled, nmodes, epsilon, nthreads,
+        sigma_min, sigma_max, 1., false, kidx);
+      interpolator = make_unique<Tplan>(false, sscaled, nf, epsilon, nthreads,
+        sigma_min, sigma_max, 2*pi, true);
       }
-  };
 
-#undef DUCC0_NUFFT_BOILERPLATE
+    /*! Returns the dimensions of the intermediate grid. */
+    const array<size_t,ndim> &grid_shape() const { return nf; }
+
+    /*! Returns the amount of memory (in bytes) needed for storing the kernel
+        weights of sources and targets; see set_kernel_cache(). */
+    size_t kernel_cache_size() const
+      { return spreader->kernel_cache_size()+interpolator->kernel_cache_size(); }
+
+    /*! Switches storage of the kernel weights of sources and targets on or
+        off (see Nufft::set_kernel_cache()). */
+    void set_kernel_cache(bool enable)
+      {
+      spreader->set_kernel_cache(enable);
+      interpolator->set_kernel_cache(enable);
+      }
+
+    /*! Computes \a points_out(k) = sum_j points_in(j) exp(+-i s_k.x_j).
+        If \a forward is true, the exponent is negative, else positive. */
+    template<typename Tpoints> void nu2nu(bool forward, size_t verbosity,
+      const cmav<complex<Tpoints>,1> &points_in,
+      vmav<complex<Tpoints>,1> &points_out)
+      {
+      static_assert(sizeof(Tpoints)<=sizeof(Tcalc),
+        "Tcalc must be at least as accurate as Tpoints");
+      MR_assert(points_in.shape(0)==npoints_in, "number of points mismatch");
+      MR_assert(points_out.shape(0)==npoints_out, "number of points mismatch");
+      if (verbosity>0)
+        {
+        cout << "Nu2nu:" << endl << "  nthreads=" << nthreads
+             << ", npoints_in=" << npoints_in << ", npoints_out="
+             << npoints_out << ", intermediate grid=(" << nf[0];
+        for (size_t d=1; d<ndim; ++d) cout << "x" << nf[d];
+        cout << ")" << endl;
+        }
+      double sgn = forward ? -1 : 1;
+      timers.push("nu2nu proper");
+      timers.push("phase shift");
+      vmav<complex<Tcalc>,1> tmp({npoints_in}, UNINITIALIZED);
+      execParallel(npoints_in, nthreads, [&](size_t lo, size_t hi)
+        {
+        for (size_t i=lo; i<hi; ++i)
+          tmp(i) = complex<Tcalc>(points_in(i))
+                  *complex<Tcalc>(polar(1., sgn*phase_in[i]));
+        });
+      timers.poppush("allocating grid");
+      auto grid = vmav<complex<Tcalc>,ndim>::build_noncritical(nf, UNINITIALIZED);
+      timers.poppush("spreading");
+      spreader->spread(tmp, grid);
+      timers.poppush("type 2 transform");
+      vmav<complex<Tcalc>,1> tmp2({npoints_out}, UNINITIALIZED);
+      interpolator->u2nu(forward, 0, grid, tmp2);
+      timers.poppush("deconvolution");
+      execParallel(npoints_out, nthreads, [&](size_t lo, size_t hi)
+        {
+        for (size_t i=lo; i<hi; ++i)
+          points_out(i) = complex<Tpoints>(tmp2(i)
+            *complex<Tcalc>(polar(corr_out[i], sgn*phase_out[i])));
+        });
+      timers.pop();
+      timers.pop();
+      if (verbosity>0) timers.report(cout);
+      }
+  };
 
 template<typename Tcalc, typename Tacc, typename Tpoints, typename Tgrid, typename Tcoord>
   void nu2u(const cmav<Tcoord,2> &coord, const cmav<complex<Tpoints>,1> &points,
@@ -1749,12 +3349,131 @@ template<typename Tcalc, typename Tacc, typename Tpoints, typename Tgrid, typena
     nufft.u2nu(forward, verbosity, uniform2, coord, points); 
     }
   }
+template<typename Tcalc, typename Tacc, typename Tpoints, typename Tcoord>
+  void nu2nu(const cmav<Tcoord,2> &coord_in,
+    const cmav<complex<Tpoints>,1> &points_in,
+    const cmav<Tcoord,2> &coord_out, bool forward, double epsilon,
+    size_t nthreads, vmav<complex<Tpoints>,1> &points_out, size_t verbosity,
+    double sigma_min, double sigma_max)
+  {
+  auto ndim = coord_in.shape(1);
+  MR_assert((ndim>=1) && (ndim<=3), "transform must be 1D/2D/3D");
+  MR_assert(ndim==coord_out.shape(1), "dimensionality mismatch");
+  if (ndim==1)
+    {
+    Nufft3<Tcalc, Tacc, Tcoord, 1> nufft(coord_in, coord_out, epsilon,
+      nthreads, sigma_min, sigma_max);
+    nufft.nu2nu(forward, verbosity, points_in, points_out);
+    }
+  else if (ndim==2)
+    {
+    Nufft3<Tcalc, Tacc, Tcoord, 2> nufft(coord_in, coord_out, epsilon,
+      nthreads, sigma_min, sigma_max);
+    nufft.nu2nu(forward, verbosity, points_in, points_out);
+    }
+  else if (ndim==3)
+    {
+    Nufft3<Tcalc, Tacc, Tcoord, 3> nufft(coord_in, coord_out, epsilon,
+      nthreads, sigma_min, sigma_max);
+    nufft.nu2nu(forward, verbosity, points_in, points_out);
+    }
+  }
+
+/*! Measures the throughput of FFTs and of spreading on the running machine,
+    fits the coefficients of the NUFFT cost model to the results and makes
+    the fitted model the current one (see set_nufft_cost_model()).
+    The reference timings are taken on a single thread; if \a nthreads is
+    larger than 1, the maximum speedups are fitted to additional runs with
+    \a nthreads threads (scaling_power is kept fixed).
+    The benchmarks take roughly one second per thread count. If \a quick is
+    \c true, much smaller problems are measured only once; this is about
+    20 times faster, but gives a less reliable model. */
+inline NufftCostModel calibrate_nufft_cost_model(size_t nthreads,
+  bool quick=false)
+  {
+  nthreads = adjust_nthreads(nthreads);
+  auto res = get_nufft_cost_model();
+  // best of several runs, after a warm-up run which also does all planning
+  auto measure = [quick](const auto &func)
+    {
+    func();
+    double tmin=1e300;
+    for (size_t i=0; i<(quick ? 1 : 3); ++i)
+      {
+      SimpleTimer timer;
+      func();
+      tmin = min(tmin, timer());
+      }
+    return tmin;
+    };
+  // inverse of NufftCostModel::speedup() with respect to its maximum
+  auto fit_scaling = [&res](size_t nthr, double speedup)
+    {
+    double x2 = double(nthr)-1, y2 = max(speedup-1, 1e-3*x2);
+    double q = pow(x2/y2, res.scaling_power)-1;
+    return (q<=0) ? 1e6 : min(1e6, 1.+x2/pow(q, 1./res.scaling_power));
+    };
+
+  // FFT: the cost model is linear in fft_ref
+  const size_t nfft = quick ? 256 : 1024;
+  vfmav<complex<double>> arr({nfft,nfft});
+  auto time_fft = [&](size_t nthr)
+    { return measure([&]{ c2c(arr, arr, {0,1}, true, 1., nthr); }); };
+  double tfft1 = time_fft(1);
+  res.fft_ref *= tfft1/res.fft_cost(double(nfft*nfft), 1);
+  if (nthreads>1)
+    res.max_fft_scaling = fit_scaling(nthreads, tfft1/time_fft(nthreads));
+
+  // spreading of random points in 2D, using the kernel the planner selects
+  const size_t npoints = quick ? 50000 : 500000;
+  const array<size_t,2> shape = quick ? array<size_t,2>{128,128}
+                                      : array<size_t,2>{512,512};
+  constexpr double epsilon=1e-6, sigma_min=1.1, sigma_max=2.6;
+  vmav<double,2> coord({npoints,2});
+  vmav<complex<double>,1> points({npoints});
+  mt19937 rng(42);
+  uniform_real_distribution<double> dist(-pi, pi);
+  for (size_t i=0; i<npoints; ++i)
+    {
+    coord(i,0) = dist(rng);
+    coord(i,1) = dist(rng);
+    points(i) = complex<double>(dist(rng), dist(rng));
+    }
+  // returns run time per unit of spreading work
+  auto time_spread = [&](size_t nthr)
+    {
+    auto [kidx, dims] = findNufftParameters<double,double>(epsilon,
+      sigma_min, sigma_max, {shape[0], shape[1]}, npoints, true, nthr);
+    Nufft<double,double,double,2> plan(true, coord, shape, epsilon, nthr,
+      sigma_min, sigma_max, 2*pi, false, kidx);
+    vmav<complex<double>,2> grid({dims[0], dims[1]});
+    double units = nufft_grid_units(2, getKernel(kidx).W,
+      mysimd<double>::size(), npoints);
+    return measure([&]{ plan.spread(points, grid); })/units;
+    };
+  double tgrid1 = time_spread(1);
+  res.grid_ref *= tgrid1/res.grid_cost(1., 1);
+  if (nthreads>1)
+    res.max_grid_scaling = fit_scaling(nthreads, tgrid1/time_spread(nthreads));
+
+  set_nufft_cost_model(res);
+  return res;
+  }
+
 } // namespace detail_nufft
 
 // public names
 using detail_nufft::u2nu;
 using detail_nufft::nu2u;
+using detail_nufft::nu2nu;
 using detail_nufft::Nufft;
+using detail_nufft::Nufft3;
+using detail_nufft::NufftCostModel;
+using detail_nufft::get_nufft_cost_model;
+using detail_nufft::set_nufft_cost_model;
+using detail_nufft::save_nufft_cost_model;
+using detail_nufft::load_nufft_cost_model;
+using detail_nufft::calibrate_nufft_cost_model;
 
 } // namespace ducc0
 
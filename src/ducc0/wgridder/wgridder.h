@@ -493,6 +493,20 @@ template<typename Tcalc, typename Tacc, typename Tms, typename Timg> class Param
       timers.pop();
       }
 
+    // grid index ranges which can be touched by the gridding kernel
+    static vector<slice> occupied_ranges(const rangeset<int> &rs)
+      {
+      // a single empty interval means "nothing", not "everything"
+      if (rs.empty()) return {slice(0,0)};
+      vector<slice> res;
+      for (size_t i=0; i<rs.nranges(); ++i)
+        res.emplace_back(size_t(rs.ivbegin(i)), size_t(rs.ivend(i)));
+      return res;
+      }
+    // grid index ranges corresponding to the dirty image
+    static vector<slice> dirty_ranges(size_t ngrid, size_t ndirty)
+      { return {slice(0, ndirty/2), slice(ngrid-ndirty/2, MAXIDX)}; }
+
     void grid2dirty_c_overwrite_wscreen_add
       (vmav<complex<Tcalc>,2> &grid, vmav<Timg,2> &dirty, double w, size_t iplane)
       {
@@ -504,30 +518,11 @@ template<typename Tcalc, typename Tacc, typename Tms, typename Timg> class Param
       const auto &rsv(vranges[iplane]);
       auto cost_ufirst = nxdirty*log(nv)*nv + rsv.nval()*log(nu)*nu;
       auto cost_vfirst = nydirty*log(nu)*nu + rsu.nval()*log(nv)*nv;
-      if (cost_ufirst<cost_vfirst)
-        {
-        for (size_t i=0; i<rsv.nranges(); ++i)
-          {
-          auto inout_tmp = inout.subarray({{},{size_t(rsv.ivbegin(i)), size_t(rsv.ivend(i))}});
-          c2c(inout_tmp, inout_tmp, {0}, BACKWARD, Tcalc(1), nthreads);
-          }
-        auto inout_lo = inout.subarray({{0,nxdirty/2},{}});
-        c2c(inout_lo, inout_lo, {1}, BACKWARD, Tcalc(1), nthreads);
-        auto inout_hi = inout.subarray({{inout.shape(0)-nxdirty/2, MAXIDX},{}});
-        c2c(inout_hi, inout_hi, {1}, BACKWARD, Tcalc(1), nthreads);
-        }
-      else
-        {
-        for (size_t i=0; i<rsu.nranges(); ++i)
-          {
-          auto inout_tmp = inout.subarray({{size_t(rsu.ivbegin(i)), size_t(rsu.ivend(i))}, {}});
-          c2c(inout_tmp, inout_tmp, {1}, BACKWARD, Tcalc(1), nthreads);
-          }
-        auto inout_lo = inout.subarray({{}, {0,nydirty/2}});
-        c2c(inout_lo, inout_lo, {0}, BACKWARD, Tcalc(1), nthreads);
-        auto inout_hi = inout.subarray({{},{inout.shape(1)-nydirty/2, MAXIDX}});
-        c2c(inout_hi, inout_hi, {0}, BACKWARD, Tcalc(1), nthreads);
-        }
+      c2c_pruned(inout, inout,
+        (cost_ufirst<cost_vfirst) ? fmav_info::shape_t{0,1} : fmav_info::shape_t{1,0},
+        {occupied_ranges(rsu), occupied_ranges(rsv)},
+        {dirty_ranges(nu, nxdirty), dirty_ranges(nv, nydirty)},
+        BACKWARD, Tcalc(1), nthreads);
 
       timers.pop();
       grid2dirty_post2(grid, dirty, w);
@@ -630,30 +625,11 @@ template<typename Tcalc, typename Tacc, typename Tms, typename Timg> class Param
       const auto &rsv(vranges[iplane]);
       auto cost_ufirst = nydirty*log(nu)*nu + rsu.nval()*log(nv)*nv;
       auto cost_vfirst = nxdirty*log(nv)*nv + rsv.nval()*log(nu)*nu;
-      if (cost_ufirst<cost_vfirst)
-        {
-        auto inout_lo = inout.subarray({{}, {0,nydirty/2}});
-        c2c(inout_lo, inout_lo, {0}, FORWARD, Tcalc(1), nthreads);
-        auto inout_hi = inout.subarray({{},{inout.shape(1)-nydirty/2, MAXIDX}});
-        c2c(inout_hi, inout_hi, {0}, FORWARD, Tcalc(1), nthreads);
-        for (size_t i=0; i<rsu.nranges(); ++i)
-          {
-          auto inout_tmp = inout.subarray({{size_t(rsu.ivbegin(i)), size_t(rsu.ivend(i))}, {}});
-          c2c(inout_tmp, inout_tmp, {1}, FORWARD, Tcalc(1), nthreads);
-          }
-        }
-      else
-        {
-        auto inout_lo = inout.subarray({{0,nxdirty/2},{}});
-        c2c(inout_lo, inout_lo, {1}, FORWARD, Tcalc(1), nthreads);
-        auto inout_hi = inout.subarray({{inout.shape(0)-nxdirty/2, MAXIDX},{}});
-        c2c(inout_hi, inout_hi, {1}, FORWARD, Tcalc(1), nthreads);
-        for (size_t i=0; i<rsv.nranges(); ++i)
-          {
-          auto inout_tmp = inout.subarray({{},{size_t(rsv.ivbegin(i)), size_t(rsv.ivend(i))}});
-          c2c(inout_tmp, inout_tmp, {0}, FORWARD, Tcalc(1), nthreads);
-          }
-        }
+      c2c_pruned(inout, inout,
+        (cost_ufirst<cost_vfirst) ? fmav_info::shape_t{0,1} : fmav_info::shape_t{1,0},
+        {dirty_ranges(nu, nxdirty), dirty_ranges(nv, nydirty)},
+        {occupied_ranges(rsu), occupied_ranges(rsv)},
+        FORWARD, Tcalc(1), nthreads);
       timers.pop();
       }
 